@@ -1,10 +1,15 @@
 #include "agent_loop.h"
 #include "agent/context_builder.h"
+#include "agent/json_arena.h"
+#include "agent/local_cmd.h"
 #include "mimi_config.h"
 #include "bus/message_bus.h"
 #include "llm/llm_proxy.h"
 #include "memory/session_mgr.h"
 #include "tools/tool_registry.h"
+#include "trace/turn_trace.h"
+#include "trace/heap_sampler.h"
+#include "trace/dlog.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -12,6 +17,7 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "cJSON.h"
 
 static const char *TAG = "agent";
@@ -62,7 +68,8 @@ static void json_set_string(cJSON *obj, const char *key, const char *value)
     cJSON_AddStringToObject(obj, key, value);
 }
 
-static void append_turn_context_prompt(char *prompt, size_t size, const mimi_msg_t *msg)
+static void append_turn_context_prompt(char *prompt, size_t size, const mimi_msg_t *msg,
+                                       uint32_t tool_groups)
 {
     if (!prompt || size == 0 || !msg) {
         return;
@@ -78,10 +85,12 @@ static void append_turn_context_prompt(char *prompt, size_t size, const mimi_msg
         "\n## Current Turn Context\n"
         "- source_channel: %s\n"
         "- source_chat_id: %s\n"
-        "- If using cron_add for Telegram in this turn, set channel='telegram' and chat_id to source_chat_id.\n"
-        "- Never use chat_id 'cron' for Telegram messages.\n",
+        "%s",
         msg->channel[0] ? msg->channel : "(unknown)",
-        msg->chat_id[0] ? msg->chat_id : "(empty)");
+        msg->chat_id[0] ? msg->chat_id : "(empty)",
+        (tool_groups & TOOL_GROUP_CRON) ?
+            "- If using cron_add for Telegram in this turn, set channel='telegram' and chat_id to source_chat_id.\n"
+            "- Never use chat_id 'cron' for Telegram messages.\n" : "");
 
     if (n < 0 || (size_t)n >= (size - off)) {
         prompt[size - 1] = '\0';
@@ -128,7 +137,7 @@ static char *patch_tool_input_with_context(const llm_tool_call_t *call, const mi
     if (changed) {
         patched = cJSON_PrintUnformatted(root);
         if (patched) {
-            ESP_LOGI(TAG, "Patched cron_add target to %s:%s", msg->channel, msg->chat_id);
+            DLOGI(TAG, "Patched cron_add target to %s:%s", msg->channel, msg->chat_id);
         }
     }
 
@@ -152,10 +161,12 @@ static cJSON *build_tool_results(const llm_response_t *resp, const mimi_msg_t *m
 
         /* Execute tool */
         tool_output[0] = '\0';
+        int64_t t0 = esp_timer_get_time();
         tool_registry_execute(call->name, tool_input, tool_output, tool_output_size);
-        free(patched_input);
+        turn_trace_span(TRACE_TOOL, call->name, t0, esp_timer_get_time());
+        cJSON_free(patched_input);
 
-        ESP_LOGI(TAG, "Tool %s result: %d bytes", call->name, (int)strlen(tool_output));
+        DLOGI(TAG, "Tool %s result: %d bytes", call->name, (int)strlen(tool_output));
 
         /* Build tool_result block */
         cJSON *result_block = cJSON_CreateObject();
@@ -183,26 +194,41 @@ static void agent_loop_task(void *arg)
         return;
     }
 
-    const char *tools_json = tool_registry_get_tools_json();
-
     while (1) {
         mimi_msg_t msg;
         esp_err_t err = message_bus_pop_inbound(&msg, UINT32_MAX);
         if (err != ESP_OK) continue;
 
-        ESP_LOGI(TAG, "Processing message from %s:%s", msg.channel, msg.chat_id);
+        /* /clear and the like run here, in order with the chat's earlier messages */
+        if (local_cmd_dispatch_queued(&msg)) {
+            free(msg.content);
+            continue;
+        }
 
-        /* 1. Build system prompt */
-        context_build_system_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE);
-        append_turn_context_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE, &msg);
-        ESP_LOGI(TAG, "LLM turn context: channel=%s chat_id=%s", msg.channel, msg.chat_id);
+        DLOGI(TAG, "Processing message from %s:%s", msg.channel, msg.chat_id);
+        turn_trace_begin(&msg);
+        heap_sampler_sample("turn_begin");
+        json_arena_begin_turn();
 
-        /* 2. Load session history into cJSON array */
+        /* 1. Load session history into cJSON array */
+        int64_t t0 = esp_timer_get_time();
         session_get_history_json(msg.chat_id, history_json,
                                  MIMI_LLM_STREAM_BUF_SIZE, MIMI_AGENT_MAX_HISTORY);
 
         cJSON *messages = cJSON_Parse(history_json);
         if (!messages) messages = cJSON_CreateArray();
+        turn_trace_span(TRACE_SESSION_LOAD, NULL, t0, esp_timer_get_time());
+
+        /* 2. Pick this turn's tools, build system prompt listing them */
+        uint32_t tool_groups = tool_registry_select(&msg, history_json);
+        const char *tools_json = tool_registry_get_tools_json_for(tool_groups);
+
+        t0 = esp_timer_get_time();
+        context_build_system_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE, msg.content, tool_groups);
+        append_turn_context_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE, &msg, tool_groups);
+        turn_trace_span(TRACE_PROMPT_BUILD, NULL, t0, esp_timer_get_time());
+        DLOGI(TAG, "LLM turn context: channel=%s chat_id=%s tools=%d bytes",
+              msg.channel, msg.chat_id, tools_json ? (int)strlen(tools_json) : 0);
 
         /* 3. Append current user message */
         cJSON *user_msg = cJSON_CreateObject();
@@ -214,6 +240,7 @@ static void agent_loop_task(void *arg)
         char *final_text = NULL;
         int iteration = 0;
         bool sent_working_status = false;
+        bool widened = false;
 
         while (iteration < MIMI_AGENT_MAX_TOOL_ITER) {
             /* Send "working" indicator before each API call */
@@ -242,6 +269,22 @@ static void agent_loop_task(void *arg)
                 break;
             }
 
+            uint32_t missing = 0;
+            if (!resp.tool_use && !widened && resp.text) {
+                missing = tool_registry_missing_groups(resp.text, tool_groups);
+            }
+            if (missing) {
+                /* The model declined for want of a group this turn left out: retry once with it */
+                DLOGI(TAG, "Reply lacks tool groups 0x%02x, retrying with them", (unsigned)missing);
+                widened = true;
+                tool_groups |= missing;
+                tools_json = tool_registry_get_tools_json_for(tool_groups);
+                context_build_system_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE, msg.content, tool_groups);
+                append_turn_context_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE, &msg, tool_groups);
+                llm_response_free(&resp);
+                continue;
+            }
+
             if (!resp.tool_use) {
                 /* Normal completion — save final text and break */
                 if (resp.text && resp.text_len > 0) {
@@ -251,7 +294,7 @@ static void agent_loop_task(void *arg)
                 break;
             }
 
-            ESP_LOGI(TAG, "Tool use iteration %d: %d calls", iteration + 1, resp.call_count);
+            DLOGI(TAG, "Tool use iteration %d: %d calls", iteration + 1, resp.call_count);
 
             /* Append assistant message with content array */
             cJSON *asst_msg = cJSON_CreateObject();
@@ -275,15 +318,17 @@ static void agent_loop_task(void *arg)
         /* 5. Send response */
         if (final_text && final_text[0]) {
             /* Save to session (only user text + final assistant text) */
+            t0 = esp_timer_get_time();
             esp_err_t save_user = session_append(msg.chat_id, "user", msg.content);
             esp_err_t save_asst = session_append(msg.chat_id, "assistant", final_text);
+            turn_trace_span(TRACE_SESSION_SAVE, NULL, t0, esp_timer_get_time());
             if (save_user != ESP_OK || save_asst != ESP_OK) {
                 ESP_LOGW(TAG, "Session save failed for chat %s (user=%s, assistant=%s)",
                          msg.chat_id,
                          esp_err_to_name(save_user),
                          esp_err_to_name(save_asst));
             } else {
-                ESP_LOGI(TAG, "Session saved for chat %s", msg.chat_id);
+                DLOGI(TAG, "Session saved for chat %s", msg.chat_id);
             }
 
             /* Push response to outbound */
@@ -291,8 +336,9 @@ static void agent_loop_task(void *arg)
             strncpy(out.channel, msg.channel, sizeof(out.channel) - 1);
             strncpy(out.chat_id, msg.chat_id, sizeof(out.chat_id) - 1);
             out.content = final_text;  /* transfer ownership */
-            ESP_LOGI(TAG, "Queue final response to %s:%s (%d bytes)",
-                     out.channel, out.chat_id, (int)strlen(final_text));
+            out.trace_id = turn_trace_active_id();
+            DLOGI(TAG, "Queue final response to %s:%s (%d bytes)",
+                  out.channel, out.chat_id, (int)strlen(final_text));
             if (message_bus_push_outbound(&out) != ESP_OK) {
                 ESP_LOGW(TAG, "Outbound queue full, drop final response");
                 free(final_text);
@@ -306,6 +352,7 @@ static void agent_loop_task(void *arg)
             strncpy(out.channel, msg.channel, sizeof(out.channel) - 1);
             strncpy(out.chat_id, msg.chat_id, sizeof(out.chat_id) - 1);
             out.content = strdup("Sorry, I encountered an error.");
+            out.trace_id = turn_trace_active_id();
             if (out.content) {
                 if (message_bus_push_outbound(&out) != ESP_OK) {
                     ESP_LOGW(TAG, "Outbound queue full, drop error response");
@@ -314,17 +361,23 @@ static void agent_loop_task(void *arg)
             }
         }
 
+        json_arena_end_turn();
+        heap_sampler_sample("turn_end");
+        turn_trace_end(err);
+
         /* Free inbound message content */
         free(msg.content);
 
         /* Log memory status */
-        ESP_LOGI(TAG, "Free PSRAM: %d bytes",
-                 (int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+        DLOGI(TAG, "Free PSRAM: %d bytes, largest internal block: %d bytes",
+              (int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
+              (int)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
     }
 }
 
 esp_err_t agent_loop_init(void)
 {
+    ESP_ERROR_CHECK(json_arena_init());
     ESP_LOGI(TAG, "Agent loop initialized");
     return ESP_OK;
 }
@@ -1,10 +1,14 @@
 #include "context_builder.h"
 #include "mimi_config.h"
 #include "memory/memory_store.h"
+#include "memory/memory_index.h"
+#include "memory/fact_store.h"
 #include "skills/skill_loader.h"
+#include "tools/tool_registry.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include "esp_log.h"
 
 static const char *TAG = "context";
@@ -25,7 +29,7 @@ static size_t append_file(char *buf, size_t size, size_t offset, const char *pat
     return offset;
 }
 
-esp_err_t context_build_system_prompt(char *buf, size_t size)
+esp_err_t context_build_system_prompt(char *buf, size_t size, const char *query, uint32_t tool_groups)
 {
     size_t off = 0;
 
@@ -35,29 +39,30 @@ esp_err_t context_build_system_prompt(char *buf, size_t size)
         "You communicate through Telegram and WebSocket.\n\n"
         "Be helpful, accurate, and concise.\n\n"
         "## Available Tools\n"
-        "You have access to the following tools:\n"
-        "- web_search: Search the web for current information. "
-        "Use this when you need up-to-date facts, news, weather, or anything beyond your training data.\n"
-        "- get_current_time: Get the current date and time. "
-        "You do NOT have an internal clock — always use this tool when you need to know the time or date.\n"
-        "- read_file: Read a file (path must start with " MIMI_SPIFFS_BASE "/).\n"
-        "- write_file: Write/overwrite a file.\n"
-        "- edit_file: Find-and-replace edit a file.\n"
-        "- list_dir: List files, optionally filter by prefix.\n"
-        "- cron_add: Schedule a recurring or one-shot task. The message will trigger an agent turn when the job fires.\n"
-        "- cron_list: List all scheduled cron jobs.\n"
-        "- cron_remove: Remove a scheduled cron job by ID.\n\n"
-        "When using cron_add for Telegram delivery, always set channel='telegram' and a valid numeric chat_id.\n\n"
+        "You have access to the following tools:\n");
+
+    /* Same tools as the request's tool list for this turn */
+    off += tool_registry_build_prompt(tool_groups, buf + off, size - off);
+    off += snprintf(buf + off, size - off, "\n");
+    if (tool_groups & TOOL_GROUP_CRON) {
+        off += snprintf(buf + off, size - off,
+            "When using cron_add for Telegram delivery, always set channel='telegram' and a valid numeric chat_id.\n\n");
+    }
+
+    off += snprintf(buf + off, size - off,
         "Use tools when needed. Provide your final answer as text after using tools.\n\n"
         "## Memory\n"
         "You have persistent memory stored on local flash:\n"
+        "- Known facts: key/value entries managed with memory_upsert, always shown below\n"
         "- Long-term memory: " MIMI_SPIFFS_MEMORY_DIR "/MEMORY.md\n"
         "- Daily notes: " MIMI_SPIFFS_MEMORY_DIR "/daily/<YYYY-MM-DD>.md\n\n"
         "IMPORTANT: Actively use memory to remember things across conversations.\n"
-        "- When you learn something new about the user (name, preferences, habits, context), write it to MEMORY.md.\n"
+        "- When you learn a discrete fact about the user (name, preferences, habits), save it with one memory_upsert call — no need to read anything first.\n"
+        "- Use MEMORY.md for longer context that does not fit a key/value fact.\n"
         "- When something noteworthy happens in a conversation, append it to today's daily note.\n"
         "- Always read_file MEMORY.md before writing, so you can edit_file to update without losing existing content.\n"
         "- Use get_current_time to know today's date before writing daily notes.\n"
+        "- Only memory relevant to the current message is shown below; use memory_search to recall anything else.\n"
         "- Keep MEMORY.md concise and organized — summarize, don't dump raw conversation.\n"
         "- You should proactively save memory without being asked. If the user tells you their name, preferences, or important facts, persist them immediately.\n\n"
         "## Skills\n"
@@ -69,16 +74,33 @@ esp_err_t context_build_system_prompt(char *buf, size_t size)
     off = append_file(buf, size, off, MIMI_SOUL_FILE, "Personality");
     off = append_file(buf, size, off, MIMI_USER_FILE, "User Info");
 
-    /* Long-term memory */
-    char mem_buf[4096];
-    if (memory_read_long_term(mem_buf, sizeof(mem_buf)) == ESP_OK && mem_buf[0]) {
-        off += snprintf(buf + off, size - off, "\n## Long-term Memory\n\n%s\n", mem_buf);
+    /* Structured facts */
+    char *facts_buf = malloc(MIMI_FACT_PROMPT_BUDGET);
+    if (facts_buf) {
+        if (fact_store_render(facts_buf, MIMI_FACT_PROMPT_BUDGET) > 0) {
+            off += snprintf(buf + off, size - off, "\n## Known Facts\n\n%s", facts_buf);
+        }
+        free(facts_buf);
+    }
+
+    /* Memory chunks ranked against the incoming message */
+    char mem_buf[MIMI_MEMIDX_CONTEXT_BUDGET];
+    size_t mem_len = 0;
+    if (query && query[0]) {
+        mem_len = memory_index_build_context(query, mem_buf, sizeof(mem_buf), MIMI_MEMIDX_TOP_K);
+        if (mem_len > 0) {
+            off += snprintf(buf + off, size - off, "\n## Relevant Memory\n%s", mem_buf);
+        }
     }
 
-    /* Recent daily notes (last 3 days) */
-    char recent_buf[4096];
-    if (memory_read_recent(recent_buf, sizeof(recent_buf), 3) == ESP_OK && recent_buf[0]) {
-        off += snprintf(buf + off, size - off, "\n## Recent Notes\n\n%s\n", recent_buf);
+    /* Nothing matched: fall back to long-term memory and today's note */
+    if (mem_len == 0) {
+        if (memory_read_long_term(mem_buf, sizeof(mem_buf)) == ESP_OK && mem_buf[0]) {
+            off += snprintf(buf + off, size - off, "\n## Long-term Memory\n\n%s\n", mem_buf);
+        }
+        if (memory_read_recent(mem_buf, sizeof(mem_buf), 1) == ESP_OK && mem_buf[0]) {
+            off += snprintf(buf + off, size - off, "\n## Today's Notes\n\n%s\n", mem_buf);
+        }
     }
 
     /* Skills */
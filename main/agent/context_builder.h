@@ -2,13 +2,18 @@
 
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * Build the system prompt from bootstrap files (SOUL.md, USER.md)
- * and memory context (MEMORY.md + recent daily notes).
+ * and the memory chunks most relevant to the incoming message. Falls back
+ * to MEMORY.md + today's note when the index has no match. The tool list
+ * is generated from the registry for the turn's tool groups.
  *
- * @param buf   Output buffer (caller allocates, recommend MIMI_CONTEXT_BUF_SIZE)
- * @param size  Buffer size
+ * @param buf         Output buffer (caller allocates, recommend MIMI_CONTEXT_BUF_SIZE)
+ * @param size        Buffer size
+ * @param query       Text of the incoming message (may be NULL)
+ * @param tool_groups TOOL_GROUP_* mask offered this turn
  */
-esp_err_t context_build_system_prompt(char *buf, size_t size);
+esp_err_t context_build_system_prompt(char *buf, size_t size, const char *query, uint32_t tool_groups);
 
@@ -0,0 +1,136 @@
+#include "json_arena.h"
+#include "mimi_config.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+
+static const char *TAG = "json_arena";
+
+#define ARENA_ALIGN 8
+
+static uint8_t *s_base = NULL;
+static size_t s_used = 0;
+static size_t s_peak = 0;
+static void *s_last = NULL;             /* most recent block, can be rolled back */
+static TaskHandle_t s_owner = NULL;     /* task whose allocations use the arena */
+static bool s_active = false;
+static unsigned s_allocs = 0;
+static unsigned s_fallbacks = 0;
+static json_arena_stats_t s_stats;
+
+static bool arena_owns(const void *ptr)
+{
+    return s_base && (const uint8_t *)ptr >= s_base &&
+           (const uint8_t *)ptr < s_base + MIMI_JSON_ARENA_SIZE;
+}
+
+static void *arena_malloc(size_t size)
+{
+    if (!s_active || xTaskGetCurrentTaskHandle() != s_owner) {
+        return malloc(size);
+    }
+
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (aligned > MIMI_JSON_ARENA_SIZE - s_used) {
+        s_fallbacks++;
+        return malloc(size);
+    }
+
+    void *p = s_base + s_used;
+    s_used += aligned;
+    if (s_used > s_peak) s_peak = s_used;
+    s_last = p;
+    s_allocs++;
+    return p;
+}
+
+static void arena_free(void *ptr)
+{
+    if (!ptr) return;
+    if (!arena_owns(ptr)) {
+        free(ptr);
+        return;
+    }
+    /* Freeing the newest block (common for temporary print buffers) gives it back */
+    if (ptr == s_last && xTaskGetCurrentTaskHandle() == s_owner) {
+        s_used = (uint8_t *)ptr - s_base;
+        s_last = NULL;
+    }
+}
+
+esp_err_t json_arena_init(void)
+{
+    s_base = heap_caps_malloc(MIMI_JSON_ARENA_SIZE, MALLOC_CAP_SPIRAM);
+    if (!s_base) {
+        ESP_LOGW(TAG, "No PSRAM for %d byte arena, cJSON stays on the heap", MIMI_JSON_ARENA_SIZE);
+        return ESP_OK;
+    }
+    s_stats.capacity = MIMI_JSON_ARENA_SIZE;
+
+    cJSON_Hooks hooks = {
+        .malloc_fn = arena_malloc,
+        .free_fn = arena_free,
+    };
+    cJSON_InitHooks(&hooks);
+
+    ESP_LOGI(TAG, "cJSON turn arena: %d bytes in PSRAM", MIMI_JSON_ARENA_SIZE);
+    return ESP_OK;
+}
+
+void json_arena_begin_turn(void)
+{
+    if (!s_base) return;
+    s_owner = xTaskGetCurrentTaskHandle();
+    s_used = 0;
+    s_peak = 0;
+    s_last = NULL;
+    s_allocs = 0;
+    s_fallbacks = 0;
+    s_active = true;
+}
+
+void json_arena_end_turn(void)
+{
+    if (!s_base || !s_owner) return;
+    s_active = false;
+    s_owner = NULL;
+
+    s_stats.last_peak = s_peak;
+    s_stats.last_allocs = s_allocs;
+    s_stats.last_fallbacks = s_fallbacks;
+    if (s_peak > s_stats.max_peak) s_stats.max_peak = s_peak;
+    s_stats.turns++;
+
+    ESP_LOGI(TAG, "Turn arena peak %u / %u bytes (%u allocs, %u heap fallbacks, max %u)",
+             (unsigned)s_peak, (unsigned)MIMI_JSON_ARENA_SIZE,
+             s_allocs, s_fallbacks, (unsigned)s_stats.max_peak);
+    s_used = 0;
+    s_last = NULL;
+}
+
+bool json_arena_suspend(void)
+{
+    bool was_active = s_active;
+    if (xTaskGetCurrentTaskHandle() == s_owner) {
+        s_active = false;
+    }
+    return was_active;
+}
+
+void json_arena_resume(bool was_active)
+{
+    if (xTaskGetCurrentTaskHandle() == s_owner) {
+        s_active = was_active;
+    }
+}
+
+void json_arena_get_stats(json_arena_stats_t *out)
+{
+    *out = s_stats;
+}
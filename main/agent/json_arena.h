@@ -0,0 +1,56 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Per-turn bump arena for cJSON, installed with cJSON_InitHooks().
+ *
+ * Between json_arena_begin_turn() and json_arena_end_turn(), cJSON allocations
+ * made by the task that began the turn come from a PSRAM arena and free() on
+ * them is a no-op; the whole arena is reset when the turn ends. Allocations
+ * from other tasks, outside a turn, while suspended, or after the arena is
+ * full go to the normal heap.
+ */
+
+typedef struct {
+    size_t capacity;
+    size_t last_peak;           /* high-water mark of the last turn */
+    size_t max_peak;            /* highest high-water mark since boot */
+    unsigned last_allocs;       /* arena allocations in the last turn */
+    unsigned last_fallbacks;    /* arena-full allocations sent to the heap in the last turn */
+    unsigned turns;
+} json_arena_stats_t;
+
+/**
+ * Allocate the arena in PSRAM and install the cJSON hooks.
+ */
+esp_err_t json_arena_init(void);
+
+/**
+ * Start serving cJSON allocations of the calling task from the arena.
+ */
+void json_arena_begin_turn(void);
+
+/**
+ * Record the turn's high-water mark and reset the arena. Every cJSON object
+ * allocated during the turn must already be gone.
+ */
+void json_arena_end_turn(void);
+
+/**
+ * Route the caller's cJSON allocations to the heap, for objects that must
+ * outlive the turn. Returns the previous state for json_arena_resume().
+ */
+bool json_arena_suspend(void);
+
+/**
+ * Restore the state returned by json_arena_suspend().
+ */
+void json_arena_resume(bool was_active);
+
+/**
+ * Copy out arena statistics.
+ */
+void json_arena_get_stats(json_arena_stats_t *out);
@@ -0,0 +1,225 @@
+#include "agent/local_cmd.h"
+#include "mimi_config.h"
+#include "memory/session_mgr.h"
+#include "cron/cron_service.h"
+#include "storage/storage.h"
+#include "wifi/wifi_manager.h"
+#include "clock/time_sync.h"
+#include "trace/turn_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "local_cmd";
+
+typedef struct {
+    const char *channel;
+    const char *chat_id;
+    const char *args;              /* text after the command, trimmed */
+} cmd_ctx_t;
+
+typedef void (*cmd_fn_t)(const cmd_ctx_t *ctx, char *buf, size_t size);
+
+typedef struct {
+    const char *name;              /* without the leading '/' */
+    const char *help;
+    cmd_fn_t fn;
+    bool queued;                   /* changes chat state: runs behind the chat's pending turns */
+} local_cmd_t;
+
+static void cmd_help(const cmd_ctx_t *ctx, char *buf, size_t size);
+
+/* ── Commands ─────────────────────────────────────────────────── */
+
+static void cmd_start(const cmd_ctx_t *ctx, char *buf, size_t size)
+{
+    size_t off = snprintf(buf, size,
+                          "Hi, I'm MimiClaw, an AI assistant running on an ESP32-S3. "
+                          "Just write to me, or use a command:\n");
+    if (off < size) cmd_help(ctx, buf + off, size - off);
+}
+
+static void cmd_clear(const cmd_ctx_t *ctx, char *buf, size_t size)
+{
+    esp_err_t err = session_clear(ctx->chat_id);
+    if (err == ESP_OK) {
+        snprintf(buf, size, "Conversation cleared.");
+    } else if (err == ESP_ERR_NOT_FOUND) {
+        snprintf(buf, size, "Nothing to clear.");
+    } else {
+        snprintf(buf, size, "Failed to clear conversation (%s).", esp_err_to_name(err));
+    }
+}
+
+static void cmd_time(const cmd_ctx_t *ctx, char *buf, size_t size)
+{
+    if (!time_sync_is_valid()) {
+        snprintf(buf, size, "The clock is not set yet.");
+        return;
+    }
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    strftime(buf, size, "%Y-%m-%d %H:%M:%S %Z (%A)", &tm);
+}
+
+static void cmd_status(const cmd_ctx_t *ctx, char *buf, size_t size)
+{
+    int64_t up = esp_timer_get_time() / 1000000;
+    size_t total = 0, used = 0;
+    storage_info(&total, &used);
+
+    snprintf(buf, size,
+             "Uptime: %dd %02d:%02d:%02d\n"
+             "WiFi: %s\n"
+             "Heap: %u KB internal, %u KB PSRAM free\n"
+             "Storage: %u/%u KB used (%s)\n"
+             "Cron jobs: %d",
+             (int)(up / 86400), (int)(up / 3600 % 24), (int)(up / 60 % 60), (int)(up % 60),
+             wifi_manager_is_connected() ? wifi_manager_get_ip() : "disconnected",
+             (unsigned)(heap_caps_get_free_size(MALLOC_CAP_INTERNAL) / 1024),
+             (unsigned)(heap_caps_get_free_size(MALLOC_CAP_SPIRAM) / 1024),
+             (unsigned)(used / 1024), (unsigned)(total / 1024), storage_backend(),
+             cron_job_count());
+}
+
+static void cmd_cron(const cmd_ctx_t *ctx, char *buf, size_t size)
+{
+    int count = cron_job_count();
+    if (count == 0) {
+        snprintf(buf, size, "No scheduled jobs.");
+        return;
+    }
+
+    size_t off = snprintf(buf, size, "Scheduled jobs (%d):", count);
+    cron_job_t job;
+    for (int i = 0; off < size && cron_get_job(i, &job); i++) {
+        char when[24] = "-";
+        if (job.enabled && job.next_run > 0) {
+            time_t t = (time_t)job.next_run;
+            struct tm tm;
+            localtime_r(&t, &tm);
+            strftime(when, sizeof(when), "%a %m-%d %H:%M", &tm);
+        }
+
+        char sched[80];
+        if (job.kind == CRON_KIND_EVERY) {
+            snprintf(sched, sizeof(sched), "every %lus", (unsigned long)job.interval_s);
+        } else if (job.kind == CRON_KIND_CRON) {
+            snprintf(sched, sizeof(sched), "cron %s", job.expr);
+        } else {
+            snprintf(sched, sizeof(sched), "once");
+        }
+        off += snprintf(buf + off, size - off, "\n%s %s (%s), next %s",
+                        job.id, job.name, sched, when);
+    }
+}
+
+static const local_cmd_t s_cmds[] = {
+    { "start",  "Introduction and command list",   cmd_start,  false },
+    { "help",   "Show this list",                  cmd_help,   false },
+    { "clear",  "Forget this conversation",        cmd_clear,  true },
+    { "status", "Uptime, WiFi, memory and storage", cmd_status, false },
+    { "time",   "Current date and time",           cmd_time,   false },
+    { "cron",   "List scheduled jobs",             cmd_cron,   false },
+};
+
+#define CMD_COUNT (sizeof(s_cmds) / sizeof(s_cmds[0]))
+
+static void cmd_help(const cmd_ctx_t *ctx, char *buf, size_t size)
+{
+    size_t off = 0;
+    for (size_t i = 0; i < CMD_COUNT && off < size; i++) {
+        off += snprintf(buf + off, size - off, "%s/%s - %s",
+                        i ? "\n" : "", s_cmds[i].name, s_cmds[i].help);
+    }
+}
+
+/* ── Dispatch ─────────────────────────────────────────────────── */
+
+/* "/name", "/name args" or Telegram's "/name@botname args" */
+static const local_cmd_t *lookup(const char *text, const char **args)
+{
+    while (isspace((unsigned char)*text)) text++;
+    if (*text != '/') return NULL;
+    text++;
+
+    size_t n = 0;
+    while (text[n] && !isspace((unsigned char)text[n]) && text[n] != '@') n++;
+
+    const char *rest = text + n;
+    if (*rest == '@') {
+        while (*rest && !isspace((unsigned char)*rest)) rest++;
+    }
+    while (isspace((unsigned char)*rest)) rest++;
+
+    for (size_t i = 0; i < CMD_COUNT; i++) {
+        if (strlen(s_cmds[i].name) == n && strncasecmp(text, s_cmds[i].name, n) == 0) {
+            *args = rest;
+            return &s_cmds[i];
+        }
+    }
+    return NULL;
+}
+
+bool local_cmd_run(const char *channel, const char *chat_id, const char *text,
+                   char *buf, size_t size)
+{
+    if (!text || !buf || size == 0) return false;
+
+    const char *args;
+    const local_cmd_t *cmd = lookup(text, &args);
+    if (!cmd) return false;
+
+    cmd_ctx_t ctx = { .channel = channel, .chat_id = chat_id, .args = args };
+    buf[0] = '\0';
+    cmd->fn(&ctx, buf, size);
+    return true;
+}
+
+/* Answer msg if it is a command of the given kind (queued or immediate) */
+static bool dispatch(const mimi_msg_t *msg, bool queued)
+{
+    if (!msg || !msg->content || msg->content[0] == '\0') return false;
+
+    const char *args;
+    const local_cmd_t *cmd = lookup(msg->content, &args);
+    if (!cmd || cmd->queued != queued) return false;
+
+    char *reply = malloc(MIMI_LOCAL_CMD_REPLY_SIZE);
+    if (!reply) return false;
+
+    int64_t t0 = esp_timer_get_time();
+    local_cmd_run(msg->channel, msg->chat_id, msg->content, reply, MIMI_LOCAL_CMD_REPLY_SIZE);
+    int64_t t1 = esp_timer_get_time();
+    ESP_LOGI(TAG, "%s:%s %.16s handled locally in %d us", msg->channel, msg->chat_id,
+             msg->content, (int)(t1 - t0));
+
+    mimi_msg_t out = {0};
+    strncpy(out.channel, msg->channel, sizeof(out.channel) - 1);
+    strncpy(out.chat_id, msg->chat_id, sizeof(out.chat_id) - 1);
+    out.content = reply;
+    out.trace_id = turn_trace_record(msg, TRACE_LOCAL_CMD, cmd->name, t0, t1);
+    if (message_bus_push_outbound(&out) != ESP_OK) {
+        ESP_LOGW(TAG, "Outbound queue full, drop command reply");
+        free(reply);
+    }
+    return true;
+}
+
+bool local_cmd_dispatch(const mimi_msg_t *msg)
+{
+    return dispatch(msg, false);
+}
+
+bool local_cmd_dispatch_queued(const mimi_msg_t *msg)
+{
+    return dispatch(msg, true);
+}
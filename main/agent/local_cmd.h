@@ -0,0 +1,36 @@
+#pragma once
+
+#include "bus/message_bus.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Fast-path slash commands answered on the device without an LLM call:
+ * /start, /help, /clear, /status, /time and /cron. Telegram and WebSocket
+ * try them before pushing to the inbound queue, so read-only commands are
+ * answered even while an agent turn is running. Commands that change chat
+ * state (/clear) go through the inbound queue like a message and are run by
+ * the agent task, so they never overtake a turn queued before them. Unknown
+ * "/..." text goes to the agent.
+ */
+
+/**
+ * Handle msg locally if it is a known read-only command. The reply is
+ * queued on the outbound bus for msg's channel/chat_id.
+ * @return true if handled (msg was not consumed; the caller still owns it)
+ */
+bool local_cmd_dispatch(const mimi_msg_t *msg);
+
+/**
+ * Handle msg if it is a state-changing command taken off the inbound queue
+ * (agent task). The reply is queued like local_cmd_dispatch's.
+ * @return true if handled (the caller still owns msg)
+ */
+bool local_cmd_dispatch_queued(const mimi_msg_t *msg);
+
+/**
+ * Run a command and write its reply into buf (for the serial CLI).
+ * @return true if text was a known command
+ */
+bool local_cmd_run(const char *channel, const char *chat_id, const char *text,
+                   char *buf, size_t size);
@@ -1,6 +1,7 @@
 #include "message_bus.h"
 #include "mimi_config.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <string.h>
 
 static const char *TAG = "bus";
@@ -24,7 +25,9 @@ esp_err_t message_bus_init(void)
 
 esp_err_t message_bus_push_inbound(const mimi_msg_t *msg)
 {
-    if (xQueueSend(s_inbound_queue, msg, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    mimi_msg_t stamped = *msg;
+    stamped.queued_us = esp_timer_get_time();
+    if (xQueueSend(s_inbound_queue, &stamped, pdMS_TO_TICKS(1000)) != pdTRUE) {
         ESP_LOGW(TAG, "Inbound queue full, dropping message");
         return ESP_ERR_NO_MEM;
     }
@@ -42,7 +45,9 @@ esp_err_t message_bus_pop_inbound(mimi_msg_t *msg, uint32_t timeout_ms)
 
 esp_err_t message_bus_push_outbound(const mimi_msg_t *msg)
 {
-    if (xQueueSend(s_outbound_queue, msg, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    mimi_msg_t stamped = *msg;
+    stamped.queued_us = esp_timer_get_time();
+    if (xQueueSend(s_outbound_queue, &stamped, pdMS_TO_TICKS(1000)) != pdTRUE) {
         ESP_LOGW(TAG, "Outbound queue full, dropping message");
         return ESP_ERR_NO_MEM;
     }
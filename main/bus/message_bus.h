@@ -10,11 +10,19 @@
 #define MIMI_CHAN_CLI        "cli"
 #define MIMI_CHAN_SYSTEM     "system"
 
+/* Who started a turn; scheduled turns cannot ask a follow-up question */
+#define MIMI_ORIGIN_USER       0
+#define MIMI_ORIGIN_CRON       1
+#define MIMI_ORIGIN_HEARTBEAT  2
+
 /* Message types on the bus */
 typedef struct {
     char channel[16];       /* "telegram", "websocket", "cli" */
     char chat_id[32];       /* Telegram chat_id or WS client id */
     char *content;          /* Heap-allocated message text (caller must free) */
+    int64_t queued_us;      /* Set by the bus on push (esp_timer_get_time) */
+    uint8_t origin;         /* MIMI_ORIGIN_* (0 = user) */
+    uint32_t trace_id;      /* Outbound: turn trace the reply is timed into (0 = none) */
 } mimi_msg_t;
 
 /**
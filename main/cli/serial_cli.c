@@ -1,21 +1,35 @@
 #include "serial_cli.h"
 #include "mimi_config.h"
+#include "agent/local_cmd.h"
 #include "wifi/wifi_manager.h"
 #include "telegram/telegram_bot.h"
 #include "llm/llm_proxy.h"
 #include "memory/memory_store.h"
 #include "memory/session_mgr.h"
+#include "memory/memory_index.h"
+#include "memory/fact_store.h"
 #include "proxy/http_proxy.h"
 #include "tools/tool_registry.h"
+#include "tools/tool_manifest.h"
 #include "tools/tool_web_search.h"
+#include "tools/search_cache.h"
 #include "cron/cron_service.h"
+#include "clock/time_sync.h"
 #include "heartbeat/heartbeat.h"
 #include "skills/skill_loader.h"
+#include "trace/turn_trace.h"
+#include "trace/heap_sampler.h"
+#include "trace/task_monitor.h"
+#include "trace/dlog.h"
+#include "agent/json_arena.h"
+#include "storage/storage.h"
+#include "storage/write_behind.h"
+#include "storage/fs_catalog.h"
+#include "storage/lzfile.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
-#include <dirent.h>
 #include "esp_log.h"
 #include "esp_console.h"
 #include "esp_system.h"
@@ -126,6 +140,91 @@ static int cmd_set_model_provider(int argc, char **argv)
     return 0;
 }
 
+/* --- set_llm_url command --- */
+static struct {
+    struct arg_str *url;
+    struct arg_end *end;
+} llm_url_args;
+
+static int cmd_set_llm_url(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&llm_url_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, llm_url_args.end, argv[0]);
+        return 1;
+    }
+    if (llm_set_url(llm_url_args.url->sval[0]) != ESP_OK) {
+        printf("Invalid URL. Expected http[s]://host[:port][/path]\n");
+        return 1;
+    }
+    printf("Local LLM URL set.\n");
+    return 0;
+}
+
+/* --- set_llm_fallback command --- */
+static struct {
+    struct arg_int *slot;
+    struct arg_str *provider;
+    struct arg_str *model;
+    struct arg_str *api_key;
+    struct arg_end *end;
+} fallback_args;
+
+static int cmd_set_llm_fallback(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&fallback_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, fallback_args.end, argv[0]);
+        return 1;
+    }
+    const char *key = fallback_args.api_key->count ? fallback_args.api_key->sval[0] : "";
+    if (llm_set_fallback(fallback_args.slot->ival[0], fallback_args.provider->sval[0],
+                         fallback_args.model->sval[0], key) != ESP_OK) {
+        printf("Invalid slot (1..%d).\n", MIMI_LLM_MAX_ENDPOINTS - 1);
+        return 1;
+    }
+    printf("Fallback %d set.\n", fallback_args.slot->ival[0]);
+    return 0;
+}
+
+/* --- clear_llm_fallback command --- */
+static int cmd_clear_llm_fallback(int argc, char **argv)
+{
+    llm_clear_fallbacks();
+    printf("Fallbacks cleared.\n");
+    return 0;
+}
+
+/* --- set_llm_hedge command --- */
+static struct {
+    struct arg_int *ms;
+    struct arg_end *end;
+} hedge_args;
+
+static int cmd_set_llm_hedge(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&hedge_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, hedge_args.end, argv[0]);
+        return 1;
+    }
+    int ms = hedge_args.ms->ival[0];
+    if (ms < 0) {
+        printf("Hedge threshold must be >= 0.\n");
+        return 1;
+    }
+    llm_set_hedge_ms((uint32_t)ms);
+    printf("Hedge threshold set.\n");
+    return 0;
+}
+
+/* --- llm_status command --- */
+static int cmd_llm_status(int argc, char **argv)
+{
+    llm_print_endpoints();
+    return 0;
+}
+
 /* --- memory_read command --- */
 static int cmd_memory_read(int argc, char **argv)
 {
@@ -161,6 +260,102 @@ static int cmd_memory_write(int argc, char **argv)
     return 0;
 }
 
+/* --- memory_search command --- */
+static struct {
+    struct arg_str *query;
+    struct arg_end *end;
+} memory_search_args;
+
+static int cmd_memory_search(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&memory_search_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, memory_search_args.end, argv[0]);
+        return 1;
+    }
+
+    memidx_hit_t hits[5];
+    int n = memory_index_search(memory_search_args.query->sval[0], hits, 5);
+    if (n == 0) {
+        printf("No matches.\n");
+        return 0;
+    }
+    char snippet[MIMI_MEMIDX_CHUNK_BYTES + 1];
+    for (int i = 0; i < n; i++) {
+        memory_index_read_hit(&hits[i], snippet, sizeof(snippet));
+        printf("[%d] %s @%u  score=%.2f\n%s\n\n", i + 1, hits[i].path,
+               (unsigned)hits[i].offset, hits[i].score, snippet);
+    }
+    return 0;
+}
+
+/* --- memory_index command --- */
+static struct {
+    struct arg_lit *rebuild;
+    struct arg_end *end;
+} memory_index_args;
+
+static int cmd_memory_index(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&memory_index_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, memory_index_args.end, argv[0]);
+        return 1;
+    }
+    if (memory_index_args.rebuild->count) {
+        memory_index_rebuild();
+    }
+    memory_index_print_stats();
+    return 0;
+}
+
+/* --- facts command --- */
+static int cmd_facts(int argc, char **argv)
+{
+    char *buf = malloc(8192);
+    if (!buf) {
+        printf("Out of memory.\n");
+        return 1;
+    }
+    int n = fact_store_list(NULL, NULL, buf, 8192);
+    printf("%d / %d facts\n%s", n, MIMI_FACT_MAX, buf);
+    free(buf);
+    return 0;
+}
+
+/* --- fs_info / fs_bench commands --- */
+static int cmd_fs_info(int argc, char **argv)
+{
+    size_t total = 0, used = 0;
+    if (storage_info(&total, &used) != ESP_OK) {
+        printf("Storage not mounted.\n");
+        return 1;
+    }
+    printf("%s at %s: %u / %u bytes used (%u%%)\n", storage_backend(), MIMI_SPIFFS_BASE,
+           (unsigned)used, (unsigned)total, total ? (unsigned)(used * 100 / total) : 0);
+    fs_catalog_print_stats();
+    return 0;
+}
+
+static int cmd_fs_sync(int argc, char **argv)
+{
+    esp_err_t err = write_behind_sync_all();
+    write_behind_print_stats();
+    return err == ESP_OK ? 0 : 1;
+}
+
+static int cmd_fs_compress(int argc, char **argv)
+{
+    lzfile_sweep_now();
+    lzfile_print_stats();
+    return 0;
+}
+
+static int cmd_fs_bench(int argc, char **argv)
+{
+    return storage_bench() == ESP_OK ? 0 : 1;
+}
+
 /* --- session_list command --- */
 static int cmd_session_list(int argc, char **argv)
 {
@@ -199,6 +394,60 @@ static int cmd_heap_info(int argc, char **argv)
            (int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
     printf("Total free:    %d bytes\n",
            (int)esp_get_free_heap_size());
+
+    json_arena_stats_t arena;
+    json_arena_get_stats(&arena);
+    if (arena.capacity) {
+        printf("JSON arena:    last turn %u / %u bytes (%u allocs, %u heap fallbacks), max %u over %u turns\n",
+               (unsigned)arena.last_peak, (unsigned)arena.capacity,
+               arena.last_allocs, arena.last_fallbacks,
+               (unsigned)arena.max_peak, arena.turns);
+    }
+    return 0;
+}
+
+/* --- heap_trend command --- */
+static struct {
+    struct arg_int *count;
+    struct arg_end *end;
+} heap_trend_args;
+
+static int cmd_heap_trend(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&heap_trend_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, heap_trend_args.end, argv[0]);
+        return 1;
+    }
+    int count = heap_trend_args.count->count ? heap_trend_args.count->ival[0] : 20;
+    if (count <= 0) count = 1;
+    heap_sampler_print(count);
+    return 0;
+}
+
+/* --- top command --- */
+static int cmd_top(int argc, char **argv)
+{
+    task_monitor_print();
+    return 0;
+}
+
+/* --- trace command --- */
+static struct {
+    struct arg_int *count;
+    struct arg_end *end;
+} trace_args;
+
+static int cmd_trace(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&trace_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, trace_args.end, argv[0]);
+        return 1;
+    }
+    int count = trace_args.count->count ? trace_args.count->ival[0] : 3;
+    if (count <= 0) count = 1;
+    turn_trace_print(count);
     return 0;
 }
 
@@ -257,6 +506,48 @@ static int cmd_set_search_key(int argc, char **argv)
     return 0;
 }
 
+/* --- search_cache command --- */
+static struct {
+    struct arg_lit *clear;
+    struct arg_end *end;
+} search_cache_args;
+
+static int cmd_search_cache(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&search_cache_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, search_cache_args.end, argv[0]);
+        return 1;
+    }
+    if (search_cache_args.clear->count) {
+        search_cache_clear();
+        printf("Search cache cleared.\n");
+    }
+    search_cache_print_stats();
+    return 0;
+}
+
+/* --- tools command --- */
+static struct {
+    struct arg_lit *reload;
+    struct arg_end *end;
+} tools_args;
+
+static int cmd_tools(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&tools_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, tools_args.end, argv[0]);
+        return 1;
+    }
+    if (tools_args.reload->count) {
+        int n = tool_manifest_reload();
+        printf("Loaded %d manifest tools from " MIMI_TOOL_MANIFEST_PREFIX ".\n", n);
+    }
+    tool_registry_print();
+    return 0;
+}
+
 /* --- wifi_scan command --- */
 static int cmd_wifi_scan(int argc, char **argv)
 {
@@ -366,6 +657,36 @@ static bool contains_nocase(const char *text, const char *keyword)
     return false;
 }
 
+/* Print the first line of a skill file that mentions keyword */
+static bool skill_search_file(const char *full_path, const char *name, const char *keyword)
+{
+    bool file_matched = contains_nocase(name, keyword);
+    int matched_line = 0;
+
+    FILE *f = fopen(full_path, "r");
+    if (!f) return false;
+
+    char line[256];
+    int line_no = 0;
+    while (!file_matched && fgets(line, sizeof(line), f)) {
+        line_no++;
+        if (contains_nocase(line, keyword)) {
+            file_matched = true;
+            matched_line = line_no;
+        }
+    }
+    fclose(f);
+
+    if (file_matched) {
+        if (matched_line > 0) {
+            printf("- %s (matched at line %d)\n", full_path, matched_line);
+        } else {
+            printf("- %s (matched in filename)\n", full_path);
+        }
+    }
+    return file_matched;
+}
+
 static int cmd_skill_search(int argc, char **argv)
 {
     int nerrors = arg_parse(argc, argv, (void **)&skill_search_args);
@@ -375,56 +696,24 @@ static int cmd_skill_search(int argc, char **argv)
     }
 
     const char *keyword = skill_search_args.keyword->sval[0];
-    DIR *dir = opendir(MIMI_SPIFFS_BASE);
-    if (!dir) {
-        printf("Cannot open " MIMI_SPIFFS_BASE ".\n");
-        return 1;
-    }
-
-    const char *prefix = "skills/";
-    const size_t prefix_len = strlen(prefix);
     int matches = 0;
 
-    struct dirent *ent;
-    while ((ent = readdir(dir)) != NULL) {
-        const char *name = ent->d_name;
-        size_t name_len = strlen(name);
-
-        if (strncmp(name, prefix, prefix_len) != 0) continue;
-        if (name_len < prefix_len + 4) continue;
-        if (strcmp(name + name_len - 3, ".md") != 0) continue;
-
-        char full_path[296];
-        snprintf(full_path, sizeof(full_path), MIMI_SPIFFS_BASE "/%s", name);
+    fs_entry_t ents[8];
+    int skip = 0, n;
+    while ((n = fs_catalog_query(MIMI_SKILLS_PREFIX, skip, ents, 8)) > 0) {
+        skip += n;
+        for (int i = 0; i < n; i++) {
+            const char *name = ents[i].path + strlen(MIMI_SKILLS_PREFIX);
+            size_t name_len = strlen(name);
 
-        bool file_matched = contains_nocase(name, keyword);
-        int matched_line = 0;
+            if (strchr(name, '/')) continue;
+            if (name_len < 4) continue;
+            if (strcmp(name + name_len - 3, ".md") != 0) continue;
 
-        FILE *f = fopen(full_path, "r");
-        if (!f) continue;
-
-        char line[256];
-        int line_no = 0;
-        while (!file_matched && fgets(line, sizeof(line), f)) {
-            line_no++;
-            if (contains_nocase(line, keyword)) {
-                file_matched = true;
-                matched_line = line_no;
-            }
-        }
-        fclose(f);
-
-        if (file_matched) {
-            matches++;
-            if (matched_line > 0) {
-                printf("- %s (matched at line %d)\n", full_path, matched_line);
-            } else {
-                printf("- %s (matched in filename)\n", full_path);
-            }
+            if (skill_search_file(ents[i].path, name, keyword)) matches++;
         }
     }
 
-    closedir(dir);
     if (matches == 0) {
         printf("No skills matched keyword: %s\n", keyword);
     } else {
@@ -437,7 +726,7 @@ static int cmd_skill_search(int argc, char **argv)
 static void print_config(const char *label, const char *ns, const char *key,
                          const char *build_val, bool mask)
 {
-    char nvs_val[128] = {0};
+    char nvs_val[192] = {0};
     const char *source = "not set";
     const char *display = "(empty)";
 
@@ -474,6 +763,8 @@ static int cmd_config_show(int argc, char **argv)
     print_config("API Key",    MIMI_NVS_LLM,    MIMI_NVS_KEY_API_KEY,  MIMI_SECRET_API_KEY,    true);
     print_config("Model",      MIMI_NVS_LLM,    MIMI_NVS_KEY_MODEL,    MIMI_SECRET_MODEL,      false);
     print_config("Provider",   MIMI_NVS_LLM,    MIMI_NVS_KEY_PROVIDER, MIMI_SECRET_MODEL_PROVIDER, false);
+    print_config("Local URL",  MIMI_NVS_LLM,    MIMI_NVS_KEY_LLM_URL,  MIMI_SECRET_LLM_URL,    false);
+    print_config("Fallback 1", MIMI_NVS_LLM,    "fb1_model",           MIMI_SECRET_FALLBACK_MODEL, false);
     print_config("Proxy Host", MIMI_NVS_PROXY,  MIMI_NVS_KEY_PROXY_HOST, MIMI_SECRET_PROXY_HOST, false);
     print_config("Proxy Port", MIMI_NVS_PROXY,  MIMI_NVS_KEY_PROXY_PORT, MIMI_SECRET_PROXY_PORT, false);
     print_config("Search Key", MIMI_NVS_SEARCH, MIMI_NVS_KEY_API_KEY,  MIMI_SECRET_SEARCH_KEY, true);
@@ -508,6 +799,7 @@ static int cmd_heartbeat_trigger(int argc, char **argv)
     } else {
         printf("Heartbeat: no actionable tasks found.\n");
     }
+    heartbeat_print_stats();
     return 0;
 }
 
@@ -524,6 +816,63 @@ static int cmd_cron_start(int argc, char **argv)
     return 1;
 }
 
+/* --- cmd command (local slash commands) --- */
+static struct {
+    struct arg_str *text;
+    struct arg_end *end;
+} local_cmd_args;
+
+static int cmd_local_cmd(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&local_cmd_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, local_cmd_args.end, argv[0]);
+        return 1;
+    }
+
+    char *reply = malloc(MIMI_LOCAL_CMD_REPLY_SIZE);
+    if (!reply) {
+        printf("Out of memory.\n");
+        return 1;
+    }
+    if (local_cmd_run(MIMI_CHAN_CLI, "cli", local_cmd_args.text->sval[0],
+                      reply, MIMI_LOCAL_CMD_REPLY_SIZE)) {
+        printf("%s\n", reply);
+    } else {
+        printf("Unknown command. Try: cmd /help\n");
+    }
+    free(reply);
+    return 0;
+}
+
+/* --- cron_status command --- */
+static int cmd_cron_status(int argc, char **argv)
+{
+    cron_print_status();
+    return 0;
+}
+
+/* --- time_sync command --- */
+static struct {
+    struct arg_lit *fetch;
+    struct arg_end *end;
+} time_sync_args;
+
+static int cmd_time_sync(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&time_sync_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, time_sync_args.end, argv[0]);
+        return 1;
+    }
+    if (time_sync_args.fetch->count) {
+        esp_err_t err = time_sync_http_now();
+        printf("HTTP time fetch: %s\n", esp_err_to_name(err));
+    }
+    time_sync_print_status();
+    return 0;
+}
+
 static int cmd_tool_exec(int argc, char **argv)
 {
     if (argc < 2) {
@@ -551,6 +900,9 @@ static int cmd_tool_exec(int argc, char **argv)
 static int cmd_restart(int argc, char **argv)
 {
     printf("Restarting...\n");
+    write_behind_sync_all();
+    search_cache_sync();
+    dlog_flush();
     esp_restart();
     return 0;  /* unreachable */
 }
@@ -642,7 +994,7 @@ esp_err_t serial_cli_init(void)
     esp_console_cmd_register(&model_cmd);
 
     /* set_model_provider */
-    provider_args.provider = arg_str1(NULL, NULL, "<provider>", "Model provider (anthropic|openai)");
+    provider_args.provider = arg_str1(NULL, NULL, "<provider>", "Model provider (anthropic|openai|local)");
     provider_args.end = arg_end(1);
     esp_console_cmd_t provider_cmd = {
         .command = "set_model_provider",
@@ -652,6 +1004,58 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&provider_cmd);
 
+    /* set_llm_url */
+    llm_url_args.url = arg_str1(NULL, NULL, "<url>", "http[s]://host[:port][/path]");
+    llm_url_args.end = arg_end(1);
+    esp_console_cmd_t llm_url_cmd = {
+        .command = "set_llm_url",
+        .help = "Set OpenAI-compatible server for provider 'local' (e.g. set_llm_url http://192.168.1.50:8080/v1)",
+        .func = &cmd_set_llm_url,
+        .argtable = &llm_url_args,
+    };
+    esp_console_cmd_register(&llm_url_cmd);
+
+    /* set_llm_fallback */
+    fallback_args.slot = arg_int1(NULL, NULL, "<slot>", "Fallback slot (1..2)");
+    fallback_args.provider = arg_str1(NULL, NULL, "<provider>", "Model provider (anthropic|openai|local)");
+    fallback_args.model = arg_str1(NULL, NULL, "<model>", "Model identifier");
+    fallback_args.api_key = arg_str0(NULL, NULL, "<api_key>", "API key (default: primary key)");
+    fallback_args.end = arg_end(4);
+    esp_console_cmd_t fallback_cmd = {
+        .command = "set_llm_fallback",
+        .help = "Set fallback LLM endpoint (e.g. set_llm_fallback 1 openai gpt-4o sk-...)",
+        .func = &cmd_set_llm_fallback,
+        .argtable = &fallback_args,
+    };
+    esp_console_cmd_register(&fallback_cmd);
+
+    /* clear_llm_fallback */
+    esp_console_cmd_t clear_fallback_cmd = {
+        .command = "clear_llm_fallback",
+        .help = "Remove all fallback LLM endpoints",
+        .func = &cmd_clear_llm_fallback,
+    };
+    esp_console_cmd_register(&clear_fallback_cmd);
+
+    /* set_llm_hedge */
+    hedge_args.ms = arg_int1(NULL, NULL, "<ms>", "Hedge after this many ms (0 = off)");
+    hedge_args.end = arg_end(1);
+    esp_console_cmd_t hedge_cmd = {
+        .command = "set_llm_hedge",
+        .help = "Send a hedged request to a fallback if no response within <ms>",
+        .func = &cmd_set_llm_hedge,
+        .argtable = &hedge_args,
+    };
+    esp_console_cmd_register(&hedge_cmd);
+
+    /* llm_status */
+    esp_console_cmd_t llm_status_cmd = {
+        .command = "llm_status",
+        .help = "Show LLM endpoints, circuit breaker state and counters",
+        .func = &cmd_llm_status,
+    };
+    esp_console_cmd_register(&llm_status_cmd);
+
     /* skill_list */
     esp_console_cmd_t skill_list_cmd = {
         .command = "skill_list",
@@ -701,6 +1105,68 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&mem_write_cmd);
 
+    /* memory_search */
+    memory_search_args.query = arg_str1(NULL, NULL, "<query>", "Search terms (quote multiple words)");
+    memory_search_args.end = arg_end(1);
+    esp_console_cmd_t mem_search_cmd = {
+        .command = "memory_search",
+        .help = "BM25 search over MEMORY.md and daily notes",
+        .func = &cmd_memory_search,
+        .argtable = &memory_search_args,
+    };
+    esp_console_cmd_register(&mem_search_cmd);
+
+    /* memory_index */
+    memory_index_args.rebuild = arg_lit0("r", "rebuild", "Re-index all memory files");
+    memory_index_args.end = arg_end(1);
+    esp_console_cmd_t mem_index_cmd = {
+        .command = "memory_index",
+        .help = "Show memory index stats, -r to rebuild",
+        .func = &cmd_memory_index,
+        .argtable = &memory_index_args,
+    };
+    esp_console_cmd_register(&mem_index_cmd);
+
+    /* facts */
+    esp_console_cmd_t facts_cmd = {
+        .command = "facts",
+        .help = "List structured facts (memory_upsert store)",
+        .func = &cmd_facts,
+    };
+    esp_console_cmd_register(&facts_cmd);
+
+    /* fs_info */
+    esp_console_cmd_t fs_info_cmd = {
+        .command = "fs_info",
+        .help = "Show filesystem backend and usage",
+        .func = &cmd_fs_info,
+    };
+    esp_console_cmd_register(&fs_info_cmd);
+
+    /* fs_sync */
+    esp_console_cmd_t fs_sync_cmd = {
+        .command = "fs_sync",
+        .help = "Flush buffered session/note appends and show write-behind stats",
+        .func = &cmd_fs_sync,
+    };
+    esp_console_cmd_register(&fs_sync_cmd);
+
+    /* fs_compress */
+    esp_console_cmd_t fs_compress_cmd = {
+        .command = "fs_compress",
+        .help = "Compress old daily notes and session heads now, show stats",
+        .func = &cmd_fs_compress,
+    };
+    esp_console_cmd_register(&fs_compress_cmd);
+
+    /* fs_bench */
+    esp_console_cmd_t fs_bench_cmd = {
+        .command = "fs_bench",
+        .help = "Benchmark append/read/list latency at 10/50/90% fill",
+        .func = &cmd_fs_bench,
+    };
+    esp_console_cmd_register(&fs_bench_cmd);
+
     /* session_list */
     esp_console_cmd_t sess_list_cmd = {
         .command = "session_list",
@@ -728,6 +1194,36 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&heap_cmd);
 
+    /* heap_trend */
+    heap_trend_args.count = arg_int0(NULL, NULL, "<n>", "Number of samples (default: 20)");
+    heap_trend_args.end = arg_end(1);
+    esp_console_cmd_t heap_trend_cmd = {
+        .command = "heap_trend",
+        .help = "Show heap free/largest-block/min-ever samples and allocation failures",
+        .func = &cmd_heap_trend,
+        .argtable = &heap_trend_args,
+    };
+    esp_console_cmd_register(&heap_trend_cmd);
+
+    /* top */
+    esp_console_cmd_t top_cmd = {
+        .command = "top",
+        .help = "Show per-task CPU %, core, priority and stack headroom",
+        .func = &cmd_top,
+    };
+    esp_console_cmd_register(&top_cmd);
+
+    /* trace */
+    trace_args.count = arg_int0(NULL, NULL, "<n>", "Number of turns (default: 3)");
+    trace_args.end = arg_end(1);
+    esp_console_cmd_t trace_cmd = {
+        .command = "trace",
+        .help = "Show per-stage timing of the last <n> agent turns",
+        .func = &cmd_trace,
+        .argtable = &trace_args,
+    };
+    esp_console_cmd_register(&trace_cmd);
+
     /* set_search_key */
     search_key_args.key = arg_str1(NULL, NULL, "<key>", "Brave Search API key");
     search_key_args.end = arg_end(1);
@@ -739,6 +1235,28 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&search_key_cmd);
 
+    /* search_cache */
+    search_cache_args.clear = arg_lit0("c", "clear", "Drop all cached results");
+    search_cache_args.end = arg_end(1);
+    esp_console_cmd_t search_cache_cmd = {
+        .command = "search_cache",
+        .help = "Show web search cache hit rate and saved latency, -c to clear",
+        .func = &cmd_search_cache,
+        .argtable = &search_cache_args,
+    };
+    esp_console_cmd_register(&search_cache_cmd);
+
+    /* tools */
+    tools_args.reload = arg_lit0("r", "reload", "Re-read the tool manifests first");
+    tools_args.end = arg_end(1);
+    esp_console_cmd_t tools_cmd = {
+        .command = "tools",
+        .help = "List registered tools, -r to reload " MIMI_TOOL_MANIFEST_PREFIX "*.json",
+        .func = &cmd_tools,
+        .argtable = &tools_args,
+    };
+    esp_console_cmd_register(&tools_cmd);
+
     /* set_proxy */
     proxy_args.host = arg_str1(NULL, NULL, "<host>", "Proxy host/IP");
     proxy_args.port = arg_int1(NULL, NULL, "<port>", "Proxy port");
@@ -784,6 +1302,36 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&heartbeat_cmd);
 
+    /* cmd */
+    local_cmd_args.text = arg_str1(NULL, NULL, "<command>", "Slash command, e.g. /status (quote if it has arguments)");
+    local_cmd_args.end = arg_end(1);
+    esp_console_cmd_t local_cmd_cmd = {
+        .command = "cmd",
+        .help = "Run a fast-path chat command (/status, /time, /cron, /help ...) locally",
+        .func = &cmd_local_cmd,
+        .argtable = &local_cmd_args,
+    };
+    esp_console_cmd_register(&local_cmd_cmd);
+
+    /* cron_status */
+    esp_console_cmd_t cron_status_cmd = {
+        .command = "cron_status",
+        .help = "Show cron jobs, next run times and scheduler wakeups",
+        .func = &cmd_cron_status,
+    };
+    esp_console_cmd_register(&cron_status_cmd);
+
+    /* time_sync */
+    time_sync_args.fetch = arg_lit0("f", "fetch", "Sync from the HTTP Date header now");
+    time_sync_args.end = arg_end(1);
+    esp_console_cmd_t time_sync_cmd = {
+        .command = "time_sync",
+        .help = "Show clock source, last sync and drift, -f to sync over HTTP now",
+        .func = &cmd_time_sync,
+        .argtable = &time_sync_args,
+    };
+    esp_console_cmd_register(&time_sync_cmd);
+
     /* cron_start */
     esp_console_cmd_t cron_start_cmd = {
         .command = "cron_start",
@@ -0,0 +1,367 @@
+#include "clock/time_sync.h"
+#include "mimi_config.h"
+#include "proxy/http_proxy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_sntp.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+
+static const char *TAG = "time_sync";
+
+#define TIME_VALID_BIT       BIT0
+#define DRIFT_MIN_SPAN_US    ((int64_t)10 * 60 * 1000000)  /* shorter gaps are too noisy */
+
+static EventGroupHandle_t s_events = NULL;
+static SemaphoreHandle_t s_http_lock = NULL;
+static TaskHandle_t s_task = NULL;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static time_sync_status_t s_status;
+static int64_t s_last_epoch_us = 0;    /* server time at the last sync */
+static int64_t s_last_sntp_us = 0;     /* esp_timer time of the last SNTP answer */
+
+static const char *const SRC_NAMES[] = { "none", "rtc", "sntp", "http" };
+
+static const char *MONTHS[] = {
+    "Jan","Feb","Mar","Apr","May","Jun",
+    "Jul","Aug","Sep","Oct","Nov","Dec"
+};
+
+static int64_t clock_now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* ── Sync bookkeeping ─────────────────────────────────────────── */
+
+/*
+ * Between syncs the clock runs free on the crystal. Comparing a new server
+ * time with the previous one carried forward by esp_timer gives how far the
+ * clock wandered over that span; SNTP-to-SNTP pairs turn that into ppm.
+ */
+static void record_sync(time_src_t src, int64_t epoch_us)
+{
+    int64_t mono = esp_timer_get_time();
+    int64_t local = clock_now_us();
+
+    portENTER_CRITICAL(&s_lock);
+    int64_t span = mono - s_status.last_sync_us;
+    int64_t predicted = s_status.last_sync_us ? s_last_epoch_us + span : local;
+    int64_t adjust = epoch_us - predicted;
+
+    if (src == TIME_SRC_SNTP && s_status.source == TIME_SRC_SNTP &&
+        s_status.last_sync_us && span >= DRIFT_MIN_SPAN_US) {
+        s_status.drift_ppm = (int32_t)(adjust * 1000000 / span);
+    }
+    s_status.source = src;
+    s_status.last_sync_us = mono;
+    s_status.last_adjust_ms = adjust / 1000;
+    s_last_epoch_us = epoch_us;
+    if (src == TIME_SRC_SNTP) {
+        s_status.sntp_syncs++;
+        s_last_sntp_us = mono;
+    } else {
+        s_status.http_syncs++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (s_events) xEventGroupSetBits(s_events, TIME_VALID_BIT);
+    ESP_LOGI(TAG, "Clock synced via %s (adjust %+lld ms)", SRC_NAMES[src], (long long)(adjust / 1000));
+}
+
+/* Runs in the lwIP task: keep it short */
+static void on_sntp_sync(struct timeval *tv)
+{
+    record_sync(TIME_SRC_SNTP, (int64_t)tv->tv_sec * 1000000 + tv->tv_usec);
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+/* ── HTTP Date fallback ───────────────────────────────────────── */
+
+/* Unix time for a UTC calendar date (month 1-12) */
+static time_t utc_to_epoch(int y, int m, int d, int hh, int mm, int ss)
+{
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long days = (long)era * 146097 + doe - 719468;
+    return (time_t)days * 86400 + hh * 3600 + mm * 60 + ss;
+}
+
+/* Parse "Sat, 01 Feb 2025 10:25:00 GMT" without touching TZ (other tasks use localtime) */
+static bool parse_http_date(const char *date_str, time_t *out)
+{
+    int day, year, hour, min, sec;
+    char mon_str[4] = {0};
+
+    if (sscanf(date_str, "%*[^,], %d %3s %d %d:%d:%d",
+               &day, mon_str, &year, &hour, &min, &sec) != 6) {
+        return false;
+    }
+
+    int mon = -1;
+    for (int i = 0; i < 12; i++) {
+        if (strcmp(mon_str, MONTHS[i]) == 0) { mon = i; break; }
+    }
+    if (mon < 0) return false;
+
+    time_t t = utc_to_epoch(year, mon + 1, day, hour, min, sec);
+    if (t < 0) return false;
+    *out = t;
+    return true;
+}
+
+/* HEAD request through the proxy, parse the Date header */
+static esp_err_t fetch_date_via_proxy(time_t *out)
+{
+    proxy_conn_t *conn = proxy_conn_open(MIMI_TIME_HTTP_HOST, 443, 10000);
+    if (!conn) return ESP_ERR_HTTP_CONNECT;
+
+    const char *req =
+        "HEAD / HTTP/1.1\r\n"
+        "Host: " MIMI_TIME_HTTP_HOST "\r\n"
+        "Connection: close\r\n\r\n";
+
+    if (proxy_conn_write(conn, req, strlen(req)) < 0) {
+        proxy_conn_close(conn);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+
+    char buf[1024];
+    int total = 0;
+    buf[0] = '\0';
+    while (total < (int)sizeof(buf) - 1) {
+        int n = proxy_conn_read(conn, buf + total, sizeof(buf) - 1 - total, 10000);
+        if (n <= 0) break;
+        total += n;
+        buf[total] = '\0';
+        if (strstr(buf, "\r\n\r\n")) break;
+    }
+    proxy_conn_close(conn);
+
+    /* Find Date header */
+    char *date_hdr = strcasestr(buf, "\r\nDate: ");
+    if (!date_hdr) return ESP_ERR_NOT_FOUND;
+    date_hdr += 8;
+
+    char *eol = strstr(date_hdr, "\r\n");
+    if (!eol) return ESP_ERR_NOT_FOUND;
+
+    char date_val[64];
+    size_t dlen = eol - date_hdr;
+    if (dlen >= sizeof(date_val)) return ESP_ERR_NOT_FOUND;
+    memcpy(date_val, date_hdr, dlen);
+    date_val[dlen] = '\0';
+
+    return parse_http_date(date_val, out) ? ESP_OK : ESP_FAIL;
+}
+
+typedef struct {
+    char date_val[64];
+} time_header_ctx_t;
+
+/**
+ * HTTP event handler that captures the "Date" response header.
+ *
+ * esp_http_client_get_header() only accesses request headers, so response
+ * headers must be captured here during HTTP_EVENT_ON_HEADER events.
+ */
+static esp_err_t time_http_event_handler(esp_http_client_event_t *evt)
+{
+    time_header_ctx_t *ctx = evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        if (strcasecmp(evt->header_key, "Date") == 0 && ctx) {
+            strncpy(ctx->date_val, evt->header_value, sizeof(ctx->date_val) - 1);
+            ctx->date_val[sizeof(ctx->date_val) - 1] = '\0';
+        }
+    }
+    return ESP_OK;
+}
+
+/* HEAD request over direct HTTPS */
+static esp_err_t fetch_date_direct(time_t *out)
+{
+    time_header_ctx_t ctx = {0};
+
+    esp_http_client_config_t config = {
+        .url = "https://" MIMI_TIME_HTTP_HOST "/",
+        .method = HTTP_METHOD_HEAD,
+        .timeout_ms = 10000,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .event_handler = time_http_event_handler,
+        .user_data = &ctx,
+    };
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return ESP_FAIL;
+
+    esp_err_t err = esp_http_client_perform(client);
+    esp_http_client_cleanup(client);
+
+    if (err != ESP_OK) return err;
+    if (ctx.date_val[0] == '\0') return ESP_ERR_NOT_FOUND;
+
+    return parse_http_date(ctx.date_val, out) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t time_sync_http_now(void)
+{
+    if (!s_http_lock) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_http_lock, portMAX_DELAY);
+
+    time_t t = 0;
+    esp_err_t err = http_proxy_is_enabled() ? fetch_date_via_proxy(&t) : fetch_date_direct(&t);
+    if (err == ESP_OK) {
+        /* The header has whole seconds: the true time is up to 1 s later */
+        int64_t epoch_us = (int64_t)t * 1000000 + 500000;
+        int64_t off = epoch_us - clock_now_us();
+        bool was_valid = time_sync_is_valid();
+
+        record_sync(TIME_SRC_HTTP, epoch_us);
+
+        /* Within the header's resolution: leave a finer clock alone */
+        if (!was_valid || llabs(off) > 1000000) {
+            struct timeval tv = { .tv_sec = epoch_us / 1000000, .tv_usec = epoch_us % 1000000 };
+            settimeofday(&tv, NULL);
+        }
+    } else {
+        portENTER_CRITICAL(&s_lock);
+        s_status.http_failures++;
+        portEXIT_CRITICAL(&s_lock);
+        ESP_LOGW(TAG, "HTTP time fetch failed: %s", esp_err_to_name(err));
+    }
+
+    xSemaphoreGive(s_http_lock);
+    return err;
+}
+
+/* ── Fallback task ────────────────────────────────────────────── */
+
+static void time_sync_task(void *arg)
+{
+    uint32_t retry_ms = MIMI_TIME_RETRY_MS;
+
+    /* Give SNTP the first chance; its callback wakes us early */
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MIMI_TIME_SNTP_WAIT_MS));
+
+    while (1) {
+        portENTER_CRITICAL(&s_lock);
+        int64_t last_sntp = s_last_sntp_us;
+        portEXIT_CRITICAL(&s_lock);
+
+        bool sntp_alive = last_sntp &&
+            esp_timer_get_time() - last_sntp < (int64_t)MIMI_TIME_SYNC_INTERVAL_MS * 2 * 1000;
+
+        uint32_t sleep_ms = MIMI_TIME_SYNC_INTERVAL_MS;
+        if (!sntp_alive) {
+            if (time_sync_http_now() == ESP_OK) {
+                retry_ms = MIMI_TIME_RETRY_MS;
+            } else {
+                sleep_ms = retry_ms;
+                retry_ms = retry_ms * 2 < MIMI_TIME_SYNC_INTERVAL_MS ? retry_ms * 2
+                                                                     : MIMI_TIME_SYNC_INTERVAL_MS;
+            }
+        }
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleep_ms));
+    }
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t time_sync_start(void)
+{
+    if (s_task) return ESP_OK;
+
+    s_events = xEventGroupCreate();
+    s_http_lock = xSemaphoreCreateMutex();
+    if (!s_events || !s_http_lock) return ESP_ERR_NO_MEM;
+
+    if (time_sync_is_valid()) {
+        s_status.source = TIME_SRC_RTC;
+        xEventGroupSetBits(s_events, TIME_VALID_BIT);
+    }
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        time_sync_task, "time_sync",
+        MIMI_TIME_SYNC_STACK, NULL,
+        MIMI_TIME_SYNC_PRIO, &s_task, MIMI_TIME_SYNC_CORE);
+    if (ok != pdPASS) return ESP_FAIL;
+
+    esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+    esp_sntp_setservername(0, MIMI_SNTP_SERVER_1);
+    esp_sntp_setservername(1, MIMI_SNTP_SERVER_2);
+    /* Slew small corrections so timestamps never step backwards; large
+     * errors (first sync) are still set at once */
+    sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
+    sntp_set_sync_interval(MIMI_TIME_SYNC_INTERVAL_MS);
+    sntp_set_time_sync_notification_cb(on_sntp_sync);
+    esp_sntp_init();
+
+    ESP_LOGI(TAG, "Time sync started (SNTP %s, HTTP fallback %s)",
+             MIMI_SNTP_SERVER_1, MIMI_TIME_HTTP_HOST);
+    return ESP_OK;
+}
+
+bool time_sync_is_valid(void)
+{
+    return time(NULL) >= MIMI_TIME_VALID_AFTER;
+}
+
+esp_err_t time_sync_wait(uint32_t timeout_ms)
+{
+    if (time_sync_is_valid()) return ESP_OK;
+    if (!s_events) return ESP_ERR_INVALID_STATE;
+
+    EventBits_t bits = xEventGroupWaitBits(s_events, TIME_VALID_BIT, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    return (bits & TIME_VALID_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void time_sync_get_status(time_sync_status_t *out)
+{
+    if (!out) return;
+    portENTER_CRITICAL(&s_lock);
+    *out = s_status;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void time_sync_print_status(void)
+{
+    time_sync_status_t st;
+    time_sync_get_status(&st);
+
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    char when[48];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S %Z", &tm);
+
+    printf("Clock: %s%s\n", when, time_sync_is_valid() ? "" : " (not set)");
+    if (st.last_sync_us) {
+        int64_t ago = (esp_timer_get_time() - st.last_sync_us) / 1000000;
+        printf("Source: %s, last sync %lld s ago, adjusted %+lld ms\n",
+               SRC_NAMES[st.source], (long long)ago, (long long)st.last_adjust_ms);
+    } else {
+        printf("Source: %s, never synced\n", SRC_NAMES[st.source]);
+    }
+    printf("Drift: %+d ppm (%+.2f s/day)\n", (int)st.drift_ppm, st.drift_ppm * 86400.0 / 1e6);
+    printf("Syncs: sntp %u, http %u (%u failed)\n",
+           (unsigned)st.sntp_syncs, (unsigned)st.http_syncs, (unsigned)st.http_failures);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * System clock discipline.
+ *
+ * SNTP (MIMI_SNTP_SERVER_1/2, smooth adjustment, polled every
+ * MIMI_TIME_SYNC_INTERVAL_MS) keeps the clock set. If SNTP has not answered
+ * within MIMI_TIME_SNTP_WAIT_MS of start, or goes quiet for two intervals
+ * (UDP blocked, proxy-only network), the Date header of an HTTPS HEAD to
+ * MIMI_TIME_HTTP_HOST is used instead, through the proxy when one is set.
+ * Each sync records how far the clock had wandered since the previous one,
+ * giving a drift estimate in ppm.
+ *
+ * The clock survives a software restart, so it counts as valid from boot
+ * whenever it reads later than MIMI_TIME_VALID_AFTER.
+ */
+
+typedef enum {
+    TIME_SRC_NONE = 0,
+    TIME_SRC_RTC,              /* kept across a restart, not synced yet */
+    TIME_SRC_SNTP,
+    TIME_SRC_HTTP,
+} time_src_t;
+
+typedef struct {
+    time_src_t source;         /* of the last sync */
+    int64_t last_sync_us;      /* esp_timer time of the last sync, 0 = never */
+    int64_t last_adjust_ms;    /* server minus local clock at the last sync */
+    int32_t drift_ppm;         /* positive: local clock runs slow */
+    uint32_t sntp_syncs;
+    uint32_t http_syncs;
+    uint32_t http_failures;
+} time_sync_status_t;
+
+/**
+ * Start SNTP and the fallback task. Call once the network is up.
+ */
+esp_err_t time_sync_start(void);
+
+/**
+ * True if the system clock holds a real date.
+ */
+bool time_sync_is_valid(void);
+
+/**
+ * Block until the clock is valid or timeout_ms passes.
+ * @return ESP_OK if valid, ESP_ERR_TIMEOUT otherwise
+ */
+esp_err_t time_sync_wait(uint32_t timeout_ms);
+
+/**
+ * Sync from the HTTP Date header now (blocking, one TLS round trip).
+ */
+esp_err_t time_sync_http_now(void);
+
+/**
+ * Copy the current sync state.
+ */
+void time_sync_get_status(time_sync_status_t *out);
+
+/**
+ * Print the clock, its source, last adjustment and drift.
+ */
+void time_sync_print_status(void);
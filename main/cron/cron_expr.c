@@ -0,0 +1,212 @@
+#include "cron/cron_expr.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define CRON_SEARCH_SPAN  ((time_t)5 * 366 * 24 * 3600)
+#define ALL_HOURS         0x00ffffffu
+
+static const char *const MONTH_NAMES[] = {
+    "jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec", NULL
+};
+static const char *const WDAY_NAMES[] = {
+    "sun", "mon", "tue", "wed", "thu", "fri", "sat", NULL
+};
+
+static const struct {
+    const char *alias;
+    const char *expr;
+} ALIASES[] = {
+    { "@hourly",   "0 * * * *" },
+    { "@daily",    "0 0 * * *" },
+    { "@midnight", "0 0 * * *" },
+    { "@weekly",   "0 0 * * 0" },
+    { "@monthly",  "0 0 1 * *" },
+    { "@yearly",   "0 0 1 1 *" },
+    { "@annually", "0 0 1 1 *" },
+};
+
+/* ── Parsing ──────────────────────────────────────────────────── */
+
+/* Number or three-letter name; names[0] maps to `base` */
+static const char *parse_value(const char *p, const char *const *names, int base, int *out)
+{
+    if (isdigit((unsigned char)*p)) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (v > 99) return NULL;
+        *out = (int)v;
+        return end;
+    }
+    if (!names) return NULL;
+    for (int i = 0; names[i]; i++) {
+        if (strncasecmp(p, names[i], 3) == 0 && !isalpha((unsigned char)p[3])) {
+            *out = base + i;
+            return p + 3;
+        }
+    }
+    return NULL;
+}
+
+/* One comma-separated field into a bit set over [lo, hi] */
+static bool parse_field(const char *p, int lo, int hi, const char *const *names, int name_base,
+                        uint64_t *bits, bool *any)
+{
+    *bits = 0;
+    *any = (*p == '*');
+
+    while (1) {
+        int a, b, step = 1;
+        if (*p == '*') {
+            a = lo;
+            b = hi;
+            p++;
+        } else {
+            p = parse_value(p, names, name_base, &a);
+            if (!p) return false;
+            b = a;
+            if (*p == '-') {
+                p = parse_value(p + 1, names, name_base, &b);
+                if (!p) return false;
+            }
+        }
+        if (*p == '/') {
+            char *end;
+            long s = strtol(p + 1, &end, 10);
+            if (end == p + 1 || s <= 0 || s > hi) return false;
+            step = (int)s;
+            p = end;
+            /* "5/15" means 5-hi/15 */
+            if (a == b) b = hi;
+        }
+        if (a < lo || b > hi || a > b) return false;
+
+        for (int v = a; v <= b; v += step) {
+            *bits |= (uint64_t)1 << v;
+        }
+
+        if (*p == '\0') return true;
+        if (*p != ',') return false;
+        p++;
+    }
+}
+
+bool cron_expr_parse(const char *text, cron_expr_t *out)
+{
+    if (!text || !out) return false;
+    while (isspace((unsigned char)*text)) text++;
+
+    for (size_t i = 0; i < sizeof(ALIASES) / sizeof(ALIASES[0]); i++) {
+        size_t n = strlen(ALIASES[i].alias);
+        if (strncasecmp(text, ALIASES[i].alias, n) == 0 &&
+            (text[n] == '\0' || isspace((unsigned char)text[n]))) {
+            text = ALIASES[i].expr;
+            break;
+        }
+    }
+
+    /* Split into exactly five fields */
+    char buf[128];
+    strncpy(buf, text, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *fields[5];
+    int n = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, " \t\r\n", &save); tok; tok = strtok_r(NULL, " \t\r\n", &save)) {
+        if (n == 5) return false;
+        fields[n++] = tok;
+    }
+    if (n != 5) return false;
+
+    cron_expr_t e;
+    memset(&e, 0, sizeof(e));
+    uint64_t bits;
+    bool any;
+
+    if (!parse_field(fields[0], 0, 59, NULL, 0, &bits, &any)) return false;
+    e.minutes = bits;
+    if (!parse_field(fields[1], 0, 23, NULL, 0, &bits, &any)) return false;
+    e.hours = (uint32_t)bits;
+    if (!parse_field(fields[2], 1, 31, NULL, 0, &bits, &e.mday_any)) return false;
+    e.mdays = (uint32_t)bits;
+    if (!parse_field(fields[3], 1, 12, MONTH_NAMES, 1, &bits, &any)) return false;
+    e.months = (uint16_t)bits;
+    if (!parse_field(fields[4], 0, 7, WDAY_NAMES, 0, &bits, &e.wday_any)) return false;
+    if (bits & (1u << 7)) bits |= 1;        /* 7 is Sunday too */
+    e.wdays = (uint8_t)(bits & 0x7f);
+
+    *out = e;
+    return true;
+}
+
+/* ── Evaluation ───────────────────────────────────────────────── */
+
+static bool day_matches(const cron_expr_t *e, const struct tm *tm)
+{
+    bool mday = e->mdays & (1u << tm->tm_mday);
+    bool wday = e->wdays & (1u << tm->tm_wday);
+    /* Vixie semantics: two restricted day fields are OR-ed */
+    if (e->mday_any || e->wday_any) return mday && wday;
+    return mday || wday;
+}
+
+/* Local midnight of the day after tm (or the first of the next month) */
+static time_t next_day(struct tm *tm, bool next_month, time_t cur)
+{
+    if (next_month) {
+        tm->tm_mon++;
+        tm->tm_mday = 1;
+    } else {
+        tm->tm_mday++;
+    }
+    tm->tm_hour = 0;
+    tm->tm_min = 0;
+    tm->tm_sec = 0;
+    tm->tm_isdst = -1;
+    time_t t = mktime(tm);
+    return t > cur ? t : cur + 60;
+}
+
+time_t cron_expr_next(const cron_expr_t *e, time_t after)
+{
+    if (!e || after < 0) return 0;
+
+    struct tm prev;
+    localtime_r(&after, &prev);
+
+    time_t t = (after / 60 + 1) * 60;
+    time_t limit = after + CRON_SEARCH_SPAN;
+    struct tm tm;
+
+    while (t <= limit) {
+        localtime_r(&t, &tm);
+
+        if (!(e->months & (1u << (tm.tm_mon + 1)))) {
+            t = next_day(&tm, true, t);
+            continue;
+        }
+        if (!day_matches(e, &tm)) {
+            t = next_day(&tm, false, t);
+            continue;
+        }
+        if (!(e->hours & (1u << tm.tm_hour))) {
+            t += (60 - tm.tm_min) * 60 - tm.tm_sec;
+            continue;
+        }
+        if (!(e->minutes & ((uint64_t)1 << tm.tm_min))) {
+            t += 60 - tm.tm_sec;
+            continue;
+        }
+        /* A fixed-hour job does not fire again in an hour repeated by DST */
+        if (e->hours != ALL_HOURS && tm.tm_year == prev.tm_year && tm.tm_yday == prev.tm_yday &&
+            tm.tm_hour == prev.tm_hour && tm.tm_min == prev.tm_min) {
+            t += 60;
+            continue;
+        }
+        return t;
+    }
+    return 0;
+}
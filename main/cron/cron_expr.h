@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Standard 5-field cron expressions: "minute hour day-of-month month day-of-week".
+ *
+ * Each field takes '*', numbers, ranges "a-b", lists "a,b" and steps "a-b/n"
+ * ('*' followed by "/15" steps over the full range); months and weekdays
+ * also take names (JAN, MON). Day of week is 0-7 with both 0 and 7 meaning
+ * Sunday. As in Vixie cron, when both day fields are restricted a day
+ * matches if either does. "@hourly", "@daily", "@weekly", "@monthly" and
+ * "@yearly" are accepted as shorthands.
+ *
+ * Evaluation uses local time (TZ, set from MIMI_TIMEZONE at boot). A wall-clock
+ * time skipped by a DST change does not fire that day; a time repeated by one
+ * fires once.
+ */
+
+typedef struct {
+    uint64_t minutes;      /* bit n = minute n (0-59) */
+    uint32_t hours;        /* bit n = hour n (0-23) */
+    uint32_t mdays;        /* bit n = day n (1-31) */
+    uint16_t months;       /* bit n = month n (1-12) */
+    uint8_t  wdays;        /* bit n = weekday n (0-6, Sunday = 0) */
+    bool     mday_any;     /* day-of-month field was '*' */
+    bool     wday_any;     /* day-of-week field was '*' */
+} cron_expr_t;
+
+/**
+ * Parse an expression.
+ * @return false on a syntax or range error
+ */
+bool cron_expr_parse(const char *text, cron_expr_t *out);
+
+/**
+ * First matching minute strictly after `after`.
+ * @return 0 if the expression never matches in the next five years
+ *         (e.g. "0 0 30 2 *")
+ */
+time_t cron_expr_next(const cron_expr_t *e, time_t after);
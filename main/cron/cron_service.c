@@ -1,26 +1,106 @@
 #include "cron/cron_service.h"
 #include "mimi_config.h"
 #include "bus/message_bus.h"
+#include "storage/fs_catalog.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_random.h"
+#include "esp_heap_caps.h"
 #include "cJSON.h"
 
 static const char *TAG = "cron";
 
 #define MAX_CRON_JOBS  MIMI_CRON_MAX_JOBS
 
-static cron_job_t s_jobs[MAX_CRON_JOBS];
+/* Job table in PSRAM, grown by doubling up to MAX_CRON_JOBS */
+static cron_job_t *s_jobs = NULL;
 static int s_job_count = 0;
+static int s_job_cap = 0;
 static TaskHandle_t s_cron_task = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+
+/* Min-heap of indices into s_jobs for enabled jobs with a next_run, earliest first */
+static int *s_heap = NULL;
+static int s_heap_len = 0;
+
+/* Jobs whose run state changed since the last state write */
+static uint8_t *s_dirty = NULL;
+
+/*
+ * Run state lives in MIMI_CRON_STATE_FILE as one fixed record per job, in
+ * s_jobs order, so a firing rewrites 32 bytes in place instead of the whole
+ * definitions file. The definitions (cron.json) change only on add/remove.
+ */
+typedef struct __attribute__((packed)) {
+    char id[8];
+    int64_t last_run;
+    int64_t next_run;
+    uint8_t enabled;
+    uint8_t reserved[7];
+} cron_state_rec_t;
+
+_Static_assert(sizeof(cron_state_rec_t) == 32, "cron state record size");
+
+static uint32_t s_wakeups = 0;
+static uint32_t s_fired = 0;
+static uint32_t s_turns = 0;
+static int64_t s_max_late_ms = 0;
+static uint32_t s_def_writes = 0;
+static uint32_t s_state_writes = 0;
 
 static esp_err_t cron_save_jobs(void);
+static esp_err_t cron_state_save_all(void);
+
+static const char *cron_kind_name(cron_kind_t kind)
+{
+    switch (kind) {
+    case CRON_KIND_EVERY: return "every";
+    case CRON_KIND_CRON:  return "cron";
+    default:              return "at";
+    }
+}
+
+static int64_t now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* Make room for `need` jobs */
+static esp_err_t cron_reserve(int need)
+{
+    if (need <= s_job_cap) return ESP_OK;
+    if (need > MAX_CRON_JOBS) return ESP_ERR_NO_MEM;
+
+    int cap = s_job_cap ? s_job_cap : MIMI_CRON_INIT_JOBS;
+    while (cap < need) cap *= 2;
+    if (cap > MAX_CRON_JOBS) cap = MAX_CRON_JOBS;
+
+    cron_job_t *jobs = heap_caps_realloc(s_jobs, cap * sizeof(cron_job_t), MALLOC_CAP_SPIRAM);
+    if (!jobs) return ESP_ERR_NO_MEM;
+    s_jobs = jobs;
+
+    int *heap = heap_caps_realloc(s_heap, cap * sizeof(int), MALLOC_CAP_SPIRAM);
+    if (!heap) return ESP_ERR_NO_MEM;
+    s_heap = heap;
+
+    uint8_t *dirty = heap_caps_realloc(s_dirty, cap, MALLOC_CAP_SPIRAM);
+    if (!dirty) return ESP_ERR_NO_MEM;
+    memset(dirty + s_job_cap, 0, cap - s_job_cap);
+    s_dirty = dirty;
+
+    s_job_cap = cap;
+    return ESP_OK;
+}
 
 static bool cron_sanitize_destination(cron_job_t *job)
 {
@@ -58,6 +138,96 @@ static void cron_generate_id(char *id_buf)
     snprintf(id_buf, 9, "%08x", (unsigned int)r);
 }
 
+/* ── Run state ── */
+
+static void cron_state_pack(const cron_job_t *job, cron_state_rec_t *rec)
+{
+    memset(rec, 0, sizeof(*rec));
+    memcpy(rec->id, job->id, sizeof(rec->id));
+    rec->last_run = job->last_run;
+    rec->next_run = job->next_run;
+    rec->enabled = job->enabled;
+}
+
+static esp_err_t cron_state_save_all(void)
+{
+    FILE *f = fopen(MIMI_CRON_STATE_FILE, "wb");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to open %s for writing", MIMI_CRON_STATE_FILE);
+        return ESP_FAIL;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < s_job_count && ok; i++) {
+        cron_state_rec_t rec;
+        cron_state_pack(&s_jobs[i], &rec);
+        ok = fwrite(&rec, sizeof(rec), 1, f) == 1;
+        s_dirty[i] = 0;
+    }
+    fclose(f);
+    fs_catalog_update(MIMI_CRON_STATE_FILE);
+    s_state_writes++;
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+/* Write the records of dirty jobs in place */
+static esp_err_t cron_state_flush(void)
+{
+    FILE *f = NULL;
+    esp_err_t err = ESP_OK;
+
+    for (int i = 0; i < s_job_count; i++) {
+        if (!s_dirty[i]) continue;
+        if (!f) {
+            f = fopen(MIMI_CRON_STATE_FILE, "r+b");
+            if (!f) return cron_state_save_all();
+        }
+        cron_state_rec_t rec;
+        cron_state_pack(&s_jobs[i], &rec);
+        if (fseek(f, (long)i * sizeof(rec), SEEK_SET) != 0 || fwrite(&rec, sizeof(rec), 1, f) != 1) {
+            err = ESP_FAIL;
+            break;
+        }
+        s_dirty[i] = 0;
+    }
+
+    if (f) {
+        fclose(f);
+        fs_catalog_update(MIMI_CRON_STATE_FILE);
+        s_state_writes++;
+    }
+    return err;
+}
+
+/*
+ * Apply saved run state to the loaded jobs. Records are in job order, but
+ * are matched by id so a stale file never moves state between jobs.
+ * Returns false if the file is missing or out of step (caller rewrites it).
+ */
+static bool cron_state_load(void)
+{
+    FILE *f = fopen(MIMI_CRON_STATE_FILE, "rb");
+    if (!f) return false;
+
+    int matched = 0;
+    cron_state_rec_t rec;
+    for (int slot = 0; fread(&rec, sizeof(rec), 1, f) == 1; slot++) {
+        int i = slot;
+        if (i >= s_job_count || memcmp(s_jobs[i].id, rec.id, sizeof(rec.id)) != 0) {
+            for (i = 0; i < s_job_count; i++) {
+                if (memcmp(s_jobs[i].id, rec.id, sizeof(rec.id)) == 0) break;
+            }
+            if (i == s_job_count) continue;
+        }
+        s_jobs[i].last_run = rec.last_run;
+        s_jobs[i].next_run = rec.next_run;
+        s_jobs[i].enabled = rec.enabled;
+        if (i == slot) matched++;
+    }
+    fclose(f);
+    return matched == s_job_count;
+}
+
 static esp_err_t cron_load_jobs(void)
 {
     FILE *f = fopen(MIMI_CRON_FILE, "r");
@@ -72,14 +242,14 @@ static esp_err_t cron_load_jobs(void)
     long fsize = ftell(f);
     fseek(f, 0, SEEK_SET);
 
-    if (fsize <= 0 || fsize > 8192) {
+    if (fsize <= 0) {
         ESP_LOGW(TAG, "Cron file invalid size: %ld", fsize);
         fclose(f);
         s_job_count = 0;
         return ESP_OK;
     }
 
-    char *buf = malloc(fsize + 1);
+    char *buf = heap_caps_malloc(fsize + 1, MALLOC_CAP_SPIRAM);
     if (!buf) {
         fclose(f);
         return ESP_ERR_NO_MEM;
@@ -107,10 +277,16 @@ static esp_err_t cron_load_jobs(void)
     }
 
     s_job_count = 0;
+    int want = cJSON_GetArraySize(jobs_arr);
+    if (cron_reserve(want < MAX_CRON_JOBS ? want : MAX_CRON_JOBS) != ESP_OK) {
+        cJSON_Delete(root);
+        return ESP_ERR_NO_MEM;
+    }
+
     bool repaired = false;
     cJSON *item;
     cJSON_ArrayForEach(item, jobs_arr) {
-        if (s_job_count >= MAX_CRON_JOBS) break;
+        if (s_job_count >= s_job_cap) break;
 
         cron_job_t *job = &s_jobs[s_job_count];
         memset(job, 0, sizeof(cron_job_t));
@@ -141,20 +317,36 @@ static esp_err_t cron_load_jobs(void)
         cJSON *delete_j = cJSON_GetObjectItem(item, "delete_after_run");
         job->delete_after_run = delete_j ? cJSON_IsTrue(delete_j) : false;
 
+        cJSON *batch_j = cJSON_GetObjectItem(item, "batch");
+        job->no_batch = batch_j ? cJSON_IsFalse(batch_j) : false;
+
         if (strcmp(kind_str, "every") == 0) {
             job->kind = CRON_KIND_EVERY;
             cJSON *interval = cJSON_GetObjectItem(item, "interval_s");
-            job->interval_s = (interval && cJSON_IsNumber(interval))
+            job->interval_s = (interval && cJSON_IsNumber(interval) && interval->valuedouble >= 1)
                               ? (uint32_t)interval->valuedouble : 0;
+            if (job->interval_s == 0) {
+                ESP_LOGW(TAG, "Skipping job %s: bad interval_s", id);
+                continue;
+            }
         } else if (strcmp(kind_str, "at") == 0) {
             job->kind = CRON_KIND_AT;
             cJSON *at_epoch = cJSON_GetObjectItem(item, "at_epoch");
             job->at_epoch = (at_epoch && cJSON_IsNumber(at_epoch))
                             ? (int64_t)at_epoch->valuedouble : 0;
+        } else if (strcmp(kind_str, "cron") == 0) {
+            job->kind = CRON_KIND_CRON;
+            const char *expr = cJSON_GetStringValue(cJSON_GetObjectItem(item, "expr"));
+            if (!expr || !cron_expr_parse(expr, &job->cexpr)) {
+                ESP_LOGW(TAG, "Skipping job %s: bad cron expression", id);
+                continue;
+            }
+            strncpy(job->expr, expr, sizeof(job->expr) - 1);
         } else {
             continue; /* Unknown kind, skip */
         }
 
+        /* Run state from files written before cron.state existed */
         cJSON *last_run = cJSON_GetObjectItem(item, "last_run");
         job->last_run = (last_run && cJSON_IsNumber(last_run))
                         ? (int64_t)last_run->valuedouble : 0;
@@ -167,13 +359,14 @@ static esp_err_t cron_load_jobs(void)
     }
 
     cJSON_Delete(root);
-    if (repaired) {
+    if (!cron_state_load() || repaired) {
         cron_save_jobs();
     }
     ESP_LOGI(TAG, "Loaded %d cron jobs", s_job_count);
     return ESP_OK;
 }
 
+/* Rewrite the job definitions and the whole state file (add/remove only) */
 static esp_err_t cron_save_jobs(void)
 {
     cJSON *root = cJSON_CreateObject();
@@ -186,11 +379,12 @@ static esp_err_t cron_save_jobs(void)
         cJSON_AddStringToObject(item, "id", job->id);
         cJSON_AddStringToObject(item, "name", job->name);
         cJSON_AddBoolToObject(item, "enabled", job->enabled);
-        cJSON_AddStringToObject(item, "kind",
-            job->kind == CRON_KIND_EVERY ? "every" : "at");
+        cJSON_AddStringToObject(item, "kind", cron_kind_name(job->kind));
 
         if (job->kind == CRON_KIND_EVERY) {
             cJSON_AddNumberToObject(item, "interval_s", job->interval_s);
+        } else if (job->kind == CRON_KIND_CRON) {
+            cJSON_AddStringToObject(item, "expr", job->expr);
         } else {
             cJSON_AddNumberToObject(item, "at_epoch", (double)job->at_epoch);
         }
@@ -198,16 +392,17 @@ static esp_err_t cron_save_jobs(void)
         cJSON_AddStringToObject(item, "message", job->message);
         cJSON_AddStringToObject(item, "channel", job->channel);
         cJSON_AddStringToObject(item, "chat_id", job->chat_id);
-        cJSON_AddNumberToObject(item, "last_run", (double)job->last_run);
-        cJSON_AddNumberToObject(item, "next_run", (double)job->next_run);
         cJSON_AddBoolToObject(item, "delete_after_run", job->delete_after_run);
+        if (job->no_batch) {
+            cJSON_AddBoolToObject(item, "batch", false);
+        }
 
         cJSON_AddItemToArray(jobs_arr, item);
     }
 
     cJSON_AddItemToObject(root, "jobs", jobs_arr);
 
-    char *json_str = cJSON_Print(root);
+    char *json_str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
 
     if (!json_str) {
@@ -218,14 +413,16 @@ static esp_err_t cron_save_jobs(void)
     FILE *f = fopen(MIMI_CRON_FILE, "w");
     if (!f) {
         ESP_LOGE(TAG, "Failed to open %s for writing", MIMI_CRON_FILE);
-        free(json_str);
+        cJSON_free(json_str);
         return ESP_FAIL;
     }
 
     size_t len = strlen(json_str);
     size_t written = fwrite(json_str, 1, len, f);
     fclose(f);
-    free(json_str);
+    cJSON_free(json_str);
+    fs_catalog_update(MIMI_CRON_FILE);
+    s_def_writes++;
 
     if (written != len) {
         ESP_LOGE(TAG, "Cron save incomplete: %d/%d bytes", (int)written, (int)len);
@@ -233,78 +430,269 @@ static esp_err_t cron_save_jobs(void)
     }
 
     ESP_LOGI(TAG, "Saved %d cron jobs to %s", s_job_count, MIMI_CRON_FILE);
-    return ESP_OK;
+    return cron_state_save_all();
 }
 
-/* ── Due-job processing ───────────────────────────────────────── */
+/* ── Schedule heap ────────────────────────────────────────────── */
 
-static void cron_process_due_jobs(void)
+/* Earlier next_run first; ties fire in job order */
+static bool heap_before(int a, int b)
 {
-    time_t now = time(NULL);
+    const cron_job_t *ja = &s_jobs[s_heap[a]], *jb = &s_jobs[s_heap[b]];
+    if (ja->next_run != jb->next_run) return ja->next_run < jb->next_run;
+    return s_heap[a] < s_heap[b];
+}
 
-    bool changed = false;
+static void heap_swap(int a, int b)
+{
+    int t = s_heap[a];
+    s_heap[a] = s_heap[b];
+    s_heap[b] = t;
+}
+
+static void heap_sift_down(int i)
+{
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < s_heap_len && heap_before(l, m)) m = l;
+        if (r < s_heap_len && heap_before(r, m)) m = r;
+        if (m == i) break;
+        heap_swap(i, m);
+        i = m;
+    }
+}
 
+static void heap_pop(void)
+{
+    s_heap[0] = s_heap[--s_heap_len];
+    heap_sift_down(0);
+}
+
+/* Jobs are stored compactly, so any add/remove re-indexes: rebuild in O(n) */
+static void heap_rebuild(void)
+{
+    s_heap_len = 0;
     for (int i = 0; i < s_job_count; i++) {
-        cron_job_t *job = &s_jobs[i];
-        if (!job->enabled) continue;
-        if (job->next_run <= 0) continue;
-        if (job->next_run > now) continue;
+        if (s_jobs[i].enabled && s_jobs[i].next_run > 0) {
+            s_heap[s_heap_len++] = i;
+        }
+    }
+    for (int i = s_heap_len / 2 - 1; i >= 0; i--) {
+        heap_sift_down(i);
+    }
+}
 
-        /* Job is due — fire it */
-        ESP_LOGI(TAG, "Cron job firing: %s (%s)", job->name, job->id);
+/* ── Due-job processing ───────────────────────────────────────── */
 
-        /* Push message to inbound queue */
-        mimi_msg_t msg;
-        memset(&msg, 0, sizeof(msg));
-        strncpy(msg.channel, job->channel, sizeof(msg.channel) - 1);
-        strncpy(msg.chat_id, job->chat_id, sizeof(msg.chat_id) - 1);
-        msg.content = strdup(job->message);
+/* Next run strictly after `after`, 0 if the job does not recur */
+static int64_t cron_next_after(const cron_job_t *job, int64_t after)
+{
+    switch (job->kind) {
+    case CRON_KIND_EVERY:
+        return after + job->interval_s;
+    case CRON_KIND_CRON:
+        return (int64_t)cron_expr_next(&job->cexpr, (time_t)after);
+    default:
+        return 0;
+    }
+}
 
-        if (msg.content) {
-            esp_err_t err = message_bus_push_inbound(&msg);
-            if (err != ESP_OK) {
-                ESP_LOGW(TAG, "Failed to push cron message: %s", esp_err_to_name(err));
-                free(msg.content);
+static void cron_remove_at(int i)
+{
+    for (int j = i; j < s_job_count - 1; j++) {
+        s_jobs[j] = s_jobs[j + 1];
+        s_dirty[j] = s_dirty[j + 1];
+    }
+    s_job_count--;
+}
+
+#define CRON_FIRE_BATCH 8
+
+/* One outgoing turn: a single job, or several due jobs for one destination */
+typedef struct {
+    int count;
+    bool solo;
+    char first_name[32];
+} cron_turn_t;
+
+/* Append "k. [name] message" to a composite turn, growing content */
+static bool cron_turn_append(mimi_msg_t *msg, int k, const char *name, const char *message)
+{
+    size_t old = strlen(msg->content);
+    size_t add = strlen(name) + strlen(message) + 24;
+    char *grown = realloc(msg->content, old + add);
+    if (!grown) return false;
+    snprintf(grown + old, add, "\n%d. [%s] %s", k, name, message);
+    msg->content = grown;
+    return true;
+}
+
+/* Fold job into an existing turn for the same destination, if there is one */
+static bool cron_merge_into(mimi_msg_t *out, cron_turn_t *turns, int n, const cron_job_t *job)
+{
+    if (job->no_batch) return false;
+
+    for (int i = 0; i < n; i++) {
+        if (turns[i].solo || strcmp(out[i].channel, job->channel) != 0 ||
+            strcmp(out[i].chat_id, job->chat_id) != 0) {
+            continue;
+        }
+        mimi_msg_t *msg = &out[i];
+        if (turns[i].count == 1) {
+            /* Turn the single message into a numbered task list */
+            static const char HEADER[] =
+                "Several scheduled tasks are due now. Handle all of them in one reply:";
+            char *first = msg->content;
+            msg->content = strdup(HEADER);
+            if (!msg->content || !cron_turn_append(msg, 1, turns[i].first_name, first)) {
+                free(msg->content);
+                msg->content = first;
+                return false;
             }
+            free(first);
         }
+        if (!cron_turn_append(msg, turns[i].count + 1, job->name, job->message)) return false;
+        turns[i].count++;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Pop every job due at now_ms off the heap and reschedule it. Due jobs for
+ * the same channel/chat_id are merged into one message (one agent turn)
+ * unless a job opts out with no_batch. Messages are collected into out
+ * (pushed by the caller after the lock is released). Fired jobs are marked
+ * dirty; *deleted is set if one-shot jobs were removed.
+ * Returns the number collected; stops early when out is full.
+ */
+static int cron_collect_due(int64_t t_ms, mimi_msg_t *out, int max, bool *deleted)
+{
+    int64_t now = t_ms / 1000;
+    int n = 0;
+    cron_turn_t turns[CRON_FIRE_BATCH];
+
+    while (s_heap_len > 0) {
+        cron_job_t *job = &s_jobs[s_heap[0]];
+        if (job->next_run > now) break;
+
+        if (!cron_merge_into(out, turns, n, job)) {
+            if (n == max) break;
+            mimi_msg_t *msg = &out[n];
+            memset(msg, 0, sizeof(*msg));
+            strncpy(msg->channel, job->channel, sizeof(msg->channel) - 1);
+            strncpy(msg->chat_id, job->chat_id, sizeof(msg->chat_id) - 1);
+            msg->origin = MIMI_ORIGIN_CRON;
+            msg->content = strdup(job->message);
+            if (msg->content) {
+                turns[n].count = 1;
+                turns[n].solo = job->no_batch;
+                strncpy(turns[n].first_name, job->name, sizeof(turns[n].first_name) - 1);
+                turns[n].first_name[sizeof(turns[n].first_name) - 1] = '\0';
+                n++;
+            }
+        }
+
+        ESP_LOGI(TAG, "Cron job firing: %s (%s)", job->name, job->id);
+        int64_t late_ms = t_ms - job->next_run * 1000;
+        if (late_ms > s_max_late_ms) s_max_late_ms = late_ms;
+        s_fired++;
 
-        /* Update state */
         job->last_run = now;
+        s_dirty[s_heap[0]] = 1;
 
         if (job->kind == CRON_KIND_AT) {
-            /* One-shot: disable or delete */
-            if (job->delete_after_run) {
-                /* Remove by shifting array */
-                ESP_LOGI(TAG, "Deleting one-shot job: %s", job->name);
-                for (int j = i; j < s_job_count - 1; j++) {
-                    s_jobs[j] = s_jobs[j + 1];
-                }
-                s_job_count--;
-                i--; /* Re-check this index */
-            } else {
-                job->enabled = false;
-                job->next_run = 0;
-            }
+            /* One-shot: disable (deleted below if requested) */
+            job->enabled = false;
+            job->next_run = 0;
+            *deleted |= job->delete_after_run;
+            heap_pop();
+            continue;
+        }
+
+        /* Recurring: schedule from the missed slot, or from now after a long outage */
+        int64_t base = job->next_run;
+        int64_t next = cron_next_after(job, base);
+        if (next <= now) next = cron_next_after(job, now);
+        if (next > 0 && next <= now) next = now + 1;   /* never due twice in one pass */
+        job->next_run = next;
+        if (next > 0) {
+            heap_sift_down(0);
         } else {
-            /* Recurring: compute next run */
-            job->next_run = now + job->interval_s;
+            job->enabled = false;
+            heap_pop();
         }
+    }
 
-        changed = true;
+    s_turns += n;
+
+    if (*deleted) {
+        for (int i = s_job_count - 1; i >= 0; i--) {
+            if (s_jobs[i].kind == CRON_KIND_AT && s_jobs[i].delete_after_run &&
+                !s_jobs[i].enabled && s_jobs[i].last_run > 0) {
+                ESP_LOGI(TAG, "Deleting one-shot job: %s", s_jobs[i].name);
+                cron_remove_at(i);
+            }
+        }
+        heap_rebuild();
     }
+    return n;
+}
 
-    if (changed) {
-        cron_save_jobs();
+/*
+ * How long the task may sleep after a pass that collected n turns at t_ms:
+ * until the earliest deadline, 0 if the batch filled up (more may be due),
+ * capped so wall-clock jumps are picked up.
+ */
+static int64_t cron_wait_ms(int n, int64_t t_ms)
+{
+    int64_t wait_ms = MIMI_CRON_MAX_SLEEP_MS;
+    if (n == CRON_FIRE_BATCH) {
+        wait_ms = 0;
+    } else if (s_heap_len > 0) {
+        int64_t until = s_jobs[s_heap[0]].next_run * 1000 - t_ms;
+        if (until < wait_ms) wait_ms = until > 0 ? until : 0;
     }
+    return wait_ms;
 }
 
 static void cron_task_main(void *arg)
 {
     (void)arg;
+    mimi_msg_t batch[CRON_FIRE_BATCH];
 
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(MIMI_CRON_CHECK_INTERVAL_MS));
-        cron_process_due_jobs();
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        bool deleted = false;
+        int n = cron_collect_due(now_ms(), batch, CRON_FIRE_BATCH, &deleted);
+        if (deleted) {
+            cron_save_jobs();
+        } else {
+            cron_state_flush();
+        }
+
+        int64_t wait_ms = cron_wait_ms(n, now_ms());
+        xSemaphoreGive(s_lock);
+
+        for (int i = 0; i < n; i++) {
+            esp_err_t err = message_bus_push_inbound(&batch[i]);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Failed to push cron message: %s", esp_err_to_name(err));
+                free(batch[i].content);
+            }
+        }
+
+        if (wait_ms > 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms) + 1);
+            s_wakeups++;
+        }
+    }
+}
+
+static void cron_wake(void)
+{
+    if (s_cron_task) {
+        xTaskNotifyGive(s_cron_task);
     }
 }
 
@@ -314,9 +702,7 @@ static void compute_initial_next_run(cron_job_t *job)
 {
     time_t now = time(NULL);
 
-    if (job->kind == CRON_KIND_EVERY) {
-        job->next_run = now + job->interval_s;
-    } else if (job->kind == CRON_KIND_AT) {
+    if (job->kind == CRON_KIND_AT) {
         if (job->at_epoch > now) {
             job->next_run = job->at_epoch;
         } else {
@@ -324,6 +710,8 @@ static void compute_initial_next_run(cron_job_t *job)
             job->next_run = 0;
             job->enabled = false;
         }
+    } else {
+        job->next_run = cron_next_after(job, now);
     }
 }
 
@@ -331,6 +719,8 @@ static void compute_initial_next_run(cron_job_t *job)
 
 esp_err_t cron_service_init(void)
 {
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock || cron_reserve(MIMI_CRON_INIT_JOBS) != ESP_OK) return ESP_ERR_NO_MEM;
     return cron_load_jobs();
 }
 
@@ -341,18 +731,25 @@ esp_err_t cron_service_start(void)
         return ESP_OK;
     }
 
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
     /* Recompute next_run for all enabled jobs that don't have one */
     time_t now = time(NULL);
     for (int i = 0; i < s_job_count; i++) {
         cron_job_t *job = &s_jobs[i];
         if (job->enabled && job->next_run <= 0) {
-            if (job->kind == CRON_KIND_EVERY) {
-                job->next_run = now + job->interval_s;
-            } else if (job->kind == CRON_KIND_AT && job->at_epoch > now) {
-                job->next_run = job->at_epoch;
+            if (job->kind == CRON_KIND_AT) {
+                if (job->at_epoch > now) job->next_run = job->at_epoch;
+            } else {
+                job->next_run = cron_next_after(job, now);
             }
+            s_dirty[i] = 1;
         }
     }
+    heap_rebuild();
+    cron_state_flush();
+
+    xSemaphoreGive(s_lock);
 
     BaseType_t ok = xTaskCreate(
         cron_task_main,
@@ -367,24 +764,37 @@ esp_err_t cron_service_start(void)
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "Cron service started (%d jobs, check every %ds)",
-             s_job_count, MIMI_CRON_CHECK_INTERVAL_MS / 1000);
+    ESP_LOGI(TAG, "Cron service started (%d jobs)", s_job_count);
     return ESP_OK;
 }
 
 void cron_service_stop(void)
 {
     if (s_cron_task) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
         vTaskDelete(s_cron_task);
         s_cron_task = NULL;
+        xSemaphoreGive(s_lock);
         ESP_LOGI(TAG, "Cron service stopped");
     }
 }
 
 esp_err_t cron_add_job(cron_job_t *job)
 {
-    if (s_job_count >= MAX_CRON_JOBS) {
-        ESP_LOGW(TAG, "Max cron jobs reached (%d)", MAX_CRON_JOBS);
+    if (job->kind == CRON_KIND_CRON && !cron_expr_parse(job->expr, &job->cexpr)) {
+        ESP_LOGW(TAG, "Invalid cron expression: %s", job->expr);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (job->kind == CRON_KIND_EVERY && job->interval_s < 1) {
+        ESP_LOGW(TAG, "Invalid interval: %lu s", (unsigned long)job->interval_s);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    if (cron_reserve(s_job_count + 1) != ESP_OK) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "Cannot add cron job (%d jobs, max %d)", s_job_count, MAX_CRON_JOBS);
         return ESP_ERR_NO_MEM;
     }
 
@@ -398,43 +808,88 @@ esp_err_t cron_add_job(cron_job_t *job)
     job->enabled = true;
     job->last_run = 0;
     compute_initial_next_run(job);
+    if (job->kind == CRON_KIND_CRON && job->next_run <= 0) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "Cron expression never fires: %s", job->expr);
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    /* Copy into static array */
     s_jobs[s_job_count] = *job;
     s_job_count++;
+    heap_rebuild();
 
     cron_save_jobs();
+    xSemaphoreGive(s_lock);
+    cron_wake();
 
     ESP_LOGI(TAG, "Added cron job: %s (%s) kind=%s next_run=%lld",
-             job->name, job->id,
-             job->kind == CRON_KIND_EVERY ? "every" : "at",
+             job->name, job->id, cron_kind_name(job->kind),
              (long long)job->next_run);
     return ESP_OK;
 }
 
 esp_err_t cron_remove_job(const char *job_id)
 {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
     for (int i = 0; i < s_job_count; i++) {
         if (strcmp(s_jobs[i].id, job_id) == 0) {
             ESP_LOGI(TAG, "Removing cron job: %s (%s)", s_jobs[i].name, job_id);
 
-            /* Shift remaining jobs down */
-            for (int j = i; j < s_job_count - 1; j++) {
-                s_jobs[j] = s_jobs[j + 1];
-            }
-            s_job_count--;
+            cron_remove_at(i);
+            heap_rebuild();
 
             cron_save_jobs();
+            xSemaphoreGive(s_lock);
+            cron_wake();
             return ESP_OK;
         }
     }
 
+    xSemaphoreGive(s_lock);
     ESP_LOGW(TAG, "Cron job not found: %s", job_id);
     return ESP_ERR_NOT_FOUND;
 }
 
-void cron_list_jobs(const cron_job_t **jobs, int *count)
+int cron_job_count(void)
+{
+    return s_job_count;
+}
+
+bool cron_get_job(int index, cron_job_t *out)
 {
-    *jobs = s_jobs;
-    *count = s_job_count;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool ok = index >= 0 && index < s_job_count;
+    if (ok) *out = s_jobs[index];
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+void cron_print_status(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    printf("Cron: %d jobs, %d scheduled, task %s\n", s_job_count, s_heap_len,
+           s_cron_task ? "running" : "stopped");
+    printf("  wakeups=%lu fired=%lu turns=%lu max_late=%lldms\n",
+           (unsigned long)s_wakeups, (unsigned long)s_fired, (unsigned long)s_turns,
+           (long long)s_max_late_ms);
+    printf("  writes: definitions=%lu state=%lu, table %d/%d (max %d)\n",
+           (unsigned long)s_def_writes, (unsigned long)s_state_writes,
+           s_job_count, s_job_cap, MAX_CRON_JOBS);
+
+    for (int i = 0; i < s_job_count; i++) {
+        const cron_job_t *j = &s_jobs[i];
+        char when[32] = "-";
+        if (j->next_run > 0) {
+            time_t t = (time_t)j->next_run;
+            struct tm tm;
+            localtime_r(&t, &tm);
+            strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+        }
+        printf("  [%s] %-20s %-5s %-16s next=%s\n", j->id, j->name, cron_kind_name(j->kind),
+               j->kind == CRON_KIND_CRON ? j->expr : "", when);
+    }
+
+    xSemaphoreGive(s_lock);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "esp_err.h"
+#include "cron/cron_expr.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -8,6 +9,7 @@
 typedef enum {
     CRON_KIND_EVERY = 0,   /* Recurring interval in seconds */
     CRON_KIND_AT    = 1,   /* One-shot at unix timestamp */
+    CRON_KIND_CRON  = 2,   /* 5-field cron expression, local time */
 } cron_kind_t;
 
 /* A single cron job */
@@ -18,12 +20,15 @@ typedef struct {
     cron_kind_t kind;
     uint32_t interval_s;   /* For EVERY: interval in seconds */
     int64_t at_epoch;      /* For AT: unix timestamp */
+    char expr[64];         /* For CRON: "m h dom mon dow" */
+    cron_expr_t cexpr;     /* For CRON: parsed expr (not persisted) */
     char message[256];     /* Message to inject into inbound queue */
     char channel[16];      /* Reply channel (default "system") */
     char chat_id[32];      /* Reply chat_id (default "cron") */
     int64_t last_run;      /* Last run epoch */
     int64_t next_run;      /* Next run epoch */
     bool delete_after_run; /* Remove job after firing (for AT jobs) */
+    bool no_batch;         /* Always fire as its own turn, never merged */
 } cron_job_t;
 
 /**
@@ -32,19 +37,23 @@ typedef struct {
 esp_err_t cron_service_init(void);
 
 /**
- * Start the cron timer. Call after WiFi is connected and time is synced.
+ * Start the cron task. It sleeps until the earliest next_run (jobs are kept
+ * in a min-heap) and is woken early when jobs are added or removed.
+ * Call after WiFi is connected and time is synced.
  */
 esp_err_t cron_service_start(void);
 
 /**
- * Stop the cron timer.
+ * Stop the cron task.
  */
 void cron_service_stop(void);
 
 /**
  * Add a new cron job.
- * @param job  Pointer to job struct (id will be generated)
- * @return ESP_OK on success, ESP_ERR_NO_MEM if max jobs reached
+ * @param job  Pointer to job struct (id will be generated; for CRON jobs
+ *             expr is parsed here)
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if MIMI_CRON_MAX_JOBS is reached,
+ *         ESP_ERR_INVALID_ARG if a cron expression is invalid or never fires
  */
 esp_err_t cron_add_job(cron_job_t *job);
 
@@ -56,8 +65,18 @@ esp_err_t cron_add_job(cron_job_t *job);
 esp_err_t cron_remove_job(const char *job_id);
 
 /**
- * List all cron jobs.
- * @param jobs      Output array of job pointers
- * @param count     Output: number of jobs
+ * Number of cron jobs.
  */
-void cron_list_jobs(const cron_job_t **jobs, int *count);
+int cron_job_count(void);
+
+/**
+ * Copy job `index` (0-based, creation order) into out. The job table grows
+ * and shifts, so callers get a copy rather than a pointer.
+ * @return false if index is out of range
+ */
+bool cron_get_job(int index, cron_job_t *out);
+
+/**
+ * Print scheduler counters and each job's next run in local time.
+ */
+void cron_print_status(void);
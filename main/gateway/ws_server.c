@@ -1,6 +1,10 @@
 #include "ws_server.h"
 #include "mimi_config.h"
 #include "bus/message_bus.h"
+#include "agent/local_cmd.h"
+#include "trace/turn_trace.h"
+#include "trace/heap_sampler.h"
+#include "trace/task_monitor.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -67,6 +71,29 @@ static void remove_client(int fd)
     }
 }
 
+/* Send a diagnostics reply on the requesting socket; takes ownership of resp */
+static void ws_reply_json(httpd_req_t *req, cJSON *resp)
+{
+    char *json_str = cJSON_PrintUnformatted(resp);
+    cJSON_Delete(resp);
+    if (!json_str) return;
+
+    httpd_ws_frame_t out = {
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)json_str,
+        .len = strlen(json_str),
+    };
+    httpd_ws_send_frame(req, &out);
+    cJSON_free(json_str);
+}
+
+/* Optional "count" field of a diagnostics request */
+static int request_count(const cJSON *root, int def)
+{
+    cJSON *count = cJSON_GetObjectItem(root, "count");
+    return (count && cJSON_IsNumber(count) && count->valueint > 0) ? count->valueint : def;
+}
+
 static esp_err_t ws_handler(httpd_req_t *req)
 {
     if (req->method == HTTP_GET) {
@@ -131,9 +158,24 @@ static esp_err_t ws_handler(httpd_req_t *req)
         strncpy(msg.channel, MIMI_CHAN_WEBSOCKET, sizeof(msg.channel) - 1);
         strncpy(msg.chat_id, chat_id, sizeof(msg.chat_id) - 1);
         msg.content = strdup(content->valuestring);
-        if (msg.content) {
+        if (msg.content && local_cmd_dispatch(&msg)) {
+            free(msg.content);
+        } else if (msg.content) {
             message_bus_push_inbound(&msg);
         }
+    } else if (type && cJSON_IsString(type) && strcmp(type->valuestring, "trace") == 0) {
+        cJSON *resp = cJSON_CreateObject();
+        cJSON_AddStringToObject(resp, "type", "trace");
+        cJSON_AddItemToObject(resp, "traces", turn_trace_to_json(request_count(root, MIMI_TRACE_RING_LEN)));
+        ws_reply_json(req, resp);
+    } else if (type && cJSON_IsString(type) && strcmp(type->valuestring, "heap") == 0) {
+        cJSON *resp = heap_sampler_to_json(request_count(root, MIMI_HEAP_SAMPLE_RING));
+        cJSON_AddStringToObject(resp, "type", "heap");
+        ws_reply_json(req, resp);
+    } else if (type && cJSON_IsString(type) && strcmp(type->valuestring, "top") == 0) {
+        cJSON *resp = task_monitor_to_json();
+        cJSON_AddStringToObject(resp, "type", "top");
+        ws_reply_json(req, resp);
     }
 
     cJSON_Delete(root);
@@ -196,7 +238,7 @@ esp_err_t ws_server_send(const char *chat_id, const char *text)
     };
 
     esp_err_t ret = httpd_ws_send_frame_async(s_server, client->fd, &ws_pkt);
-    free(json_str);
+    cJSON_free(json_str);
 
     if (ret != ESP_OK) {
         ESP_LOGW(TAG, "Failed to send to %s: %s", chat_id, esp_err_to_name(ret));
@@ -9,6 +9,13 @@
  * Protocol:
  *   Inbound:  {"type":"message","content":"hello","chat_id":"ws_client1"}
  *   Outbound: {"type":"response","content":"Hi!","chat_id":"ws_client1"}
+ *
+ *   Trace:    {"type":"trace","count":5}
+ *          -> {"type":"trace","traces":[{"id":1,"spans":[{"stage":"llm_ttfb",...}]}]}
+ *   Heap:     {"type":"heap","count":20}
+ *          -> {"type":"heap","samples":[{"internal":{"free":..,"largest":..,"min_free":..},...}],"failures":[...]}
+ *   Top:      {"type":"top"}
+ *          -> {"type":"top","interval_ms":5000,"cores":[12.5,80.1],"tasks":[{"name":"agent_loop","cpu":..},...]}
  */
 esp_err_t ws_server_start(void);
 
@@ -17,18 +17,60 @@ static const char *TAG = "heartbeat";
     "Read " MIMI_HEARTBEAT_FILE " and follow any instructions or tasks listed there. " \
     "If nothing needs attention, reply with just: HEARTBEAT_OK"
 
+#define HEARTBEAT_OK_TOKEN  "HEARTBEAT_OK"
+
 static TimerHandle_t s_heartbeat_timer = NULL;
 
+/*
+ * Short-circuit state. The actionable lines of HEARTBEAT.md are hashed; once
+ * the agent has answered HEARTBEAT_OK for a hash, later ticks with the same
+ * hash are skipped for `backoff` intervals, doubling after each further OK
+ * up to MIMI_HEARTBEAT_MAX_BACKOFF. Any other reply or a content change
+ * resets it.
+ */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_sent_hash = 0;       /* hash of the last prompt sent */
+static uint32_t s_ok_hash = 0;         /* hash the agent last answered OK for */
+static bool s_ok_valid = false;
+static int s_backoff = 1;              /* intervals between runs for s_ok_hash */
+static int s_countdown = 0;            /* ticks left before the next run */
+
+typedef struct {
+    uint32_t ticks;
+    uint32_t idle;                     /* no actionable lines */
+    uint32_t skipped;                  /* unchanged since an OK */
+    uint32_t executed;
+    uint32_t ok_replies;
+    uint32_t acted;
+} heartbeat_stats_t;
+
+static heartbeat_stats_t s_stats;
+
 /* ── Content check ────────────────────────────────────────────── */
 
+static uint32_t fnv1a(uint32_t h, const char *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        h ^= (uint8_t)p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
 /**
- * Check if HEARTBEAT.md has actionable content.
- * Returns true if any line is NOT:
+ * Scan HEARTBEAT.md for actionable content.
+ * A line is actionable unless it is:
  *   - empty / whitespace-only
  *   - a markdown header (starts with #)
  *   - a completed checkbox (- [x] or * [x])
+ * The hash covers the trimmed actionable lines only, so editing headers or
+ * ticking boxes off elsewhere does not count as new work unless it changes
+ * what is still open.
+ * If text is given, the whole file is copied into it (NUL-terminated);
+ * *fits is false when it was larger than text_size.
+ * Returns true if any actionable line was found.
  */
-static bool heartbeat_has_tasks(void)
+static bool heartbeat_scan(uint32_t *hash, char *text, size_t text_size, bool *fits)
 {
     FILE *f = fopen(MIMI_HEARTBEAT_FILE, "r");
     if (!f) {
@@ -37,8 +79,21 @@ static bool heartbeat_has_tasks(void)
 
     char line[256];
     bool found_task = false;
+    uint32_t h = 2166136261u;
+    size_t off = 0;
+    if (fits) *fits = true;
 
     while (fgets(line, sizeof(line), f)) {
+        if (text) {
+            size_t len = strlen(line);
+            if (off + len < text_size) {
+                memcpy(text + off, line, len);
+                off += len;
+            } else if (fits) {
+                *fits = false;
+            }
+        }
+
         /* Skip leading whitespace */
         const char *p = line;
         while (*p && isspace((unsigned char)*p)) {
@@ -63,21 +118,81 @@ static bool heartbeat_has_tasks(void)
             }
         }
 
-        /* Found an actionable line */
+        /* Actionable line: hash it without trailing whitespace */
+        size_t n = strlen(p);
+        while (n > 0 && isspace((unsigned char)p[n - 1])) n--;
+        h = fnv1a(h, p, n);
+        h = fnv1a(h, "\n", 1);
         found_task = true;
-        break;
     }
 
     fclose(f);
+    if (text && text_size) text[off] = '\0';
+    *hash = h;
     return found_task;
 }
 
 /* ── Send heartbeat to agent ──────────────────────────────────── */
 
-static bool heartbeat_send(void)
+/* Prompt with the file inlined so the agent needs no read_file round trip */
+static char *heartbeat_build_prompt(const char *content, bool fits)
 {
-    if (!heartbeat_has_tasks()) {
+    if (!fits) {
+        return strdup(HEARTBEAT_PROMPT);
+    }
+
+    static const char HEAD[] = "Current contents of " MIMI_HEARTBEAT_FILE ":\n---\n";
+    static const char TAIL[] =
+        "---\nFollow any instructions or tasks listed above (edit the file to tick off "
+        "finished items). If nothing needs attention, reply with just: " HEARTBEAT_OK_TOKEN;
+    size_t len = strlen(content);
+    bool nl = len > 0 && content[len - 1] == '\n';
+    char *prompt = malloc(sizeof(HEAD) + len + 1 + sizeof(TAIL));
+    if (!prompt) return NULL;
+    snprintf(prompt, sizeof(HEAD) + len + 1 + sizeof(TAIL), "%s%s%s%s",
+             HEAD, content, nl ? "" : "\n", TAIL);
+    return prompt;
+}
+
+static bool heartbeat_send(bool force)
+{
+    uint32_t hash;
+    bool fits;
+    char *content = malloc(MIMI_HEARTBEAT_INLINE_MAX);
+    if (!content) {
+        ESP_LOGE(TAG, "Failed to allocate heartbeat buffer");
+        return false;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.ticks++;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!heartbeat_scan(&hash, content, MIMI_HEARTBEAT_INLINE_MAX, &fits)) {
         ESP_LOGD(TAG, "No actionable tasks in HEARTBEAT.md");
+        portENTER_CRITICAL(&s_lock);
+        s_stats.idle++;
+        portEXIT_CRITICAL(&s_lock);
+        free(content);
+        return false;
+    }
+
+    /* Unchanged since the agent last said OK: wait out the backoff */
+    portENTER_CRITICAL(&s_lock);
+    bool skip = !force && s_ok_valid && hash == s_ok_hash && --s_countdown > 0;
+    if (skip) {
+        s_stats.skipped++;
+    } else {
+        s_stats.executed++;
+        s_sent_hash = hash;
+        s_countdown = s_backoff;
+    }
+    int backoff = s_backoff;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (skip) {
+        ESP_LOGI(TAG, "HEARTBEAT.md unchanged since last OK, skipping (backoff %dx)", backoff);
+        free(content);
         return false;
     }
 
@@ -85,7 +200,9 @@ static bool heartbeat_send(void)
     memset(&msg, 0, sizeof(msg));
     strncpy(msg.channel, MIMI_CHAN_SYSTEM, sizeof(msg.channel) - 1);
     strncpy(msg.chat_id, "heartbeat", sizeof(msg.chat_id) - 1);
-    msg.content = strdup(HEARTBEAT_PROMPT);
+    msg.origin = MIMI_ORIGIN_HEARTBEAT;
+    msg.content = heartbeat_build_prompt(content, fits);
+    free(content);
 
     if (!msg.content) {
         ESP_LOGE(TAG, "Failed to allocate heartbeat prompt");
@@ -99,7 +216,7 @@ static bool heartbeat_send(void)
         return false;
     }
 
-    ESP_LOGI(TAG, "Triggered agent check");
+    ESP_LOGI(TAG, "Triggered agent check (hash %08lx)", (unsigned long)hash);
     return true;
 }
 
@@ -108,7 +225,7 @@ static bool heartbeat_send(void)
 static void heartbeat_timer_callback(TimerHandle_t xTimer)
 {
     (void)xTimer;
-    heartbeat_send();
+    heartbeat_send(false);
 }
 
 /* ── Public API ───────────────────────────────────────────────── */
@@ -161,5 +278,52 @@ void heartbeat_stop(void)
 
 bool heartbeat_trigger(void)
 {
-    return heartbeat_send();
+    return heartbeat_send(true);
+}
+
+void heartbeat_on_reply(const char *text)
+{
+    bool ok = text && strstr(text, HEARTBEAT_OK_TOKEN) != NULL;
+
+    portENTER_CRITICAL(&s_lock);
+    if (ok) {
+        s_stats.ok_replies++;
+        if (s_ok_valid && s_ok_hash == s_sent_hash) {
+            s_backoff = s_backoff * 2 > MIMI_HEARTBEAT_MAX_BACKOFF
+                        ? MIMI_HEARTBEAT_MAX_BACKOFF : s_backoff * 2;
+        } else {
+            s_backoff = 2;
+        }
+        s_ok_hash = s_sent_hash;
+        s_ok_valid = true;
+        s_countdown = s_backoff;
+    } else {
+        /* The agent did something: keep checking every interval */
+        s_stats.acted++;
+        s_ok_valid = false;
+        s_backoff = 1;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void heartbeat_print_stats(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    heartbeat_stats_t st = s_stats;
+    bool ok_valid = s_ok_valid;
+    uint32_t ok_hash = s_ok_hash;
+    int backoff = s_backoff, countdown = s_countdown;
+    portEXIT_CRITICAL(&s_lock);
+
+    printf("Heartbeat: every %d min, %s\n", MIMI_HEARTBEAT_INTERVAL_MS / 60000,
+           s_heartbeat_timer ? "running" : "stopped");
+    printf("  ticks=%lu idle=%lu skipped=%lu executed=%lu\n",
+           (unsigned long)st.ticks, (unsigned long)st.idle,
+           (unsigned long)st.skipped, (unsigned long)st.executed);
+    printf("  replies: ok=%lu acted=%lu\n",
+           (unsigned long)st.ok_replies, (unsigned long)st.acted);
+    if (ok_valid) {
+        printf("  last OK for %08lx, backoff %dx, next run in %d tick(s)\n",
+               (unsigned long)ok_hash, backoff, countdown);
+    }
 }
@@ -20,7 +20,20 @@ esp_err_t heartbeat_start(void);
 void heartbeat_stop(void);
 
 /**
- * Manually trigger a heartbeat check (for CLI testing).
+ * Manually trigger a heartbeat check (for CLI testing). Ignores the
+ * unchanged-content backoff.
  * Returns true if the agent was prompted, false if no tasks found.
  */
 bool heartbeat_trigger(void);
+
+/**
+ * Feed the agent's reply to a heartbeat prompt back in. A HEARTBEAT_OK reply
+ * lets later ticks with the same HEARTBEAT.md content be skipped, with the
+ * gap doubling up to MIMI_HEARTBEAT_MAX_BACKOFF intervals.
+ */
+void heartbeat_on_reply(const char *text);
+
+/**
+ * Print tick/skip/execute counters and the current backoff.
+ */
+void heartbeat_print_stats(void);
@@ -1,10 +1,18 @@
 #include "llm_proxy.h"
 #include "mimi_config.h"
 #include "proxy/http_proxy.h"
+#include "trace/turn_trace.h"
+#include "agent/json_arena.h"
+#include "trace/dlog.h"
 
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_heap_caps.h"
@@ -17,10 +25,41 @@ static const char *TAG = "llm";
 #define LLM_MODEL_MAX_LEN   64
 #define LLM_DUMP_MAX_BYTES   (16 * 1024)
 #define LLM_DUMP_CHUNK_BYTES 320
+#define LLM_READ_CHUNK_BYTES 2048
 
-static char s_api_key[LLM_API_KEY_MAX_LEN] = {0};
-static char s_model[LLM_MODEL_MAX_LEN] = MIMI_LLM_DEFAULT_MODEL;
-static char s_provider[16] = MIMI_LLM_PROVIDER_DEFAULT;
+/* One provider/model pair plus its health. Slot 0 is the primary endpoint
+ * (set_api_key / set_model / set_model_provider); the others are fallbacks. */
+typedef struct {
+    char provider[16];
+    char model[LLM_MODEL_MAX_LEN];
+    char api_key[LLM_API_KEY_MAX_LEN];   /* empty on fallbacks = reuse primary key */
+    uint32_t fail_count;                 /* consecutive failures */
+    int64_t retry_at_us;                 /* backoff: do not retry before this */
+    uint32_t ok_total;
+    uint32_t fail_total;
+    int last_status;
+} llm_endpoint_t;
+
+static llm_endpoint_t s_endpoints[MIMI_LLM_MAX_ENDPOINTS] = {
+    [0] = {
+        .provider = MIMI_LLM_PROVIDER_DEFAULT,
+        .model = MIMI_LLM_DEFAULT_MODEL,
+    },
+};
+static uint32_t s_hedge_ms = MIMI_LLM_HEDGE_DEFAULT_MS;
+
+/* OpenAI-compatible server used by provider "local" (set_llm_url) */
+typedef struct {
+    char url[192];
+    char host[64];
+    char path[96];
+    int port;
+    bool https;
+} llm_local_url_t;
+
+static llm_local_url_t s_local;
+
+#define s_primary (&s_endpoints[0])
 
 static void llm_log_payload(const char *label, const char *payload)
 {
@@ -53,18 +92,14 @@ static void llm_log_payload(const char *label, const char *payload)
         char preview[MIMI_LLM_LOG_PREVIEW_BYTES + 1];
         memcpy(preview, payload, shown);
         preview[shown] = '\0';
-        for (size_t i = 0; i < shown; i++) {
-            if (preview[i] == '\n' || preview[i] == '\r' || preview[i] == '\t') {
-                preview[i] = ' ';
-            }
-        }
-        ESP_LOGI(TAG, "%s (%u bytes): %s%s",
-                 label,
-                 (unsigned)total,
-                 preview,
-                 (shown < total) ? " ..." : "");
+        /* The drain task folds newlines, no need to sanitize here */
+        DLOGI(TAG, "%s (%u bytes): %s%s",
+              label,
+              (unsigned)total,
+              preview,
+              (shown < total) ? " ..." : "");
     } else {
-        ESP_LOGI(TAG, "%s (%u bytes)", label, (unsigned)total);
+        DLOGI(TAG, "%s (%u bytes)", label, (unsigned)total);
     }
 #endif
 }
@@ -121,52 +156,180 @@ static void resp_buf_free(resp_buf_t *rb)
     rb->cap = 0;
 }
 
-/* ── HTTP event handler (for esp_http_client direct path) ─────── */
+/* ── One HTTP attempt against one endpoint ────────────────────── */
 
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+struct llm_race;
+
+typedef struct {
+    const llm_endpoint_t *ep;
+    int ep_idx;
+    char *post_data;            /* owned */
+    resp_buf_t rb;
+    int status;
+    int retry_after_s;          /* parsed "retry-after" header, 0 if absent */
+    esp_err_t err;
+    volatile bool cancelled;    /* set by the caller when a hedge won */
+    struct llm_race *race;      /* non-NULL when running on a worker task */
+    int slot;
+} llm_call_t;
+
+/* ── Provider helpers ──────────────────────────────────────────── */
+
+static bool provider_is_local(const llm_endpoint_t *ep)
 {
-    resp_buf_t *rb = (resp_buf_t *)evt->user_data;
-    if (evt->event_id == HTTP_EVENT_ON_DATA) {
-        resp_buf_append(rb, (const char *)evt->data, evt->data_len);
-    }
-    return ESP_OK;
+    return strcmp(ep->provider, "local") == 0;
 }
 
-/* ── Provider helpers ──────────────────────────────────────────── */
+/* "local" speaks the OpenAI chat-completions wire format */
+static bool provider_is_openai(const llm_endpoint_t *ep)
+{
+    return strcmp(ep->provider, "openai") == 0 || provider_is_local(ep);
+}
 
-static bool provider_is_openai(void)
+static const char *llm_api_url(const llm_endpoint_t *ep)
 {
-    return strcmp(s_provider, "openai") == 0;
+    if (provider_is_local(ep)) return s_local.url;
+    return provider_is_openai(ep) ? MIMI_OPENAI_API_URL : MIMI_LLM_API_URL;
 }
 
-static const char *llm_api_url(void)
+static const char *llm_api_host(const llm_endpoint_t *ep)
 {
-    return provider_is_openai() ? MIMI_OPENAI_API_URL : MIMI_LLM_API_URL;
+    if (provider_is_local(ep)) return s_local.host;
+    return provider_is_openai(ep) ? "api.openai.com" : "api.anthropic.com";
 }
 
-static const char *llm_api_host(void)
+static const char *llm_api_path(const llm_endpoint_t *ep)
 {
-    return provider_is_openai() ? "api.openai.com" : "api.anthropic.com";
+    if (provider_is_local(ep)) return s_local.path;
+    return provider_is_openai(ep) ? "/v1/chat/completions" : "/v1/messages";
 }
 
-static const char *llm_api_path(void)
+/**
+ * Parse "http[s]://host[:port][/path]" into s_local-style parts.
+ * A missing port defaults by scheme; a missing path (or a bare "/v1" base
+ * URL) gets MIMI_LLM_LOCAL_PATH_DEFAULT / "/chat/completions" appended.
+ */
+static esp_err_t llm_parse_local_url(const char *url, llm_local_url_t *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    const char *p;
+    if (strncasecmp(url, "http://", 7) == 0) {
+        out->https = false;
+        p = url + 7;
+    } else if (strncasecmp(url, "https://", 8) == 0) {
+        out->https = true;
+        p = url + 8;
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+    out->port = out->https ? 443 : 80;
+
+    size_t host_len = strcspn(p, ":/");
+    if (host_len == 0 || host_len >= sizeof(out->host)) return ESP_ERR_INVALID_ARG;
+    memcpy(out->host, p, host_len);
+    p += host_len;
+
+    if (*p == ':') {
+        char *end;
+        long port = strtol(p + 1, &end, 10);
+        if (end == p + 1 || port <= 0 || port > 65535 || (*end && *end != '/')) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        out->port = (int)port;
+        p = end;
+    }
+
+    if (*p == '\0' || strcmp(p, "/") == 0) {
+        snprintf(out->path, sizeof(out->path), "%s", MIMI_LLM_LOCAL_PATH_DEFAULT);
+    } else if (strcmp(p, "/v1") == 0 || strcmp(p, "/v1/") == 0) {
+        snprintf(out->path, sizeof(out->path), "/v1/chat/completions");
+    } else if (strlen(p) < sizeof(out->path)) {
+        snprintf(out->path, sizeof(out->path), "%s", p);
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    snprintf(out->url, sizeof(out->url), "%s://%s:%d%s",
+             out->https ? "https" : "http", out->host, out->port, out->path);
+    return ESP_OK;
+}
+
+static const char *llm_api_key(const llm_endpoint_t *ep)
+{
+    return ep->api_key[0] ? ep->api_key : s_primary->api_key;
+}
+
+/* ── HTTP event handler (for esp_http_client direct path) ─────── */
+
+static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
-    return provider_is_openai() ? "/v1/chat/completions" : "/v1/messages";
+    llm_call_t *call = (llm_call_t *)evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER && call &&
+        strcasecmp(evt->header_key, "retry-after") == 0) {
+        call->retry_after_s = atoi(evt->header_value);
+    }
+    return ESP_OK;
 }
 
 /* ── Init ─────────────────────────────────────────────────────── */
 
+static void fallback_nvs_keys(int slot, char *prov_key, char *model_key, char *api_key_key)
+{
+    /* NVS keys are limited to 15 chars */
+    snprintf(prov_key, 16, "fb%d_provider", slot);
+    snprintf(model_key, 16, "fb%d_model", slot);
+    snprintf(api_key_key, 16, "fb%d_api_key", slot);
+}
+
+static void llm_load_fallback(nvs_handle_t nvs, int slot)
+{
+    char prov_key[16], model_key[16], api_key_key[16];
+    fallback_nvs_keys(slot, prov_key, model_key, api_key_key);
+
+    llm_endpoint_t *ep = &s_endpoints[slot];
+    char tmp[LLM_API_KEY_MAX_LEN] = {0};
+    size_t len = sizeof(tmp);
+    if (nvs_get_str(nvs, prov_key, tmp, &len) != ESP_OK || !tmp[0]) {
+        return;
+    }
+    safe_copy(ep->provider, sizeof(ep->provider), tmp);
+
+    len = sizeof(tmp);
+    tmp[0] = '\0';
+    if (nvs_get_str(nvs, model_key, tmp, &len) == ESP_OK) {
+        safe_copy(ep->model, sizeof(ep->model), tmp);
+    }
+
+    len = sizeof(tmp);
+    tmp[0] = '\0';
+    ep->api_key[0] = '\0';
+    if (nvs_get_str(nvs, api_key_key, tmp, &len) == ESP_OK) {
+        safe_copy(ep->api_key, sizeof(ep->api_key), tmp);
+    }
+}
+
 esp_err_t llm_proxy_init(void)
 {
     /* Start with build-time defaults */
     if (MIMI_SECRET_API_KEY[0] != '\0') {
-        safe_copy(s_api_key, sizeof(s_api_key), MIMI_SECRET_API_KEY);
+        safe_copy(s_primary->api_key, sizeof(s_primary->api_key), MIMI_SECRET_API_KEY);
     }
     if (MIMI_SECRET_MODEL[0] != '\0') {
-        safe_copy(s_model, sizeof(s_model), MIMI_SECRET_MODEL);
+        safe_copy(s_primary->model, sizeof(s_primary->model), MIMI_SECRET_MODEL);
     }
     if (MIMI_SECRET_MODEL_PROVIDER[0] != '\0') {
-        safe_copy(s_provider, sizeof(s_provider), MIMI_SECRET_MODEL_PROVIDER);
+        safe_copy(s_primary->provider, sizeof(s_primary->provider), MIMI_SECRET_MODEL_PROVIDER);
+    }
+    if (MIMI_SECRET_LLM_URL[0] != '\0' &&
+        llm_parse_local_url(MIMI_SECRET_LLM_URL, &s_local) != ESP_OK) {
+        ESP_LOGW(TAG, "Ignoring invalid MIMI_SECRET_LLM_URL");
+    }
+    if (MIMI_LLM_MAX_ENDPOINTS > 1 && MIMI_SECRET_FALLBACK_PROVIDER[0] != '\0') {
+        llm_endpoint_t *fb = &s_endpoints[1];
+        safe_copy(fb->provider, sizeof(fb->provider), MIMI_SECRET_FALLBACK_PROVIDER);
+        safe_copy(fb->model, sizeof(fb->model), MIMI_SECRET_FALLBACK_MODEL);
+        safe_copy(fb->api_key, sizeof(fb->api_key), MIMI_SECRET_FALLBACK_API_KEY);
     }
 
     /* NVS overrides take highest priority (set via CLI) */
@@ -175,77 +338,158 @@ esp_err_t llm_proxy_init(void)
         char tmp[LLM_API_KEY_MAX_LEN] = {0};
         size_t len = sizeof(tmp);
         if (nvs_get_str(nvs, MIMI_NVS_KEY_API_KEY, tmp, &len) == ESP_OK && tmp[0]) {
-            safe_copy(s_api_key, sizeof(s_api_key), tmp);
+            safe_copy(s_primary->api_key, sizeof(s_primary->api_key), tmp);
         }
         char model_tmp[LLM_MODEL_MAX_LEN] = {0};
         len = sizeof(model_tmp);
         if (nvs_get_str(nvs, MIMI_NVS_KEY_MODEL, model_tmp, &len) == ESP_OK && model_tmp[0]) {
-            safe_copy(s_model, sizeof(s_model), model_tmp);
+            safe_copy(s_primary->model, sizeof(s_primary->model), model_tmp);
         }
         char provider_tmp[16] = {0};
         len = sizeof(provider_tmp);
         if (nvs_get_str(nvs, MIMI_NVS_KEY_PROVIDER, provider_tmp, &len) == ESP_OK && provider_tmp[0]) {
-            safe_copy(s_provider, sizeof(s_provider), provider_tmp);
+            safe_copy(s_primary->provider, sizeof(s_primary->provider), provider_tmp);
+        }
+        char url_tmp[sizeof(s_local.url)] = {0};
+        len = sizeof(url_tmp);
+        if (nvs_get_str(nvs, MIMI_NVS_KEY_LLM_URL, url_tmp, &len) == ESP_OK && url_tmp[0]) {
+            llm_local_url_t parsed;
+            if (llm_parse_local_url(url_tmp, &parsed) == ESP_OK) {
+                s_local = parsed;
+            }
+        }
+        for (int i = 1; i < MIMI_LLM_MAX_ENDPOINTS; i++) {
+            llm_load_fallback(nvs, i);
+        }
+        uint32_t hedge_ms = 0;
+        if (nvs_get_u32(nvs, MIMI_NVS_KEY_HEDGE_MS, &hedge_ms) == ESP_OK) {
+            s_hedge_ms = hedge_ms;
         }
         nvs_close(nvs);
     }
 
-    if (s_api_key[0]) {
-        ESP_LOGI(TAG, "LLM proxy initialized (provider: %s, model: %s)", s_provider, s_model);
+    if (s_primary->api_key[0] || provider_is_local(s_primary)) {
+        ESP_LOGI(TAG, "LLM proxy initialized (provider: %s, model: %s)",
+                 s_primary->provider, s_primary->model);
     } else {
         ESP_LOGW(TAG, "No API key. Use CLI: set_api_key <KEY>");
     }
+    for (int i = 1; i < MIMI_LLM_MAX_ENDPOINTS; i++) {
+        if (s_endpoints[i].provider[0]) {
+            ESP_LOGI(TAG, "Fallback %d: %s / %s", i, s_endpoints[i].provider, s_endpoints[i].model);
+        }
+    }
+    if (s_hedge_ms > 0) {
+        ESP_LOGI(TAG, "Hedging enabled after %u ms", (unsigned)s_hedge_ms);
+    }
+    if (s_local.url[0]) {
+        ESP_LOGI(TAG, "Local endpoint: %s", s_local.url);
+    }
     return ESP_OK;
 }
 
 /* ── Direct path: esp_http_client ───────────────────────────── */
 
-static esp_err_t llm_http_direct(const char *post_data, resp_buf_t *rb, int *out_status)
+static esp_err_t llm_http_direct(llm_call_t *call)
 {
+    const llm_endpoint_t *ep = call->ep;
     esp_http_client_config_t config = {
-        .url = llm_api_url(),
+        .url = llm_api_url(ep),
         .event_handler = http_event_handler,
-        .user_data = rb,
+        .user_data = call,
         .timeout_ms = 120 * 1000,
         .buffer_size = 4096,
         .buffer_size_tx = 4096,
         .crt_bundle_attach = esp_crt_bundle_attach,
     };
+    if (provider_is_local(ep) && !s_local.https) {
+        config.crt_bundle_attach = NULL;
+    }
 
     esp_http_client_handle_t client = esp_http_client_init(&config);
     if (!client) return ESP_FAIL;
 
     esp_http_client_set_method(client, HTTP_METHOD_POST);
     esp_http_client_set_header(client, "Content-Type", "application/json");
-    if (provider_is_openai()) {
-        if (s_api_key[0]) {
+    if (provider_is_openai(ep)) {
+        if (llm_api_key(ep)[0]) {
             char auth[LLM_API_KEY_MAX_LEN + 16];
-            snprintf(auth, sizeof(auth), "Bearer %s", s_api_key);
+            snprintf(auth, sizeof(auth), "Bearer %s", llm_api_key(ep));
             esp_http_client_set_header(client, "Authorization", auth);
         }
     } else {
-        esp_http_client_set_header(client, "x-api-key", s_api_key);
+        esp_http_client_set_header(client, "x-api-key", llm_api_key(ep));
         esp_http_client_set_header(client, "anthropic-version", MIMI_LLM_API_VERSION);
     }
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
 
-    esp_err_t err = esp_http_client_perform(client);
-    *out_status = esp_http_client_get_status_code(client);
+    /* open/write/read instead of perform() so a cancelled hedge can bail out early */
+    int body_len = strlen(call->post_data);
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = esp_http_client_open(client, body_len);
+    if (err != ESP_OK) {
+        esp_http_client_cleanup(client);
+        return err;
+    }
+    turn_trace_span(TRACE_LLM_CONNECT, ep->provider, t0, esp_timer_get_time());
+
+    int written = 0;
+    while (written < body_len) {
+        int n = esp_http_client_write(client, call->post_data + written, body_len - written);
+        if (n <= 0) break;
+        written += n;
+    }
+    if (written < body_len) {
+        esp_http_client_cleanup(client);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+
+    t0 = esp_timer_get_time();
+    if (esp_http_client_fetch_headers(client) < 0) {
+        esp_http_client_cleanup(client);
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    call->status = esp_http_client_get_status_code(client);
+    int64_t t_first = esp_timer_get_time();
+    turn_trace_span(TRACE_LLM_TTFB, ep->provider, t0, t_first);
+
+    char tmp[LLM_READ_CHUNK_BYTES];
+    while (!call->cancelled) {
+        int n = esp_http_client_read(client, tmp, sizeof(tmp));
+        if (n < 0) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        if (n == 0) break;
+        if (resp_buf_append(&call->rb, tmp, n) != ESP_OK) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+    }
+    turn_trace_span(TRACE_LLM_RECV, ep->provider, t_first, esp_timer_get_time());
+
     esp_http_client_cleanup(client);
     return err;
 }
 
 /* ── Proxy path: manual HTTP over CONNECT tunnel ────────────── */
 
-static esp_err_t llm_http_via_proxy(const char *post_data, resp_buf_t *rb, int *out_status)
+static esp_err_t llm_http_via_proxy(llm_call_t *call)
 {
-    proxy_conn_t *conn = proxy_conn_open(llm_api_host(), 443, 30000);
+    const llm_endpoint_t *ep = call->ep;
+    resp_buf_t *rb = &call->rb;
+    int64_t t0 = esp_timer_get_time();
+    proxy_conn_t *conn = proxy_conn_open(llm_api_host(ep), 443, 30000);
     if (!conn) return ESP_ERR_HTTP_CONNECT;
 
-    int body_len = strlen(post_data);
+    int64_t tunnel_done, tls_done;
+    proxy_conn_get_timing(conn, &tunnel_done, &tls_done);
+    turn_trace_span(TRACE_LLM_CONNECT, ep->provider, t0, tunnel_done);
+    turn_trace_span(TRACE_LLM_TLS, ep->provider, tunnel_done, tls_done);
+
+    int body_len = strlen(call->post_data);
     char header[1024];
     int hlen = 0;
-    if (provider_is_openai()) {
+    if (provider_is_openai(ep)) {
         hlen = snprintf(header, sizeof(header),
             "POST %s HTTP/1.1\r\n"
             "Host: %s\r\n"
@@ -253,7 +497,7 @@ static esp_err_t llm_http_via_proxy(const char *post_data, resp_buf_t *rb, int *
             "Authorization: Bearer %s\r\n"
             "Content-Length: %d\r\n"
             "Connection: close\r\n\r\n",
-            llm_api_path(), llm_api_host(), s_api_key, body_len);
+            llm_api_path(ep), llm_api_host(ep), llm_api_key(ep), body_len);
     } else {
         hlen = snprintf(header, sizeof(header),
             "POST %s HTTP/1.1\r\n"
@@ -263,34 +507,56 @@ static esp_err_t llm_http_via_proxy(const char *post_data, resp_buf_t *rb, int *
             "anthropic-version: %s\r\n"
             "Content-Length: %d\r\n"
             "Connection: close\r\n\r\n",
-            llm_api_path(), llm_api_host(), s_api_key, MIMI_LLM_API_VERSION, body_len);
+            llm_api_path(ep), llm_api_host(ep), llm_api_key(ep), MIMI_LLM_API_VERSION, body_len);
     }
 
     if (proxy_conn_write(conn, header, hlen) < 0 ||
-        proxy_conn_write(conn, post_data, body_len) < 0) {
+        proxy_conn_write(conn, call->post_data, body_len) < 0) {
         proxy_conn_close(conn);
         return ESP_ERR_HTTP_WRITE_DATA;
     }
 
     /* Read full response into buffer */
     char tmp[4096];
-    while (1) {
+    int64_t t_sent = esp_timer_get_time();
+    int64_t t_first = 0;
+    while (!call->cancelled) {
         int n = proxy_conn_read(conn, tmp, sizeof(tmp), 120000);
         if (n <= 0) break;
+        if (!t_first) {
+            t_first = esp_timer_get_time();
+            turn_trace_span(TRACE_LLM_TTFB, ep->provider, t_sent, t_first);
+        }
         if (resp_buf_append(rb, tmp, n) != ESP_OK) break;
     }
     proxy_conn_close(conn);
+    if (t_first) {
+        turn_trace_span(TRACE_LLM_RECV, ep->provider, t_first, esp_timer_get_time());
+    }
 
     /* Parse status line */
-    *out_status = 0;
+    call->status = 0;
     if (rb->len > 5 && strncmp(rb->data, "HTTP/", 5) == 0) {
         const char *sp = strchr(rb->data, ' ');
-        if (sp) *out_status = atoi(sp + 1);
+        if (sp) call->status = atoi(sp + 1);
+    }
+    if (call->status == 0) {
+        /* Nothing (read timeout) or no status line: fail over, don't mark the endpoint bad */
+        if (!call->cancelled) {
+            ESP_LOGW(TAG, "%s via proxy: %s", ep->provider,
+                     rb->len ? "no HTTP status line" : "no response");
+        }
+        return rb->len ? ESP_FAIL : ESP_ERR_TIMEOUT;
     }
 
     /* Strip HTTP headers, keep body only */
     char *body = strstr(rb->data, "\r\n\r\n");
     if (body) {
+        *body = '\0';
+        const char *ra = strcasestr(rb->data, "\r\nretry-after:");
+        if (ra) {
+            call->retry_after_s = atoi(ra + 14);
+        }
         body += 4;
         size_t blen = rb->len - (body - rb->data);
         memmove(rb->data, body, blen);
@@ -303,12 +569,16 @@ static esp_err_t llm_http_via_proxy(const char *post_data, resp_buf_t *rb, int *
 
 /* ── Shared HTTP dispatch ─────────────────────────────────────── */
 
-static esp_err_t llm_http_call(const char *post_data, resp_buf_t *rb, int *out_status)
+static esp_err_t llm_http_call(llm_call_t *call)
 {
-    if (http_proxy_is_enabled()) {
-        return llm_http_via_proxy(post_data, rb, out_status);
+    if (resp_buf_init(&call->rb, MIMI_LLM_STREAM_BUF_SIZE) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    /* A LAN server is reached directly; the proxy only tunnels TLS to the internet */
+    if (http_proxy_is_enabled() && !provider_is_local(call->ep)) {
+        return llm_http_via_proxy(call);
     } else {
-        return llm_http_direct(post_data, rb, out_status);
+        return llm_http_direct(call);
     }
 }
 
@@ -415,7 +685,7 @@ static cJSON *convert_messages_openai(const char *system_prompt, cJSON *messages
                         char *args = cJSON_PrintUnformatted(input);
                         if (args) {
                             cJSON_AddStringToObject(func, "arguments", args);
-                            free(args);
+                            cJSON_free(args);
                         }
                     }
                     cJSON_AddItemToObject(tc, "function", func);
@@ -481,40 +751,21 @@ static cJSON *convert_messages_openai(const char *system_prompt, cJSON *messages
     return out;
 }
 
-/* ── Public: chat with tools (non-streaming) ──────────────────── */
+/* ── Request / response (per provider) ────────────────────────── */
 
-void llm_response_free(llm_response_t *resp)
+static char *llm_build_body(const llm_endpoint_t *ep, const char *system_prompt,
+                            cJSON *messages, const char *tools_json)
 {
-    free(resp->text);
-    resp->text = NULL;
-    resp->text_len = 0;
-    for (int i = 0; i < resp->call_count; i++) {
-        free(resp->calls[i].input);
-        resp->calls[i].input = NULL;
-    }
-    resp->call_count = 0;
-    resp->tool_use = false;
-}
-
-esp_err_t llm_chat_tools(const char *system_prompt,
-                         cJSON *messages,
-                         const char *tools_json,
-                         llm_response_t *resp)
-{
-    memset(resp, 0, sizeof(*resp));
-
-    if (s_api_key[0] == '\0') return ESP_ERR_INVALID_STATE;
-
-    /* Build request body (non-streaming) */
+    int64_t t0 = esp_timer_get_time();
     cJSON *body = cJSON_CreateObject();
-    cJSON_AddStringToObject(body, "model", s_model);
-    if (provider_is_openai()) {
+    cJSON_AddStringToObject(body, "model", ep->model);
+    if (provider_is_openai(ep)) {
         cJSON_AddNumberToObject(body, "max_completion_tokens", MIMI_LLM_MAX_TOKENS);
     } else {
         cJSON_AddNumberToObject(body, "max_tokens", MIMI_LLM_MAX_TOKENS);
     }
 
-    if (provider_is_openai()) {
+    if (provider_is_openai(ep)) {
         cJSON *openai_msgs = convert_messages_openai(system_prompt, messages);
         cJSON_AddItemToObject(body, "messages", openai_msgs);
 
@@ -543,48 +794,25 @@ esp_err_t llm_chat_tools(const char *system_prompt,
 
     char *post_data = cJSON_PrintUnformatted(body);
     cJSON_Delete(body);
-    if (!post_data) return ESP_ERR_NO_MEM;
+    if (!post_data) return NULL;
+    turn_trace_span(TRACE_LLM_SERIALIZE, ep->provider, t0, esp_timer_get_time());
 
-    ESP_LOGI(TAG, "Calling LLM API with tools (provider: %s, model: %s, body: %d bytes)",
-             s_provider, s_model, (int)strlen(post_data));
+    DLOGI(TAG, "Calling LLM API with tools (provider: %s, model: %s, body: %d bytes)",
+          ep->provider, ep->model, (int)strlen(post_data));
     llm_log_payload("LLM tools request", post_data);
+    return post_data;
+}
 
-    /* HTTP call */
-    resp_buf_t rb;
-    if (resp_buf_init(&rb, MIMI_LLM_STREAM_BUF_SIZE) != ESP_OK) {
-        free(post_data);
-        return ESP_ERR_NO_MEM;
-    }
-
-    int status = 0;
-    esp_err_t err = llm_http_call(post_data, &rb, &status);
-    free(post_data);
-
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
-        llm_log_payload("LLM tools partial response", rb.data);
-        resp_buf_free(&rb);
-        return err;
-    }
-
-    llm_log_payload("LLM tools raw response", rb.data);
-
-    if (status != 200) {
-        ESP_LOGE(TAG, "API error %d: %.500s", status, rb.data ? rb.data : "");
-        resp_buf_free(&rb);
-        return ESP_FAIL;
-    }
-
-    /* Parse full JSON response */
-    cJSON *root = cJSON_Parse(rb.data);
-    resp_buf_free(&rb);
-
+static esp_err_t llm_parse_response(const llm_endpoint_t *ep, const char *data, llm_response_t *resp)
+{
+    int64_t t0 = esp_timer_get_time();
+    cJSON *root = cJSON_Parse(data);
     if (!root) {
         ESP_LOGE(TAG, "Failed to parse API response JSON");
         return ESP_FAIL;
     }
 
-    if (provider_is_openai()) {
+    if (provider_is_openai(ep)) {
         cJSON *choices = cJSON_GetObjectItem(root, "choices");
         cJSON *choice0 = choices && cJSON_IsArray(choices) ? cJSON_GetArrayItem(choices, 0) : NULL;
         if (choice0) {
@@ -710,14 +938,359 @@ esp_err_t llm_chat_tools(const char *system_prompt,
     }
 
     cJSON_Delete(root);
+    turn_trace_span(TRACE_LLM_PARSE, ep->provider, t0, esp_timer_get_time());
 
-    ESP_LOGI(TAG, "Response: %d bytes text, %d tool calls, stop=%s",
-             (int)resp->text_len, resp->call_count,
-             resp->tool_use ? "tool_use" : "end_turn");
+    DLOGI(TAG, "Response: %d bytes text, %d tool calls, stop=%s",
+          (int)resp->text_len, resp->call_count,
+          resp->tool_use ? "tool_use" : "end_turn");
 
     return ESP_OK;
 }
 
+/* ── Endpoint health (circuit breaker + backoff) ──────────────── */
+
+static bool endpoint_configured(const llm_endpoint_t *ep)
+{
+    if (!ep->provider[0] || !ep->model[0]) return false;
+    if (provider_is_local(ep)) return s_local.url[0] != '\0';   /* key optional */
+    return llm_api_key(ep)[0] != '\0';
+}
+
+/* Timeouts, transport errors, a missing status, 408/429/529 and 5xx are worth retrying;
+ * other 4xx mean the request or credentials are wrong for this endpoint. */
+static bool call_is_retryable(const llm_call_t *call)
+{
+    if (call->err != ESP_OK || call->status == 0) return true;
+    return call->status == 408 || call->status == 429 || call->status >= 500;
+}
+
+static bool call_succeeded(const llm_call_t *call)
+{
+    return call->err == ESP_OK && call->status == 200;
+}
+
+static void endpoint_record(llm_endpoint_t *ep, const llm_call_t *call)
+{
+    ep->last_status = call->status;
+    if (call_succeeded(call)) {
+        ep->fail_count = 0;
+        ep->retry_at_us = 0;
+        ep->ok_total++;
+        return;
+    }
+
+    ep->fail_count++;
+    ep->fail_total++;
+
+    uint32_t shift = ep->fail_count - 1;
+    if (shift > 16) shift = 16;
+    int64_t backoff_ms = (int64_t)MIMI_LLM_BACKOFF_BASE_MS << shift;
+    if (call->retry_after_s > 0) {
+        backoff_ms = (int64_t)call->retry_after_s * 1000;
+    }
+    if (backoff_ms > MIMI_LLM_BACKOFF_MAX_MS) {
+        backoff_ms = MIMI_LLM_BACKOFF_MAX_MS;
+    }
+    ep->retry_at_us = esp_timer_get_time() + backoff_ms * 1000;
+
+    ESP_LOGW(TAG, "Endpoint %s/%s failed (%s, status %d), fails=%u, backoff %lld ms%s",
+             ep->provider, ep->model, esp_err_to_name(call->err), call->status,
+             (unsigned)ep->fail_count, (long long)backoff_ms,
+             ep->fail_count >= MIMI_LLM_CB_THRESHOLD ? " [breaker open]" : "");
+}
+
+/* Breaker is closed below the threshold; once open it lets one attempt
+ * through (half-open) when the backoff expires. */
+static bool endpoint_available(const llm_endpoint_t *ep, int64_t now)
+{
+    return ep->fail_count < MIMI_LLM_CB_THRESHOLD || now >= ep->retry_at_us;
+}
+
+/**
+ * Pick the next endpoint to try: the first untried endpoint whose breaker
+ * allows it, else whichever retryable endpoint comes out of backoff first.
+ * *wait_us is how long to sleep before using it.
+ */
+static int llm_pick_endpoint(uint32_t tried, uint32_t dead, int64_t *wait_us)
+{
+    int64_t now = esp_timer_get_time();
+    *wait_us = 0;
+
+    for (int i = 0; i < MIMI_LLM_MAX_ENDPOINTS; i++) {
+        if (!endpoint_configured(&s_endpoints[i])) continue;
+        if ((tried | dead) & (1u << i)) continue;
+        if (endpoint_available(&s_endpoints[i], now)) return i;
+    }
+
+    int best = -1;
+    for (int i = 0; i < MIMI_LLM_MAX_ENDPOINTS; i++) {
+        if (!endpoint_configured(&s_endpoints[i])) continue;
+        if (dead & (1u << i)) continue;
+        if (best < 0 || s_endpoints[i].retry_at_us < s_endpoints[best].retry_at_us) {
+            best = i;
+        }
+    }
+    if (best >= 0 && s_endpoints[best].retry_at_us > now) {
+        *wait_us = s_endpoints[best].retry_at_us - now;
+    }
+    return best;
+}
+
+/* ── Hedged requests ──────────────────────────────────────────── */
+
+/* Shared between the caller and up to two worker tasks; freed by whoever
+ * drops the last reference, so a cancelled loser can finish on its own. */
+typedef struct llm_race {
+    llm_call_t calls[2];
+    QueueHandle_t done;         /* slot index of each finished call */
+    int refs;
+} llm_race_t;
+
+static portMUX_TYPE s_race_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void llm_race_release(llm_race_t *race)
+{
+    portENTER_CRITICAL(&s_race_lock);
+    int refs = --race->refs;
+    portEXIT_CRITICAL(&s_race_lock);
+    if (refs > 0) return;
+
+    for (int i = 0; i < 2; i++) {
+        cJSON_free(race->calls[i].post_data);
+        resp_buf_free(&race->calls[i].rb);
+    }
+    vQueueDelete(race->done);
+    free(race);
+}
+
+static void llm_race_worker(void *arg)
+{
+    llm_call_t *call = (llm_call_t *)arg;
+    llm_race_t *race = call->race;
+    int slot = call->slot;
+
+    call->err = llm_http_call(call);
+    if (call->cancelled) {
+        DLOGI(TAG, "Hedge loser %s/%s finished after cancel", call->ep->provider, call->ep->model);
+    }
+    xQueueSend(race->done, &slot, 0);
+    llm_race_release(race);
+    vTaskDelete(NULL);
+}
+
+static bool llm_race_start(llm_race_t *race, int slot)
+{
+    portENTER_CRITICAL(&s_race_lock);
+    race->refs++;
+    portEXIT_CRITICAL(&s_race_lock);
+
+    llm_call_t *call = &race->calls[slot];
+    call->race = race;
+    call->slot = slot;
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        llm_race_worker, slot == 0 ? "llm_primary" : "llm_hedge",
+        MIMI_LLM_WORKER_STACK, call,
+        MIMI_AGENT_PRIO, NULL, MIMI_AGENT_CORE);
+    if (ok != pdPASS) {
+        ESP_LOGW(TAG, "Failed to start %s worker", slot == 0 ? "primary" : "hedge");
+        llm_race_release(race);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Run the request against `primary`; if no answer arrives within the hedge
+ * threshold, fire the same turn at `alt` and take whichever succeeds first.
+ * Health is recorded for every call that finished. On success the winner's
+ * response buffer is moved into *out and its endpoint into *out_idx.
+ */
+static esp_err_t llm_call_hedged(int primary, int alt, char *post_data,
+                                 const char *system_prompt, cJSON *messages, const char *tools_json,
+                                 uint32_t *tried, uint32_t *dead,
+                                 resp_buf_t *out, int *out_idx)
+{
+    llm_race_t *race = heap_caps_calloc(1, sizeof(*race), MALLOC_CAP_SPIRAM);
+    QueueHandle_t done = xQueueCreate(2, sizeof(int));
+    if (!race || !done) {
+        free(race);
+        if (done) vQueueDelete(done);
+        cJSON_free(post_data);
+        return ESP_ERR_NO_MEM;
+    }
+    race->done = done;
+    race->refs = 1;
+    race->calls[0].ep = &s_endpoints[primary];
+    race->calls[0].ep_idx = primary;
+    race->calls[0].post_data = post_data;
+
+    if (!llm_race_start(race, 0)) {
+        llm_race_release(race);
+        return ESP_FAIL;
+    }
+
+    int pending = 1;
+    int winner = -1;
+    bool hedged = false;
+    esp_err_t last_err = ESP_FAIL;
+
+    while (pending > 0 && winner < 0) {
+        int slot;
+        TickType_t wait = hedged ? portMAX_DELAY : pdMS_TO_TICKS(s_hedge_ms);
+        if (xQueueReceive(race->done, &slot, wait) == pdTRUE) {
+            pending--;
+            llm_call_t *call = &race->calls[slot];
+            endpoint_record(&s_endpoints[call->ep_idx], call);
+            if (call_succeeded(call)) {
+                winner = slot;
+            } else {
+                last_err = call->err != ESP_OK ? call->err : ESP_FAIL;
+                if (!call_is_retryable(call)) {
+                    *dead |= 1u << call->ep_idx;
+                }
+                if (call->rb.data) {
+                    ESP_LOGE(TAG, "API error %d: %.500s", call->status, call->rb.data);
+                }
+            }
+            continue;
+        }
+
+        /* Primary is slow: fire the hedge */
+        hedged = true;
+        bool arena = json_arena_suspend();
+        char *alt_body = llm_build_body(&s_endpoints[alt], system_prompt, messages, tools_json);
+        json_arena_resume(arena);
+        if (!alt_body) continue;
+        ESP_LOGW(TAG, "No response after %u ms, hedging to %s/%s",
+                 (unsigned)s_hedge_ms, s_endpoints[alt].provider, s_endpoints[alt].model);
+        race->calls[1].ep = &s_endpoints[alt];
+        race->calls[1].ep_idx = alt;
+        race->calls[1].post_data = alt_body;
+        *tried |= 1u << alt;
+        if (llm_race_start(race, 1)) {
+            pending++;
+        }
+    }
+
+    if (winner >= 0) {
+        for (int i = 0; i < 2; i++) {
+            race->calls[i].cancelled = (i != winner);
+        }
+        *out = race->calls[winner].rb;
+        *out_idx = race->calls[winner].ep_idx;
+        memset(&race->calls[winner].rb, 0, sizeof(resp_buf_t));
+        if (hedged) {
+            DLOGI(TAG, "Hedge race won by %s", winner == 0 ? "primary" : "hedge");
+        }
+    }
+
+    llm_race_release(race);
+    return winner >= 0 ? ESP_OK : last_err;
+}
+
+/* ── Public: chat with tools (non-streaming) ──────────────────── */
+
+void llm_response_free(llm_response_t *resp)
+{
+    free(resp->text);
+    resp->text = NULL;
+    resp->text_len = 0;
+    for (int i = 0; i < resp->call_count; i++) {
+        cJSON_free(resp->calls[i].input);
+        resp->calls[i].input = NULL;
+    }
+    resp->call_count = 0;
+    resp->tool_use = false;
+}
+
+esp_err_t llm_chat_tools(const char *system_prompt,
+                         cJSON *messages,
+                         const char *tools_json,
+                         llm_response_t *resp)
+{
+    memset(resp, 0, sizeof(*resp));
+
+    if (!endpoint_configured(s_primary)) return ESP_ERR_INVALID_STATE;
+
+    uint32_t tried = 0;
+    uint32_t dead = 0;
+    esp_err_t err = ESP_FAIL;
+
+    for (int attempt = 0; attempt < MIMI_LLM_MAX_ATTEMPTS; attempt++) {
+        int64_t wait_us = 0;
+        int idx = llm_pick_endpoint(tried, dead, &wait_us);
+        if (idx < 0) break;
+        if (wait_us > (int64_t)MIMI_LLM_RETRY_WAIT_MAX_MS * 1000) {
+            ESP_LOGW(TAG, "All LLM endpoints backing off (next in %lld ms), giving up",
+                     (long long)(wait_us / 1000));
+            break;
+        }
+        if (wait_us > 0) {
+            ESP_LOGW(TAG, "Backing off %lld ms before retrying %s/%s",
+                     (long long)(wait_us / 1000), s_endpoints[idx].provider, s_endpoints[idx].model);
+            vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+        }
+        tried |= 1u << idx;
+
+        /* Hedge only when a different healthy endpoint is available */
+        int64_t alt_wait = 0;
+        int alt = (s_hedge_ms > 0) ? llm_pick_endpoint(tried, dead, &alt_wait) : -1;
+        if (alt == idx || alt_wait > 0) alt = -1;
+
+        /* Hedge workers can outlive the turn, so their bodies stay off the turn arena */
+        bool arena = (alt >= 0) ? json_arena_suspend() : false;
+        char *post_data = llm_build_body(&s_endpoints[idx], system_prompt, messages, tools_json);
+        if (alt >= 0) json_arena_resume(arena);
+        if (!post_data) return ESP_ERR_NO_MEM;
+
+        resp_buf_t rb = {0};
+        int winner = idx;
+        if (alt >= 0) {
+            err = llm_call_hedged(idx, alt, post_data, system_prompt, messages, tools_json,
+                                  &tried, &dead, &rb, &winner);
+        } else {
+            llm_call_t call = {
+                .ep = &s_endpoints[idx],
+                .ep_idx = idx,
+                .post_data = post_data,
+            };
+            call.err = llm_http_call(&call);
+            cJSON_free(post_data);
+            endpoint_record(&s_endpoints[idx], &call);
+
+            if (call_succeeded(&call)) {
+                rb = call.rb;
+                err = ESP_OK;
+            } else {
+                if (call.err != ESP_OK) {
+                    ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(call.err));
+                    llm_log_payload("LLM tools partial response", call.rb.data);
+                } else {
+                    ESP_LOGE(TAG, "API error %d: %.500s", call.status, call.rb.data ? call.rb.data : "");
+                }
+                if (!call_is_retryable(&call)) {
+                    dead |= 1u << idx;
+                }
+                err = call.err != ESP_OK ? call.err : ESP_FAIL;
+                resp_buf_free(&call.rb);
+            }
+        }
+
+        if (err != ESP_OK) continue;
+
+        llm_log_payload("LLM tools raw response", rb.data);
+        err = llm_parse_response(&s_endpoints[winner], rb.data, resp);
+        resp_buf_free(&rb);
+        if (err == ESP_OK && winner != 0) {
+            DLOGI(TAG, "Served by fallback %s/%s",
+                  s_endpoints[winner].provider, s_endpoints[winner].model);
+        }
+        return err;
+    }
+
+    return err;
+}
+
 /* ── NVS helpers ──────────────────────────────────────────────── */
 
 esp_err_t llm_set_api_key(const char *api_key)
@@ -728,7 +1301,7 @@ esp_err_t llm_set_api_key(const char *api_key)
     ESP_ERROR_CHECK(nvs_commit(nvs));
     nvs_close(nvs);
 
-    safe_copy(s_api_key, sizeof(s_api_key), api_key);
+    safe_copy(s_primary->api_key, sizeof(s_primary->api_key), api_key);
     ESP_LOGI(TAG, "API key saved");
     return ESP_OK;
 }
@@ -741,8 +1314,8 @@ esp_err_t llm_set_model(const char *model)
     ESP_ERROR_CHECK(nvs_commit(nvs));
     nvs_close(nvs);
 
-    safe_copy(s_model, sizeof(s_model), model);
-    ESP_LOGI(TAG, "Model set to: %s", s_model);
+    safe_copy(s_primary->model, sizeof(s_primary->model), model);
+    ESP_LOGI(TAG, "Model set to: %s", s_primary->model);
     return ESP_OK;
 }
 
@@ -754,7 +1327,106 @@ esp_err_t llm_set_provider(const char *provider)
     ESP_ERROR_CHECK(nvs_commit(nvs));
     nvs_close(nvs);
 
-    safe_copy(s_provider, sizeof(s_provider), provider);
-    ESP_LOGI(TAG, "Provider set to: %s", s_provider);
+    safe_copy(s_primary->provider, sizeof(s_primary->provider), provider);
+    ESP_LOGI(TAG, "Provider set to: %s", s_primary->provider);
     return ESP_OK;
 }
+
+esp_err_t llm_set_url(const char *url)
+{
+    llm_local_url_t parsed;
+    if (!url || llm_parse_local_url(url, &parsed) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs;
+    ESP_ERROR_CHECK(nvs_open(MIMI_NVS_LLM, NVS_READWRITE, &nvs));
+    ESP_ERROR_CHECK(nvs_set_str(nvs, MIMI_NVS_KEY_LLM_URL, parsed.url));
+    ESP_ERROR_CHECK(nvs_commit(nvs));
+    nvs_close(nvs);
+
+    s_local = parsed;
+    ESP_LOGI(TAG, "Local endpoint set to: %s", s_local.url);
+    return ESP_OK;
+}
+
+esp_err_t llm_set_fallback(int slot, const char *provider, const char *model, const char *api_key)
+{
+    if (slot < 1 || slot >= MIMI_LLM_MAX_ENDPOINTS || !provider || !model) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char prov_key[16], model_key[16], api_key_key[16];
+    fallback_nvs_keys(slot, prov_key, model_key, api_key_key);
+
+    nvs_handle_t nvs;
+    ESP_ERROR_CHECK(nvs_open(MIMI_NVS_LLM, NVS_READWRITE, &nvs));
+    ESP_ERROR_CHECK(nvs_set_str(nvs, prov_key, provider));
+    ESP_ERROR_CHECK(nvs_set_str(nvs, model_key, model));
+    ESP_ERROR_CHECK(nvs_set_str(nvs, api_key_key, api_key ? api_key : ""));
+    ESP_ERROR_CHECK(nvs_commit(nvs));
+    nvs_close(nvs);
+
+    llm_endpoint_t *ep = &s_endpoints[slot];
+    memset(ep, 0, sizeof(*ep));
+    safe_copy(ep->provider, sizeof(ep->provider), provider);
+    safe_copy(ep->model, sizeof(ep->model), model);
+    safe_copy(ep->api_key, sizeof(ep->api_key), api_key);
+    ESP_LOGI(TAG, "Fallback %d set to: %s / %s", slot, ep->provider, ep->model);
+    return ESP_OK;
+}
+
+esp_err_t llm_clear_fallbacks(void)
+{
+    nvs_handle_t nvs;
+    ESP_ERROR_CHECK(nvs_open(MIMI_NVS_LLM, NVS_READWRITE, &nvs));
+    for (int i = 1; i < MIMI_LLM_MAX_ENDPOINTS; i++) {
+        char prov_key[16], model_key[16], api_key_key[16];
+        fallback_nvs_keys(i, prov_key, model_key, api_key_key);
+        nvs_erase_key(nvs, prov_key);
+        nvs_erase_key(nvs, model_key);
+        nvs_erase_key(nvs, api_key_key);
+        memset(&s_endpoints[i], 0, sizeof(s_endpoints[i]));
+    }
+    nvs_commit(nvs);
+    nvs_close(nvs);
+
+    ESP_LOGI(TAG, "Fallbacks cleared");
+    return ESP_OK;
+}
+
+esp_err_t llm_set_hedge_ms(uint32_t hedge_ms)
+{
+    nvs_handle_t nvs;
+    ESP_ERROR_CHECK(nvs_open(MIMI_NVS_LLM, NVS_READWRITE, &nvs));
+    ESP_ERROR_CHECK(nvs_set_u32(nvs, MIMI_NVS_KEY_HEDGE_MS, hedge_ms));
+    ESP_ERROR_CHECK(nvs_commit(nvs));
+    nvs_close(nvs);
+
+    s_hedge_ms = hedge_ms;
+    ESP_LOGI(TAG, "Hedge threshold set to %u ms%s", (unsigned)hedge_ms, hedge_ms ? "" : " (off)");
+    return ESP_OK;
+}
+
+void llm_print_endpoints(void)
+{
+    int64_t now = esp_timer_get_time();
+    ESP_LOGI(TAG, "Hedging: %s (%u ms)", s_hedge_ms ? "on" : "off", (unsigned)s_hedge_ms);
+    ESP_LOGI(TAG, "Local URL: %s", s_local.url[0] ? s_local.url : "(not set)");
+    for (int i = 0; i < MIMI_LLM_MAX_ENDPOINTS; i++) {
+        const llm_endpoint_t *ep = &s_endpoints[i];
+        if (!ep->provider[0]) continue;
+
+        const char *state = "closed";
+        if (!endpoint_configured(ep)) {
+            state = "unconfigured";
+        } else if (ep->fail_count >= MIMI_LLM_CB_THRESHOLD) {
+            state = endpoint_available(ep, now) ? "half-open" : "open";
+        }
+        int64_t backoff_ms = ep->retry_at_us > now ? (ep->retry_at_us - now) / 1000 : 0;
+        ESP_LOGI(TAG, "  [%d] %s / %s: %s, fails=%u, ok=%u, failed=%u, last_status=%d, backoff=%lld ms",
+                 i, ep->provider, ep->model, state,
+                 (unsigned)ep->fail_count, (unsigned)ep->ok_total, (unsigned)ep->fail_total,
+                 ep->last_status, (long long)backoff_ms);
+    }
+}
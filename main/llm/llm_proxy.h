@@ -18,7 +18,7 @@ esp_err_t llm_proxy_init(void);
 esp_err_t llm_set_api_key(const char *api_key);
 
 /**
- * Save the LLM provider to NVS. (e.g. "anthropic", "openai")
+ * Save the LLM provider to NVS. (e.g. "anthropic", "openai", "local")
  */
 esp_err_t llm_set_provider(const char *provider);
 
@@ -27,11 +27,41 @@ esp_err_t llm_set_provider(const char *provider);
  */
 esp_err_t llm_set_model(const char *model);
 
+/**
+ * Save the URL of the OpenAI-compatible server used by provider "local"
+ * (http[s]://host[:port][/path]) to NVS. Returns ESP_ERR_INVALID_ARG if
+ * the URL cannot be parsed.
+ */
+esp_err_t llm_set_url(const char *url);
+
+/**
+ * Save a fallback endpoint (slot 1..MIMI_LLM_MAX_ENDPOINTS-1) to NVS.
+ * An empty api_key reuses the primary key.
+ */
+esp_err_t llm_set_fallback(int slot, const char *provider, const char *model, const char *api_key);
+
+/**
+ * Remove all fallback endpoints from NVS and memory.
+ */
+esp_err_t llm_clear_fallbacks(void);
+
+/**
+ * Save the hedge threshold to NVS. If the answering endpoint has not responded
+ * within hedge_ms, the same request is sent to a healthy fallback and the first
+ * success wins. 0 disables hedging.
+ */
+esp_err_t llm_set_hedge_ms(uint32_t hedge_ms);
+
+/**
+ * Log every configured endpoint with its breaker state and counters.
+ */
+void llm_print_endpoints(void);
+
 /* ── Tool Use Support ──────────────────────────────────────────── */
 
 typedef struct {
     char id[64];        /* "toolu_xxx" */
-    char name[32];      /* "web_search" */
+    char name[MIMI_TOOL_NAME_MAX + 1];  /* "web_search" */
     char *input;        /* heap-allocated JSON string */
     size_t input_len;
 } llm_tool_call_t;
@@ -0,0 +1,364 @@
+#include "fact_store.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+#include "storage/fs_catalog.h"
+
+static const char *TAG = "facts";
+
+/* Worst case: every key/category/value byte escaped as \uXXXX, plus field
+ * names, op and timestamp; one record always fits a single fgets */
+#define FACT_LINE_MAX       ((MIMI_FACT_KEY_LEN + MIMI_FACT_CAT_LEN + MIMI_FACT_VALUE_LEN) * 6 + 128)
+#define FACT_DEFAULT_CAT    "general"
+
+static fact_t *s_facts = NULL;          /* MIMI_FACT_MAX entries, PSRAM */
+static int s_count = 0;
+static int s_log_records = 0;           /* lines in the log file */
+static SemaphoreHandle_t s_lock = NULL;
+
+/* ── In-memory table ──────────────────────────────────────────── */
+
+static int find(const char *key)
+{
+    for (int i = 0; i < s_count; i++) {
+        if (strcasecmp(s_facts[i].key, key) == 0) return i;
+    }
+    return -1;
+}
+
+static void apply_set(const char *key, const char *category, const char *value, int64_t ts, bool *created)
+{
+    int i = find(key);
+    if (created) *created = (i < 0);
+    if (i < 0) {
+        if (s_count >= MIMI_FACT_MAX) return;
+        i = s_count++;
+        memset(&s_facts[i], 0, sizeof(fact_t));
+        strncpy(s_facts[i].key, key, MIMI_FACT_KEY_LEN - 1);
+        strncpy(s_facts[i].category, FACT_DEFAULT_CAT, MIMI_FACT_CAT_LEN - 1);
+    }
+    if (category && category[0]) {
+        strncpy(s_facts[i].category, category, MIMI_FACT_CAT_LEN - 1);
+        s_facts[i].category[MIMI_FACT_CAT_LEN - 1] = '\0';
+    }
+    strncpy(s_facts[i].value, value, MIMI_FACT_VALUE_LEN - 1);
+    s_facts[i].value[MIMI_FACT_VALUE_LEN - 1] = '\0';
+    s_facts[i].updated = ts;
+}
+
+static bool apply_del(const char *key)
+{
+    int i = find(key);
+    if (i < 0) return false;
+    /* Keep insertion order so the prompt rendering stays stable */
+    memmove(&s_facts[i], &s_facts[i + 1], (s_count - i - 1) * sizeof(fact_t));
+    s_count--;
+    return true;
+}
+
+/* ── Log ──────────────────────────────────────────────────────── */
+
+static char *record_line(const char *op, const fact_t *f, const char *key)
+{
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddStringToObject(obj, "op", op);
+    cJSON_AddStringToObject(obj, "k", f ? f->key : key);
+    if (f) {
+        cJSON_AddStringToObject(obj, "c", f->category);
+        cJSON_AddStringToObject(obj, "v", f->value);
+        cJSON_AddNumberToObject(obj, "t", (double)f->updated);
+    }
+    char *line = cJSON_PrintUnformatted(obj);
+    cJSON_Delete(obj);
+    return line;
+}
+
+static esp_err_t log_compact(void)
+{
+    const char *tmp = MIMI_FACT_FILE ".tmp";
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        ESP_LOGE(TAG, "Cannot open %s", tmp);
+        return ESP_FAIL;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < s_count && ok; i++) {
+        char *line = record_line("set", &s_facts[i], NULL);
+        ok = line && fprintf(f, "%s\n", line) > 0;
+        cJSON_free(line);
+    }
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok) {
+        remove(tmp);
+        ESP_LOGE(TAG, "Compaction failed, keeping the old log");
+        return ESP_FAIL;
+    }
+
+    /* LittleFS replaces the old log atomically; SPIFFS cannot rename over a
+     * file, and if power is lost after the remove, init adopts the .tmp */
+    int rc = rename(tmp, MIMI_FACT_FILE);
+    if (rc != 0) {
+        remove(MIMI_FACT_FILE);
+        rc = rename(tmp, MIMI_FACT_FILE);
+    }
+    fs_catalog_update(tmp);
+    fs_catalog_update(MIMI_FACT_FILE);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Cannot rename %s", tmp);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Compacted fact log: %d -> %d records", s_log_records, s_count);
+    s_log_records = s_count;
+    return ESP_OK;
+}
+
+static esp_err_t log_append(const char *op, const fact_t *fact, const char *key)
+{
+    char *line = record_line(op, fact, key);
+    if (!line) return ESP_ERR_NO_MEM;
+
+    FILE *f = fopen(MIMI_FACT_FILE, "a");
+    if (!f) {
+        cJSON_free(line);
+        ESP_LOGE(TAG, "Cannot open %s", MIMI_FACT_FILE);
+        return ESP_FAIL;
+    }
+    fprintf(f, "%s\n", line);
+    fclose(f);
+    cJSON_free(line);
+    fs_catalog_update(MIMI_FACT_FILE);
+    s_log_records++;
+
+    if (s_log_records > 2 * s_count + MIMI_FACT_COMPACT_SLACK) {
+        log_compact();
+    }
+    return ESP_OK;
+}
+
+/* Finish or discard a compaction that was cut short */
+static void log_recover(void)
+{
+    const char *tmp = MIMI_FACT_FILE ".tmp";
+    struct stat st;
+    if (stat(tmp, &st) != 0) return;
+
+    if (stat(MIMI_FACT_FILE, &st) != 0) {
+        /* Old log already removed: the .tmp was complete before that */
+        if (rename(tmp, MIMI_FACT_FILE) == 0) {
+            ESP_LOGW(TAG, "Recovered fact log from %s", tmp);
+        }
+    } else {
+        remove(tmp);
+    }
+    fs_catalog_update(tmp);
+    fs_catalog_update(MIMI_FACT_FILE);
+}
+
+static void log_replay(void)
+{
+    FILE *f = fopen(MIMI_FACT_FILE, "r");
+    if (!f) return;
+
+    char *line = malloc(FACT_LINE_MAX);
+    if (!line) {
+        fclose(f);
+        return;
+    }
+
+    while (fgets(line, FACT_LINE_MAX, f)) {
+        size_t len = strlen(line);
+        if (len == FACT_LINE_MAX - 1 && line[len - 1] != '\n') {
+            /* Not written by us: skip the whole line rather than parse its pieces */
+            ESP_LOGW(TAG, "Skipping over-long record in %s", MIMI_FACT_FILE);
+            int c;
+            while ((c = fgetc(f)) != EOF && c != '\n') {}
+            continue;
+        }
+        cJSON *obj = cJSON_Parse(line);
+        if (!obj) continue;
+        s_log_records++;
+
+        const char *op = cJSON_GetStringValue(cJSON_GetObjectItem(obj, "op"));
+        const char *key = cJSON_GetStringValue(cJSON_GetObjectItem(obj, "k"));
+        if (op && key) {
+            if (strcmp(op, "set") == 0) {
+                const char *value = cJSON_GetStringValue(cJSON_GetObjectItem(obj, "v"));
+                cJSON *ts = cJSON_GetObjectItem(obj, "t");
+                if (value) {
+                    apply_set(key, cJSON_GetStringValue(cJSON_GetObjectItem(obj, "c")), value,
+                              cJSON_IsNumber(ts) ? (int64_t)ts->valuedouble : 0, NULL);
+                }
+            } else if (strcmp(op, "del") == 0) {
+                apply_del(key);
+            }
+        }
+        cJSON_Delete(obj);
+    }
+
+    free(line);
+    fclose(f);
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t fact_store_init(void)
+{
+    s_facts = heap_caps_calloc(MIMI_FACT_MAX, sizeof(fact_t), MALLOC_CAP_SPIRAM);
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_facts || !s_lock) {
+        ESP_LOGE(TAG, "Out of memory for fact store");
+        return ESP_ERR_NO_MEM;
+    }
+
+    log_recover();
+    log_replay();
+    if (s_log_records > 2 * s_count + MIMI_FACT_COMPACT_SLACK) {
+        log_compact();
+    }
+
+    ESP_LOGI(TAG, "Fact store: %d facts (%d log records)", s_count, s_log_records);
+    return ESP_OK;
+}
+
+esp_err_t fact_upsert(const char *key, const char *category, const char *value, bool *created)
+{
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+    if (!key || !key[0] || strlen(key) >= MIMI_FACT_KEY_LEN ||
+        !value || !value[0] || strlen(value) >= MIMI_FACT_VALUE_LEN ||
+        (category && strlen(category) >= MIMI_FACT_CAT_LEN)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find(key);
+    if (i < 0 && s_count >= MIMI_FACT_MAX) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Skip the flash write when nothing changes */
+    if (i >= 0 && strcmp(s_facts[i].value, value) == 0 &&
+        (!category || !category[0] || strcmp(s_facts[i].category, category) == 0)) {
+        if (created) *created = false;
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+
+    apply_set(key, category, value, (int64_t)time(NULL), created);
+    esp_err_t err = log_append("set", &s_facts[find(key)], NULL);
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+esp_err_t fact_get(const char *key, fact_t *out)
+{
+    if (!s_lock || !key) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find(key);
+    if (i >= 0) *out = s_facts[i];
+    xSemaphoreGive(s_lock);
+    return i >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t fact_delete(const char *key)
+{
+    if (!s_lock || !key) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (apply_del(key)) {
+        err = log_append("del", NULL, key);
+    }
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+int fact_store_list(const char *category, const char *prefix, char *buf, size_t size)
+{
+    if (size == 0) return 0;
+    buf[0] = '\0';
+    if (!s_lock) return 0;
+
+    size_t off = 0;
+    int n = 0;
+    size_t plen = prefix ? strlen(prefix) : 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < s_count && off < size - 1; i++) {
+        const fact_t *f = &s_facts[i];
+        if (category && category[0] && strcasecmp(f->category, category) != 0) continue;
+        if (plen && strncasecmp(f->key, prefix, plen) != 0) continue;
+        off += snprintf(buf + off, size - off, "%s [%s]: %s\n", f->key, f->category, f->value);
+        n++;
+    }
+    xSemaphoreGive(s_lock);
+
+    if (off >= size) buf[size - 1] = '\0';
+    return n;
+}
+
+size_t fact_store_render(char *buf, size_t size)
+{
+    if (size == 0) return 0;
+    buf[0] = '\0';
+    if (!s_lock) return 0;
+
+    size_t off = 0;
+    int shown = 0;
+    bool full = false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    /* Categories in order of first appearance */
+    for (int i = 0; i < s_count && !full; i++) {
+        bool seen = false;
+        for (int j = 0; j < i && !seen; j++) {
+            seen = strcmp(s_facts[j].category, s_facts[i].category) == 0;
+        }
+        if (seen) continue;
+
+        int n = snprintf(buf + off, size - off, "%s[%s]\n", off ? "\n" : "", s_facts[i].category);
+        if (n < 0 || off + n >= size) {
+            buf[off] = '\0';
+            break;
+        }
+        off += n;
+
+        for (int j = i; j < s_count; j++) {
+            if (strcmp(s_facts[j].category, s_facts[i].category) != 0) continue;
+            n = snprintf(buf + off, size - off, "- %s: %s\n", s_facts[j].key, s_facts[j].value);
+            if (n < 0 || off + n >= size) {
+                buf[off] = '\0';
+                full = true;
+                break;
+            }
+            off += n;
+            shown++;
+        }
+    }
+    int total = s_count;
+    xSemaphoreGive(s_lock);
+
+    if (shown < total) {
+        int n = snprintf(buf + off, size - off, "(%d more, use memory_get)\n", total - shown);
+        if (n > 0 && off + n < size) off += n;
+    }
+    return off;
+}
+
+int fact_store_count(void)
+{
+    return s_count;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mimi_config.h"
+
+/**
+ * Structured key/value facts ("user.name" = "Alex", category "user").
+ *
+ * Facts are held in PSRAM and persisted as an append-only JSONL log
+ * (MIMI_FACT_FILE): one "set" or "del" record per change. The log is
+ * rewritten with only the live facts once it grows past twice their count.
+ * Keys are case-insensitive.
+ */
+
+typedef struct {
+    char key[MIMI_FACT_KEY_LEN];
+    char category[MIMI_FACT_CAT_LEN];
+    char value[MIMI_FACT_VALUE_LEN];
+    int64_t updated;            /* unix time of the last upsert */
+} fact_t;
+
+/**
+ * Replay the log from flash.
+ */
+esp_err_t fact_store_init(void);
+
+/**
+ * Insert or update a fact. category may be NULL (keeps the old one, or "general").
+ * @param created  Set to true when the key was new (may be NULL)
+ * @return ESP_ERR_INVALID_ARG for empty/oversized key or value,
+ *         ESP_ERR_NO_MEM when the store is full
+ */
+esp_err_t fact_upsert(const char *key, const char *category, const char *value, bool *created);
+
+/**
+ * Copy one fact by key.
+ * @return ESP_ERR_NOT_FOUND if missing
+ */
+esp_err_t fact_get(const char *key, fact_t *out);
+
+/**
+ * Delete a fact by key.
+ * @return ESP_ERR_NOT_FOUND if missing
+ */
+esp_err_t fact_delete(const char *key);
+
+/**
+ * List facts as "key [category]: value" lines. Filters may be NULL.
+ * @param category  Exact category match
+ * @param prefix    Key prefix match
+ * @return number of facts listed
+ */
+int fact_store_list(const char *category, const char *prefix, char *buf, size_t size);
+
+/**
+ * Render all facts grouped by category for the system prompt.
+ * @return bytes written (0 if the store is empty)
+ */
+size_t fact_store_render(char *buf, size_t size);
+
+/**
+ * Number of live facts.
+ */
+int fact_store_count(void);
@@ -0,0 +1,783 @@
+#include "memory_index.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "storage/fs_catalog.h"
+#include "storage/lzfile.h"
+
+static const char *TAG = "memidx";
+
+#define MEMIDX_MAGIC        0x5844494d      /* "MIDX" */
+#define MEMIDX_VERSION      3
+#define MEMIDX_NAME_LEN     48
+#define MEMIDX_NONE         0xffff
+#define MEMIDX_CHUNK_TERMS  128             /* distinct terms kept per chunk */
+#define MEMIDX_QUERY_TERMS  16
+#define MEMIDX_MAX_TOPK     8
+#define MEMIDX_TOKEN_MAX    32
+
+#define BM25_K1             1.2f
+#define BM25_B              0.75f
+
+typedef struct {
+    char name[MEMIDX_NAME_LEN];     /* relative to MIMI_SPIFFS_BASE, "" = free slot */
+    uint32_t size;                  /* file size when indexed */
+    int64_t mtime;                  /* file mtime when indexed (0 if unknown) */
+} memidx_file_t;
+
+typedef struct {
+    uint16_t file;                  /* MEMIDX_NONE = free slot */
+    uint16_t len;
+    uint32_t off;
+    uint16_t ntok;
+    uint16_t reserved;
+} memidx_chunk_t;
+
+typedef struct {
+    uint32_t term;                  /* FNV-1a of the lowercased token */
+    uint16_t chunk;
+    uint16_t tf;
+} memidx_post_t;
+
+/* On flash: header, nfiles x (slot, file), nchunks x (slot, chunk), npost postings */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t max_files;
+    uint16_t max_chunks;
+    uint16_t nfiles;                /* live entries that follow */
+    uint16_t nchunks;
+    uint16_t reserved;
+    uint32_t npost;
+} memidx_hdr_t;
+
+/* All three tables live in PSRAM; postings are kept sorted by (term, chunk) */
+static memidx_file_t *s_files = NULL;
+static memidx_chunk_t *s_chunks = NULL;
+static memidx_post_t *s_posts = NULL;
+static uint32_t s_npost = 0;
+static uint32_t s_live_chunks = 0;
+static uint32_t s_total_tok = 0;
+static bool s_full_warned = false;
+
+static SemaphoreHandle_t s_lock = NULL;
+static bool s_dirty = false;
+static int64_t s_last_save_us = 0;
+
+/* ── Tokenizer ────────────────────────────────────────────────── */
+
+static const char *const s_stopwords[] = {
+    "a", "an", "and", "are", "as", "at", "be", "but", "by", "do", "for", "from",
+    "has", "have", "he", "her", "his", "i", "if", "in", "is", "it", "its", "me",
+    "my", "of", "on", "or", "our", "she", "so", "that", "the", "their", "them",
+    "they", "this", "to", "was", "we", "were", "what", "when", "with", "you", "your",
+};
+
+static bool is_stopword(const char *tok, size_t len)
+{
+    if (len > 5) return false;
+    for (size_t i = 0; i < sizeof(s_stopwords) / sizeof(s_stopwords[0]); i++) {
+        if (strlen(s_stopwords[i]) == len && memcmp(s_stopwords[i], tok, len) == 0) return true;
+    }
+    return false;
+}
+
+static bool is_token_char(unsigned char c)
+{
+    /* UTF-8 continuation/lead bytes count as word characters */
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '_' || c >= 0x80;
+}
+
+typedef void (*term_cb_t)(uint32_t term, void *ctx);
+
+static void tokenize(const char *text, size_t len, term_cb_t cb, void *ctx)
+{
+    char tok[MEMIDX_TOKEN_MAX];
+    size_t i = 0;
+
+    while (i < len) {
+        while (i < len && !is_token_char((unsigned char)text[i])) i++;
+        size_t tl = 0;
+        uint32_t h = 2166136261u;
+        while (i < len && is_token_char((unsigned char)text[i])) {
+            char c = text[i++];
+            if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+            if (tl < sizeof(tok)) tok[tl] = c;
+            tl++;
+            h = (h ^ (uint8_t)c) * 16777619u;
+        }
+        if (tl < 2 || (tl <= sizeof(tok) && is_stopword(tok, tl))) continue;
+        cb(h, ctx);
+    }
+}
+
+/* ── Index maintenance (s_lock held) ──────────────────────────── */
+
+static int post_cmp(const void *a, const void *b)
+{
+    const memidx_post_t *pa = a, *pb = b;
+    if (pa->term != pb->term) return pa->term < pb->term ? -1 : 1;
+    return (int)pa->chunk - (int)pb->chunk;
+}
+
+static const char *memory_rel_dir(void)
+{
+    /* "memory" for "/spiffs/memory" */
+    return MIMI_SPIFFS_MEMORY_DIR + strlen(MIMI_SPIFFS_BASE) + 1;
+}
+
+static bool is_memory_name(const char *name)
+{
+    const char *dir = memory_rel_dir();
+    size_t dl = strlen(dir), nl = strlen(name);
+    return nl > dl + 4 && nl < MEMIDX_NAME_LEN &&
+           strncmp(name, dir, dl) == 0 && name[dl] == '/' &&
+           strcmp(name + nl - 3, ".md") == 0;
+}
+
+static int file_find(const char *name)
+{
+    for (int i = 0; i < MIMI_MEMIDX_MAX_FILES; i++) {
+        if (s_files[i].name[0] && strcmp(s_files[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+static int file_alloc(const char *name)
+{
+    for (int i = 0; i < MIMI_MEMIDX_MAX_FILES; i++) {
+        if (!s_files[i].name[0]) {
+            strncpy(s_files[i].name, name, MEMIDX_NAME_LEN - 1);
+            s_files[i].size = 0;
+            s_files[i].mtime = 0;
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool chunk_dropped(const memidx_chunk_t *ch, int fi, uint32_t from)
+{
+    return ch->file == fi && ch->off >= from;
+}
+
+/* Drop the postings of a file's chunks starting at or after from (stable
+ * filter keeps the sort order) and free those chunks */
+static void file_forget_from(int fi, uint32_t from)
+{
+    uint32_t w = 0;
+    for (uint32_t r = 0; r < s_npost; r++) {
+        if (!chunk_dropped(&s_chunks[s_posts[r].chunk], fi, from)) s_posts[w++] = s_posts[r];
+    }
+    s_npost = w;
+
+    for (int c = 0; c < MIMI_MEMIDX_MAX_CHUNKS; c++) {
+        if (chunk_dropped(&s_chunks[c], fi, from)) {
+            s_total_tok -= s_chunks[c].ntok;
+            s_live_chunks--;
+            s_chunks[c].file = MEMIDX_NONE;
+        }
+    }
+    s_dirty = true;
+}
+
+static void file_remove(int fi)
+{
+    file_forget_from(fi, 0);
+    s_files[fi].name[0] = '\0';
+}
+
+typedef struct {
+    uint32_t term;
+    uint16_t tf;
+} term_tf_t;
+
+typedef struct {
+    term_tf_t terms[MEMIDX_CHUNK_TERMS];
+    int nterms;
+    uint32_t ntok;
+} chunk_acc_t;
+
+static void acc_add(uint32_t term, void *ctx)
+{
+    chunk_acc_t *acc = ctx;
+    acc->ntok++;
+    for (int i = 0; i < acc->nterms; i++) {
+        if (acc->terms[i].term == term) {
+            if (acc->terms[i].tf < UINT16_MAX) acc->terms[i].tf++;
+            return;
+        }
+    }
+    if (acc->nterms < MEMIDX_CHUNK_TERMS) {
+        acc->terms[acc->nterms].term = term;
+        acc->terms[acc->nterms].tf = 1;
+        acc->nterms++;
+    }
+}
+
+/* New postings are staged past s_npost; nnew counts them */
+static bool chunk_commit(int fi, uint32_t off, uint32_t len, const chunk_acc_t *acc, uint32_t *nnew)
+{
+    if (acc->nterms == 0) return true;
+
+    int c;
+    for (c = 0; c < MIMI_MEMIDX_MAX_CHUNKS; c++) {
+        if (s_chunks[c].file == MEMIDX_NONE) break;
+    }
+    if (c == MIMI_MEMIDX_MAX_CHUNKS || s_npost + *nnew + acc->nterms > MIMI_MEMIDX_MAX_POSTINGS) {
+        if (!s_full_warned) {
+            ESP_LOGW(TAG, "Index full (%d chunks, %d postings), older notes stay unindexed",
+                     MIMI_MEMIDX_MAX_CHUNKS, MIMI_MEMIDX_MAX_POSTINGS);
+            s_full_warned = true;
+        }
+        return false;
+    }
+
+    s_chunks[c].file = fi;
+    s_chunks[c].off = off;
+    s_chunks[c].len = len;
+    s_chunks[c].ntok = acc->ntok > UINT16_MAX ? UINT16_MAX : acc->ntok;
+    s_live_chunks++;
+    s_total_tok += s_chunks[c].ntok;
+
+    memidx_post_t *dst = s_posts + s_npost + *nnew;
+    for (int i = 0; i < acc->nterms; i++) {
+        dst[i].term = acc->terms[i].term;
+        dst[i].chunk = c;
+        dst[i].tf = acc->terms[i].tf;
+    }
+    *nnew += acc->nterms;
+    return true;
+}
+
+/* Merge the staged run [s_npost, s_npost + nnew) into the sorted postings */
+static void postings_merge(uint32_t nnew)
+{
+    if (nnew == 0) return;
+
+    memidx_post_t *run = malloc(nnew * sizeof(memidx_post_t));
+    if (!run) {
+        /* Degrade to a full sort rather than lose the file */
+        s_npost += nnew;
+        qsort(s_posts, s_npost, sizeof(memidx_post_t), post_cmp);
+        return;
+    }
+    memcpy(run, s_posts + s_npost, nnew * sizeof(memidx_post_t));
+    qsort(run, nnew, sizeof(memidx_post_t), post_cmp);
+
+    int64_t a = (int64_t)s_npost - 1, b = (int64_t)nnew - 1;
+    int64_t w = (int64_t)s_npost + nnew - 1;
+    while (b >= 0) {
+        if (a >= 0 && post_cmp(&s_posts[a], &run[b]) > 0) {
+            s_posts[w--] = s_posts[a--];
+        } else {
+            s_posts[w--] = run[b--];
+        }
+    }
+    s_npost += nnew;
+    free(run);
+}
+
+static bool line_is_blank(const char *line)
+{
+    for (; *line; line++) {
+        if (*line != ' ' && *line != '\t' && *line != '\r' && *line != '\n') return false;
+    }
+    return true;
+}
+
+/* (Re)index a file from byte from on; chunks before from are kept */
+static void file_index_from(int fi, uint32_t from)
+{
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_BASE, s_files[fi].name);
+
+    /* Taken before reading, so a write during indexing shows up at the next boot */
+    struct stat st;
+    int64_t mtime = stat(path, &st) == 0 ? (int64_t)st.st_mtime : 0;
+
+    /* Old daily notes may only exist compressed */
+    char *hold;
+    FILE *f = lzfile_open(path, &hold);
+    if (!f) {
+        file_remove(fi);
+        return;
+    }
+    if (from > 0 && fseek(f, from, SEEK_SET) != 0) from = 0;
+    file_forget_from(fi, from);
+
+    chunk_acc_t *acc = calloc(1, sizeof(chunk_acc_t));
+    char *line = malloc(MIMI_MEMIDX_CHUNK_BYTES + 1);
+    if (!acc || !line) {
+        free(acc);
+        free(line);
+        fclose(f);
+        free(hold);
+        return;
+    }
+
+    uint32_t pos = from, chunk_off = from, chunk_len = 0, nnew = 0;
+    bool room = true;
+
+    while (room && fgets(line, MIMI_MEMIDX_CHUNK_BYTES + 1, f)) {
+        uint32_t ll = strlen(line);
+        bool blank = line_is_blank(line);
+
+        /* Paragraphs and headings start new chunks; long ones are split */
+        if (chunk_len > 0 && (blank || line[0] == '#' || chunk_len + ll > MIMI_MEMIDX_CHUNK_BYTES)) {
+            room = chunk_commit(fi, chunk_off, chunk_len, acc, &nnew);
+            memset(acc, 0, sizeof(*acc));
+            chunk_len = 0;
+        }
+        if (!blank) {
+            if (chunk_len == 0) chunk_off = pos;
+            tokenize(line, ll, acc_add, acc);
+            chunk_len += ll;
+        }
+        pos += ll;
+    }
+    if (room && chunk_len > 0) {
+        chunk_commit(fi, chunk_off, chunk_len, acc, &nnew);
+    }
+
+    fclose(f);
+    free(hold);
+    free(line);
+    free(acc);
+
+    postings_merge(nnew);
+    s_files[fi].size = pos;
+    s_files[fi].mtime = mtime;
+    s_dirty = true;
+}
+
+static void file_index(int fi)
+{
+    file_index_from(fi, 0);
+}
+
+/* Where re-indexing has to start after an append: the last chunk is reopened
+ * if it ran up to the old end, so chunking matches a full index */
+static uint32_t append_resume_offset(int fi)
+{
+    uint32_t size = s_files[fi].size;
+    int last = -1;
+    for (int c = 0; c < MIMI_MEMIDX_MAX_CHUNKS; c++) {
+        if (s_chunks[c].file == fi && (last < 0 || s_chunks[c].off > s_chunks[last].off)) last = c;
+    }
+    if (last >= 0 && s_chunks[last].off + s_chunks[last].len == size) return s_chunks[last].off;
+    return size;
+}
+
+static void index_dir_new_files(void)
+{
+    fs_entry_t ents[8];
+    int skip = 0, n;
+    while ((n = fs_catalog_query(MIMI_SPIFFS_MEMORY_DIR "/", skip, ents, 8)) > 0) {
+        skip += n;
+        for (int i = 0; i < n; i++) {
+            /* "x.md.lz" is indexed under "x.md" */
+            char name[MEMIDX_NAME_LEN + 8];
+            snprintf(name, sizeof(name), "%s", ents[i].path + strlen(MIMI_SPIFFS_BASE "/"));
+            size_t nl = strlen(name);
+            if (nl > 3 && strcmp(name + nl - 3, ".lz") == 0) name[nl - 3] = '\0';
+            if (!is_memory_name(name) || file_find(name) >= 0) continue;
+            int fi = file_alloc(name);
+            if (fi < 0) {
+                ESP_LOGW(TAG, "File table full, skipping %s", name);
+                return;
+            }
+            file_index(fi);
+        }
+    }
+}
+
+/* ── Persistence ──────────────────────────────────────────────── */
+
+static void index_save(bool force)
+{
+    int64_t now = esp_timer_get_time();
+    if (!s_dirty) return;
+    /* Changes newer than the last save are picked up by the size/mtime check at boot */
+    if (!force && now - s_last_save_us < (int64_t)MIMI_MEMIDX_SAVE_INTERVAL_MS * 1000) return;
+
+    FILE *f = fopen(MIMI_MEMIDX_FILE, "wb");
+    if (!f) {
+        ESP_LOGW(TAG, "Cannot write %s", MIMI_MEMIDX_FILE);
+        return;
+    }
+
+    memidx_hdr_t hdr = {
+        .magic = MEMIDX_MAGIC,
+        .version = MEMIDX_VERSION,
+        .max_files = MIMI_MEMIDX_MAX_FILES,
+        .max_chunks = MIMI_MEMIDX_MAX_CHUNKS,
+        .npost = s_npost,
+    };
+    for (int i = 0; i < MIMI_MEMIDX_MAX_FILES; i++) {
+        if (s_files[i].name[0]) hdr.nfiles++;
+    }
+    hdr.nchunks = s_live_chunks;
+
+    /* Only live slots are written, each prefixed with its slot number */
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    for (uint16_t i = 0; ok && i < MIMI_MEMIDX_MAX_FILES; i++) {
+        if (!s_files[i].name[0]) continue;
+        ok = fwrite(&i, sizeof(i), 1, f) == 1 && fwrite(&s_files[i], sizeof(memidx_file_t), 1, f) == 1;
+    }
+    for (uint16_t c = 0; ok && c < MIMI_MEMIDX_MAX_CHUNKS; c++) {
+        if (s_chunks[c].file == MEMIDX_NONE) continue;
+        ok = fwrite(&c, sizeof(c), 1, f) == 1 && fwrite(&s_chunks[c], sizeof(memidx_chunk_t), 1, f) == 1;
+    }
+    ok = ok && fwrite(s_posts, sizeof(memidx_post_t), s_npost, f) == s_npost;
+    if (fclose(f) != 0) ok = false;
+
+    if (!ok) {
+        ESP_LOGW(TAG, "Short write on %s, removing", MIMI_MEMIDX_FILE);
+        remove(MIMI_MEMIDX_FILE);
+    }
+    fs_catalog_update(MIMI_MEMIDX_FILE);
+    if (!ok) return;
+    s_dirty = false;
+    s_last_save_us = now;
+}
+
+static bool index_load(void)
+{
+    FILE *f = fopen(MIMI_MEMIDX_FILE, "rb");
+    if (!f) return false;
+
+    memidx_hdr_t hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+              hdr.magic == MEMIDX_MAGIC && hdr.version == MEMIDX_VERSION &&
+              hdr.max_files == MIMI_MEMIDX_MAX_FILES && hdr.max_chunks == MIMI_MEMIDX_MAX_CHUNKS &&
+              hdr.nfiles <= MIMI_MEMIDX_MAX_FILES && hdr.nchunks <= MIMI_MEMIDX_MAX_CHUNKS &&
+              hdr.npost <= MIMI_MEMIDX_MAX_POSTINGS;
+
+    memset(s_files, 0, MIMI_MEMIDX_MAX_FILES * sizeof(memidx_file_t));
+    for (int c = 0; c < MIMI_MEMIDX_MAX_CHUNKS; c++) s_chunks[c].file = MEMIDX_NONE;
+    for (int i = 0; ok && i < hdr.nfiles; i++) {
+        uint16_t slot;
+        ok = fread(&slot, sizeof(slot), 1, f) == 1 && slot < MIMI_MEMIDX_MAX_FILES &&
+             fread(&s_files[slot], sizeof(memidx_file_t), 1, f) == 1;
+    }
+    for (int i = 0; ok && i < hdr.nchunks; i++) {
+        uint16_t slot;
+        ok = fread(&slot, sizeof(slot), 1, f) == 1 && slot < MIMI_MEMIDX_MAX_CHUNKS &&
+             fread(&s_chunks[slot], sizeof(memidx_chunk_t), 1, f) == 1 &&
+             s_chunks[slot].file < MIMI_MEMIDX_MAX_FILES;
+    }
+    ok = ok && fread(s_posts, sizeof(memidx_post_t), hdr.npost, f) == hdr.npost;
+    for (uint32_t p = 0; ok && p < hdr.npost; p++) {
+        ok = s_posts[p].chunk < MIMI_MEMIDX_MAX_CHUNKS && s_chunks[s_posts[p].chunk].file != MEMIDX_NONE;
+    }
+    fclose(f);
+
+    if (!ok) {
+        ESP_LOGW(TAG, "Index file invalid, rebuilding");
+        return false;
+    }
+
+    s_npost = hdr.npost;
+    s_live_chunks = 0;
+    s_total_tok = 0;
+    for (int c = 0; c < MIMI_MEMIDX_MAX_CHUNKS; c++) {
+        if (s_chunks[c].file == MEMIDX_NONE) continue;
+        s_live_chunks++;
+        s_total_tok += s_chunks[c].ntok;
+    }
+    return true;
+}
+
+static void index_clear(void)
+{
+    memset(s_files, 0, MIMI_MEMIDX_MAX_FILES * sizeof(memidx_file_t));
+    for (int c = 0; c < MIMI_MEMIDX_MAX_CHUNKS; c++) s_chunks[c].file = MEMIDX_NONE;
+    s_npost = 0;
+    s_live_chunks = 0;
+    s_total_tok = 0;
+    s_full_warned = false;
+    s_dirty = true;
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t memory_index_init(void)
+{
+    s_files = heap_caps_calloc(MIMI_MEMIDX_MAX_FILES, sizeof(memidx_file_t), MALLOC_CAP_SPIRAM);
+    s_chunks = heap_caps_calloc(MIMI_MEMIDX_MAX_CHUNKS, sizeof(memidx_chunk_t), MALLOC_CAP_SPIRAM);
+    s_posts = heap_caps_calloc(MIMI_MEMIDX_MAX_POSTINGS, sizeof(memidx_post_t), MALLOC_CAP_SPIRAM);
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_files || !s_chunks || !s_posts || !s_lock) {
+        ESP_LOGE(TAG, "Out of memory for memory index");
+        return ESP_ERR_NO_MEM;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    if (!index_load()) {
+        index_clear();
+    }
+
+    /* Reconcile with what is on flash now */
+    int reindexed = 0;
+    for (int i = 0; i < MIMI_MEMIDX_MAX_FILES; i++) {
+        if (!s_files[i].name[0]) continue;
+        char path[96];
+        snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_BASE, s_files[i].name);
+        fs_entry_t st;
+        if (!fs_catalog_stat(path, &st)) {
+            /* Compressed notes are never appended to, so their entry stays valid */
+            if (!lzfile_exists(path)) file_remove(i);
+        } else if (st.size != s_files[i].size || st.mtime != s_files[i].mtime) {
+            /* A same-size rewrite (e.g. from the CLI) only shows in the mtime */
+            file_index(i);
+            reindexed++;
+        }
+    }
+    index_dir_new_files();
+    index_save(true);
+
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGI(TAG, "Memory index ready: %d chunks, %d postings (%d files refreshed, %d ms)",
+             (int)s_live_chunks, (int)s_npost, reindexed,
+             (int)((esp_timer_get_time() - t0) / 1000));
+    return ESP_OK;
+}
+
+/* Relative name of a memory note, or NULL for paths the index ignores */
+static const char *memory_name(const char *path)
+{
+    size_t base_len = strlen(MIMI_SPIFFS_BASE);
+    if (!path || strncmp(path, MIMI_SPIFFS_BASE "/", base_len + 1) != 0) return NULL;
+    const char *name = path + base_len + 1;
+    return is_memory_name(name) ? name : NULL;
+}
+
+/* s_lock held */
+static void update_locked(const char *path, const char *name)
+{
+    int fi = file_find(name);
+    struct stat st;
+    bool plain = stat(path, &st) == 0;
+    if (!plain && !lzfile_exists(path)) {
+        if (fi >= 0) file_remove(fi);
+    } else if (plain || fi < 0) {
+        /* A compressed note that is already indexed has not changed */
+        if (fi < 0) fi = file_alloc(name);
+        if (fi >= 0) {
+            file_index(fi);
+        } else {
+            ESP_LOGW(TAG, "File table full, %s not indexed", name);
+        }
+    }
+}
+
+esp_err_t memory_index_update_file(const char *path)
+{
+    if (!s_lock || !path) return ESP_ERR_INVALID_STATE;
+    const char *name = memory_name(path);
+    if (!name) return ESP_OK;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    update_locked(path, name);
+    index_save(false);
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+esp_err_t memory_index_append_file(const char *path)
+{
+    if (!s_lock || !path) return ESP_ERR_INVALID_STATE;
+    const char *name = memory_name(path);
+    if (!name) return ESP_OK;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int fi = file_find(name);
+    struct stat st;
+    if (fi >= 0 && stat(path, &st) == 0 && (uint32_t)st.st_size >= s_files[fi].size) {
+        file_index_from(fi, append_resume_offset(fi));
+    } else {
+        update_locked(path, name);
+    }
+    index_save(false);
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+esp_err_t memory_index_rebuild(void)
+{
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    index_clear();
+    index_dir_new_files();
+    index_save(true);
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGI(TAG, "Memory index rebuilt: %d chunks, %d postings", (int)s_live_chunks, (int)s_npost);
+    return ESP_OK;
+}
+
+typedef struct {
+    uint32_t terms[MEMIDX_QUERY_TERMS];
+    int n;
+} query_terms_t;
+
+static void query_add(uint32_t term, void *ctx)
+{
+    query_terms_t *q = ctx;
+    for (int i = 0; i < q->n; i++) {
+        if (q->terms[i] == term) return;
+    }
+    if (q->n < MEMIDX_QUERY_TERMS) q->terms[q->n++] = term;
+}
+
+static uint32_t postings_lower_bound(uint32_t term)
+{
+    uint32_t lo = 0, hi = s_npost;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (s_posts[mid].term < term) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int memory_index_search(const char *query, memidx_hit_t *hits, int max_hits)
+{
+    if (!s_lock || !query || max_hits <= 0) return 0;
+
+    query_terms_t q = {0};
+    tokenize(query, strlen(query), query_add, &q);
+    if (q.n == 0) return 0;
+
+    float *scores = heap_caps_calloc(MIMI_MEMIDX_MAX_CHUNKS, sizeof(float), MALLOC_CAP_SPIRAM);
+    if (!scores) return 0;
+
+    int found = 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    if (s_live_chunks > 0) {
+        float n = (float)s_live_chunks;
+        float avgdl = (float)s_total_tok / n;
+        if (avgdl < 1.0f) avgdl = 1.0f;
+
+        for (int t = 0; t < q.n; t++) {
+            uint32_t lo = postings_lower_bound(q.terms[t]);
+            uint32_t hi = lo;
+            while (hi < s_npost && s_posts[hi].term == q.terms[t]) hi++;
+            if (hi == lo) continue;
+
+            float df = (float)(hi - lo);
+            float idf = logf(1.0f + (n - df + 0.5f) / (df + 0.5f));
+            for (uint32_t p = lo; p < hi; p++) {
+                float tf = s_posts[p].tf;
+                float dl = s_chunks[s_posts[p].chunk].ntok;
+                scores[s_posts[p].chunk] += idf * tf * (BM25_K1 + 1.0f) /
+                                            (tf + BM25_K1 * (1.0f - BM25_B + BM25_B * dl / avgdl));
+            }
+        }
+
+        /* Insertion into the top-k list */
+        for (int c = 0; c < MIMI_MEMIDX_MAX_CHUNKS; c++) {
+            if (scores[c] <= 0.0f || s_chunks[c].file == MEMIDX_NONE) continue;
+            if (found == max_hits && scores[c] <= hits[found - 1].score) continue;
+
+            int pos = found < max_hits ? found++ : max_hits - 1;
+            while (pos > 0 && hits[pos - 1].score < scores[c]) {
+                hits[pos] = hits[pos - 1];
+                pos--;
+            }
+            snprintf(hits[pos].path, sizeof(hits[pos].path), "%s/%s",
+                     MIMI_SPIFFS_BASE, s_files[s_chunks[c].file].name);
+            hits[pos].offset = s_chunks[c].off;
+            hits[pos].len = s_chunks[c].len;
+            hits[pos].score = scores[c];
+        }
+    }
+
+    xSemaphoreGive(s_lock);
+    free(scores);
+    return found;
+}
+
+size_t memory_index_read_hit(const memidx_hit_t *hit, char *buf, size_t size)
+{
+    if (size == 0) return 0;
+    buf[0] = '\0';
+
+    char *hold;
+    FILE *f = lzfile_open(hit->path, &hold);
+    if (!f) return 0;
+
+    size_t want = hit->len < size - 1 ? hit->len : size - 1;
+    size_t n = 0;
+    if (fseek(f, hit->offset, SEEK_SET) == 0) {
+        n = fread(buf, 1, want, f);
+    }
+    fclose(f);
+    free(hold);
+
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == '\r')) n--;
+    buf[n] = '\0';
+    return n;
+}
+
+size_t memory_index_build_context(const char *query, char *buf, size_t budget, int top_k)
+{
+    if (budget == 0) return 0;
+    buf[0] = '\0';
+    if (top_k > MEMIDX_MAX_TOPK) top_k = MEMIDX_MAX_TOPK;
+
+    memidx_hit_t hits[MEMIDX_MAX_TOPK];
+    int n = memory_index_search(query, hits, top_k);
+
+    size_t off = 0;
+    for (int i = 0; i < n; i++) {
+        const char *rel = hits[i].path + strlen(MIMI_SPIFFS_BASE) + 1;
+        size_t header = strlen(rel) + 6;
+        if (off + header + hits[i].len + 2 > budget) continue;
+
+        off += snprintf(buf + off, budget - off, "\n### %s\n", rel);
+        off += memory_index_read_hit(&hits[i], buf + off, budget - off);
+        if (off < budget - 1) {
+            buf[off++] = '\n';
+            buf[off] = '\0';
+        }
+    }
+    return off;
+}
+
+void memory_index_print_stats(void)
+{
+    if (!s_lock) {
+        printf("Memory index not initialized.\n");
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int files = 0;
+    for (int i = 0; i < MIMI_MEMIDX_MAX_FILES; i++) {
+        if (s_files[i].name[0]) files++;
+    }
+    printf("Files:    %d / %d\n", files, MIMI_MEMIDX_MAX_FILES);
+    printf("Chunks:   %u / %d (avg %u tokens)\n", (unsigned)s_live_chunks, MIMI_MEMIDX_MAX_CHUNKS,
+           s_live_chunks ? (unsigned)(s_total_tok / s_live_chunks) : 0);
+    printf("Postings: %u / %d\n", (unsigned)s_npost, MIMI_MEMIDX_MAX_POSTINGS);
+    printf("Unsaved:  %s\n", s_dirty ? "yes" : "no");
+    xSemaphoreGive(s_lock);
+}
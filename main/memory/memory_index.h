@@ -0,0 +1,69 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Full-text index over the .md files in MIMI_SPIFFS_MEMORY_DIR.
+ *
+ * Files are split into chunks (paragraphs, headings, or MIMI_MEMIDX_CHUNK_BYTES
+ * pieces). Each chunk's terms go into a postings array sorted by term hash, so
+ * a lookup is a binary search and document frequency is the range length.
+ * Queries are ranked with BM25. The index is persisted to MIMI_MEMIDX_FILE and
+ * reconciled against file sizes and mtimes at boot.
+ */
+
+typedef struct {
+    char path[64];          /* absolute path of the note */
+    uint32_t offset;        /* chunk byte range in the file */
+    uint16_t len;
+    float score;
+} memidx_hit_t;
+
+/**
+ * Load the persisted index (or build it) and pick up files changed since.
+ */
+esp_err_t memory_index_init(void);
+
+/**
+ * Re-index one file after it was written. Paths outside the memory
+ * directory or not ending in .md are ignored; a missing file is dropped.
+ */
+esp_err_t memory_index_update_file(const char *path);
+
+/**
+ * Index only what was appended to path since it was last indexed (the last
+ * chunk is reopened so chunking matches a full index). Falls back to
+ * memory_index_update_file if the file shrank or is not indexed yet.
+ */
+esp_err_t memory_index_append_file(const char *path);
+
+/**
+ * Drop everything and index the memory directory from scratch.
+ */
+esp_err_t memory_index_rebuild(void);
+
+/**
+ * BM25 search. Fills up to max_hits hits ordered by descending score.
+ * @return number of hits
+ */
+int memory_index_search(const char *query, memidx_hit_t *hits, int max_hits);
+
+/**
+ * Read the text of a hit into buf (NUL-terminated, newlines preserved).
+ * @return bytes read
+ */
+size_t memory_index_read_hit(const memidx_hit_t *hit, char *buf, size_t size);
+
+/**
+ * Append the top_k chunks relevant to query as "### <path>" sections,
+ * stopping at budget bytes.
+ * @return bytes appended (0 if nothing matched)
+ */
+size_t memory_index_build_context(const char *query, char *buf, size_t budget, int top_k);
+
+/**
+ * Print file/chunk/posting counts.
+ */
+void memory_index_print_stats(void);
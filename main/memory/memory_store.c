@@ -1,11 +1,17 @@
 #include "memory_store.h"
+#include "memory_index.h"
 #include "mimi_config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <time.h>
 #include <sys/stat.h>
 #include "esp_log.h"
+#include "storage/write_behind.h"
+#include "storage/fs_catalog.h"
+#include "storage/lzfile.h"
 
 static const char *TAG = "memory";
 
@@ -19,12 +25,34 @@ static void get_date_str(char *buf, size_t size, int days_ago)
     strftime(buf, size, "%Y-%m-%d", &tm);
 }
 
+/* Compress daily notes older than MIMI_LZ_NOTE_AGE_DAYS; reads stay transparent via lzfile_open() */
+static void compress_old_notes(void)
+{
+    char cutoff[16];
+    get_date_str(cutoff, sizeof(cutoff), MIMI_LZ_NOTE_AGE_DAYS);
+
+    const char *dir = MIMI_SPIFFS_MEMORY_DIR "/";
+    fs_entry_t ent;
+    int done = 0;
+    for (int i = 0; fs_catalog_query(dir, i, &ent, 1) == 1; i++) {
+        const char *name = ent.path + strlen(dir);
+        /* "YYYY-MM-DD.md", dates compare as strings */
+        if (strlen(name) != 13 || name[4] != '-' || name[7] != '-' ||
+            strcmp(name + 10, ".md") != 0 || strncmp(name, cutoff, 10) >= 0 || ent.size == 0) {
+            continue;
+        }
+        write_behind_sync(ent.path);
+        if (lzfile_compress(ent.path) == ESP_OK) done++;
+    }
+    if (done) ESP_LOGI(TAG, "Compressed %d daily note(s) older than %s", done, cutoff);
+}
+
 esp_err_t memory_store_init(void)
 {
-    /* SPIFFS is flat — no real directory creation needed.
-       Just verify we can open the base path. */
+    /* Directories are created by storage_init() (LittleFS) or implicit (SPIFFS) */
+    lzfile_register_sweep(compress_old_notes);
     ESP_LOGI(TAG, "Memory store initialized at %s", MIMI_SPIFFS_BASE);
-    return ESP_OK;
+    return memory_index_init();
 }
 
 esp_err_t memory_read_long_term(char *buf, size_t size)
@@ -50,10 +78,17 @@ esp_err_t memory_write_long_term(const char *content)
     }
     fputs(content, f);
     fclose(f);
+    fs_catalog_update(MIMI_MEMORY_FILE);
+    memory_index_update_file(MIMI_MEMORY_FILE);
     ESP_LOGI(TAG, "Long-term memory updated (%d bytes)", (int)strlen(content));
     return ESP_OK;
 }
 
+static void on_note_flushed(const char *path)
+{
+    memory_index_append_file(path);
+}
+
 esp_err_t memory_append_today(const char *note)
 {
     char date_str[16];
@@ -62,20 +97,23 @@ esp_err_t memory_append_today(const char *note)
     char path[64];
     snprintf(path, sizeof(path), "%s/%s.md", MIMI_SPIFFS_MEMORY_DIR, date_str);
 
-    FILE *f = fopen(path, "a");
-    if (!f) {
-        /* Try creating — if file doesn't exist yet, write header */
-        f = fopen(path, "w");
-        if (!f) {
-            ESP_LOGE(TAG, "Cannot open %s", path);
-            return ESP_FAIL;
-        }
-        fprintf(f, "# %s\n\n", date_str);
+    /* New file (not on flash, nothing buffered) gets a date header */
+    struct stat st;
+    bool is_new = stat(path, &st) != 0 && !write_behind_pending(path);
+
+    size_t len = strlen(note);
+    char *rec = malloc(len + 32);
+    if (!rec) return ESP_ERR_NO_MEM;
+    int n = is_new ? snprintf(rec, len + 32, "# %s\n\n%s\n", date_str, note)
+                   : snprintf(rec, len + 32, "%s\n", note);
+
+    /* The index picks the note up once it is on flash */
+    esp_err_t err = write_behind_append(path, rec, n, on_note_flushed);
+    free(rec);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot append to %s", path);
     }
-
-    fprintf(f, "%s\n", note);
-    fclose(f);
-    return ESP_OK;
+    return err;
 }
 
 esp_err_t memory_read_recent(char *buf, size_t size, int days)
@@ -90,7 +128,9 @@ esp_err_t memory_read_recent(char *buf, size_t size, int days)
         char path[64];
         snprintf(path, sizeof(path), "%s/%s.md", MIMI_SPIFFS_MEMORY_DIR, date_str);
 
-        FILE *f = fopen(path, "r");
+        write_behind_sync(path);
+        char *hold;
+        FILE *f = lzfile_open(path, &hold);
         if (!f) continue;
 
         if (offset > 0 && offset < size - 4) {
@@ -101,6 +141,7 @@ esp_err_t memory_read_recent(char *buf, size_t size, int days)
         offset += n;
         buf[offset] = '\0';
         fclose(f);
+        free(hold);
     }
 
     return ESP_OK;
@@ -4,10 +4,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <dirent.h>
 #include <time.h>
+#include <sys/stat.h>
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "cJSON.h"
+#include "storage/write_behind.h"
+#include "storage/fs_catalog.h"
+#include "storage/lzfile.h"
 
 static const char *TAG = "session";
 
@@ -16,8 +20,93 @@ static void session_path(const char *chat_id, char *buf, size_t size)
     snprintf(buf, size, "%s/tg_%s.jsonl", MIMI_SPIFFS_SESSION_DIR, chat_id);
 }
 
+/* ── Cold history ─────────────────────────────────────────────── */
+
+/*
+ * Move all but the last MIMI_LZ_SESSION_KEEP_MSGS records of a large session
+ * into <path>.lz. Runs under write_behind_exclusive() so no append lands
+ * between reading the file and replacing it.
+ */
+static esp_err_t archive_head(const char *path, void *ctx)
+{
+    struct stat st;
+    if (stat(path, &st) != 0 || st.st_size < MIMI_LZ_SESSION_HOT_BYTES) return ESP_OK;
+
+    size_t size = st.st_size;
+    char *data = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!data) return ESP_ERR_NO_MEM;
+
+    FILE *f = fopen(path, "r");
+    size_t n = f ? fread(data, 1, size, f) : 0;
+    if (f) fclose(f);
+    if (n != size) {
+        free(data);
+        return ESP_FAIL;
+    }
+
+    /* Split at the start of the KEEP-th record from the end */
+    size_t split = 0;
+    int records = 0;
+    for (size_t i = size - 1; i > 0; i--) {
+        if (data[i - 1] == '\n' && ++records == MIMI_LZ_SESSION_KEEP_MSGS) {
+            split = i;
+            break;
+        }
+    }
+    if (split == 0) {
+        free(data);
+        return ESP_OK;
+    }
+
+    /* Tail first: a crash before the rename leaves the old file (and at worst duplicated records) */
+    char tmp[80], lz[80];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    snprintf(lz, sizeof(lz), "%s.lz", path);
+
+    esp_err_t err = ESP_FAIL;
+    f = fopen(tmp, "w");
+    if (f) {
+        bool ok = fwrite(data + split, 1, size - split, f) == size - split;
+        if (fclose(f) == 0 && ok) err = ESP_OK;
+    }
+    if (err == ESP_OK) err = lzfile_append(lz, data, split);
+    if (err == ESP_OK) err = lzfile_replace(tmp, path);
+    if (err != ESP_OK) remove(tmp);
+    free(data);
+
+    fs_catalog_update(tmp);
+    fs_catalog_update(path);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Archived %u bytes of %s", (unsigned)split, path);
+    }
+    return err;
+}
+
+static void archive_sweep(void)
+{
+    fs_entry_t ent;
+    for (int i = 0; fs_catalog_query(MIMI_SPIFFS_SESSION_DIR "/", i, &ent, 1) == 1; i++) {
+        size_t len = strlen(ent.path);
+        if (len < 6 || strcmp(ent.path + len - 6, ".jsonl") != 0) continue;
+        if (ent.size < MIMI_LZ_SESSION_HOT_BYTES) continue;
+        write_behind_exclusive(ent.path, archive_head, NULL);
+    }
+}
+
 esp_err_t session_mgr_init(void)
 {
+    /* An archive cut short by a power loss leaves the kept tail in <file>.tmp */
+    fs_entry_t ent;
+    for (int i = 0; fs_catalog_query(MIMI_SPIFFS_SESSION_DIR "/", i, &ent, 1) == 1; i++) {
+        size_t len = strlen(ent.path);
+        if (len < 10 || strcmp(ent.path + len - 10, ".jsonl.tmp") != 0) continue;
+        char path[sizeof(ent.path)];
+        snprintf(path, sizeof(path), "%.*s", (int)(len - 4), ent.path);
+        lzfile_recover_tmp(ent.path, path);
+        if (!fs_catalog_stat(ent.path, NULL)) i--;   /* the .tmp left the catalog */
+    }
+
+    lzfile_register_sweep(archive_sweep);
     ESP_LOGI(TAG, "Session manager initialized at %s", MIMI_SPIFFS_SESSION_DIR);
     return ESP_OK;
 }
@@ -27,12 +116,6 @@ esp_err_t session_append(const char *chat_id, const char *role, const char *cont
     char path[64];
     session_path(chat_id, path, sizeof(path));
 
-    FILE *f = fopen(path, "a");
-    if (!f) {
-        ESP_LOGE(TAG, "Cannot open session file %s", path);
-        return ESP_FAIL;
-    }
-
     cJSON *obj = cJSON_CreateObject();
     cJSON_AddStringToObject(obj, "role", role);
     cJSON_AddStringToObject(obj, "content", content);
@@ -40,14 +123,109 @@ esp_err_t session_append(const char *chat_id, const char *role, const char *cont
 
     char *line = cJSON_PrintUnformatted(obj);
     cJSON_Delete(obj);
+    if (!line) return ESP_ERR_NO_MEM;
 
-    if (line) {
-        fprintf(f, "%s\n", line);
-        free(line);
+    /* One record per append so a flush never splits a line */
+    size_t len = strlen(line);
+    char *rec = malloc(len + 2);
+    if (!rec) {
+        cJSON_free(line);
+        return ESP_ERR_NO_MEM;
     }
+    memcpy(rec, line, len);
+    rec[len++] = '\n';
+    rec[len] = '\0';
+    cJSON_free(line);
 
-    fclose(f);
-    return ESP_OK;
+    esp_err_t err = write_behind_append(path, rec, len, NULL);
+    free(rec);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot append to session file %s", path);
+    }
+    return err;
+}
+
+typedef struct {
+    cJSON **messages;
+    int max_msgs;
+    int count;
+    int write_idx;
+    bool archive;               /* also read the compressed head */
+} history_ring_t;
+
+static void history_add(history_ring_t *ring, char *line)
+{
+    /* Strip newline */
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
+    if (line[0] == '\0') return;
+
+    cJSON *obj = cJSON_Parse(line);
+    if (!obj) return;
+
+    /* Ring buffer: overwrite oldest if full */
+    if (ring->count >= ring->max_msgs) {
+        cJSON_Delete(ring->messages[ring->write_idx]);
+    }
+    ring->messages[ring->write_idx] = obj;
+    ring->write_idx = (ring->write_idx + 1) % ring->max_msgs;
+    if (ring->count < ring->max_msgs) ring->count++;
+}
+
+/* Records from a buffer that is not NUL-terminated */
+static void history_add_span(history_ring_t *ring, const char *data, size_t len)
+{
+    char line[2048];
+    while (len > 0) {
+        const char *nl = memchr(data, '\n', len);
+        size_t n = nl ? (size_t)(nl - data) : len;
+        if (n < sizeof(line)) {
+            memcpy(line, data, n);
+            line[n] = '\0';
+            history_add(ring, line);
+        }
+        n += nl ? 1 : 0;
+        data += n;
+        len -= n;
+    }
+}
+
+static void history_reset(history_ring_t *ring)
+{
+    for (int i = 0; i < ring->count; i++) cJSON_Delete(ring->messages[i]);
+    ring->count = 0;
+    ring->write_idx = 0;
+}
+
+/*
+ * Archive (compressed head), then the plain file, then records still in the
+ * write-behind buffer. Runs under write_behind_read(), so neither a flush
+ * nor archive_head() can move records between the three while they are read.
+ */
+static void history_feed(const char *path, const char *pending, size_t len, void *ctx)
+{
+    history_ring_t *ring = ctx;
+
+    if (ring->archive) {
+        char lz[80];
+        snprintf(lz, sizeof(lz), "%s.lz", path);
+        char *head = lzfile_load(lz, NULL);
+        if (head) {
+            history_add_span(ring, head, strlen(head));
+            free(head);
+        }
+    }
+
+    FILE *f = fopen(path, "r");
+    if (f) {
+        char line[2048];
+        while (fgets(line, sizeof(line), f)) {
+            history_add(ring, line);
+        }
+        fclose(f);
+    }
+
+    history_add_span(ring, pending, len);
 }
 
 esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size, int max_msgs)
@@ -55,8 +233,10 @@ esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size,
     char path[64];
     session_path(chat_id, path, sizeof(path));
 
-    FILE *f = fopen(path, "r");
-    if (!f) {
+    bool pending = write_behind_pending(path);
+    bool archived = lzfile_exists(path);
+    struct stat st;
+    if (stat(path, &st) != 0 && !pending && !archived) {
         /* No history yet */
         snprintf(buf, size, "[]");
         return ESP_OK;
@@ -64,28 +244,17 @@ esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size,
 
     /* Read all lines into a ring buffer of cJSON objects */
     cJSON *messages[MIMI_SESSION_MAX_MSGS];
-    int count = 0;
-    int write_idx = 0;
+    history_ring_t ring = { .messages = messages, .max_msgs = max_msgs };
+    write_behind_read(path, history_feed, &ring);
 
-    char line[2048];
-    while (fgets(line, sizeof(line), f)) {
-        /* Strip newline */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
-        if (line[0] == '\0') continue;
-
-        cJSON *obj = cJSON_Parse(line);
-        if (!obj) continue;
-
-        /* Ring buffer: overwrite oldest if full */
-        if (count >= max_msgs) {
-            cJSON_Delete(messages[write_idx]);
-        }
-        messages[write_idx] = obj;
-        write_idx = (write_idx + 1) % max_msgs;
-        if (count < max_msgs) count++;
+    /* The plain tail normally holds enough; reach into the archive only when it does not */
+    if (ring.count < max_msgs && archived) {
+        history_reset(&ring);
+        ring.archive = true;
+        write_behind_read(path, history_feed, &ring);
     }
-    fclose(f);
+    int count = ring.count;
+    int write_idx = ring.write_idx;
 
     /* Build JSON array with only role + content */
     cJSON *arr = cJSON_CreateArray();
@@ -117,7 +286,7 @@ esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size,
     if (json_str) {
         strncpy(buf, json_str, size - 1);
         buf[size - 1] = '\0';
-        free(json_str);
+        cJSON_free(json_str);
     } else {
         snprintf(buf, size, "[]");
     }
@@ -130,7 +299,13 @@ esp_err_t session_clear(const char *chat_id)
     char path[64];
     session_path(chat_id, path, sizeof(path));
 
-    if (remove(path) == 0) {
+    bool pending = write_behind_pending(path);
+    write_behind_discard(path);
+    bool archived = lzfile_exists(path);
+    lzfile_remove(path);
+    int rc = remove(path);
+    fs_catalog_update(path);
+    if (rc == 0 || pending || archived) {
         ESP_LOGI(TAG, "Session %s cleared", chat_id);
         return ESP_OK;
     }
@@ -139,25 +314,19 @@ esp_err_t session_clear(const char *chat_id)
 
 void session_list(void)
 {
-    DIR *dir = opendir(MIMI_SPIFFS_SESSION_DIR);
-    if (!dir) {
-        /* SPIFFS is flat, so list all files matching pattern */
-        dir = opendir(MIMI_SPIFFS_BASE);
-        if (!dir) {
-            ESP_LOGW(TAG, "Cannot open SPIFFS directory");
-            return;
-        }
-    }
-
-    struct dirent *entry;
-    int count = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        if (strstr(entry->d_name, "tg_") && strstr(entry->d_name, ".jsonl")) {
-            ESP_LOGI(TAG, "  Session: %s", entry->d_name);
-            count++;
+    /* Served from the file catalog, no directory walk */
+    fs_entry_t ents[8];
+    int skip = 0, count = 0, n;
+    while ((n = fs_catalog_query(MIMI_SPIFFS_SESSION_DIR "/", skip, ents, 8)) > 0) {
+        for (int i = 0; i < n; i++) {
+            const char *name = ents[i].path + strlen(MIMI_SPIFFS_SESSION_DIR "/");
+            if (strstr(name, "tg_") && strstr(name, ".jsonl")) {
+                ESP_LOGI(TAG, "  Session: %s (%u bytes)", name, (unsigned)ents[i].size);
+                count++;
+            }
         }
+        skip += n;
     }
-    closedir(dir);
 
     if (count == 0) {
         ESP_LOGI(TAG, "  No sessions found");
@@ -1,12 +1,14 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_event.h"
 #include "esp_system.h"
 #include "esp_heap_caps.h"
-#include "esp_spiffs.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 
 #include "mimi_config.h"
@@ -17,15 +19,26 @@
 #include "agent/agent_loop.h"
 #include "memory/memory_store.h"
 #include "memory/session_mgr.h"
+#include "memory/fact_store.h"
+#include "storage/storage.h"
+#include "storage/write_behind.h"
+#include "storage/fs_catalog.h"
+#include "storage/lzfile.h"
 #include "gateway/ws_server.h"
 #include "cli/serial_cli.h"
 #include "proxy/http_proxy.h"
 #include "tools/tool_registry.h"
+#include "tools/tool_manifest.h"
 #include "cron/cron_service.h"
+#include "clock/time_sync.h"
 #include "heartbeat/heartbeat.h"
 #include "buttons/button_driver.h"
 #include "imu/imu_manager.h"
 #include "skills/skill_loader.h"
+#include "trace/turn_trace.h"
+#include "trace/heap_sampler.h"
+#include "trace/task_monitor.h"
+#include "trace/dlog.h"
 
 static const char *TAG = "mimi";
 
@@ -40,28 +53,6 @@ static esp_err_t init_nvs(void)
     return ret;
 }
 
-static esp_err_t init_spiffs(void)
-{
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = MIMI_SPIFFS_BASE,
-        .partition_label = NULL,
-        .max_files = 10,
-        .format_if_mount_failed = true,
-    };
-
-    esp_err_t ret = esp_vfs_spiffs_register(&conf);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "SPIFFS mount failed: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    size_t total = 0, used = 0;
-    esp_spiffs_info(NULL, &total, &used);
-    ESP_LOGI(TAG, "SPIFFS: total=%d, used=%d", (int)total, (int)used);
-
-    return ESP_OK;
-}
-
 /* Outbound dispatch task: reads from outbound queue and routes to channels */
 static void outbound_dispatch_task(void *arg)
 {
@@ -72,6 +63,7 @@ static void outbound_dispatch_task(void *arg)
         if (message_bus_pop_outbound(&msg, UINT32_MAX) != ESP_OK) continue;
 
         ESP_LOGI(TAG, "Dispatching response to %s:%s", msg.channel, msg.chat_id);
+        int64_t t0 = esp_timer_get_time();
 
         if (strcmp(msg.channel, MIMI_CHAN_TELEGRAM) == 0) {
             esp_err_t send_err = telegram_send_message(msg.chat_id, msg.content);
@@ -87,9 +79,14 @@ static void outbound_dispatch_task(void *arg)
             }
         } else if (strcmp(msg.channel, MIMI_CHAN_SYSTEM) == 0) {
             ESP_LOGI(TAG, "System message [%s]: %.128s", msg.chat_id, msg.content);
+            if (strcmp(msg.chat_id, "heartbeat") == 0) {
+                heartbeat_on_reply(msg.content);
+            }
         } else {
             ESP_LOGW(TAG, "Unknown channel: %s", msg.channel);
         }
+        /* Time in the outbound queue is not delivery time; the span starts at dequeue */
+        turn_trace_outbound(msg.trace_id, t0, esp_timer_get_time());
 
         free(msg.content);
     }
@@ -118,11 +115,22 @@ void app_main(void)
     /* Phase 1: Core infrastructure */
     ESP_ERROR_CHECK(init_nvs());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    ESP_ERROR_CHECK(init_spiffs());
+
+    /* Local time zone for cron expressions, daily notes and timestamps */
+    setenv("TZ", MIMI_TIMEZONE, 1);
+    tzset();
+
+    ESP_ERROR_CHECK(storage_init());
+    ESP_ERROR_CHECK(write_behind_init());
+    ESP_ERROR_CHECK(fs_catalog_init());
 
     /* Initialize subsystems */
     ESP_ERROR_CHECK(message_bus_init());
+    ESP_ERROR_CHECK(dlog_init());
+    ESP_ERROR_CHECK(turn_trace_init());
+    ESP_ERROR_CHECK(heap_sampler_init());
     ESP_ERROR_CHECK(memory_store_init());
+    ESP_ERROR_CHECK(fact_store_init());
     ESP_ERROR_CHECK(skill_loader_init());
     ESP_ERROR_CHECK(session_mgr_init());
     ESP_ERROR_CHECK(wifi_manager_init());
@@ -130,12 +138,16 @@ void app_main(void)
     ESP_ERROR_CHECK(telegram_bot_init());
     ESP_ERROR_CHECK(llm_proxy_init());
     ESP_ERROR_CHECK(tool_registry_init());
+    ESP_ERROR_CHECK(tool_manifest_init());
     ESP_ERROR_CHECK(cron_service_init());
     ESP_ERROR_CHECK(heartbeat_init());
     ESP_ERROR_CHECK(agent_loop_init());
 
     /* Start Serial CLI first (works without WiFi) */
     ESP_ERROR_CHECK(serial_cli_init());
+    heap_sampler_start();
+    task_monitor_start();
+    lzfile_start();
 
     /* Start WiFi */
     esp_err_t wifi_err = wifi_manager_start();
@@ -154,11 +166,17 @@ void app_main(void)
                 ? ESP_OK : ESP_FAIL);
 
             /* Start network-dependent services */
+            time_sync_start();
             ESP_ERROR_CHECK(agent_loop_start());
             ESP_ERROR_CHECK(telegram_bot_start());
+            ESP_ERROR_CHECK(ws_server_start());
+
+            /* Cron schedules from the wall clock: give the first sync a chance */
+            if (time_sync_wait(MIMI_TIME_BOOT_WAIT_MS) != ESP_OK) {
+                ESP_LOGW(TAG, "Clock not set yet, cron starts anyway");
+            }
             cron_service_start();
             heartbeat_start();
-            ESP_ERROR_CHECK(ws_server_start());
 
             ESP_LOGI(TAG, "All services started!");
         } else {
@@ -25,6 +25,18 @@
 #ifndef MIMI_SECRET_MODEL_PROVIDER
 #define MIMI_SECRET_MODEL_PROVIDER  "anthropic"
 #endif
+#ifndef MIMI_SECRET_LLM_URL
+#define MIMI_SECRET_LLM_URL         ""
+#endif
+#ifndef MIMI_SECRET_FALLBACK_PROVIDER
+#define MIMI_SECRET_FALLBACK_PROVIDER ""
+#endif
+#ifndef MIMI_SECRET_FALLBACK_MODEL
+#define MIMI_SECRET_FALLBACK_MODEL  ""
+#endif
+#ifndef MIMI_SECRET_FALLBACK_API_KEY
+#define MIMI_SECRET_FALLBACK_API_KEY ""
+#endif
 #ifndef MIMI_SECRET_PROXY_HOST
 #define MIMI_SECRET_PROXY_HOST      ""
 #endif
@@ -60,6 +72,14 @@
 #define MIMI_AGENT_MAX_TOOL_ITER     10
 #define MIMI_MAX_TOOL_CALLS          4
 #define MIMI_AGENT_SEND_WORKING_STATUS 1
+#define MIMI_JSON_ARENA_SIZE         (256 * 1024)  /* per-turn cJSON arena in PSRAM */
+#define MIMI_TOOLS_SELECT            1             /* 0: send every tool schema on every turn */
+#define MIMI_TOOLS_HINT_TAIL         1024          /* history bytes scanned for tool hints */
+#define MIMI_TOOLS_SKILL_SCAN        4096          /* skill text scanned for tool names per turn */
+#define MIMI_TOOLS_LACK_SENTENCE     256           /* reply sentence bytes checked for a missing tool */
+#define MIMI_TOOLS_INIT              16            /* tool table grows by doubling */
+#define MIMI_TOOLS_MAX               64
+#define MIMI_TOOL_NAME_MAX           64            /* [A-Za-z0-9_-]{1,64}, the limit both LLM APIs allow */
 
 /* Timezone (POSIX TZ format) */
 #define MIMI_TIMEZONE                "PST8PDT,M3.2.0,M11.1.0"
@@ -70,10 +90,42 @@
 #define MIMI_LLM_MAX_TOKENS          4096
 #define MIMI_LLM_API_URL             "https://api.anthropic.com/v1/messages"
 #define MIMI_OPENAI_API_URL          "https://api.openai.com/v1/chat/completions"
+#define MIMI_LLM_LOCAL_PATH_DEFAULT  "/v1/chat/completions"  /* "local" provider, when URL has no path */
 #define MIMI_LLM_API_VERSION         "2023-06-01"
 #define MIMI_LLM_STREAM_BUF_SIZE     (32 * 1024)
 #define MIMI_LLM_LOG_VERBOSE_PAYLOAD 0
 #define MIMI_LLM_LOG_PREVIEW_BYTES   160
+#define MIMI_LLM_MAX_ENDPOINTS       3       /* primary + fallbacks */
+#define MIMI_LLM_MAX_ATTEMPTS        4       /* HTTP attempts per llm_chat_tools() */
+#define MIMI_LLM_CB_THRESHOLD        3       /* consecutive failures that open the breaker */
+#define MIMI_LLM_BACKOFF_BASE_MS     1000
+#define MIMI_LLM_BACKOFF_MAX_MS      (5 * 60 * 1000)
+#define MIMI_LLM_RETRY_WAIT_MAX_MS   (30 * 1000)  /* longest in-turn wait for a backoff */
+#define MIMI_LLM_HEDGE_DEFAULT_MS    0       /* 0 = hedging off */
+#define MIMI_LLM_WORKER_STACK        (12 * 1024)
+
+/* Turn Tracing */
+#define MIMI_TRACE_RING_LEN          16      /* turns kept in PSRAM */
+#define MIMI_TRACE_MAX_SPANS         32      /* spans per turn, extra are counted as dropped */
+
+/* Heap Telemetry */
+#define MIMI_HEAP_SAMPLE_INTERVAL_MS (10 * 1000)
+#define MIMI_HEAP_SAMPLE_RING        128     /* samples kept in PSRAM */
+#define MIMI_HEAP_FAIL_RING          16      /* failed allocations kept */
+
+/* Task Monitor */
+#define MIMI_TASKMON_INTERVAL_MS     (5 * 1000)
+#define MIMI_TASKMON_MAX_TASKS       40
+#define MIMI_TASKMON_STACK_WARN      1024    /* bytes of headroom that trigger a warning */
+
+/* Deferred Logging */
+#define MIMI_DLOG_ENABLED            1       /* 0: DLOGx fall back to ESP_LOGx */
+#define MIMI_DLOG_RING_SIZE          (32 * 1024)
+#define MIMI_DLOG_STR_MAX            160     /* string arguments are truncated to this */
+#define MIMI_DLOG_DRAIN_MS           50
+#define MIMI_DLOG_DRAIN_STACK        (4 * 1024)
+#define MIMI_DLOG_DRAIN_PRIO         1
+#define MIMI_DLOG_DRAIN_CORE         0
 
 /* Message Bus */
 #define MIMI_BUS_QUEUE_LEN           16
@@ -82,7 +134,11 @@
 #define MIMI_OUTBOUND_CORE           0
 
 /* Memory / SPIFFS */
-#define MIMI_SPIFFS_BASE             "/spiffs"
+#define MIMI_SPIFFS_BASE             "/spiffs"       /* mount point, LittleFS or SPIFFS */
+#define MIMI_STORAGE_PARTITION       "spiffs"
+#define MIMI_STORAGE_MIGRATE_MAX     (4 * 1024 * 1024)   /* largest SPIFFS image staged for migration */
+#define MIMI_CATALOG_MAX_FILES       512     /* in-memory file catalog (list_dir, skills, sessions) */
+#define MIMI_CATALOG_PATH_LEN        96
 #define MIMI_SPIFFS_CONFIG_DIR       MIMI_SPIFFS_BASE "/config"
 #define MIMI_SPIFFS_MEMORY_DIR       MIMI_SPIFFS_BASE "/memory"
 #define MIMI_SPIFFS_SESSION_DIR      MIMI_SPIFFS_BASE "/sessions"
@@ -90,17 +146,104 @@
 #define MIMI_SOUL_FILE               MIMI_SPIFFS_CONFIG_DIR "/SOUL.md"
 #define MIMI_USER_FILE               MIMI_SPIFFS_CONFIG_DIR "/USER.md"
 #define MIMI_CONTEXT_BUF_SIZE        (16 * 1024)
+#define MIMI_LOCAL_CMD_REPLY_SIZE    (2 * 1024)        /* /status, /cron, ... replies */
 #define MIMI_SESSION_MAX_MSGS        20
+#define MIMI_FILE_EDIT_CHUNK         (4 * 1024)  /* edit_file streams through files in PSRAM chunks of this size */
+
+/* Memory Index */
+#define MIMI_MEMIDX_FILE             MIMI_SPIFFS_BASE "/memidx.bin"
+#define MIMI_MEMIDX_MAX_FILES        256
+#define MIMI_MEMIDX_MAX_CHUNKS       2048
+#define MIMI_MEMIDX_MAX_POSTINGS     (24 * 1024)
+#define MIMI_MEMIDX_CHUNK_BYTES      480     /* notes split at blank lines, headings or this size */
+#define MIMI_MEMIDX_SAVE_INTERVAL_MS (60 * 1000)
+#define MIMI_MEMIDX_TOP_K            6       /* chunks pulled into the system prompt */
+#define MIMI_MEMIDX_CONTEXT_BUDGET   3072    /* bytes of prompt spent on them */
+
+/* Fact Store */
+#define MIMI_FACT_FILE               MIMI_SPIFFS_MEMORY_DIR "/facts.jsonl"
+#define MIMI_FACT_MAX                128
+#define MIMI_FACT_KEY_LEN            48
+#define MIMI_FACT_CAT_LEN            24
+#define MIMI_FACT_VALUE_LEN          256
+#define MIMI_FACT_COMPACT_SLACK      32      /* log records allowed beyond 2x live facts */
+#define MIMI_FACT_PROMPT_BUDGET      2048
+
+/* Write-Behind (session + daily note appends) */
+#define MIMI_WB_MAX_FILES            8
+#define MIMI_WB_BUF_SIZE             (8 * 1024)  /* per file, PSRAM */
+#define MIMI_WB_FLUSH_BYTES          (4 * 1024)  /* flush a file once this much is pending */
+#define MIMI_WB_MAX_AGE_MS           (10 * 1000) /* ...or its oldest byte is this old: max loss on power cut */
+#define MIMI_WB_TICK_MS              1000
+#define MIMI_WB_STACK                (4 * 1024)
+#define MIMI_WB_PRIO                 2
+#define MIMI_WB_CORE                 0
+
+/* Cold-File Compression */
+#define MIMI_LZ_BLOCK_SIZE           (16 * 1024) /* independent compressed blocks in an .lz file */
+#define MIMI_LZ_LOAD_MAX             (512 * 1024)
+#define MIMI_LZ_NOTE_AGE_DAYS        7           /* daily notes older than this are compressed */
+#define MIMI_LZ_SESSION_HOT_BYTES    (32 * 1024) /* sessions above this move their head into <file>.lz */
+#define MIMI_LZ_SESSION_KEEP_MSGS    40          /* ...keeping this many records as plain text */
+#define MIMI_LZ_SWEEP_DELAY_MS       (3 * 60 * 1000)
+#define MIMI_LZ_SWEEP_INTERVAL_MS    (6 * 60 * 60 * 1000)
+#define MIMI_LZ_SWEEP_STACK          (6 * 1024)
+#define MIMI_LZ_SWEEP_PRIO           1
+#define MIMI_LZ_SWEEP_CORE           0
 
 /* Cron / Heartbeat */
 #define MIMI_CRON_FILE               MIMI_SPIFFS_BASE "/cron.json"
-#define MIMI_CRON_MAX_JOBS           16
-#define MIMI_CRON_CHECK_INTERVAL_MS  (60 * 1000)
+#define MIMI_CRON_STATE_FILE         MIMI_SPIFFS_BASE "/cron.state"
+#define MIMI_CRON_INIT_JOBS          16                /* job table grows by doubling */
+#define MIMI_CRON_MAX_JOBS           256
+#define MIMI_CRON_MAX_SLEEP_MS       (60 * 60 * 1000)  /* re-check cap, picks up clock changes */
 #define MIMI_HEARTBEAT_FILE          MIMI_SPIFFS_BASE "/HEARTBEAT.md"
 #define MIMI_HEARTBEAT_INTERVAL_MS   (30 * 60 * 1000)
+#define MIMI_HEARTBEAT_MAX_BACKOFF   8                 /* max intervals skipped after HEARTBEAT_OK */
+#define MIMI_HEARTBEAT_INLINE_MAX    (2 * 1024)        /* larger files: agent reads them itself */
+
+/* Web Search Cache */
+#define MIMI_SEARCH_CACHE_FILE       MIMI_SPIFFS_BASE "/search_cache.bin"
+#define MIMI_SEARCH_CACHE_ENTRIES    32
+#define MIMI_SEARCH_CACHE_KEY_MAX    128               /* longer queries are not cached */
+#define MIMI_SEARCH_CACHE_VALUE_MAX  (4 * 1024)        /* larger results are not cached */
+#define MIMI_SEARCH_CACHE_TTL_S      (30 * 60)
+#define MIMI_SEARCH_CACHE_SAVE_INTERVAL_MS (5 * 60 * 1000)
+#define MIMI_SEARCH_CACHE_MAX_FLIGHTS 4                /* distinct queries fetched at once that others can join */
+#define MIMI_SEARCH_CACHE_WAIT_MS    (20 * 1000)       /* how long a joiner waits for that fetch */
+
+/* Web Fetch */
+#define MIMI_WEB_FETCH_MAX_TEXT      (6 * 1024)        /* text returned unless max_chars asks for less */
+#define MIMI_WEB_FETCH_MAX_BYTES     (512 * 1024)      /* download budget per page */
+#define MIMI_WEB_FETCH_TIMEOUT_MS    15000
+#define MIMI_WEB_FETCH_MAX_REDIRECTS 3
+#define MIMI_WEB_FETCH_USER_AGENT    "MimiClaw/1.0 (ESP32-S3)"
+
+/* Manifest Tools */
+#define MIMI_TOOL_MANIFEST_PREFIX    MIMI_SPIFFS_BASE "/tools/"
+#define MIMI_TOOL_ENDPOINTS_FILE     MIMI_SPIFFS_BASE "/tools/endpoints.json"
+#define MIMI_TOOL_MANIFEST_MAX_SIZE  (4 * 1024)
+#define MIMI_TOOL_MANIFEST_MAX       16
+#define MIMI_TOOL_HTTP_URL_MAX       256
+#define MIMI_TOOL_HTTP_HEADERS_MAX   384               /* "Name: value\n" lines from endpoints.json */
+#define MIMI_TOOL_HTTP_TIMEOUT_MS    10000
+
+/* Time Sync */
+#define MIMI_SNTP_SERVER_1           "pool.ntp.org"
+#define MIMI_SNTP_SERVER_2           "time.cloudflare.com"
+#define MIMI_TIME_HTTP_HOST          "api.telegram.org"  /* Date header fallback */
+#define MIMI_TIME_SYNC_INTERVAL_MS   (60 * 60 * 1000)    /* SNTP poll; HTTP after 2x this without an answer */
+#define MIMI_TIME_SNTP_WAIT_MS       (10 * 1000)         /* first SNTP answer before trying HTTP */
+#define MIMI_TIME_RETRY_MS           (30 * 1000)         /* HTTP retry while failing, doubling */
+#define MIMI_TIME_BOOT_WAIT_MS       (25 * 1000)         /* cron start waits this long for a valid clock */
+#define MIMI_TIME_VALID_AFTER        1704067200          /* 2024-01-01: earlier readings mean unset */
+#define MIMI_TIME_SYNC_STACK         (8 * 1024)
+#define MIMI_TIME_SYNC_PRIO          2
+#define MIMI_TIME_SYNC_CORE          0
 
 /* Skills */
-#define MIMI_SKILLS_PREFIX           MIMI_SPIFFS_BASE "/skills/"
+#define MIMI_SKILLS_DIR              MIMI_SPIFFS_BASE "/skills"
+#define MIMI_SKILLS_PREFIX           MIMI_SKILLS_DIR "/"
 
 /* WebSocket Gateway */
 #define MIMI_WS_PORT                 18789
@@ -117,6 +260,7 @@
 #define MIMI_NVS_LLM                 "llm_config"
 #define MIMI_NVS_PROXY               "proxy_config"
 #define MIMI_NVS_SEARCH              "search_config"
+#define MIMI_NVS_STORAGE             "storage_config"
 
 /* NVS Keys */
 #define MIMI_NVS_KEY_SSID            "ssid"
@@ -125,5 +269,8 @@
 #define MIMI_NVS_KEY_API_KEY         "api_key"
 #define MIMI_NVS_KEY_MODEL           "model"
 #define MIMI_NVS_KEY_PROVIDER        "provider"
+#define MIMI_NVS_KEY_HEDGE_MS        "hedge_ms"
+#define MIMI_NVS_KEY_LLM_URL         "base_url"
 #define MIMI_NVS_KEY_PROXY_HOST      "host"
 #define MIMI_NVS_KEY_PROXY_PORT      "port"
+#define MIMI_NVS_KEY_MIGRATING       "migrating"
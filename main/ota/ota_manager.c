@@ -1,4 +1,6 @@
 #include "ota_manager.h"
+#include "storage/write_behind.h"
+#include "tools/search_cache.h"
 
 #include "esp_log.h"
 #include "esp_ota_ops.h"
@@ -26,6 +28,8 @@ esp_err_t ota_update_from_url(const char *url)
     esp_err_t ret = esp_https_ota(&ota_config);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "OTA successful, restarting...");
+        write_behind_sync_all();
+        search_cache_sync();
         esp_restart();
     } else {
         ESP_LOGE(TAG, "OTA failed: %s", esp_err_to_name(ret));
@@ -3,12 +3,14 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <strings.h>
 #include <errno.h>
 #include <sys/socket.h>
 #include <netdb.h>
 #include <unistd.h>
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs.h"
 #include "esp_tls.h"
 #include "esp_crt_bundle.h"
@@ -109,6 +111,8 @@ bool http_proxy_is_enabled(void)
 struct proxy_conn {
     int         sock;   /* raw TCP socket (for timeout control) */
     esp_tls_t  *tls;    /* esp_tls handle owns TLS + socket lifecycle */
+    int64_t     tunnel_done_us;     /* esp_timer time when the tunnel was up */
+    int64_t     tls_done_us;        /* esp_timer time when the handshake finished */
 };
 
 /* Read a line from socket (up to CR-LF). Returns length or -1. */
@@ -274,10 +278,12 @@ proxy_conn_t *proxy_conn_open(const char *host, int port, int timeout_ms)
         sock = open_connect_tunnel(host, port, timeout_ms);
     }
     if (sock < 0) return NULL;
+    int64_t tunnel_done = esp_timer_get_time();
 
     proxy_conn_t *conn = calloc(1, sizeof(*conn));
     if (!conn) { close(sock); return NULL; }
     conn->sock = sock;
+    conn->tunnel_done_us = tunnel_done;
 
     /* ── TLS handshake via esp_tls over tunnel ───────────────── */
     conn->tls = esp_tls_init();
@@ -304,10 +310,17 @@ proxy_conn_t *proxy_conn_open(const char *host, int port, int timeout_ms)
         return NULL;
     }
 
+    conn->tls_done_us = esp_timer_get_time();
     ESP_LOGI(TAG, "TLS handshake OK with %s:%d via proxy", host, port);
     return conn;
 }
 
+void proxy_conn_get_timing(const proxy_conn_t *conn, int64_t *tunnel_done_us, int64_t *tls_done_us)
+{
+    if (tunnel_done_us) *tunnel_done_us = conn->tunnel_done_us;
+    if (tls_done_us) *tls_done_us = conn->tls_done_us;
+}
+
 int proxy_conn_write(proxy_conn_t *conn, const char *data, int len)
 {
     int written = 0;
@@ -340,6 +353,159 @@ int proxy_conn_read(proxy_conn_t *conn, char *buf, int len, int timeout_ms)
     return (int)ret;
 }
 
+/* ── Streaming response body ──────────────────────────────────── */
+
+typedef struct {
+    bool chunked;
+    int state;                 /* chunked: BODY_SIZE / BODY_DATA / BODY_DATA_END */
+    long remaining;            /* bytes left in the chunk, or Content-Length (-1 = until close) */
+    bool in_ext;               /* skipping a chunk extension */
+    uint8_t size_digits;       /* significant hex digits of the chunk size so far */
+    bool done;
+    bool error;                /* malformed chunk framing */
+    proxy_body_cb_t cb;
+    void *ctx;
+} body_state_t;
+
+enum { BODY_SIZE, BODY_DATA, BODY_DATA_END };
+#define BODY_SIZE_DIGITS_MAX 7     /* chunk sizes up to 256 MB; keeps `remaining` within a 32-bit long */
+
+/* Feed raw body bytes; false once the body is complete or the callback stopped */
+static bool body_feed(body_state_t *b, const char *data, size_t len)
+{
+    if (!b->chunked) {
+        if (b->remaining >= 0 && (long)len > b->remaining) len = b->remaining;
+        if (len && !b->cb(b->ctx, data, len)) return false;
+        if (b->remaining >= 0) {
+            b->remaining -= len;
+            if (b->remaining == 0) b->done = true;
+        }
+        return !b->done;
+    }
+
+    size_t i = 0;
+    while (i < len) {
+        if (b->state == BODY_SIZE) {
+            char c = data[i++];
+            if (c == '\n') {
+                if (b->remaining == 0) {
+                    b->done = true;        /* last chunk; trailers are ignored */
+                    return false;
+                }
+                b->state = BODY_DATA;
+                b->in_ext = false;
+            } else if (c == ';') {
+                b->in_ext = true;
+            } else if (!b->in_ext && c != '\r') {
+                int v = (c >= '0' && c <= '9') ? c - '0' :
+                        (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+                        (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+                if (b->remaining || v) b->size_digits++;   /* leading zeros are free */
+                if (v < 0 || b->size_digits > BODY_SIZE_DIGITS_MAX) {
+                    b->error = true;
+                    return false;
+                }
+                b->remaining = b->remaining * 16 + v;
+            }
+        } else if (b->state == BODY_DATA) {
+            size_t n = len - i;
+            if ((long)n > b->remaining) n = b->remaining;
+            if (!b->cb(b->ctx, data + i, n)) return false;
+            i += n;
+            b->remaining -= n;
+            if (b->remaining == 0) b->state = BODY_DATA_END;
+        } else {
+            /* CRLF after the chunk data */
+            if (data[i++] == '\n') {
+                b->state = BODY_SIZE;
+                b->remaining = 0;
+                b->size_digits = 0;
+            }
+        }
+    }
+    return true;
+}
+
+/* Value of header `name` in a NUL-terminated response head, trimmed */
+static bool header_value(const char *head, const char *name, char *out, size_t size)
+{
+    size_t n = strlen(name);
+    for (const char *p = strstr(head, "\r\n"); p; p = strstr(p + 2, "\r\n")) {
+        if (strncasecmp(p + 2, name, n) != 0 || p[2 + n] != ':') continue;
+        const char *v = p + 3 + n;
+        while (*v == ' ' || *v == '\t') v++;
+        size_t len = strcspn(v, "\r\n");
+        while (len && (v[len - 1] == ' ' || v[len - 1] == '\t')) len--;
+        if (len >= size) len = size - 1;
+        memcpy(out, v, len);
+        out[len] = '\0';
+        return true;
+    }
+    return false;
+}
+
+int proxy_conn_read_response(proxy_conn_t *conn, int timeout_ms, proxy_resp_info_t *info,
+                             proxy_body_cb_t on_body, void *ctx)
+{
+    char head[1536];
+    size_t hlen = 0;
+    char *end = NULL;
+
+    /* Header */
+    while (!end) {
+        if (hlen >= sizeof(head) - 1) return -1;
+        int n = proxy_conn_read(conn, head + hlen, sizeof(head) - 1 - hlen, timeout_ms);
+        if (n <= 0) return -1;
+        hlen += n;
+        head[hlen] = '\0';
+        end = strstr(head, "\r\n\r\n");
+    }
+
+    int status = -1;
+    if (strncmp(head, "HTTP/", 5) == 0) {
+        const char *sp = strchr(head, ' ');
+        if (sp) status = atoi(sp + 1);
+    }
+
+    *end = '\0';
+    if (info) {
+        info->status = status;
+        if (!header_value(head, "Content-Type", info->content_type, sizeof(info->content_type))) {
+            info->content_type[0] = '\0';
+        }
+        if (!header_value(head, "Location", info->location, sizeof(info->location))) {
+            info->location[0] = '\0';
+        }
+    }
+
+    char val[32];
+    body_state_t b = { .remaining = -1, .cb = on_body, .ctx = ctx };
+    if (header_value(head, "Transfer-Encoding", val, sizeof(val)) && strcasestr(val, "chunked")) {
+        b.chunked = true;
+        b.remaining = 0;
+    } else if (header_value(head, "Content-Length", val, sizeof(val))) {
+        b.remaining = atol(val);
+    }
+
+    /* Body: what came with the header, then the rest */
+    const char *body = end + 4;
+    size_t blen = hlen - (body - head);
+    if (b.remaining == 0 && !b.chunked) return status;
+    if (!blen || body_feed(&b, body, blen)) {
+        char buf[1024];
+        while (1) {
+            int n = proxy_conn_read(conn, buf, sizeof(buf), timeout_ms);
+            if (n <= 0) break;
+            if (!body_feed(&b, buf, n)) break;
+        }
+    }
+    if (b.error) {
+        ESP_LOGW(TAG, "Bad chunk size in response");
+        return -1;
+    }
+    return status;
+}
+
 void proxy_conn_close(proxy_conn_t *conn)
 {
     if (!conn) return;
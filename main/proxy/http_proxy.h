@@ -44,5 +44,31 @@ int proxy_conn_write(proxy_conn_t *conn, const char *data, int len);
 /** Read raw bytes from the TLS tunnel. Returns bytes read or -1. */
 int proxy_conn_read(proxy_conn_t *conn, char *buf, int len, int timeout_ms);
 
+/** Receives body bytes; return false to stop reading. */
+typedef bool (*proxy_body_cb_t)(void *ctx, const char *data, size_t len);
+
+/** Response header fields, filled in before the first body byte. */
+typedef struct {
+    int status;
+    char content_type[64];             /* empty if absent */
+    char location[256];                /* redirect target, empty if absent */
+} proxy_resp_info_t;
+
+/**
+ * Read an HTTP/1.1 response and hand its body to on_body as it arrives,
+ * with chunked transfer coding removed, so the caller needs no buffer for
+ * the whole response. Stops at the end of the body, on a read error or
+ * timeout, or when on_body returns false. info may be NULL.
+ * @return HTTP status code, or -1 if no complete header arrived
+ */
+int proxy_conn_read_response(proxy_conn_t *conn, int timeout_ms, proxy_resp_info_t *info,
+                             proxy_body_cb_t on_body, void *ctx);
+
+/**
+ * esp_timer timestamps of when the proxy tunnel came up and when the TLS
+ * handshake over it finished (for tracing).
+ */
+void proxy_conn_get_timing(const proxy_conn_t *conn, int64_t *tunnel_done_us, int64_t *tls_done_us);
+
 /** Close and free the connection. */
 void proxy_conn_close(proxy_conn_t *conn);
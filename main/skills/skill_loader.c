@@ -1,9 +1,12 @@
 #include "skills/skill_loader.h"
 #include "mimi_config.h"
+#include "storage/fs_catalog.h"
 
 #include <stdio.h>
 #include <string.h>
-#include <dirent.h>
+#include <stdbool.h>
+#include <strings.h>
+#include <ctype.h>
 #include "esp_log.h"
 
 static const char *TAG = "skills";
@@ -125,6 +128,7 @@ static void install_builtin(const builtin_skill_t *skill)
 
     fputs(skill->content, f);
     fclose(f);
+    fs_catalog_update(path);
     ESP_LOGI(TAG, "Installed built-in skill: %s", path);
 }
 
@@ -200,63 +204,142 @@ static void extract_description(FILE *f, char *out, size_t out_size)
     out[off] = '\0';
 }
 
-size_t skill_loader_build_summary(char *buf, size_t size)
+/**
+ * Parse "title\tdescription" out of a skill file.
+ */
+static bool parse_skill_meta(const char *path, char *out, size_t out_size)
 {
-    DIR *dir = opendir(MIMI_SPIFFS_BASE);
-    if (!dir) {
-        ESP_LOGW(TAG, "Cannot open SPIFFS for skill enumeration");
-        buf[0] = '\0';
-        return 0;
-    }
-
-    size_t off = 0;
-    struct dirent *ent;
-    /* SPIFFS readdir returns filenames relative to the mount point (e.g. "skills/weather.md").
-       We match entries that start with "skills/" and end with ".md". */
-    const char *skills_subdir = "skills/";
-    const size_t subdir_len = strlen(skills_subdir);
-
-    while ((ent = readdir(dir)) != NULL && off < size - 1) {
-        const char *name = ent->d_name;
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
 
-        /* Match files under skills/ with .md extension */
-        if (strncmp(name, skills_subdir, subdir_len) != 0) continue;
+    /* Read first line for title */
+    char first_line[128];
+    if (!fgets(first_line, sizeof(first_line), f)) {
+        fclose(f);
+        return false;
+    }
 
-        size_t name_len = strlen(name);
-        if (name_len < subdir_len + 4) continue;  /* at least "skills/x.md" */
-        if (strcmp(name + name_len - 3, ".md") != 0) continue;
+    char title[64];
+    extract_title(first_line, strlen(first_line), title, sizeof(title));
 
-        /* Build full path */
-        char full_path[296];
-        snprintf(full_path, sizeof(full_path), "%s/%s", MIMI_SPIFFS_BASE, name);
+    /* Read description (until blank line) */
+    char desc[256];
+    extract_description(f, desc, sizeof(desc));
+    fclose(f);
 
-        FILE *f = fopen(full_path, "r");
-        if (!f) continue;
+    snprintf(out, out_size, "%s\t%s", title, desc);
+    return true;
+}
 
-        /* Read first line for title */
-        char first_line[128];
-        if (!fgets(first_line, sizeof(first_line), f)) {
-            fclose(f);
-            continue;
+size_t skill_loader_build_summary(char *buf, size_t size)
+{
+    size_t off = 0;
+    buf[0] = '\0';
+
+    /* Skills come from the file catalog; title/description are parsed once per file version */
+    fs_entry_t ents[8];
+    int skip = 0, n;
+    while (off < size - 1 && (n = fs_catalog_query(MIMI_SKILLS_PREFIX, skip, ents, 8)) > 0) {
+        skip += n;
+        for (int i = 0; i < n && off < size - 1; i++) {
+            const char *full_path = ents[i].path;
+            const char *name = full_path + strlen(MIMI_SKILLS_PREFIX);
+
+            /* Match .md files directly in the skills directory */
+            size_t name_len = strlen(name);
+            if (strchr(name, '/')) continue;
+            if (name_len < 4) continue;  /* at least "x.md" */
+            if (strcmp(name + name_len - 3, ".md") != 0) continue;
+
+            char meta[64 + 256 + 2];
+            if (!fs_catalog_get_meta(full_path, meta, sizeof(meta))) {
+                if (!parse_skill_meta(full_path, meta, sizeof(meta))) continue;
+                fs_catalog_set_meta(full_path, meta);
+            }
+            char *desc = strchr(meta, '\t');
+            if (desc) *desc++ = '\0';
+
+            /* Append to summary */
+            off += snprintf(buf + off, size - off,
+                "- **%s**: %s (read with: read_file %s)\n",
+                meta, desc ? desc : "", full_path);
         }
+    }
 
-        char title[64];
-        extract_title(first_line, strlen(first_line), title, sizeof(title));
+    if (off >= size) off = size - 1;
+    buf[off] = '\0';
+    ESP_LOGI(TAG, "Skills summary: %d bytes", (int)off);
+    return off;
+}
 
-        /* Read description (until blank line) */
-        char desc[256];
-        extract_description(f, desc, sizeof(desc));
-        fclose(f);
+/* ── Skills a message refers to ──────────────────────────────── */
+
+#define SKILL_MATCH_WORD_MIN  7     /* shorter description words match too much */
 
-        /* Append to summary */
-        off += snprintf(buf + off, size - off,
-            "- **%s**: %s (read with: read_file %s)\n",
-            title, desc, full_path);
+/* Case-insensitive match of a phrase, with '-' and '_' read as spaces */
+static bool text_has_phrase(const char *text, const char *phrase, size_t len)
+{
+    char key[64];
+    if (len < 4 || len >= sizeof(key)) return false;
+    for (size_t i = 0; i < len; i++) {
+        key[i] = (phrase[i] == '-' || phrase[i] == '_') ? ' ' : phrase[i];
     }
+    key[len] = '\0';
+    return strcasestr(text, key) != NULL;
+}
 
-    closedir(dir);
+/* The skill's file name, title, or a long word of its description appears in text */
+static bool skill_mentioned(const char *text, const char *name, const char *meta)
+{
+    const char *dot = strrchr(name, '.');
+    if (text_has_phrase(text, name, dot ? (size_t)(dot - name) : strlen(name))) return true;
+
+    const char *tab = strchr(meta, '\t');
+    size_t title_len = tab ? (size_t)(tab - meta) : strlen(meta);
+    if (text_has_phrase(text, meta, title_len)) return true;
+    if (!tab) return false;
+
+    for (const char *p = tab + 1; *p; ) {
+        size_t n = 0;
+        while (isalpha((unsigned char)p[n])) n++;
+        if (n >= SKILL_MATCH_WORD_MIN && text_has_phrase(text, p, n)) return true;
+        p += n ? n : 1;
+    }
+    return false;
+}
 
-    buf[off] = '\0';
-    ESP_LOGI(TAG, "Skills summary: %d bytes", (int)off);
+size_t skill_loader_read_matching(const char *text, char *buf, size_t size)
+{
+    size_t off = 0;
+    if (size == 0) return 0;
+    buf[0] = '\0';
+    if (!text || !text[0]) return 0;
+
+    fs_entry_t ents[8];
+    int skip = 0, n;
+    while (off < size - 1 && (n = fs_catalog_query(MIMI_SKILLS_PREFIX, skip, ents, 8)) > 0) {
+        skip += n;
+        for (int i = 0; i < n && off < size - 1; i++) {
+            const char *full_path = ents[i].path;
+            const char *name = full_path + strlen(MIMI_SKILLS_PREFIX);
+            size_t name_len = strlen(name);
+            if (strchr(name, '/') || name_len < 4 || strcmp(name + name_len - 3, ".md") != 0) continue;
+
+            char meta[64 + 256 + 2];
+            if (!fs_catalog_get_meta(full_path, meta, sizeof(meta))) {
+                if (!parse_skill_meta(full_path, meta, sizeof(meta))) continue;
+                fs_catalog_set_meta(full_path, meta);
+            }
+            if (!skill_mentioned(text, name, meta)) continue;
+
+            FILE *f = fopen(full_path, "r");
+            if (!f) continue;
+            off += fread(buf + off, 1, size - 1 - off, f);
+            fclose(f);
+            buf[off] = '\0';
+            if (off < size - 1) buf[off++] = '\n';
+            buf[off] = '\0';
+        }
+    }
     return off;
 }
@@ -18,3 +18,11 @@ esp_err_t skill_loader_init(void);
  * @return Number of bytes written (0 if no skills found)
  */
 size_t skill_loader_build_summary(char *buf, size_t size);
+
+/**
+ * Copy the skill files that text refers to (by file name, title or a long
+ * word of the description) into buf, so their tool mentions can be found.
+ *
+ * @return bytes written (0 if no skill matches)
+ */
+size_t skill_loader_read_matching(const char *text, char *buf, size_t size);
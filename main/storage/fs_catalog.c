@@ -0,0 +1,263 @@
+#include "fs_catalog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "catalog";
+
+#define CATALOG_MAX_DEPTH   4
+
+typedef struct {
+    fs_entry_t e;
+    char *meta;                 /* PSRAM, NULL until set */
+} cat_slot_t;
+
+static cat_slot_t *s_slots = NULL;      /* MIMI_CATALOG_MAX_FILES, sorted by path, PSRAM */
+static int s_count = 0;
+static bool s_truncated = false;
+static SemaphoreHandle_t s_lock = NULL;
+
+static struct {
+    int64_t scan_us;
+    uint32_t queries;
+    uint32_t updates;
+} s_stats;
+
+/* ── Sorted table (caller holds s_lock) ───────────────────────── */
+
+static int lower_bound(const char *path)
+{
+    int lo = 0, hi = s_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(s_slots[mid].e.path, path) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int find(const char *path)
+{
+    int i = lower_bound(path);
+    return (i < s_count && strcmp(s_slots[i].e.path, path) == 0) ? i : -1;
+}
+
+static void put(const char *path, const struct stat *st)
+{
+    int i = lower_bound(path);
+    cat_slot_t *slot;
+
+    if (i < s_count && strcmp(s_slots[i].e.path, path) == 0) {
+        slot = &s_slots[i];
+        if (slot->e.size != (uint32_t)st->st_size || slot->e.mtime != (int64_t)st->st_mtime) {
+            free(slot->meta);
+            slot->meta = NULL;
+        }
+    } else {
+        if (s_count >= MIMI_CATALOG_MAX_FILES) {
+            if (!s_truncated) ESP_LOGW(TAG, "Catalog full, %s and later files not listed", path);
+            s_truncated = true;
+            return;
+        }
+        memmove(&s_slots[i + 1], &s_slots[i], (s_count - i) * sizeof(cat_slot_t));
+        s_count++;
+        slot = &s_slots[i];
+        memset(slot, 0, sizeof(*slot));
+        strcpy(slot->e.path, path);
+    }
+
+    slot->e.size = (uint32_t)st->st_size;
+    slot->e.mtime = (int64_t)st->st_mtime;
+}
+
+static void drop(int i)
+{
+    free(s_slots[i].meta);
+    memmove(&s_slots[i], &s_slots[i + 1], (s_count - i - 1) * sizeof(cat_slot_t));
+    s_count--;
+}
+
+static void clear(void)
+{
+    for (int i = 0; i < s_count; i++) free(s_slots[i].meta);
+    s_count = 0;
+    s_truncated = false;
+}
+
+/* ── Directory walk ───────────────────────────────────────────── */
+
+/* Subdirectories exist on LittleFS; SPIFFS returns names with embedded slashes */
+static void walk(const char *dir_path, int depth)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir) return;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        char path[MIMI_CATALOG_PATH_LEN];
+        if (snprintf(path, sizeof(path), "%s/%s", dir_path, ent->d_name) >= (int)sizeof(path)) {
+            ESP_LOGW(TAG, "Path too long, skipped: %s/%s", dir_path, ent->d_name);
+            continue;
+        }
+
+        if (ent->d_type == DT_DIR) {
+            if (depth < CATALOG_MAX_DEPTH) walk(path, depth + 1);
+            continue;
+        }
+
+        struct stat st;
+        if (stat(path, &st) == 0) put(path, &st);
+    }
+    closedir(dir);
+}
+
+static void scan_locked(void)
+{
+    int64_t t0 = esp_timer_get_time();
+    clear();
+    walk(MIMI_SPIFFS_BASE, 0);
+    s_stats.scan_us = esp_timer_get_time() - t0;
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t fs_catalog_init(void)
+{
+    s_slots = heap_caps_calloc(MIMI_CATALOG_MAX_FILES, sizeof(cat_slot_t), MALLOC_CAP_SPIRAM);
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_slots || !s_lock) {
+        ESP_LOGE(TAG, "Out of memory for file catalog");
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    scan_locked();
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGI(TAG, "File catalog: %d files (%d ms)", s_count, (int)(s_stats.scan_us / 1000));
+    return ESP_OK;
+}
+
+void fs_catalog_update(const char *path)
+{
+    if (!s_lock || !path) return;
+    if (strncmp(path, MIMI_SPIFFS_BASE "/", strlen(MIMI_SPIFFS_BASE) + 1) != 0) return;
+    if (strlen(path) >= MIMI_CATALOG_PATH_LEN) return;
+
+    struct stat st;
+    bool exists = stat(path, &st) == 0 && !S_ISDIR(st.st_mode);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.updates++;
+    if (exists) {
+        put(path, &st);
+    } else {
+        int i = find(path);
+        if (i >= 0) drop(i);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void fs_catalog_rescan(void)
+{
+    if (!s_lock) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    scan_locked();
+    xSemaphoreGive(s_lock);
+}
+
+int fs_catalog_query(const char *prefix, int skip, fs_entry_t *out, int max)
+{
+    if (!s_lock) return 0;
+    if (!prefix) prefix = "";
+    size_t plen = strlen(prefix);
+
+    int n = 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.queries++;
+    for (int i = lower_bound(prefix) + skip; i < s_count && n < max; i++) {
+        if (strncmp(s_slots[i].e.path, prefix, plen) != 0) break;
+        out[n++] = s_slots[i].e;
+    }
+    xSemaphoreGive(s_lock);
+    return n;
+}
+
+bool fs_catalog_stat(const char *path, fs_entry_t *out)
+{
+    if (!s_lock || !path) return false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find(path);
+    if (i >= 0 && out) *out = s_slots[i].e;
+    xSemaphoreGive(s_lock);
+    return i >= 0;
+}
+
+bool fs_catalog_get_meta(const char *path, char *buf, size_t size)
+{
+    if (!s_lock || !path || size == 0) return false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find(path);
+    bool found = i >= 0 && s_slots[i].meta;
+    if (found) {
+        strncpy(buf, s_slots[i].meta, size - 1);
+        buf[size - 1] = '\0';
+    }
+    xSemaphoreGive(s_lock);
+    return found;
+}
+
+void fs_catalog_set_meta(const char *path, const char *meta)
+{
+    if (!s_lock || !path || !meta) return;
+
+    size_t len = strlen(meta);
+    char *copy = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM);
+    if (!copy) return;
+    memcpy(copy, meta, len + 1);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find(path);
+    if (i >= 0) {
+        free(s_slots[i].meta);
+        s_slots[i].meta = copy;
+        copy = NULL;
+    }
+    xSemaphoreGive(s_lock);
+    free(copy);
+}
+
+void fs_catalog_print_stats(void)
+{
+    if (!s_lock) {
+        printf("File catalog not initialized\n");
+        return;
+    }
+
+    uint64_t bytes = 0;
+    int with_meta = 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < s_count; i++) {
+        bytes += s_slots[i].e.size;
+        if (s_slots[i].meta) with_meta++;
+    }
+    int count = s_count;
+    bool truncated = s_truncated;
+    xSemaphoreGive(s_lock);
+
+    printf("Catalog: %d / %d files%s, %llu bytes, %d with metadata\n",
+           count, MIMI_CATALOG_MAX_FILES, truncated ? " (FULL, some files missing)" : "",
+           (unsigned long long)bytes, with_meta);
+    printf("  last scan %d ms, %lu queries, %lu updates since boot\n",
+           (int)(s_stats.scan_us / 1000), (unsigned long)s_stats.queries, (unsigned long)s_stats.updates);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mimi_config.h"
+
+/**
+ * In-memory catalog of every file under MIMI_SPIFFS_BASE.
+ *
+ * Built by one directory walk at boot and kept current by the writers
+ * (file tools, write-behind flushes, memory/fact/cron/skill saves), which
+ * call fs_catalog_update() after touching a file. Entries are sorted by
+ * path, so prefix queries ("/spiffs/sessions/") are a binary search plus a
+ * scan and never touch flash. Each entry can carry a short metadata string
+ * (skills keep their parsed title/description there); it is dropped when
+ * the file's size or mtime changes.
+ */
+
+typedef struct {
+    char path[MIMI_CATALOG_PATH_LEN];   /* full path, e.g. "/spiffs/memory/MEMORY.md" */
+    uint32_t size;
+    int64_t mtime;                      /* 0 if the filesystem does not keep one */
+} fs_entry_t;
+
+/**
+ * Walk the mounted filesystem and build the catalog.
+ */
+esp_err_t fs_catalog_init(void);
+
+/**
+ * Re-stat one path after it was created, written, renamed or removed.
+ */
+void fs_catalog_update(const char *path);
+
+/**
+ * Drop the catalog and walk the filesystem again.
+ */
+void fs_catalog_rescan(void);
+
+/**
+ * Copy entries whose path starts with prefix, in path order.
+ * @param skip  Matching entries to skip (for paging)
+ * @return entries copied (0 when done)
+ */
+int fs_catalog_query(const char *prefix, int skip, fs_entry_t *out, int max);
+
+/**
+ * Look up one path.
+ * @return false if the file is not in the catalog
+ */
+bool fs_catalog_stat(const char *path, fs_entry_t *out);
+
+/**
+ * Copy the metadata string attached to path.
+ * @return false if the file is unknown or has no metadata
+ */
+bool fs_catalog_get_meta(const char *path, char *buf, size_t size);
+
+/**
+ * Attach a metadata string to path (copied to PSRAM).
+ */
+void fs_catalog_set_meta(const char *path, const char *meta);
+
+/**
+ * Print entry count, bytes and build time.
+ */
+void fs_catalog_print_stats(void);
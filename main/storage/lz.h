@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Small LZ77 codec producing LZ4 block format (no frame): greedy parse,
+ * 4096-entry hash table, 64 KB window. Pure C with no ESP-IDF dependencies
+ * so the host benchmark in scripts/ can build it as is.
+ */
+
+/* Scratch memory lz_compress() needs (hash table) */
+#define LZ_WORK_SIZE        (4096 * sizeof(uint32_t))
+
+/* Worst-case compressed size of n bytes */
+#define LZ_BOUND(n)         ((n) + (n) / 255 + 16)
+
+/**
+ * Compress n bytes of src into dst.
+ * @param work  LZ_WORK_SIZE bytes, contents need not be initialized
+ * @return compressed size, or 0 if dst is too small
+ */
+size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap, void *work);
+
+/**
+ * Decompress a block produced by lz_compress().
+ * @return decompressed size, or -1 if the input is corrupt or does not fit in cap
+ */
+int lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap);
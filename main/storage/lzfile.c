@@ -0,0 +1,413 @@
+#include "lzfile.h"
+#include "lz.h"
+#include "fs_catalog.h"
+#include "mimi_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "lzfile";
+
+#define LZF_MAGIC           "MLZ1"
+#define LZF_STORED          0x80000000u     /* packed_len flag: block kept uncompressed */
+#define LZF_MAX_SWEEPS      4
+
+typedef struct {
+    uint32_t raw_len;
+    uint32_t packed_len;
+} lzf_block_t;
+
+static lzfile_sweep_fn_t s_sweeps[LZF_MAX_SWEEPS];
+static int s_nsweeps = 0;
+static SemaphoreHandle_t s_sweep_lock = NULL;
+
+static struct {
+    uint32_t files;             /* files compressed or appended to */
+    uint32_t blocks;
+    uint64_t raw_bytes;
+    uint64_t packed_bytes;
+    uint32_t loads;
+    int64_t load_us;
+    uint32_t errors;
+} s_stats;
+
+static void lz_path_of(const char *path, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s.lz", path);
+}
+
+/*
+ * Walk the block headers from just past the magic and return the offset
+ * after the last block that is entirely inside the file; a block cut short
+ * by a power loss during lzfile_append() ends the walk. -1 if a header is
+ * corrupt.
+ */
+static long scan_blocks(FILE *f, long fsize, size_t *total)
+{
+    long pos = 4;
+    size_t sum = 0;
+    lzf_block_t hdr;
+
+    if (fseek(f, pos, SEEK_SET) != 0) return -1;
+    while (pos + (long)sizeof(hdr) <= fsize && fread(&hdr, sizeof(hdr), 1, f) == 1) {
+        uint32_t packed = hdr.packed_len & ~LZF_STORED;
+        if (hdr.raw_len > MIMI_LZ_BLOCK_SIZE || packed > LZ_BOUND(MIMI_LZ_BLOCK_SIZE)) return -1;
+        if (pos + (long)sizeof(hdr) + (long)packed > fsize) break;
+        pos += sizeof(hdr) + packed;
+        sum += hdr.raw_len;
+        if (fseek(f, pos, SEEK_SET) != 0) return -1;
+    }
+    if (total) *total = sum;
+    return pos;
+}
+
+/* ── Replacing files ──────────────────────────────────────────── */
+
+esp_err_t lzfile_replace(const char *tmp, const char *path)
+{
+    if (rename(tmp, path) == 0) return ESP_OK;
+    remove(path);
+    return rename(tmp, path) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+void lzfile_recover_tmp(const char *tmp, const char *path)
+{
+    struct stat st;
+    if (stat(tmp, &st) != 0) return;
+
+    if (stat(path, &st) != 0) {
+        if (rename(tmp, path) == 0) ESP_LOGW(TAG, "Recovered %s from %s", path, tmp);
+    } else {
+        remove(tmp);
+    }
+    fs_catalog_update(tmp);
+    fs_catalog_update(path);
+}
+
+/* ── Writing ──────────────────────────────────────────────────── */
+
+static esp_err_t write_blocks(FILE *f, const char *data, size_t len)
+{
+    uint8_t *work = heap_caps_malloc(LZ_WORK_SIZE, MALLOC_CAP_SPIRAM);
+    uint8_t *out = heap_caps_malloc(LZ_BOUND(MIMI_LZ_BLOCK_SIZE), MALLOC_CAP_SPIRAM);
+    if (!work || !out) {
+        free(work);
+        free(out);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = ESP_OK;
+    for (size_t off = 0; off < len && err == ESP_OK; off += MIMI_LZ_BLOCK_SIZE) {
+        size_t n = len - off < MIMI_LZ_BLOCK_SIZE ? len - off : MIMI_LZ_BLOCK_SIZE;
+        size_t packed = lz_compress((const uint8_t *)data + off, n, out,
+                                    LZ_BOUND(MIMI_LZ_BLOCK_SIZE), work);
+
+        lzf_block_t hdr = { .raw_len = n, .packed_len = packed };
+        const void *payload = out;
+        if (packed == 0 || packed >= n) {
+            hdr.packed_len = n | LZF_STORED;
+            payload = data + off;
+            packed = n;
+        }
+
+        if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 || fwrite(payload, 1, packed, f) != packed) {
+            err = ESP_FAIL;
+        }
+        s_stats.blocks++;
+        s_stats.raw_bytes += n;
+        s_stats.packed_bytes += sizeof(hdr) + packed;
+    }
+
+    free(work);
+    free(out);
+    return err;
+}
+
+esp_err_t lzfile_append(const char *lz_path, const char *data, size_t len)
+{
+    struct stat st;
+    bool fresh = stat(lz_path, &st) != 0 || st.st_size == 0;
+
+    /* A block torn by a power loss would swallow the blocks appended after it */
+    if (!fresh) {
+        FILE *r = fopen(lz_path, "rb");
+        long end = r ? scan_blocks(r, st.st_size, NULL) : -1;
+        if (r) fclose(r);
+        if (end > 0 && end < st.st_size) {
+            ESP_LOGW(TAG, "%s: dropping %ld bytes of a torn block", lz_path, (long)st.st_size - end);
+            if (truncate(lz_path, end) != 0) {
+                ESP_LOGE(TAG, "Cannot truncate %s", lz_path);
+                return ESP_FAIL;
+            }
+        }
+    }
+
+    FILE *f = fopen(lz_path, "ab");
+    if (!f) {
+        ESP_LOGE(TAG, "Cannot open %s", lz_path);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (fresh && fwrite(LZF_MAGIC, 1, 4, f) != 4) err = ESP_FAIL;
+    if (err == ESP_OK) err = write_blocks(f, data, len);
+    if (fclose(f) != 0 && err == ESP_OK) err = ESP_FAIL;
+    fs_catalog_update(lz_path);
+
+    if (err != ESP_OK) {
+        s_stats.errors++;
+        ESP_LOGE(TAG, "Append to %s failed: %s", lz_path, esp_err_to_name(err));
+    } else {
+        s_stats.files++;
+    }
+    return err;
+}
+
+esp_err_t lzfile_compress(const char *path)
+{
+    char lz[MIMI_CATALOG_PATH_LEN + 8], tmp[MIMI_CATALOG_PATH_LEN + 12];
+    lz_path_of(path, lz, sizeof(lz));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", lz);
+
+    FILE *in = fopen(path, "rb");
+    if (!in) return ESP_ERR_NOT_FOUND;
+
+    char *buf = heap_caps_malloc(MIMI_LZ_BLOCK_SIZE, MALLOC_CAP_SPIRAM);
+    FILE *out = buf ? fopen(tmp, "wb") : NULL;
+    if (!out) {
+        fclose(in);
+        free(buf);
+        return buf ? ESP_FAIL : ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = fwrite(LZF_MAGIC, 1, 4, out) == 4 ? ESP_OK : ESP_FAIL;
+    size_t n;
+    while (err == ESP_OK && (n = fread(buf, 1, MIMI_LZ_BLOCK_SIZE, in)) > 0) {
+        err = write_blocks(out, buf, n);
+    }
+    fclose(in);
+    if (fclose(out) != 0) err = ESP_FAIL;
+    free(buf);
+
+    /* The compressed copy replaces the original only once it is complete */
+    if (err == ESP_OK) err = lzfile_replace(tmp, lz);
+    if (err == ESP_OK) {
+        remove(path);
+        s_stats.files++;
+    } else {
+        remove(tmp);
+        s_stats.errors++;
+        ESP_LOGE(TAG, "Compressing %s failed", path);
+    }
+
+    fs_catalog_update(tmp);
+    fs_catalog_update(lz);
+    fs_catalog_update(path);
+    return err;
+}
+
+/* ── Reading ──────────────────────────────────────────────────── */
+
+char *lzfile_load(const char *lz_path, size_t *len)
+{
+    FILE *f = fopen(lz_path, "rb");
+    if (!f) return NULL;
+
+    int64_t t0 = esp_timer_get_time();
+    char magic[4];
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, LZF_MAGIC, 4) != 0) {
+        ESP_LOGW(TAG, "%s is not an .lz file", lz_path);
+        fclose(f);
+        return NULL;
+    }
+
+    /* Pass 1: total size from the block headers, up to the last complete block */
+    struct stat st;
+    size_t total = 0;
+    long end = fstat(fileno(f), &st) == 0 ? scan_blocks(f, st.st_size, &total) : -1;
+    if (end < 0 || total > MIMI_LZ_LOAD_MAX) {
+        ESP_LOGW(TAG, "%s: bad block or too large", lz_path);
+        fclose(f);
+        return NULL;
+    }
+    if (end < st.st_size) {
+        ESP_LOGW(TAG, "%s: ignoring %ld bytes of a torn block", lz_path, (long)st.st_size - end);
+    }
+
+    char *data = heap_caps_malloc(total + 1, MALLOC_CAP_SPIRAM);
+    uint8_t *packed_buf = heap_caps_malloc(LZ_BOUND(MIMI_LZ_BLOCK_SIZE), MALLOC_CAP_SPIRAM);
+    bool ok = data && packed_buf;
+
+    /* Pass 2: decode */
+    size_t off = 0;
+    lzf_block_t hdr;
+    fseek(f, 4, SEEK_SET);
+    while (ok && off < total && fread(&hdr, sizeof(hdr), 1, f) == 1) {
+        uint32_t packed = hdr.packed_len & ~LZF_STORED;
+        if (hdr.packed_len & LZF_STORED) {
+            ok = packed == hdr.raw_len && fread(data + off, 1, packed, f) == packed;
+        } else {
+            ok = fread(packed_buf, 1, packed, f) == packed &&
+                 lz_decompress(packed_buf, packed, (uint8_t *)data + off, hdr.raw_len) == (int)hdr.raw_len;
+        }
+        off += hdr.raw_len;
+    }
+    fclose(f);
+    free(packed_buf);
+
+    if (!ok || off != total) {
+        ESP_LOGW(TAG, "%s: decode failed", lz_path);
+        free(data);
+        s_stats.errors++;
+        return NULL;
+    }
+
+    data[total] = '\0';
+    if (len) *len = total;
+    s_stats.loads++;
+    s_stats.load_us += esp_timer_get_time() - t0;
+    return data;
+}
+
+esp_err_t lzfile_restore(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) == 0) return ESP_OK;
+
+    char lz[MIMI_CATALOG_PATH_LEN + 8];
+    lz_path_of(path, lz, sizeof(lz));
+    size_t len;
+    char *data = lzfile_load(lz, &len);
+    if (!data) return ESP_ERR_NOT_FOUND;
+
+    FILE *f = fopen(path, "wb");
+    bool ok = f && fwrite(data, 1, len, f) == len;
+    if (f && fclose(f) != 0) ok = false;
+    free(data);
+
+    if (ok) {
+        remove(lz);
+    } else {
+        remove(path);
+    }
+    fs_catalog_update(path);
+    fs_catalog_update(lz);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+void lzfile_remove(const char *path)
+{
+    char lz[MIMI_CATALOG_PATH_LEN + 8];
+    lz_path_of(path, lz, sizeof(lz));
+    if (remove(lz) == 0) fs_catalog_update(lz);
+}
+
+bool lzfile_exists(const char *path)
+{
+    char lz[MIMI_CATALOG_PATH_LEN + 8];
+    lz_path_of(path, lz, sizeof(lz));
+    struct stat st;
+    return fs_catalog_stat(lz, NULL) || stat(lz, &st) == 0;
+}
+
+FILE *lzfile_open(const char *path, char **hold)
+{
+    *hold = NULL;
+
+    size_t plen = strlen(path);
+    bool explicit_lz = plen > 3 && strcmp(path + plen - 3, ".lz") == 0;
+    if (!explicit_lz) {
+        FILE *f = fopen(path, "r");
+        if (f) return f;
+    }
+
+    char lz[MIMI_CATALOG_PATH_LEN + 8], tmp[MIMI_CATALOG_PATH_LEN + 12];
+    if (explicit_lz) {
+        snprintf(lz, sizeof(lz), "%s", path);
+    } else {
+        lz_path_of(path, lz, sizeof(lz));
+    }
+    /* Power lost between removing the old .lz and renaming the new one */
+    if (!explicit_lz) {
+        snprintf(tmp, sizeof(tmp), "%s.tmp", lz);
+        lzfile_recover_tmp(tmp, lz);
+    }
+
+    size_t len;
+    char *data = lzfile_load(lz, &len);
+    if (!data) return NULL;
+    if (len == 0) {
+        free(data);
+        return NULL;
+    }
+
+    FILE *f = fmemopen(data, len, "r");
+    if (!f) {
+        free(data);
+        return NULL;
+    }
+    *hold = data;
+    return f;
+}
+
+/* ── Sweeps ───────────────────────────────────────────────────── */
+
+void lzfile_register_sweep(lzfile_sweep_fn_t fn)
+{
+    if (s_nsweeps < LZF_MAX_SWEEPS) s_sweeps[s_nsweeps++] = fn;
+}
+
+void lzfile_sweep_now(void)
+{
+    if (s_sweep_lock) xSemaphoreTake(s_sweep_lock, portMAX_DELAY);
+    for (int i = 0; i < s_nsweeps; i++) {
+        s_sweeps[i]();
+    }
+    if (s_sweep_lock) xSemaphoreGive(s_sweep_lock);
+}
+
+static void sweep_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(MIMI_LZ_SWEEP_DELAY_MS));
+    while (1) {
+        lzfile_sweep_now();
+        vTaskDelay(pdMS_TO_TICKS(MIMI_LZ_SWEEP_INTERVAL_MS));
+    }
+}
+
+esp_err_t lzfile_start(void)
+{
+    s_sweep_lock = xSemaphoreCreateMutex();
+    if (!s_sweep_lock) return ESP_ERR_NO_MEM;
+
+    if (xTaskCreatePinnedToCore(sweep_task, "lz_sweep", MIMI_LZ_SWEEP_STACK, NULL,
+                                MIMI_LZ_SWEEP_PRIO, NULL, MIMI_LZ_SWEEP_CORE) != pdPASS) {
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Cold-file compression: %d sweep(s), first in %d s",
+             s_nsweeps, MIMI_LZ_SWEEP_DELAY_MS / 1000);
+    return ESP_OK;
+}
+
+void lzfile_print_stats(void)
+{
+    printf("Compression: %lu files, %lu blocks, %llu -> %llu bytes",
+           (unsigned long)s_stats.files, (unsigned long)s_stats.blocks,
+           (unsigned long long)s_stats.raw_bytes, (unsigned long long)s_stats.packed_bytes);
+    if (s_stats.raw_bytes) {
+        printf(" (%.1f%%)", 100.0 * s_stats.packed_bytes / s_stats.raw_bytes);
+    }
+    printf("\n  reads: %lu, avg decode %d us, errors: %lu\n",
+           (unsigned long)s_stats.loads,
+           s_stats.loads ? (int)(s_stats.load_us / s_stats.loads) : 0,
+           (unsigned long)s_stats.errors);
+}
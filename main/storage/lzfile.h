@@ -0,0 +1,93 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * At-rest compression for cold files.
+ *
+ * "<path>.lz" holds the compressed form of "<path>": a "MLZ1" magic followed
+ * by independent blocks of at most MIMI_LZ_BLOCK_SIZE raw bytes, each
+ * {u32 raw_len, u32 packed_len, data} (packed_len bit 31 set = stored as is).
+ * Blocks can be appended, so a session archive grows without rewriting it.
+ *
+ * Owners register a sweep function (old daily notes, session heads); a
+ * low-priority task runs the sweeps a few minutes after boot and then
+ * every MIMI_LZ_SWEEP_INTERVAL_MS.
+ */
+
+typedef void (*lzfile_sweep_fn_t)(void);
+
+/**
+ * Compress data and append it to lz_path (created with a header if missing).
+ */
+esp_err_t lzfile_append(const char *lz_path, const char *data, size_t len);
+
+/**
+ * Replace path with path.lz.
+ */
+esp_err_t lzfile_compress(const char *path);
+
+/**
+ * Move tmp over path: rename first (atomic on LittleFS), then remove +
+ * rename where rename cannot replace a file (SPIFFS).
+ */
+esp_err_t lzfile_replace(const char *tmp, const char *path);
+
+/**
+ * Finish a replace cut short by a power loss: tmp becomes path if path is
+ * missing, otherwise the stale tmp is removed.
+ */
+void lzfile_recover_tmp(const char *tmp, const char *path);
+
+/**
+ * Decompress path.lz back to path (for in-place edits). No-op if path exists.
+ */
+esp_err_t lzfile_restore(const char *path);
+
+/**
+ * Remove path.lz if present.
+ */
+void lzfile_remove(const char *path);
+
+/**
+ * True if path.lz exists.
+ */
+bool lzfile_exists(const char *path);
+
+/**
+ * Decompress an .lz file into a NUL-terminated PSRAM buffer (caller frees).
+ * A block left incomplete by a power loss at the end is ignored.
+ * @return NULL if missing, corrupt or larger than MIMI_LZ_LOAD_MAX
+ */
+char *lzfile_load(const char *lz_path, size_t *len);
+
+/**
+ * Open path for reading whether it is plain or compressed: path itself,
+ * path.lz if path is missing, or an explicit ".lz" path. Compressed files
+ * are decoded into memory and returned as a read-only stream.
+ * @param hold  Set to the buffer behind the stream; free() it after fclose()
+ */
+FILE *lzfile_open(const char *path, char **hold);
+
+/**
+ * Add a sweep function. Call before lzfile_start().
+ */
+void lzfile_register_sweep(lzfile_sweep_fn_t fn);
+
+/**
+ * Start the background sweep task.
+ */
+esp_err_t lzfile_start(void);
+
+/**
+ * Run every sweep now in the calling task.
+ */
+void lzfile_sweep_now(void);
+
+/**
+ * Print compression counters.
+ */
+void lzfile_print_stats(void);
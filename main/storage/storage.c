@@ -0,0 +1,502 @@
+#include "storage.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_spiffs.h"
+#if CONFIG_MIMI_STORAGE_LITTLEFS
+#include "esp_littlefs.h"
+#include "esp_partition.h"
+#include "nvs.h"
+#endif
+
+static const char *TAG = "storage";
+
+static bool s_littlefs = false;
+
+static const char *const s_dirs[] = {
+    MIMI_SPIFFS_CONFIG_DIR,
+    MIMI_SPIFFS_MEMORY_DIR,
+    MIMI_SPIFFS_SESSION_DIR,
+    MIMI_SKILLS_DIR,
+};
+
+/* ── Mounting ─────────────────────────────────────────────────── */
+
+static esp_err_t mount_spiffs(bool format_if_needed)
+{
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = MIMI_SPIFFS_BASE,
+        .partition_label = MIMI_STORAGE_PARTITION,
+        .max_files = 10,
+        .format_if_mount_failed = format_if_needed,
+    };
+    return esp_vfs_spiffs_register(&conf);
+}
+
+#if CONFIG_MIMI_STORAGE_LITTLEFS
+
+static esp_err_t mount_littlefs(bool format_if_needed)
+{
+    esp_vfs_littlefs_conf_t conf = {
+        .base_path = MIMI_SPIFFS_BASE,
+        .partition_label = MIMI_STORAGE_PARTITION,
+        .format_if_mount_failed = format_if_needed,
+    };
+    return esp_vfs_littlefs_register(&conf);
+}
+
+#define MIGRATE_BLOCK_SIZE       4096    /* LittleFS block = flash sector */
+#define MIGRATE_RESERVED_BLOCKS  8       /* superblocks, root dir and slack */
+#define MIGRATE_WRITE_TRIES      3
+
+typedef struct {
+    char name[64];              /* relative to MIMI_SPIFFS_BASE */
+    char *data;
+    size_t len;
+} staged_file_t;
+
+static staged_file_t *s_staged = NULL;     /* only kept if no filesystem took it back */
+static int s_staged_count = 0;
+
+static void staged_free(staged_file_t *files, int count)
+{
+    for (int i = 0; i < count; i++) free(files[i].data);
+    free(files);
+}
+
+/* Read every file of the mounted SPIFFS image into PSRAM */
+static int stage_spiffs(staged_file_t **out)
+{
+    DIR *dir = opendir(MIMI_SPIFFS_BASE);
+    if (!dir) return -1;
+
+    int cap = 64, count = 0;
+    staged_file_t *files = heap_caps_calloc(cap, sizeof(staged_file_t), MALLOC_CAP_SPIRAM);
+    if (!files) {
+        closedir(dir);
+        return -1;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (count == cap) {
+            staged_file_t *grown = heap_caps_realloc(files, cap * 2 * sizeof(staged_file_t), MALLOC_CAP_SPIRAM);
+            if (!grown) goto fail;
+            memset(grown + cap, 0, cap * sizeof(staged_file_t));
+            files = grown;
+            cap *= 2;
+        }
+
+        staged_file_t *sf = &files[count];
+        strncpy(sf->name, ent->d_name, sizeof(sf->name) - 1);
+
+        char path[96];
+        snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_BASE, sf->name);
+        FILE *f = fopen(path, "rb");
+        if (!f) continue;
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+
+        sf->data = heap_caps_malloc(size > 0 ? size : 1, MALLOC_CAP_SPIRAM);
+        if (!sf->data) {
+            fclose(f);
+            goto fail;
+        }
+        sf->len = fread(sf->data, 1, size, f);
+        fclose(f);
+        count++;
+    }
+    closedir(dir);
+    *out = files;
+    return count;
+
+fail:
+    closedir(dir);
+    staged_free(files, count);
+    return -1;
+}
+
+/* LittleFS stores each file in whole blocks plus metadata; make sure the
+ * staged files fit before the SPIFFS image is given up */
+static bool staged_fits_littlefs(const staged_file_t *files, int count)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY,
+                                                           MIMI_STORAGE_PARTITION);
+    if (!part || part->readonly) return false;
+
+    size_t blocks = MIGRATE_RESERVED_BLOCKS;
+    for (int i = 0; i < count; i++) {
+        blocks += 1 + (files[i].len + MIGRATE_BLOCK_SIZE - 1) / MIGRATE_BLOCK_SIZE;
+    }
+    return blocks * MIGRATE_BLOCK_SIZE <= part->size;
+}
+
+/* The marker survives the format: set while the staged copy in PSRAM is the only one */
+static void migrate_mark(bool active)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(MIMI_NVS_STORAGE, NVS_READWRITE, &nvs) != ESP_OK) return;
+    if (active) {
+        nvs_set_u8(nvs, MIMI_NVS_KEY_MIGRATING, 1);
+    } else {
+        nvs_erase_key(nvs, MIMI_NVS_KEY_MIGRATING);
+    }
+    nvs_commit(nvs);
+    nvs_close(nvs);
+}
+
+static bool migrate_marked(void)
+{
+    nvs_handle_t nvs;
+    uint8_t v = 0;
+    if (nvs_open(MIMI_NVS_STORAGE, NVS_READONLY, &nvs) != ESP_OK) return false;
+    nvs_get_u8(nvs, MIMI_NVS_KEY_MIGRATING, &v);
+    nvs_close(nvs);
+    return v != 0;
+}
+
+static bool write_one(const char *path, const staged_file_t *sf)
+{
+    for (int attempt = 0; attempt < MIGRATE_WRITE_TRIES; attempt++) {
+        if (attempt) vTaskDelay(pdMS_TO_TICKS(100));
+        storage_make_parents(path);
+        FILE *f = fopen(path, "wb");
+        if (!f) continue;
+        bool ok = fwrite(sf->data, 1, sf->len, f) == sf->len;
+        if (fclose(f) != 0) ok = false;
+        if (ok) return true;
+        remove(path);
+    }
+    ESP_LOGE(TAG, "Cannot recreate %s", path);
+    return false;
+}
+
+/* Write the staged files to the mounted filesystem; true if all of them made it */
+static bool write_back(const staged_file_t *files, int count)
+{
+    int written = 0;
+    for (int i = 0; i < count; i++) {
+        char path[96];
+        snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_BASE, files[i].name);
+        if (write_one(path, &files[i])) written++;
+    }
+    ESP_LOGI(TAG, "Wrote back %d/%d files", written, count);
+    return written == count;
+}
+
+/* LittleFS could not take the data: put the staged copy back on a fresh SPIFFS */
+static esp_err_t rollback_to_spiffs(const staged_file_t *files, int count)
+{
+    if (s_littlefs) esp_vfs_littlefs_unregister(MIMI_STORAGE_PARTITION);
+    s_littlefs = false;
+
+    esp_err_t err = mount_spiffs(false);
+    if (err == ESP_OK) err = esp_spiffs_format(MIMI_STORAGE_PARTITION);
+    if (err != ESP_OK) err = mount_spiffs(true);
+    if (err != ESP_OK) return err;
+    return write_back(files, count) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t migrate_from_spiffs(void)
+{
+    size_t total = 0, used = 0;
+    esp_spiffs_info(MIMI_STORAGE_PARTITION, &total, &used);
+    if (used > MIMI_STORAGE_MIGRATE_MAX ||
+        used + 256 * 1024 > heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) {
+        ESP_LOGE(TAG, "SPIFFS image too big to migrate (%d bytes used), staying on SPIFFS", (int)used);
+        return ESP_ERR_NO_MEM;
+    }
+
+    staged_file_t *files = NULL;
+    int count = stage_spiffs(&files);
+    if (count < 0) {
+        ESP_LOGE(TAG, "Could not stage SPIFFS files, staying on SPIFFS");
+        return ESP_ERR_NO_MEM;
+    }
+    if (!staged_fits_littlefs(files, count)) {
+        ESP_LOGE(TAG, "Files would not fit on LittleFS, staying on SPIFFS");
+        staged_free(files, count);
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Point of no return: the staged copy in PSRAM is the only one until written back */
+    ESP_LOGW(TAG, "Migrating %d files (%d bytes) from SPIFFS to LittleFS, do not power off",
+             count, (int)used);
+    migrate_mark(true);
+    esp_vfs_spiffs_unregister(MIMI_STORAGE_PARTITION);
+
+    esp_err_t err = esp_littlefs_format(MIMI_STORAGE_PARTITION);
+    if (err == ESP_OK) err = mount_littlefs(false);
+    if (err == ESP_OK) {
+        s_littlefs = true;
+        if (!write_back(files, count)) err = ESP_FAIL;
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Migration to LittleFS failed (%s), restoring SPIFFS", esp_err_to_name(err));
+        if (rollback_to_spiffs(files, count) != ESP_OK) {
+            /* Keep the staged copy and the marker: nothing else holds this data now */
+            ESP_LOGE(TAG, "Could not restore SPIFFS either; staged files kept in PSRAM");
+            s_staged = files;
+            s_staged_count = count;
+            return ESP_FAIL;
+        }
+        migrate_mark(false);
+        staged_free(files, count);
+        ESP_LOGW(TAG, "Restored %d files on SPIFFS", count);
+        return ESP_ERR_NO_MEM;      /* keep running on SPIFFS */
+    }
+
+    migrate_mark(false);
+    staged_free(files, count);
+    ESP_LOGI(TAG, "Migration done: %d files", count);
+    return ESP_OK;
+}
+
+#endif /* CONFIG_MIMI_STORAGE_LITTLEFS */
+
+esp_err_t storage_init(void)
+{
+    esp_err_t ret;
+
+#if CONFIG_MIMI_STORAGE_LITTLEFS
+    /* A migration that lost power after the format left its data only in PSRAM */
+    bool interrupted = migrate_marked();
+    ret = mount_littlefs(false);
+    if (ret == ESP_OK) {
+        s_littlefs = true;
+        if (interrupted) {
+            ESP_LOGE(TAG, "SPIFFS to LittleFS migration was interrupted while writing back; "
+                          "files from before it may be missing");
+            migrate_mark(false);
+        }
+    } else if (mount_spiffs(false) == ESP_OK) {
+        /* Existing SPIFFS image (an interrupted migration that had not formatted yet
+         * starts over): migrate once, or keep running on it */
+        ret = migrate_from_spiffs();
+        if (ret == ESP_ERR_NO_MEM) ret = ESP_OK;
+    } else {
+        if (interrupted) {
+            ESP_LOGE(TAG, "SPIFFS to LittleFS migration was interrupted during the format; "
+                          "the old files are lost");
+            migrate_mark(false);
+        }
+        ESP_LOGW(TAG, "No filesystem found, formatting LittleFS");
+        ret = mount_littlefs(true);
+        s_littlefs = (ret == ESP_OK);
+    }
+#else
+    ret = mount_spiffs(true);
+#endif
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Storage mount failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (s_littlefs) {
+        for (size_t i = 0; i < sizeof(s_dirs) / sizeof(s_dirs[0]); i++) {
+            mkdir(s_dirs[i], 0775);
+        }
+    }
+
+    size_t total = 0, used = 0;
+    storage_info(&total, &used);
+    ESP_LOGI(TAG, "%s: total=%d, used=%d", s_littlefs ? "LittleFS" : "SPIFFS", (int)total, (int)used);
+    return ESP_OK;
+}
+
+const char *storage_backend(void)
+{
+    return s_littlefs ? "littlefs" : "spiffs";
+}
+
+esp_err_t storage_info(size_t *total, size_t *used)
+{
+#if CONFIG_MIMI_STORAGE_LITTLEFS
+    if (s_littlefs) return esp_littlefs_info(MIMI_STORAGE_PARTITION, total, used);
+#endif
+    return esp_spiffs_info(MIMI_STORAGE_PARTITION, total, used);
+}
+
+esp_err_t storage_make_parents(const char *path)
+{
+    if (!s_littlefs) return ESP_OK;
+
+    char tmp[128];
+    size_t len = strlen(path);
+    if (len >= sizeof(tmp)) return ESP_ERR_INVALID_SIZE;
+    memcpy(tmp, path, len + 1);
+
+    /* Skip the mount point itself */
+    for (char *p = tmp + strlen(MIMI_SPIFFS_BASE) + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0775) != 0 && errno != EEXIST) return ESP_FAIL;
+        *p = '/';
+    }
+    return ESP_OK;
+}
+
+/* ── Benchmark ────────────────────────────────────────────────── */
+
+#define BENCH_DIR           MIMI_SPIFFS_BASE "/bench"
+#define BENCH_BALLAST_SIZE  (64 * 1024)
+#define BENCH_APPENDS       50
+#define BENCH_TAIL_READS    20
+#define BENCH_LIST_FILES    40
+#define BENCH_LISTS         5
+
+static int s_ballast_count = 0;
+
+static void bench_path(char *buf, size_t size, const char *fmt, int n)
+{
+    int off = snprintf(buf, size, "%s/", BENCH_DIR);
+    snprintf(buf + off, size - off, fmt, n);
+}
+
+static bool bench_fill_to(size_t target, const char *chunk)
+{
+    size_t total = 0, used = 0;
+    storage_info(&total, &used);
+    while (used < target) {
+        char path[64];
+        bench_path(path, sizeof(path), "ballast_%d.bin", s_ballast_count);
+        FILE *f = fopen(path, "wb");
+        if (!f) return false;
+        bool ok = true;
+        for (int i = 0; i < BENCH_BALLAST_SIZE / 4096 && ok; i++) {
+            ok = fwrite(chunk, 1, 4096, f) == 4096;
+        }
+        fclose(f);
+        s_ballast_count++;
+        if (!ok) return false;
+        vTaskDelay(1);
+        storage_info(&total, &used);
+    }
+    return true;
+}
+
+static void bench_cleanup(void)
+{
+    char path[64];
+    for (int i = 0; i < s_ballast_count; i++) {
+        bench_path(path, sizeof(path), "ballast_%d.bin", i);
+        remove(path);
+    }
+    s_ballast_count = 0;
+    for (int i = 0; i < BENCH_LIST_FILES; i++) {
+        bench_path(path, sizeof(path), "list/f_%02d.txt", i);
+        remove(path);
+    }
+    bench_path(path, sizeof(path), "append.jsonl", 0);
+    remove(path);
+    if (s_littlefs) {
+        rmdir(BENCH_DIR "/list");
+        rmdir(BENCH_DIR);
+    }
+}
+
+esp_err_t storage_bench(void)
+{
+    char *chunk = malloc(4096);
+    if (!chunk) return ESP_ERR_NO_MEM;
+    memset(chunk, 'x', 4096);
+
+    char path[64];
+    if (s_littlefs) {
+        mkdir(BENCH_DIR, 0775);
+        mkdir(BENCH_DIR "/list", 0775);
+    }
+    for (int i = 0; i < BENCH_LIST_FILES; i++) {
+        bench_path(path, sizeof(path), "list/f_%02d.txt", i);
+        FILE *f = fopen(path, "w");
+        if (f) {
+            fputs("bench\n", f);
+            fclose(f);
+        }
+    }
+
+    size_t total = 0, used = 0;
+    storage_info(&total, &used);
+    printf("Backend: %s, %d KB partition\n", storage_backend(), (int)(total / 1024));
+    printf("fill   used   append avg/max (ms)   tail-read avg (ms)   list %d avg (ms)\n", BENCH_LIST_FILES);
+
+    static const int levels[] = { 10, 50, 90 };
+    esp_err_t err = ESP_OK;
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        if (!bench_fill_to(total / 100 * levels[l], chunk)) {
+            printf("%3d%%   fill failed (partition full?)\n", levels[l]);
+            err = ESP_FAIL;
+            break;
+        }
+        storage_info(&total, &used);
+
+        /* Session-style append: open, write one line, close */
+        bench_path(path, sizeof(path), "append.jsonl", 0);
+        int64_t sum = 0, worst = 0;
+        for (int i = 0; i < BENCH_APPENDS; i++) {
+            int64_t t0 = esp_timer_get_time();
+            FILE *f = fopen(path, "a");
+            if (f) {
+                fwrite(chunk + 1, 1, 199, f);
+                fputc('\n', f);
+                fclose(f);
+            }
+            int64_t dt = esp_timer_get_time() - t0;
+            sum += dt;
+            if (dt > worst) worst = dt;
+        }
+        int64_t append_avg = sum / BENCH_APPENDS;
+
+        /* Tail read: last 4 KB, like loading recent history */
+        sum = 0;
+        for (int i = 0; i < BENCH_TAIL_READS; i++) {
+            int64_t t0 = esp_timer_get_time();
+            FILE *f = fopen(path, "r");
+            if (f) {
+                fseek(f, -4096, SEEK_END);
+                fread(chunk, 1, 4096, f);
+                fclose(f);
+            }
+            sum += esp_timer_get_time() - t0;
+        }
+        int64_t tail_avg = sum / BENCH_TAIL_READS;
+
+        /* Listing one directory among everything else on the partition */
+        sum = 0;
+        for (int i = 0; i < BENCH_LISTS; i++) {
+            int64_t t0 = esp_timer_get_time();
+            DIR *dir = opendir(BENCH_DIR "/list");
+            if (dir) {
+                while (readdir(dir) != NULL) {}
+                closedir(dir);
+            }
+            sum += esp_timer_get_time() - t0;
+        }
+        int64_t list_avg = sum / BENCH_LISTS;
+
+        printf("%3d%%   %3d%%   %8.2f / %-8.2f       %8.2f             %8.2f\n",
+               levels[l], (int)(used * 100 / total),
+               append_avg / 1000.0, worst / 1000.0, tail_avg / 1000.0, list_avg / 1000.0);
+    }
+
+    bench_cleanup();
+    free(chunk);
+    return err;
+}
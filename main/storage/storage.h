@@ -0,0 +1,37 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+/**
+ * Data partition mounted at MIMI_SPIFFS_BASE.
+ *
+ * With CONFIG_MIMI_STORAGE_LITTLEFS the partition is LittleFS with real
+ * directories for config, memory, sessions and skills. A partition that
+ * still holds a SPIFFS image is migrated once: files are staged in PSRAM,
+ * the partition is reformatted and the files are written back. Without the
+ * option (or if the image is too big to stage) SPIFFS is used as before.
+ */
+esp_err_t storage_init(void);
+
+/**
+ * "littlefs" or "spiffs".
+ */
+const char *storage_backend(void);
+
+/**
+ * Partition capacity and usage in bytes.
+ */
+esp_err_t storage_info(size_t *total, size_t *used);
+
+/**
+ * Create the parent directories of a file path (no-op on SPIFFS).
+ */
+esp_err_t storage_make_parents(const char *path);
+
+/**
+ * Measure append, tail-read and directory-listing latency at 10/50/90%
+ * fill using ballast files under MIMI_SPIFFS_BASE/bench, then remove them.
+ * Prints a table; takes a few minutes on a large partition.
+ */
+esp_err_t storage_bench(void);
@@ -0,0 +1,350 @@
+#include "write_behind.h"
+#include "fs_catalog.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "wbehind";
+
+typedef struct {
+    char path[64];
+    char *buf;                  /* MIMI_WB_BUF_SIZE bytes, PSRAM */
+    size_t len;
+    int64_t since_us;           /* when the oldest pending byte arrived */
+    write_behind_cb_t on_flush;
+} wb_file_t;
+
+/* Callbacks collected under the lock, run after it is released */
+typedef struct {
+    char path[64];
+    write_behind_cb_t cb;
+} wb_done_t;
+
+static wb_file_t s_files[MIMI_WB_MAX_FILES];
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_task = NULL;
+
+static struct {
+    uint32_t appends;
+    uint32_t append_bytes;
+    uint32_t flushes;           /* fopen/fclose cycles on behalf of buffered data */
+    uint32_t direct;            /* oversized appends written straight through */
+    uint32_t errors;
+    size_t max_pending;
+} s_stats;
+
+/* ── Flash I/O ────────────────────────────────────────────────── */
+
+static esp_err_t write_out(const char *path, const char *data, size_t len)
+{
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        return ESP_FAIL;
+    }
+    size_t n = fwrite(data, 1, len, f);
+    int rc = fclose(f);
+    fs_catalog_update(path);
+    if (n != len || rc != 0) {
+        ESP_LOGE(TAG, "Short write to %s (%u/%u)", path, (unsigned)n, (unsigned)len);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/* Caller holds s_lock. On failure the bytes stay buffered for the next attempt. */
+static esp_err_t flush_locked(wb_file_t *e, wb_done_t *done, int *ndone)
+{
+    if (e->len == 0) return ESP_OK;
+
+    esp_err_t err = write_out(e->path, e->buf, e->len);
+    if (err != ESP_OK) {
+        s_stats.errors++;
+        return err;
+    }
+    s_stats.flushes++;
+    e->len = 0;
+
+    if (e->on_flush && done) {
+        strcpy(done[*ndone].path, e->path);
+        done[*ndone].cb = e->on_flush;
+        (*ndone)++;
+    }
+    return ESP_OK;
+}
+
+static void run_callbacks(const wb_done_t *done, int ndone)
+{
+    for (int i = 0; i < ndone; i++) {
+        done[i].cb(done[i].path);
+    }
+}
+
+static wb_file_t *find(const char *path)
+{
+    for (int i = 0; i < MIMI_WB_MAX_FILES; i++) {
+        if (s_files[i].len && strcmp(s_files[i].path, path) == 0) return &s_files[i];
+    }
+    return NULL;
+}
+
+/* Caller holds s_lock. Evicts the oldest file if every slot is busy. */
+static wb_file_t *claim(const char *path, wb_done_t *done, int *ndone)
+{
+    wb_file_t *oldest = NULL;
+    for (int i = 0; i < MIMI_WB_MAX_FILES; i++) {
+        wb_file_t *e = &s_files[i];
+        if (e->len == 0) {
+            oldest = e;
+            break;
+        }
+        if (!oldest || e->since_us < oldest->since_us) oldest = e;
+    }
+
+    if (oldest->len && flush_locked(oldest, done, ndone) != ESP_OK) {
+        return NULL;
+    }
+    strncpy(oldest->path, path, sizeof(oldest->path) - 1);
+    oldest->path[sizeof(oldest->path) - 1] = '\0';
+    return oldest;
+}
+
+/* ── Flush task ───────────────────────────────────────────────── */
+
+static void flush_task(void *arg)
+{
+    wb_done_t done[MIMI_WB_MAX_FILES];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MIMI_WB_TICK_MS));
+
+        int ndone = 0;
+        int64_t now = esp_timer_get_time();
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        for (int i = 0; i < MIMI_WB_MAX_FILES; i++) {
+            wb_file_t *e = &s_files[i];
+            if (e->len == 0) continue;
+            if (e->len >= MIMI_WB_FLUSH_BYTES ||
+                now - e->since_us >= (int64_t)MIMI_WB_MAX_AGE_MS * 1000) {
+                flush_locked(e, done, &ndone);
+            }
+        }
+        xSemaphoreGive(s_lock);
+
+        run_callbacks(done, ndone);
+    }
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t write_behind_init(void)
+{
+    for (int i = 0; i < MIMI_WB_MAX_FILES; i++) {
+        s_files[i].buf = heap_caps_malloc(MIMI_WB_BUF_SIZE, MALLOC_CAP_SPIRAM);
+        if (!s_files[i].buf) {
+            ESP_LOGE(TAG, "Out of memory for write-behind buffers");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    /* Published before the flush task exists, which takes it on its first pass */
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) return ESP_ERR_NO_MEM;
+
+    if (xTaskCreatePinnedToCore(flush_task, "wb_flush", MIMI_WB_STACK, NULL,
+                                MIMI_WB_PRIO, &s_task, MIMI_WB_CORE) != pdPASS) {
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Write-behind: %d files x %d bytes, flush at %d bytes or %d ms",
+             MIMI_WB_MAX_FILES, MIMI_WB_BUF_SIZE, MIMI_WB_FLUSH_BYTES, MIMI_WB_MAX_AGE_MS);
+    return ESP_OK;
+}
+
+esp_err_t write_behind_append(const char *path, const char *data, size_t len,
+                              write_behind_cb_t on_flush)
+{
+    if (!path || !data) return ESP_ERR_INVALID_ARG;
+    if (strlen(path) >= sizeof(s_files[0].path)) return ESP_ERR_INVALID_ARG;
+    if (len == 0) return ESP_OK;
+
+    if (!s_lock) {
+        esp_err_t err = write_out(path, data, len);
+        if (err == ESP_OK && on_flush) on_flush(path);
+        return err;
+    }
+
+    wb_done_t done[2];
+    int ndone = 0;
+    esp_err_t err = ESP_OK;
+    bool wake = false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.appends++;
+    s_stats.append_bytes += len;
+
+    wb_file_t *e = find(path);
+
+    /* Keep file order: whatever is buffered goes out before data that cannot fit */
+    if (e && e->len + len > MIMI_WB_BUF_SIZE) {
+        err = flush_locked(e, done, &ndone);
+        e = NULL;
+    }
+
+    if (err == ESP_OK && len > MIMI_WB_BUF_SIZE) {
+        err = write_out(path, data, len);
+        if (err == ESP_OK) {
+            s_stats.direct++;
+            if (on_flush && ndone == 0) {
+                strcpy(done[ndone].path, path);
+                done[ndone++].cb = on_flush;
+            }
+        } else {
+            s_stats.errors++;
+        }
+    } else if (err == ESP_OK) {
+        if (!e) e = claim(path, done, &ndone);
+        if (!e) {
+            err = ESP_FAIL;
+        } else {
+            if (e->len == 0) e->since_us = esp_timer_get_time();
+            memcpy(e->buf + e->len, data, len);
+            e->len += len;
+            e->on_flush = on_flush;
+            if (e->len > s_stats.max_pending) s_stats.max_pending = e->len;
+            wake = e->len >= MIMI_WB_FLUSH_BYTES;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    run_callbacks(done, ndone);
+    if (wake) xTaskNotifyGive(s_task);
+    return err;
+}
+
+bool write_behind_pending(const char *path)
+{
+    if (!s_lock) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool pending = find(path) != NULL;
+    xSemaphoreGive(s_lock);
+    return pending;
+}
+
+void write_behind_read(const char *path,
+                       void (*fn)(const char *path, const char *pending, size_t len, void *ctx),
+                       void *ctx)
+{
+    if (!s_lock) {
+        fn(path, "", 0, ctx);
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    wb_file_t *e = find(path);
+    fn(path, e ? e->buf : "", e ? e->len : 0, ctx);
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t write_behind_sync(const char *path)
+{
+    if (!s_lock) return ESP_OK;
+
+    wb_done_t done[1];
+    int ndone = 0;
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    wb_file_t *e = find(path);
+    if (e) err = flush_locked(e, done, &ndone);
+    xSemaphoreGive(s_lock);
+
+    run_callbacks(done, ndone);
+    return err;
+}
+
+void write_behind_discard(const char *path)
+{
+    if (!s_lock) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    wb_file_t *e = find(path);
+    if (e) e->len = 0;
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t write_behind_exclusive(const char *path,
+                                 esp_err_t (*fn)(const char *path, void *ctx), void *ctx)
+{
+    if (!s_lock) return fn(path, ctx);
+
+    wb_done_t done[1];
+    int ndone = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    wb_file_t *e = find(path);
+    esp_err_t err = e ? flush_locked(e, done, &ndone) : ESP_OK;
+    if (err == ESP_OK) err = fn(path, ctx);
+    xSemaphoreGive(s_lock);
+
+    run_callbacks(done, ndone);
+    return err;
+}
+
+esp_err_t write_behind_sync_all(void)
+{
+    if (!s_lock) return ESP_OK;
+
+    wb_done_t done[MIMI_WB_MAX_FILES];
+    int ndone = 0;
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < MIMI_WB_MAX_FILES; i++) {
+        if (flush_locked(&s_files[i], done, &ndone) != ESP_OK) err = ESP_FAIL;
+    }
+    xSemaphoreGive(s_lock);
+
+    run_callbacks(done, ndone);
+    return err;
+}
+
+void write_behind_print_stats(void)
+{
+    if (!s_lock) {
+        printf("Write-behind disabled (appends go straight to flash)\n");
+        return;
+    }
+
+    int files = 0;
+    size_t pending = 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < MIMI_WB_MAX_FILES; i++) {
+        if (s_files[i].len) {
+            files++;
+            pending += s_files[i].len;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    printf("Write-behind: %d file(s), %u bytes pending (max %u per file)\n",
+           files, (unsigned)pending, (unsigned)s_stats.max_pending);
+    printf("  appends:     %lu (%lu bytes)\n",
+           (unsigned long)s_stats.appends, (unsigned long)s_stats.append_bytes);
+    printf("  file writes: %lu batched + %lu direct",
+           (unsigned long)s_stats.flushes, (unsigned long)s_stats.direct);
+    if (s_stats.flushes + s_stats.direct) {
+        printf(" (%.1f appends per write)",
+               (double)s_stats.appends / (s_stats.flushes + s_stats.direct));
+    }
+    printf("\n  errors:      %lu\n", (unsigned long)s_stats.errors);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Write-behind buffer for append-only files (session JSONL, daily notes).
+ *
+ * Appends are collected per file in PSRAM and written with a single
+ * fopen/fwrite/fclose when the file's buffer passes MIMI_WB_FLUSH_BYTES,
+ * when its oldest pending byte is MIMI_WB_MAX_AGE_MS old, or on an explicit
+ * sync. A crash or power loss loses at most that window per file.
+ * Call write_behind_sync_all() before esp_restart().
+ */
+
+/**
+ * Called after a file's pending bytes reach flash (outside the buffer lock).
+ */
+typedef void (*write_behind_cb_t)(const char *path);
+
+/**
+ * Allocate buffers and start the flush task.
+ * Before init (or if it failed) appends go straight to flash.
+ */
+esp_err_t write_behind_init(void);
+
+/**
+ * Queue bytes for the end of path. on_flush may be NULL.
+ */
+esp_err_t write_behind_append(const char *path, const char *data, size_t len,
+                              write_behind_cb_t on_flush);
+
+/**
+ * True if path has bytes that are not on flash yet.
+ */
+bool write_behind_pending(const char *path);
+
+/**
+ * Run fn with the pending bytes of path (not NUL-terminated, len may be 0)
+ * while no flush can move them to flash. fn can read the file and the
+ * buffer as one consistent snapshot; it must not call write_behind_*.
+ */
+void write_behind_read(const char *path,
+                       void (*fn)(const char *path, const char *pending, size_t len, void *ctx),
+                       void *ctx);
+
+/**
+ * Flush one file now. Call before reading or rewriting a file through stdio.
+ */
+esp_err_t write_behind_sync(const char *path);
+
+/**
+ * Drop the pending bytes of path (the file is about to be removed).
+ */
+void write_behind_discard(const char *path);
+
+/**
+ * Flush path, then run fn(path, ctx) while no buffered append can reach
+ * flash. For rewriting a file that also receives appends (session archiving).
+ */
+esp_err_t write_behind_exclusive(const char *path,
+                                 esp_err_t (*fn)(const char *path, void *ctx), void *ctx);
+
+/**
+ * Flush every file.
+ */
+esp_err_t write_behind_sync_all(void);
+
+/**
+ * Print append/flush counters.
+ */
+void write_behind_print_stats(void);
@@ -1,7 +1,9 @@
 #include "telegram_bot.h"
 #include "mimi_config.h"
 #include "bus/message_bus.h"
+#include "agent/local_cmd.h"
 #include "proxy/http_proxy.h"
+#include "trace/dlog.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -346,22 +348,24 @@ static void process_updates(const char *json_str)
         if (msg_id_val >= 0) {
             uint64_t msg_key = make_msg_key(chat_id_str, msg_id_val);
             if (seen_msg_contains(msg_key)) {
-                ESP_LOGW(TAG, "Drop duplicate message update_id=%" PRId64 " chat=%s message_id=%d",
-                         uid, chat_id_str, msg_id_val);
+                DLOGW(TAG, "Drop duplicate message update_id=%" PRId64 " chat=%s message_id=%d",
+                      uid, chat_id_str, msg_id_val);
                 continue;
             }
             seen_msg_insert(msg_key);
         }
 
-        ESP_LOGI(TAG, "Message update_id=%" PRId64 " message_id=%d from chat %s: %.40s...",
-                 uid, msg_id_val, chat_id_str, text->valuestring);
+        DLOGI(TAG, "Message update_id=%" PRId64 " message_id=%d from chat %s: %.40s...",
+              uid, msg_id_val, chat_id_str, text->valuestring);
 
         /* Push to inbound bus */
         mimi_msg_t msg = {0};
         strncpy(msg.channel, MIMI_CHAN_TELEGRAM, sizeof(msg.channel) - 1);
         strncpy(msg.chat_id, chat_id_str, sizeof(msg.chat_id) - 1);
         msg.content = strdup(text->valuestring);
-        if (msg.content) {
+        if (msg.content && local_cmd_dispatch(&msg)) {
+            free(msg.content);
+        } else if (msg.content) {
             if (message_bus_push_inbound(&msg) != ESP_OK) {
                 ESP_LOGW(TAG, "Inbound queue full, drop telegram message");
                 free(msg.content);
@@ -485,9 +489,9 @@ esp_err_t telegram_send_message(const char *chat_id, const char *text)
             continue;
         }
 
-        ESP_LOGI(TAG, "Sending telegram chunk to %s (%d bytes)", chat_id, (int)chunk);
+        DLOGI(TAG, "Sending telegram chunk to %s (%d bytes)", chat_id, (int)chunk);
         char *resp = tg_api_call("sendMessage", json_str);
-        free(json_str);
+        cJSON_free(json_str);
 
         int sent_ok = 0;
         bool markdown_failed = false;
@@ -516,7 +520,7 @@ esp_err_t telegram_send_message(const char *chat_id, const char *text)
             cJSON_Delete(body2);
             if (json2) {
                 char *resp2 = tg_api_call("sendMessage", json2);
-                free(json2);
+                cJSON_free(json2);
                 if (resp2) {
                     const char *desc2 = NULL;
                     sent_ok = tg_response_is_ok(resp2, &desc2);
@@ -537,9 +541,9 @@ esp_err_t telegram_send_message(const char *chat_id, const char *text)
             all_ok = 0;
         } else {
             if (markdown_failed) {
-                ESP_LOGI(TAG, "Plain-text fallback succeeded for %s", chat_id);
+                DLOGI(TAG, "Plain-text fallback succeeded for %s", chat_id);
             }
-            ESP_LOGI(TAG, "Telegram send success to %s (%d bytes)", chat_id, (int)chunk);
+            DLOGI(TAG, "Telegram send success to %s (%d bytes)", chat_id, (int)chunk);
         }
 
         free(resp);
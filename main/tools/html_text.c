@@ -0,0 +1,526 @@
+#include "tools/html_text.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+enum {
+    ST_SNIFF,              /* AUTO mode before the first non-blank byte */
+    ST_TEXT,
+    ST_TAG_OPEN,           /* just after '<' */
+    ST_TAG,
+    ST_COMMENT,
+    ST_ENTITY,
+    ST_SKIP,               /* inside script/style/...: look for the end tag */
+    ST_SKIP_CLOSE,         /* end tag matched, wait for its '>' */
+};
+
+/* Whitespace owed before the next text, strongest wins */
+enum { WS_NONE, WS_SPACE, WS_LINE, WS_PARA };
+
+/* Elements whose content is never text */
+static const char *const SKIP_TAGS[] = {
+    "script", "style", "noscript", "svg", "template", "iframe", "object", "canvas", "select", NULL
+};
+
+/* Blank line around these */
+static const char *const PARA_TAGS[] = {
+    "p", "blockquote", "ul", "ol", "dl", "table", "title", "section", "article",
+    "figure", "hr", "form", NULL
+};
+
+/* Line break around these */
+static const char *const LINE_TAGS[] = {
+    "div", "br", "tr", "dt", "dd", "header", "footer", "nav", "main", "aside",
+    "address", "details", "summary", "figcaption", "caption", "option", "li", NULL
+};
+
+static const struct {
+    const char *name;
+    unsigned cp;
+} ENTITIES[] = {
+    { "amp", '&' },      { "lt", '<' },       { "gt", '>' },       { "quot", '"' },
+    { "apos", '\'' },    { "nbsp", ' ' },     { "mdash", 0x2014 }, { "ndash", 0x2013 },
+    { "hellip", 0x2026 },{ "copy", 0xA9 },    { "reg", 0xAE },     { "trade", 0x2122 },
+    { "lsquo", 0x2018 }, { "rsquo", 0x2019 }, { "ldquo", 0x201C }, { "rdquo", 0x201D },
+    { "laquo", 0xAB },   { "raquo", 0xBB },   { "middot", 0xB7 },  { "bull", 0x2022 },
+    { "euro", 0x20AC },  { "times", 0xD7 },   { "deg", 0xB0 },     { "eacute", 0xE9 },
+    { "egrave", 0xE8 },  { "aacute", 0xE1 },  { "agrave", 0xE0 },  { "auml", 0xE4 },
+    { "ouml", 0xF6 },    { "uuml", 0xFC },    { "szlig", 0xDF },   { "ntilde", 0xF1 },
+    { "ccedil", 0xE7 },
+};
+
+static bool in_list(const char *const *list, const char *name)
+{
+    for (int i = 0; list[i]; i++) {
+        if (strcmp(list[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static bool is_space(unsigned char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+/* ── Output ───────────────────────────────────────────────────── */
+
+static bool out_bytes(html_text_t *h, const char *s, size_t n)
+{
+    if (h->full) return false;
+    if (h->len + n > h->cap - 1) {
+        h->full = true;
+        return false;
+    }
+    memcpy(h->out + h->len, s, n);
+    h->len += n;
+    h->out[h->len] = '\0';
+    return true;
+}
+
+static void set_break(html_text_t *h, int ws)
+{
+    if (ws > h->pending) h->pending = ws;
+}
+
+/* Text bytes, preceded by whatever whitespace is owed */
+static void emit(html_text_t *h, const char *s, size_t n)
+{
+    if (h->len > 0 && h->pending != WS_NONE) {
+        static const char *const gap[] = { "", " ", "\n", "\n\n" };
+        if (!out_bytes(h, gap[h->pending], strlen(gap[h->pending]))) return;
+    }
+    h->pending = WS_NONE;
+    out_bytes(h, s, n);
+}
+
+static void emit_str(html_text_t *h, const char *s)
+{
+    emit(h, s, strlen(s));
+}
+
+static void emit_codepoint(html_text_t *h, unsigned cp)
+{
+    char b[4];
+    size_t n;
+    if (cp < 0x80) {
+        b[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        b[0] = (char)(0xC0 | (cp >> 6));
+        b[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        b[0] = (char)(0xE0 | (cp >> 12));
+        b[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        b[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        b[0] = (char)(0xF0 | (cp >> 18));
+        b[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        b[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        b[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+    emit(h, b, n);
+}
+
+/* A multi-byte sequence that broke off: its bytes were Latin-1 after all */
+static void utf8_abort(html_text_t *h)
+{
+    for (int i = 0; i < h->utf8_len; i++) emit_codepoint(h, h->utf8[i]);
+    h->utf8_len = 0;
+    h->utf8_need = 0;
+}
+
+/* One non-blank text byte, checked for valid UTF-8 */
+static void text_byte(html_text_t *h, unsigned char b)
+{
+    if (h->utf8_need) {
+        if ((b & 0xC0) == 0x80) {
+            h->utf8[h->utf8_len++] = b;
+            if (--h->utf8_need == 0) {
+                emit(h, (const char *)h->utf8, h->utf8_len);
+                h->utf8_len = 0;
+            }
+            return;
+        }
+        utf8_abort(h);
+    }
+
+    int need = (b >= 0xC2 && b <= 0xDF) ? 1 : (b >= 0xE0 && b <= 0xEF) ? 2 :
+               (b >= 0xF0 && b <= 0xF4) ? 3 : 0;
+    if (need) {
+        h->utf8[0] = b;
+        h->utf8_len = 1;
+        h->utf8_need = need;
+    } else if (b < 0x80) {
+        emit(h, (const char *)&b, 1);
+    } else {
+        emit_codepoint(h, b);
+    }
+}
+
+static void text_char(html_text_t *h, unsigned char c)
+{
+    if (!is_space(c)) {
+        text_byte(h, c);
+        return;
+    }
+    utf8_abort(h);
+    if (c == '\n' && (h->pre || h->mode == HTML_TEXT_PLAIN)) {
+        /* Plain text keeps paragraphs: a second newline makes a blank line */
+        set_break(h, h->pending >= WS_LINE && h->mode == HTML_TEXT_PLAIN ? WS_PARA : WS_LINE);
+    } else if (h->pre && c != '\r') {
+        emit(h, " ", 1);                           /* keep code indentation */
+    } else {
+        set_break(h, WS_SPACE);
+    }
+}
+
+/* ── Entities ─────────────────────────────────────────────────── */
+
+static bool entity_decode(const char *ent, unsigned *cp)
+{
+    if (ent[0] == '#') {
+        char *end;
+        unsigned long v = (ent[1] == 'x' || ent[1] == 'X') ? strtoul(ent + 2, &end, 16)
+                                                           : strtoul(ent + 1, &end, 10);
+        if (*end || end == ent + 1) return false;
+        *cp = (v == 0 || v > 0x10FFFF || (v >= 0xD800 && v <= 0xDFFF)) ? 0xFFFD : (unsigned)v;
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(ENTITIES) / sizeof(ENTITIES[0]); i++) {
+        if (strcmp(ENTITIES[i].name, ent) == 0) {
+            *cp = ENTITIES[i].cp;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void entity_literal(html_text_t *h)
+{
+    text_byte(h, '&');
+    for (size_t i = 0; i < h->ent_len; i++) text_byte(h, (unsigned char)h->ent[i]);
+}
+
+/* ── Links ────────────────────────────────────────────────────── */
+
+/* Value of attribute name in a tag's attribute text, "&amp;" decoded */
+static bool tag_attr(const char *attrs, const char *name, char *out, size_t size)
+{
+    size_t nlen = strlen(name);
+    const char *p = attrs;
+
+    while (*p) {
+        while (*p && (is_space((unsigned char)*p) || *p == '/')) p++;
+        const char *an = p;
+        while (*p && *p != '=' && !is_space((unsigned char)*p) && *p != '/') p++;
+        size_t alen = p - an;
+        while (is_space((unsigned char)*p)) p++;
+        if (*p != '=') {
+            if (alen == 0 && *p) p++;
+            continue;
+        }
+        p++;
+        while (is_space((unsigned char)*p)) p++;
+
+        char q = (*p == '"' || *p == '\'') ? *p++ : 0;
+        const char *v = p;
+        while (*p && (q ? *p != q : !is_space((unsigned char)*p))) p++;
+        size_t vlen = p - v;
+        if (*p) p++;
+
+        if (alen == nlen && strncasecmp(an, name, nlen) == 0) {
+            size_t n = 0;
+            for (size_t i = 0; i < vlen && n + 1 < size; i++) {
+                out[n++] = v[i];
+                if (i + 5 <= vlen && strncmp(v + i, "&amp;", 5) == 0) i += 4;
+            }
+            out[n] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+void html_text_resolve_url(const char *base, const char *href, char *out, size_t size)
+{
+    out[0] = '\0';
+    while (is_space((unsigned char)*href)) href++;
+    if (!*href || *href == '#' || strncasecmp(href, "javascript:", 11) == 0 ||
+        strncasecmp(href, "mailto:", 7) == 0 || strncasecmp(href, "tel:", 4) == 0 ||
+        strncasecmp(href, "data:", 5) == 0) {
+        return;
+    }
+
+    const char *scheme_end = strstr(href, "://");
+    if (scheme_end && scheme_end < href + strcspn(href, "/?#")) {
+        snprintf(out, size, "%s", href);
+        return;
+    }
+
+    const char *origin_start = base ? strstr(base, "://") : NULL;
+    if (!origin_start) return;
+    const char *path_start = origin_start + 3 + strcspn(origin_start + 3, "/?#");
+
+    if (href[0] == '/' && href[1] == '/') {
+        snprintf(out, size, "%.*s%s", (int)(origin_start + 1 - base), base, href);
+    } else if (href[0] == '/') {
+        snprintf(out, size, "%.*s%s", (int)(path_start - base), base, href);
+    } else {
+        /* Relative to the page's directory */
+        const char *dir_end = path_start;
+        for (const char *p = path_start; *p && *p != '?' && *p != '#'; p++) {
+            if (*p == '/') dir_end = p + 1;
+        }
+        if (dir_end == path_start) {
+            snprintf(out, size, "%.*s/%s", (int)(path_start - base), base, href);
+        } else {
+            snprintf(out, size, "%.*s%s", (int)(dir_end - base), base, href);
+        }
+    }
+}
+
+/* ── Tags ─────────────────────────────────────────────────────── */
+
+static void handle_tag(html_text_t *h)
+{
+    h->tag[h->tag_len] = '\0';
+    const char *p = h->tag;
+    if (*p == '!' || *p == '?') return;            /* doctype, processing instruction */
+
+    bool closing = (*p == '/');
+    if (closing) p++;
+
+    char name[12];
+    size_t n = 0;
+    while (isalnum((unsigned char)*p)) {
+        if (n + 1 < sizeof(name)) name[n++] = (char)tolower((unsigned char)*p);
+        p++;
+    }
+    name[n] = '\0';
+    if (n == 0) return;
+    bool self_closing = h->tag_len > 0 && h->tag[h->tag_len - 1] == '/';
+
+    if (!closing && !self_closing && in_list(SKIP_TAGS, name)) {
+        strcpy(h->skip, name);
+        h->skip_match = 0;
+        h->state = ST_SKIP;
+        return;
+    }
+
+    if (name[0] == 'h' && name[1] >= '1' && name[1] <= '6' && name[2] == '\0') {
+        set_break(h, WS_PARA);
+        if (!closing) {
+            static const char hashes[] = "######";
+            emit(h, hashes, name[1] - '0');
+            set_break(h, WS_SPACE);
+        }
+        return;
+    }
+    if (strcmp(name, "li") == 0 && !closing) {
+        set_break(h, WS_LINE);
+        emit_str(h, "-");
+        set_break(h, WS_SPACE);
+        return;
+    }
+    if (strcmp(name, "pre") == 0) {
+        if (closing && h->pre > 0) h->pre--;
+        else if (!closing) h->pre++;
+        set_break(h, WS_PARA);
+        return;
+    }
+    if (strcmp(name, "td") == 0 || strcmp(name, "th") == 0) {
+        set_break(h, WS_SPACE);
+        return;
+    }
+    if (strcmp(name, "a") == 0) {
+        if (!closing) {
+            char href[HTML_TEXT_URL_MAX];
+            h->href[0] = '\0';
+            if (tag_attr(p, "href", href, sizeof(href))) {
+                html_text_resolve_url(h->base, href, h->href, sizeof(h->href));
+            }
+            h->in_link = h->href[0] != '\0';
+            h->link_start = h->len;
+        } else if (h->in_link) {
+            h->in_link = false;
+            /* Only links with visible text, and not when the text is the URL */
+            size_t tlen = h->len - h->link_start;
+            if (h->len > h->link_start &&
+                !(tlen >= strlen(h->href) && strstr(h->out + h->link_start, h->href))) {
+                h->pending = WS_NONE;
+                emit_str(h, " (");
+                emit_str(h, h->href);
+                emit_str(h, ")");
+            }
+        }
+        return;
+    }
+    if (in_list(PARA_TAGS, name)) {
+        set_break(h, WS_PARA);
+    } else if (in_list(LINE_TAGS, name)) {
+        set_break(h, WS_LINE);
+    }
+}
+
+/* ── Scanner ──────────────────────────────────────────────────── */
+
+static void step(html_text_t *h, unsigned char c)
+{
+    switch (h->state) {
+    case ST_SNIFF:
+        if (is_space(c) || c == 0xEF || c == 0xBB || c == 0xBF) return;   /* BOM */
+        if (c == '<') {
+            h->mode = HTML_TEXT_HTML;
+            h->state = ST_TAG_OPEN;
+            return;
+        }
+        h->mode = HTML_TEXT_PLAIN;
+        h->state = ST_TEXT;
+        text_char(h, c);
+        return;
+
+    case ST_TEXT:
+        if (h->mode == HTML_TEXT_PLAIN) {
+            text_char(h, c);
+        } else if (c == '<') {
+            h->state = ST_TAG_OPEN;
+        } else if (c == '&') {
+            h->ent_len = 0;
+            h->state = ST_ENTITY;
+        } else {
+            text_char(h, c);
+        }
+        return;
+
+    case ST_TAG_OPEN:
+        if (isalpha(c) || c == '/' || c == '!' || c == '?') {
+            h->tag[0] = (char)c;
+            h->tag_len = 1;
+            h->quote = 0;
+            h->state = ST_TAG;
+            return;
+        }
+        /* A bare '<' in text */
+        h->state = ST_TEXT;
+        text_byte(h, '<');
+        step(h, c);
+        return;
+
+    case ST_TAG:
+        if (h->quote) {
+            if (c == h->quote) h->quote = 0;
+        } else if (c == '"' || c == '\'') {
+            h->quote = (char)c;
+        } else if (c == '>') {
+            h->state = ST_TEXT;
+            handle_tag(h);                         /* may switch to ST_SKIP */
+            return;
+        }
+        if (h->tag_len < sizeof(h->tag) - 1) h->tag[h->tag_len++] = (char)c;
+        if (h->tag_len == 3 && memcmp(h->tag, "!--", 3) == 0) {
+            h->skip_match = 0;                     /* dashes seen */
+            h->state = ST_COMMENT;
+        }
+        return;
+
+    case ST_COMMENT:
+        if (c == '-') {
+            h->skip_match++;
+        } else {
+            if (c == '>' && h->skip_match >= 2) h->state = ST_TEXT;
+            h->skip_match = 0;
+        }
+        return;
+
+    case ST_ENTITY:
+        if (c == ';') {
+            h->ent[h->ent_len] = '\0';
+            unsigned cp;
+            h->state = ST_TEXT;
+            if (!entity_decode(h->ent, &cp)) {
+                entity_literal(h);
+                text_byte(h, ';');
+            } else if (cp == ' ') {
+                text_char(h, ' ');
+            } else {
+                utf8_abort(h);
+                emit_codepoint(h, cp);
+            }
+            return;
+        }
+        if ((isalnum(c) || c == '#') && h->ent_len < sizeof(h->ent) - 1) {
+            h->ent[h->ent_len++] = (char)c;
+            return;
+        }
+        h->state = ST_TEXT;
+        entity_literal(h);
+        step(h, c);
+        return;
+
+    case ST_SKIP: {
+        size_t want = 2 + strlen(h->skip);
+        if (h->skip_match == want) {
+            /* "</script" seen: it ends here unless the name goes on */
+            if (c == '>') {
+                h->state = ST_TEXT;
+            } else if (isalnum(c)) {
+                h->skip_match = 0;
+            } else {
+                h->state = ST_SKIP_CLOSE;
+            }
+            return;
+        }
+        char expect = h->skip_match == 0 ? '<' : h->skip_match == 1 ? '/' : h->skip[h->skip_match - 2];
+        if ((char)tolower(c) == expect) {
+            h->skip_match++;
+        } else {
+            h->skip_match = (c == '<') ? 1 : 0;
+        }
+        return;
+    }
+
+    case ST_SKIP_CLOSE:
+        if (c == '>') h->state = ST_TEXT;
+        return;
+    }
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+void html_text_init(html_text_t *h, char *out, size_t cap, html_text_mode_t mode, const char *base)
+{
+    memset(h, 0, sizeof(*h));
+    h->out = out;
+    h->cap = cap;
+    h->mode = mode;
+    h->state = mode == HTML_TEXT_AUTO ? ST_SNIFF : ST_TEXT;
+    if (base && strlen(base) < sizeof(h->base)) memcpy(h->base, base, strlen(base) + 1);
+    if (cap) out[0] = '\0';
+}
+
+bool html_text_feed(html_text_t *h, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len && !h->full; i++) {
+        step(h, (unsigned char)data[i]);
+    }
+    return !h->full;
+}
+
+size_t html_text_finish(html_text_t *h)
+{
+    if (h->state == ST_ENTITY) {
+        h->state = ST_TEXT;
+        entity_literal(h);
+    }
+    utf8_abort(h);
+    /* A budget cut can leave the gap before the next word */
+    while (h->len > 0 && is_space((unsigned char)h->out[h->len - 1])) h->len--;
+    if (h->cap) h->out[h->len] = '\0';
+    return h->len;
+}
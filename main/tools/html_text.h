@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Streaming HTML-to-text conversion into a fixed buffer.
+ *
+ * Bytes are fed as they arrive. Script, style and similar elements are
+ * dropped, whitespace is collapsed, block elements become line breaks,
+ * headings become "# Title" lines, list items "- item" and links
+ * "text (url)" with the URL resolved against the page. Entities are
+ * decoded and non-UTF-8 bytes are taken as Latin-1, so the result is always
+ * valid UTF-8. Only the tag being read and the current link are held
+ * besides the output, whatever the page size.
+ */
+
+#define HTML_TEXT_TAG_MAX    384     /* longer tags lose their tail attributes */
+#define HTML_TEXT_URL_MAX    256     /* resolved link targets */
+#define HTML_TEXT_BASE_MAX   512     /* page URL; as long as web_fetch accepts */
+
+typedef enum {
+    HTML_TEXT_AUTO,        /* HTML if the first non-blank byte is '<' */
+    HTML_TEXT_HTML,
+    HTML_TEXT_PLAIN,       /* keep the text, only tidy whitespace */
+} html_text_mode_t;
+
+typedef struct {
+    char *out;
+    size_t cap;                        /* bytes including the NUL */
+    size_t len;
+    bool full;                         /* budget reached; later input is ignored */
+
+    html_text_mode_t mode;
+    int state;
+    int pending;                       /* whitespace owed before the next text */
+    int pre;                           /* <pre> nesting */
+
+    char tag[HTML_TEXT_TAG_MAX];
+    size_t tag_len;
+    char quote;                        /* inside a quoted attribute value */
+
+    char ent[12];
+    size_t ent_len;
+
+    char skip[12];                     /* element whose content is dropped */
+    size_t skip_match;                 /* bytes of "</name" matched so far */
+
+    unsigned char utf8[4];             /* multi-byte sequence being checked */
+    int utf8_len;
+    int utf8_need;
+
+    char base[HTML_TEXT_BASE_MAX];     /* page URL, for relative links */
+    char href[HTML_TEXT_URL_MAX];
+    bool in_link;
+    size_t link_start;                 /* len when the link text began */
+} html_text_t;
+
+/**
+ * Prepare h to write at most cap - 1 bytes of text into out.
+ * base is the page URL (may be NULL). A base too long to keep whole is
+ * dropped, so relative links are left out rather than resolved wrongly.
+ */
+void html_text_init(html_text_t *h, char *out, size_t cap, html_text_mode_t mode, const char *base);
+
+/**
+ * Convert the next piece of the document.
+ * @return false once the output is full (stop downloading)
+ */
+bool html_text_feed(html_text_t *h, const char *data, size_t len);
+
+/**
+ * Finish the text (trailing whitespace trimmed).
+ * @return text length
+ */
+size_t html_text_finish(html_text_t *h);
+
+/**
+ * Resolve href (absolute, "//host/...", "/path" or relative) against the
+ * page URL base. out is empty for fragments, javascript:, mailto: and the
+ * like, or when href is relative and base is not an absolute URL.
+ */
+void html_text_resolve_url(const char *base, const char *href, char *out, size_t size);
@@ -0,0 +1,327 @@
+#include "tools/json_stream.h"
+
+#include <string.h>
+
+enum {
+    ST_VALUE,              /* a value is required */
+    ST_VALUE_OR_END,       /* after '[': a value or ']' */
+    ST_KEY_OR_END,         /* after '{': a key or '}' */
+    ST_KEY,                /* after ',' in an object */
+    ST_COLON,
+    ST_AFTER,              /* after a value: ',' or the closer */
+    ST_STRING,
+    ST_ESCAPE,
+    ST_UNICODE,
+    ST_SCALAR,
+    ST_DONE,               /* top-level value complete */
+};
+
+void json_stream_init(json_stream_t *js, char *buf, size_t cap, json_stream_cb_t cb, void *ctx)
+{
+    memset(js, 0, sizeof(*js));
+    js->buf = buf;
+    js->cap = cap;
+    js->cb = cb;
+    js->ctx = ctx;
+    js->state = ST_VALUE;
+    js->status = JSON_STREAM_OK;
+}
+
+/* ── Value buffer ─────────────────────────────────────────────── */
+
+static void put_byte(json_stream_t *js, char c)
+{
+    if (js->len + 1 < js->cap) {
+        js->buf[js->len++] = c;
+    } else {
+        js->truncated = true;
+    }
+}
+
+static void put_utf8(json_stream_t *js, unsigned cp)
+{
+    if (cp < 0x80) {
+        put_byte(js, (char)cp);
+    } else if (cp < 0x800) {
+        put_byte(js, (char)(0xC0 | (cp >> 6)));
+        put_byte(js, (char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        put_byte(js, (char)(0xE0 | (cp >> 12)));
+        put_byte(js, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        put_byte(js, (char)(0x80 | (cp & 0x3F)));
+    } else {
+        put_byte(js, (char)(0xF0 | (cp >> 18)));
+        put_byte(js, (char)(0x80 | ((cp >> 12) & 0x3F)));
+        put_byte(js, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        put_byte(js, (char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+/* A high surrogate not followed by a low one */
+static void flush_surrogate(json_stream_t *js)
+{
+    if (js->surrogate) {
+        put_utf8(js, 0xFFFD);
+        js->surrogate = 0;
+    }
+}
+
+static void put_codepoint(json_stream_t *js, unsigned cp)
+{
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        flush_surrogate(js);
+        js->surrogate = cp;
+        return;
+    }
+    if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        if (!js->surrogate) {
+            put_utf8(js, 0xFFFD);
+            return;
+        }
+        cp = 0x10000 + ((js->surrogate - 0xD800) << 10) + (cp - 0xDC00);
+        js->surrogate = 0;
+    }
+    flush_surrogate(js);
+    put_utf8(js, cp);
+}
+
+/* ── Structure ────────────────────────────────────────────────── */
+
+static bool emit(json_stream_t *js, json_ev_t ev)
+{
+    const char *val = NULL;
+    size_t len = 0;
+    if (ev != JSON_EV_END) {
+        js->buf[js->len] = '\0';
+        val = js->buf;
+        len = js->len;
+    }
+    if (!js->cb(js->ctx, js, ev, val, len)) {
+        js->status = JSON_STREAM_STOPPED;
+        return false;
+    }
+    return true;
+}
+
+static void after_value(json_stream_t *js)
+{
+    js->state = js->depth == 0 ? ST_DONE : ST_AFTER;
+}
+
+static bool push(json_stream_t *js, char type)
+{
+    if (js->depth == JSON_STREAM_MAX_DEPTH) return false;
+    json_level_t *l = &js->stack[js->depth++];
+    l->type = type;
+    l->index = 0;
+    l->key[0] = '\0';
+    js->state = type == '{' ? ST_KEY_OR_END : ST_VALUE_OR_END;
+    return true;
+}
+
+static bool pop(json_stream_t *js)
+{
+    js->depth--;
+    if (!emit(js, JSON_EV_END)) return false;
+    after_value(js);
+    return true;
+}
+
+static void begin_string(json_stream_t *js, bool key)
+{
+    js->in_key = key;
+    js->len = 0;
+    js->truncated = false;
+    js->surrogate = 0;
+    js->state = ST_STRING;
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool is_scalar_char(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '-' || c == '+' || c == '.';
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* One byte; false ends the scan (js->status says why) */
+static bool step(json_stream_t *js, char c)
+{
+    json_level_t *top = js->depth ? &js->stack[js->depth - 1] : NULL;
+
+    switch (js->state) {
+    case ST_VALUE_OR_END:
+        if (c == ']') return pop(js);
+        /* fall through */
+    case ST_VALUE:
+        if (is_space(c)) return true;
+        if (c == '{' || c == '[') {
+            if (push(js, c)) return true;
+            break;
+        }
+        if (c == '"') {
+            begin_string(js, false);
+            return true;
+        }
+        if (is_scalar_char(c)) {
+            js->len = 0;
+            js->truncated = false;
+            put_byte(js, c);
+            js->state = ST_SCALAR;
+            return true;
+        }
+        break;
+
+    case ST_KEY_OR_END:
+        if (c == '}') return pop(js);
+        /* fall through */
+    case ST_KEY:
+        if (is_space(c)) return true;
+        if (c == '"') {
+            begin_string(js, true);
+            return true;
+        }
+        break;
+
+    case ST_COLON:
+        if (is_space(c)) return true;
+        if (c == ':') {
+            js->state = ST_VALUE;
+            return true;
+        }
+        break;
+
+    case ST_AFTER:
+        if (is_space(c)) return true;
+        if (c == ',') {
+            if (top->type == '{') {
+                js->state = ST_KEY;
+            } else {
+                top->index++;
+                js->state = ST_VALUE;
+            }
+            return true;
+        }
+        if ((c == '}' && top->type == '{') || (c == ']' && top->type == '[')) return pop(js);
+        break;
+
+    case ST_STRING:
+        if (c == '\\') {
+            js->state = ST_ESCAPE;
+            return true;
+        }
+        if (c != '"') {
+            flush_surrogate(js);
+            put_byte(js, c);
+            return true;
+        }
+        flush_surrogate(js);
+        if (js->in_key) {
+            size_t n = js->len < JSON_STREAM_KEY_MAX - 1 ? js->len : JSON_STREAM_KEY_MAX - 1;
+            memcpy(top->key, js->buf, n);
+            top->key[n] = '\0';
+            js->state = ST_COLON;
+            return true;
+        }
+        if (!emit(js, JSON_EV_STRING)) return false;
+        after_value(js);
+        return true;
+
+    case ST_ESCAPE: {
+        static const char from[] = "bfnrt\"\\/";
+        static const char to[]   = "\b\f\n\r\t\"\\/";
+        if (c == 'u') {
+            js->hex = 0;
+            js->hex_digits = 0;
+            js->state = ST_UNICODE;
+            return true;
+        }
+        const char *p = c ? strchr(from, c) : NULL;
+        if (!p) break;
+        flush_surrogate(js);
+        put_byte(js, to[p - from]);
+        js->state = ST_STRING;
+        return true;
+    }
+
+    case ST_UNICODE: {
+        int v = hex_value(c);
+        if (v < 0) break;
+        js->hex = (js->hex << 4) | (unsigned)v;
+        if (++js->hex_digits == 4) {
+            put_codepoint(js, js->hex);
+            js->state = ST_STRING;
+        }
+        return true;
+    }
+
+    case ST_SCALAR:
+        if (is_scalar_char(c)) {
+            put_byte(js, c);
+            return true;
+        }
+        if (!emit(js, JSON_EV_SCALAR)) return false;
+        after_value(js);
+        return js->state == ST_DONE ? true : step(js, c);
+
+    case ST_DONE:
+        if (is_space(c)) return true;
+        break;
+    }
+
+    js->status = JSON_STREAM_ERROR;
+    return false;
+}
+
+json_stream_status_t json_stream_feed(json_stream_t *js, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len && js->status == JSON_STREAM_OK; i++) {
+        step(js, data[i]);
+    }
+    return js->status;
+}
+
+/* ── Position ─────────────────────────────────────────────────── */
+
+bool json_stream_match(const json_stream_t *js, const char *path)
+{
+    int level = 0;
+    const char *p = path;
+
+    while (*p) {
+        if (p[0] == '[' && p[1] == ']') {
+            if (level >= js->depth || js->stack[level].type != '[') return false;
+            level++;
+            p += 2;
+        } else {
+            size_t n = strcspn(p, ".[");
+            if (level >= js->depth || js->stack[level].type != '{' ||
+                strlen(js->stack[level].key) != n || strncmp(js->stack[level].key, p, n) != 0) {
+                return false;
+            }
+            level++;
+            p += n;
+        }
+        if (*p == '.') p++;
+    }
+    return level == js->depth;
+}
+
+int json_stream_index(const json_stream_t *js)
+{
+    for (int i = js->depth - 1; i >= 0; i--) {
+        if (js->stack[i].type == '[') return js->stack[i].index;
+    }
+    return -1;
+}
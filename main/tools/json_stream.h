@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Incremental JSON scanner for responses too large to buffer.
+ *
+ * Bytes are fed as they arrive, in pieces of any size. The scanner keeps
+ * only the container stack (key or array index per level) and the scalar
+ * being read, so memory does not depend on document size. Each scalar is
+ * handed to a callback with escapes decoded; json_stream_match() tells the
+ * callback where in the document it is. Values longer than the value buffer
+ * are truncated (still NUL-terminated).
+ */
+
+#define JSON_STREAM_MAX_DEPTH  12
+#define JSON_STREAM_KEY_MAX    32      /* longer keys are truncated */
+
+typedef enum {
+    JSON_EV_STRING,        /* string value */
+    JSON_EV_SCALAR,        /* number, true, false or null (raw text) */
+    JSON_EV_END,           /* a container closed; the stack is back at its parent */
+} json_ev_t;
+
+typedef enum {
+    JSON_STREAM_OK,        /* feed more */
+    JSON_STREAM_STOPPED,   /* callback returned false */
+    JSON_STREAM_ERROR,     /* malformed input or nesting too deep */
+} json_stream_status_t;
+
+typedef struct json_stream json_stream_t;
+
+/**
+ * Called for every scalar and container end. val/len are NULL/0 for
+ * JSON_EV_END. Return false to stop scanning.
+ */
+typedef bool (*json_stream_cb_t)(void *ctx, const json_stream_t *js, json_ev_t ev,
+                                 const char *val, size_t len);
+
+typedef struct {
+    char type;                         /* '{' or '[' */
+    int index;                         /* current element, arrays only */
+    char key[JSON_STREAM_KEY_MAX];     /* current member, objects only */
+} json_level_t;
+
+struct json_stream {
+    json_level_t stack[JSON_STREAM_MAX_DEPTH];
+    int depth;
+    int state;
+    bool in_key;
+    bool truncated;                    /* the current value did not fit */
+    char *buf;
+    size_t cap;
+    size_t len;
+    unsigned hex;                      /* \uXXXX being read */
+    int hex_digits;
+    unsigned surrogate;                /* pending high surrogate */
+    json_stream_cb_t cb;
+    void *ctx;
+    json_stream_status_t status;
+};
+
+/**
+ * Prepare js. buf holds one scalar at a time (cap bytes including the NUL).
+ */
+void json_stream_init(json_stream_t *js, char *buf, size_t cap, json_stream_cb_t cb, void *ctx);
+
+/**
+ * Scan the next piece of the document.
+ * @return JSON_STREAM_OK while more input is wanted
+ */
+json_stream_status_t json_stream_feed(json_stream_t *js, const char *data, size_t len);
+
+/**
+ * True if the current position is exactly path, e.g. "web.results[].title":
+ * dot-separated member names from the root object, "[]" for any array
+ * element. At JSON_EV_END the position is the closed container's parent.
+ */
+bool json_stream_match(const json_stream_t *js, const char *path);
+
+/**
+ * Element index in the innermost array, or -1 if not inside one.
+ */
+int json_stream_index(const json_stream_t *js);
@@ -0,0 +1,456 @@
+#include "tools/search_cache.h"
+#include "mimi_config.h"
+#include "clock/time_sync.h"
+#include "storage/fs_catalog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "search_cache";
+
+#define CACHE_MAGIC     0x48435353      /* "SSCH" */
+#define CACHE_VERSION   1
+#define FLIGHT_DONE     BIT0
+
+typedef struct {
+    uint32_t hash;
+    uint32_t last_used;                 /* LRU tick, 0 = free slot */
+    int64_t  stored_at;                 /* epoch seconds */
+    uint32_t fetch_ms;                  /* what the original fetch cost */
+    uint16_t len;
+    char key[MIMI_SEARCH_CACHE_KEY_MAX];
+    char *value;                        /* PSRAM, len + 1 bytes */
+} cache_entry_t;
+
+/* A fetch in progress that identical lookups can wait for */
+typedef struct {
+    bool active;
+    int waiters;
+    uint32_t hash;
+    char key[MIMI_SEARCH_CACHE_KEY_MAX];
+    TaskHandle_t owner;
+    EventGroupHandle_t done;
+} flight_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+} cache_file_hdr_t;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t fetch_ms;
+    int64_t  stored_at;
+    uint16_t key_len;
+    uint16_t len;
+} cache_file_rec_t;
+
+typedef struct {
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t coalesced;                 /* hits served by another caller's fetch */
+    uint32_t misses;
+    uint32_t expired;
+    uint32_t bypassed;                  /* clock unset or query too long */
+    uint32_t fetches;
+    uint32_t evictions;
+    uint32_t saves;
+    int64_t fetch_us;                   /* total time of successful fetches */
+    int64_t saved_us;                   /* fetch time avoided by hits */
+} cache_stats_t;
+
+static cache_entry_t *s_entries = NULL;
+static flight_t s_flights[MIMI_SEARCH_CACHE_MAX_FLIGHTS];
+static SemaphoreHandle_t s_lock = NULL;
+static uint32_t s_tick = 0;
+static bool s_dirty = false;
+static int64_t s_last_save_us = 0;
+static cache_stats_t s_stats;
+
+/* ── Keys ─────────────────────────────────────────────────────── */
+
+/* Lowercase, trim, collapse whitespace. False if empty or too long. */
+static bool normalize(const char *query, char *key, size_t size)
+{
+    size_t n = 0;
+    bool space = false;
+
+    for (const char *p = query; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (isspace(c)) {
+            space = n > 0;
+            continue;
+        }
+        if (space) {
+            if (n + 1 >= size) return false;
+            key[n++] = ' ';
+            space = false;
+        }
+        if (n + 1 >= size) return false;
+        key[n++] = (char)tolower(c);
+    }
+    key[n] = '\0';
+    return n > 0;
+}
+
+static uint32_t key_hash(const char *key)
+{
+    uint32_t h = 2166136261u;
+    for (; *key; key++) {
+        h ^= (uint8_t)*key;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* ── Table (caller holds s_lock) ──────────────────────────────── */
+
+static int entry_find(uint32_t hash, const char *key)
+{
+    for (int i = 0; i < MIMI_SEARCH_CACHE_ENTRIES; i++) {
+        if (s_entries[i].last_used && s_entries[i].hash == hash &&
+            strcmp(s_entries[i].key, key) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void entry_free(int i)
+{
+    free(s_entries[i].value);
+    memset(&s_entries[i], 0, sizeof(s_entries[i]));
+    s_dirty = true;
+}
+
+/* Free slot, else the least recently used one */
+static int entry_victim(void)
+{
+    int lru = 0;
+    for (int i = 0; i < MIMI_SEARCH_CACHE_ENTRIES; i++) {
+        if (!s_entries[i].last_used) return i;
+        if (s_entries[i].last_used < s_entries[lru].last_used) lru = i;
+    }
+    s_stats.evictions++;
+    entry_free(lru);
+    return lru;
+}
+
+static void entry_put(uint32_t hash, const char *key, const char *value, int64_t fetch_us)
+{
+    size_t len = strlen(value);
+    if (len > MIMI_SEARCH_CACHE_VALUE_MAX) return;
+
+    int i = entry_find(hash, key);
+    if (i < 0) i = entry_victim();
+
+    char *copy = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM);
+    if (!copy) return;
+    memcpy(copy, value, len + 1);
+
+    cache_entry_t *e = &s_entries[i];
+    free(e->value);
+    e->hash = hash;
+    e->last_used = ++s_tick;
+    e->stored_at = time(NULL);
+    e->fetch_ms = (uint32_t)(fetch_us / 1000);
+    e->len = (uint16_t)len;
+    strncpy(e->key, key, sizeof(e->key) - 1);
+    e->value = copy;
+    s_dirty = true;
+}
+
+static flight_t *flight_find(uint32_t hash, const char *key)
+{
+    for (int i = 0; i < MIMI_SEARCH_CACHE_MAX_FLIGHTS; i++) {
+        flight_t *f = &s_flights[i];
+        if (f->active && f->hash == hash && strcmp(f->key, key) == 0) return f;
+    }
+    return NULL;
+}
+
+static void flight_claim(uint32_t hash, const char *key)
+{
+    for (int i = 0; i < MIMI_SEARCH_CACHE_MAX_FLIGHTS; i++) {
+        flight_t *f = &s_flights[i];
+        /* A finished flight is reusable once its last waiter has left */
+        if (f->active || f->waiters > 0) continue;
+        f->active = true;
+        f->hash = hash;
+        strncpy(f->key, key, sizeof(f->key) - 1);
+        f->key[sizeof(f->key) - 1] = '\0';
+        f->owner = xTaskGetCurrentTaskHandle();
+        xEventGroupClearBits(f->done, FLIGHT_DONE);
+        return;
+    }
+}
+
+/* ── Persistence (caller holds s_lock) ────────────────────────── */
+
+static void cache_save(void)
+{
+    /* Oldest first, so loading in file order rebuilds the LRU ticks */
+    int order[MIMI_SEARCH_CACHE_ENTRIES];
+    int count = 0;
+    for (int i = 0; i < MIMI_SEARCH_CACHE_ENTRIES; i++) {
+        if (!s_entries[i].last_used) continue;
+        int j = count++;
+        while (j > 0 && s_entries[order[j - 1]].last_used > s_entries[i].last_used) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    FILE *f = fopen(MIMI_SEARCH_CACHE_FILE, "wb");
+    if (!f) {
+        ESP_LOGW(TAG, "Cannot write %s", MIMI_SEARCH_CACHE_FILE);
+        return;
+    }
+
+    cache_file_hdr_t hdr = { .magic = CACHE_MAGIC, .version = CACHE_VERSION, .count = count };
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    for (int k = 0; ok && k < count; k++) {
+        const cache_entry_t *e = &s_entries[order[k]];
+        cache_file_rec_t rec = {
+            .hash = e->hash,
+            .fetch_ms = e->fetch_ms,
+            .stored_at = e->stored_at,
+            .key_len = (uint16_t)strlen(e->key),
+            .len = e->len,
+        };
+        ok = fwrite(&rec, sizeof(rec), 1, f) == 1 &&
+             fwrite(e->key, 1, rec.key_len, f) == rec.key_len &&
+             fwrite(e->value, 1, rec.len, f) == rec.len;
+    }
+    fclose(f);
+
+    if (!ok) {
+        ESP_LOGW(TAG, "Short write on %s, removing", MIMI_SEARCH_CACHE_FILE);
+        remove(MIMI_SEARCH_CACHE_FILE);
+    }
+    fs_catalog_update(MIMI_SEARCH_CACHE_FILE);
+    if (!ok) return;
+    s_dirty = false;
+    s_last_save_us = esp_timer_get_time();
+    s_stats.saves++;
+}
+
+static int cache_load(void)
+{
+    FILE *f = fopen(MIMI_SEARCH_CACHE_FILE, "rb");
+    if (!f) return 0;
+
+    cache_file_hdr_t hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+        hdr.magic != CACHE_MAGIC || hdr.version != CACHE_VERSION) {
+        fclose(f);
+        ESP_LOGW(TAG, "Cache file invalid, ignoring");
+        return 0;
+    }
+
+    int loaded = 0;
+    for (int k = 0; k < hdr.count; k++) {
+        cache_file_rec_t rec;
+        if (fread(&rec, sizeof(rec), 1, f) != 1 ||
+            rec.key_len >= MIMI_SEARCH_CACHE_KEY_MAX || rec.len > MIMI_SEARCH_CACHE_VALUE_MAX) {
+            break;
+        }
+
+        char *value = heap_caps_malloc(rec.len + 1, MALLOC_CAP_SPIRAM);
+        if (!value) break;
+        cache_entry_t e = {
+            .hash = rec.hash,
+            .stored_at = rec.stored_at,
+            .fetch_ms = rec.fetch_ms,
+            .len = rec.len,
+            .value = value,
+        };
+        if (fread(e.key, 1, rec.key_len, f) != rec.key_len ||
+            fread(value, 1, rec.len, f) != rec.len) {
+            free(value);
+            break;
+        }
+        value[rec.len] = '\0';
+
+        /* More records than slots (smaller build): later ones are newer */
+        int i = entry_victim();
+        e.last_used = ++s_tick;
+        s_entries[i] = e;
+        loaded++;
+    }
+    fclose(f);
+
+    s_stats.evictions = 0;
+    return loaded;
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+esp_err_t search_cache_init(void)
+{
+    s_entries = heap_caps_calloc(MIMI_SEARCH_CACHE_ENTRIES, sizeof(cache_entry_t), MALLOC_CAP_SPIRAM);
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_entries || !s_lock) {
+        ESP_LOGE(TAG, "Out of memory for search cache");
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < MIMI_SEARCH_CACHE_MAX_FLIGHTS; i++) {
+        s_flights[i].done = xEventGroupCreate();
+        if (!s_flights[i].done) return ESP_ERR_NO_MEM;
+    }
+
+    int loaded = cache_load();
+    ESP_LOGI(TAG, "Search cache ready: %d entries loaded, TTL %d s",
+             loaded, MIMI_SEARCH_CACHE_TTL_S);
+    return ESP_OK;
+}
+
+search_cache_result_t search_cache_lookup(const char *query, char *out, size_t size)
+{
+    char key[MIMI_SEARCH_CACHE_KEY_MAX];
+    if (!s_entries || !query || !out || size == 0) return SEARCH_CACHE_FETCH;
+
+    bool usable = time_sync_is_valid() && normalize(query, key, sizeof(key));
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.lookups++;
+    if (!usable) {
+        s_stats.bypassed++;
+        xSemaphoreGive(s_lock);
+        return SEARCH_CACHE_FETCH;
+    }
+
+    uint32_t hash = key_hash(key);
+    bool waited = false;
+
+    while (1) {
+        int i = entry_find(hash, key);
+        if (i >= 0) {
+            cache_entry_t *e = &s_entries[i];
+            if (time(NULL) - e->stored_at < MIMI_SEARCH_CACHE_TTL_S) {
+                strncpy(out, e->value, size - 1);
+                out[size - 1] = '\0';
+                e->last_used = ++s_tick;
+                s_stats.hits++;
+                s_stats.saved_us += (int64_t)e->fetch_ms * 1000;
+                if (waited) s_stats.coalesced++;
+                xSemaphoreGive(s_lock);
+                return SEARCH_CACHE_HIT;
+            }
+            s_stats.expired++;
+            entry_free(i);
+        }
+
+        /* Already waited once: that fetch failed or timed out, fetch ourselves */
+        if (waited) break;
+
+        flight_t *f = flight_find(hash, key);
+        if (!f) break;
+
+        f->waiters++;
+        xSemaphoreGive(s_lock);
+        xEventGroupWaitBits(f->done, FLIGHT_DONE, pdFALSE, pdTRUE,
+                            pdMS_TO_TICKS(MIMI_SEARCH_CACHE_WAIT_MS));
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        f->waiters--;
+        waited = true;
+    }
+
+    s_stats.misses++;
+    if (!flight_find(hash, key)) flight_claim(hash, key);
+    xSemaphoreGive(s_lock);
+    return SEARCH_CACHE_FETCH;
+}
+
+void search_cache_complete(const char *query, const char *result, int64_t fetch_us)
+{
+    char key[MIMI_SEARCH_CACHE_KEY_MAX];
+    if (!s_entries || !query || !normalize(query, key, sizeof(key))) return;
+    uint32_t hash = key_hash(key);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (result) {
+        s_stats.fetches++;
+        s_stats.fetch_us += fetch_us;
+        if (time_sync_is_valid()) entry_put(hash, key, result, fetch_us);
+    }
+
+    flight_t *f = flight_find(hash, key);
+    if (f && f->owner == xTaskGetCurrentTaskHandle()) {
+        f->active = false;
+        xEventGroupSetBits(f->done, FLIGHT_DONE);
+    }
+
+    if (s_dirty &&
+        esp_timer_get_time() - s_last_save_us >= (int64_t)MIMI_SEARCH_CACHE_SAVE_INTERVAL_MS * 1000) {
+        cache_save();
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void search_cache_clear(void)
+{
+    if (!s_entries) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < MIMI_SEARCH_CACHE_ENTRIES; i++) {
+        if (s_entries[i].last_used) entry_free(i);
+    }
+    remove(MIMI_SEARCH_CACHE_FILE);
+    fs_catalog_update(MIMI_SEARCH_CACHE_FILE);
+    s_dirty = false;
+    xSemaphoreGive(s_lock);
+}
+
+void search_cache_sync(void)
+{
+    if (!s_entries) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_dirty) cache_save();
+    xSemaphoreGive(s_lock);
+}
+
+void search_cache_print_stats(void)
+{
+    if (!s_entries) {
+        printf("Search cache not initialized.\n");
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    cache_stats_t st = s_stats;
+    int used = 0;
+    size_t bytes = 0;
+    for (int i = 0; i < MIMI_SEARCH_CACHE_ENTRIES; i++) {
+        if (!s_entries[i].last_used) continue;
+        used++;
+        bytes += s_entries[i].len;
+    }
+    bool dirty = s_dirty;
+    xSemaphoreGive(s_lock);
+
+    uint32_t answered = st.hits + st.misses;
+    printf("Entries:   %d/%d (%u bytes), TTL %d s%s\n", used, MIMI_SEARCH_CACHE_ENTRIES,
+           (unsigned)bytes, MIMI_SEARCH_CACHE_TTL_S, dirty ? ", unsaved changes" : "");
+    printf("Lookups:   %u, hits %u (%.1f%%), misses %u, bypassed %u\n",
+           (unsigned)st.lookups, (unsigned)st.hits,
+           answered ? 100.0 * st.hits / answered : 0.0,
+           (unsigned)st.misses, (unsigned)st.bypassed);
+    printf("Coalesced: %u lookups waited for an identical fetch\n", (unsigned)st.coalesced);
+    printf("Fetches:   %u, avg %d ms\n", (unsigned)st.fetches,
+           st.fetches ? (int)(st.fetch_us / st.fetches / 1000) : 0);
+    printf("Saved:     %d ms of fetch latency\n", (int)(st.saved_us / 1000));
+    printf("Expired %u, evicted %u, file writes %u\n",
+           (unsigned)st.expired, (unsigned)st.evictions, (unsigned)st.saves);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Cache of formatted web search results.
+ *
+ * Keyed by the normalized query (lowercased, whitespace collapsed), kept for
+ * MIMI_SEARCH_CACHE_TTL_S, least recently used entry evicted when the
+ * MIMI_SEARCH_CACHE_ENTRIES slots are full. Entries live in PSRAM and are
+ * written to MIMI_SEARCH_CACHE_FILE at most every
+ * MIMI_SEARCH_CACHE_SAVE_INTERVAL_MS, so they survive a reboot.
+ *
+ * Concurrent lookups of a query that is already being fetched wait for that
+ * fetch instead of starting their own. TTLs use the wall clock: while it is
+ * not set, every lookup is a plain miss and nothing is stored.
+ */
+
+typedef enum {
+    SEARCH_CACHE_HIT,      /* out holds the cached result */
+    SEARCH_CACHE_FETCH,    /* caller fetches, then calls search_cache_complete() */
+} search_cache_result_t;
+
+/**
+ * Allocate the table and load MIMI_SEARCH_CACHE_FILE.
+ */
+esp_err_t search_cache_init(void);
+
+/**
+ * Look up query. On SEARCH_CACHE_FETCH the caller may be the one fetch that
+ * other lookups of the same query are waiting on, so it must always call
+ * search_cache_complete(), also on failure.
+ */
+search_cache_result_t search_cache_lookup(const char *query, char *out, size_t size);
+
+/**
+ * Finish a fetch started after SEARCH_CACHE_FETCH. result is NULL on failure;
+ * fetch_us is the time the fetch took (reported as saved on later hits).
+ */
+void search_cache_complete(const char *query, const char *result, int64_t fetch_us);
+
+/**
+ * Drop every entry and the file.
+ */
+void search_cache_clear(void);
+
+/**
+ * Write pending entries now (before a restart).
+ */
+void search_cache_sync(void);
+
+/**
+ * Print hit rate, coalesced lookups and saved latency.
+ */
+void search_cache_print_stats(void);
@@ -57,8 +57,8 @@ esp_err_t tool_cron_add_execute(const char *input_json, char *output, size_t out
     if (strcmp(schedule_type, "every") == 0) {
         job.kind = CRON_KIND_EVERY;
         cJSON *interval = cJSON_GetObjectItem(root, "interval_s");
-        if (!interval || !cJSON_IsNumber(interval) || interval->valuedouble <= 0) {
-            snprintf(output, output_size, "Error: 'every' schedule requires positive 'interval_s'");
+        if (!interval || !cJSON_IsNumber(interval) || interval->valuedouble < 1) {
+            snprintf(output, output_size, "Error: 'every' schedule requires 'interval_s' of at least 1");
             cJSON_Delete(root);
             return ESP_ERR_INVALID_ARG;
         }
@@ -86,15 +86,35 @@ esp_err_t tool_cron_add_execute(const char *input_json, char *output, size_t out
         /* Default: delete one-shot jobs after run */
         cJSON *delete_j = cJSON_GetObjectItem(root, "delete_after_run");
         job.delete_after_run = delete_j ? cJSON_IsTrue(delete_j) : true;
+    } else if (strcmp(schedule_type, "cron") == 0) {
+        job.kind = CRON_KIND_CRON;
+        const char *expr = cJSON_GetStringValue(cJSON_GetObjectItem(root, "expr"));
+        if (!expr || !cron_expr_parse(expr, &job.cexpr)) {
+            snprintf(output, output_size,
+                     "Error: 'cron' schedule requires 'expr' with 5 fields "
+                     "(minute hour day-of-month month day-of-week), e.g. \"0 8 * * mon-fri\"");
+            cJSON_Delete(root);
+            return ESP_ERR_INVALID_ARG;
+        }
+        strncpy(job.expr, expr, sizeof(job.expr) - 1);
+        job.delete_after_run = false;
     } else {
-        snprintf(output, output_size, "Error: schedule_type must be 'every' or 'at'");
+        snprintf(output, output_size, "Error: schedule_type must be 'every', 'at' or 'cron'");
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
 
+    /* Jobs due together for the same chat share one turn unless batch=false */
+    cJSON *batch_j = cJSON_GetObjectItem(root, "batch");
+    job.no_batch = batch_j && cJSON_IsFalse(batch_j);
+
     cJSON_Delete(root);
 
     esp_err_t err = cron_add_job(&job);
+    if (err == ESP_ERR_INVALID_ARG) {
+        snprintf(output, output_size, "Error: cron expression '%s' never fires", job.expr);
+        return err;
+    }
     if (err != ESP_OK) {
         snprintf(output, output_size, "Error: failed to add job (%s)", esp_err_to_name(err));
         return err;
@@ -105,6 +125,15 @@ esp_err_t tool_cron_add_execute(const char *input_json, char *output, size_t out
         snprintf(output, output_size,
                  "OK: Added recurring job '%s' (id=%s), runs every %lu seconds. Next run at epoch %lld.",
                  job.name, job.id, (unsigned long)job.interval_s, (long long)job.next_run);
+    } else if (job.kind == CRON_KIND_CRON) {
+        char when[32];
+        time_t t = (time_t)job.next_run;
+        struct tm tm;
+        localtime_r(&t, &tm);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M %Z", &tm);
+        snprintf(output, output_size,
+                 "OK: Added cron job '%s' (id=%s), schedule '%s'. Next run %s (epoch %lld).",
+                 job.name, job.id, job.expr, when, (long long)job.next_run);
     } else {
         snprintf(output, output_size,
                  "OK: Added one-shot job '%s' (id=%s), fires at epoch %lld.%s",
@@ -122,9 +151,7 @@ esp_err_t tool_cron_list_execute(const char *input_json, char *output, size_t ou
 {
     (void)input_json;
 
-    const cron_job_t *jobs;
-    int count;
-    cron_list_jobs(&jobs, &count);
+    int count = cron_job_count();
 
     if (count == 0) {
         snprintf(output, output_size, "No cron jobs scheduled.");
@@ -135,26 +162,37 @@ esp_err_t tool_cron_list_execute(const char *input_json, char *output, size_t ou
     off += snprintf(output + off, output_size - off,
                     "Scheduled jobs (%d):\n", count);
 
-    for (int i = 0; i < count && off < output_size - 1; i++) {
-        const cron_job_t *j = &jobs[i];
+    cron_job_t job;
+    for (int i = 0; off < output_size - 1 && cron_get_job(i, &job); i++) {
+        const cron_job_t *j = &job;
 
         if (j->kind == CRON_KIND_EVERY) {
             off += snprintf(output + off, output_size - off,
-                "  %d. [%s] \"%s\" — every %lus, %s, next=%lld, last=%lld, ch=%s:%s\n",
+                "  %d. [%s] \"%s\" — every %lus, %s, next=%lld, last=%lld, ch=%s:%s%s\n",
                 i + 1, j->id, j->name,
                 (unsigned long)j->interval_s,
                 j->enabled ? "enabled" : "disabled",
                 (long long)j->next_run, (long long)j->last_run,
-                j->channel, j->chat_id);
+                j->channel, j->chat_id,
+                j->no_batch ? " (own turn)" : "");
+        } else if (j->kind == CRON_KIND_CRON) {
+            off += snprintf(output + off, output_size - off,
+                "  %d. [%s] \"%s\" — cron '%s', %s, next=%lld, last=%lld, ch=%s:%s%s\n",
+                i + 1, j->id, j->name, j->expr,
+                j->enabled ? "enabled" : "disabled",
+                (long long)j->next_run, (long long)j->last_run,
+                j->channel, j->chat_id,
+                j->no_batch ? " (own turn)" : "");
         } else {
             off += snprintf(output + off, output_size - off,
-                "  %d. [%s] \"%s\" — at %lld, %s, last=%lld, ch=%s:%s%s\n",
+                "  %d. [%s] \"%s\" — at %lld, %s, last=%lld, ch=%s:%s%s%s\n",
                 i + 1, j->id, j->name,
                 (long long)j->at_epoch,
                 j->enabled ? "enabled" : "disabled",
                 (long long)j->last_run,
                 j->channel, j->chat_id,
-                j->delete_after_run ? " (auto-delete)" : "");
+                j->delete_after_run ? " (auto-delete)" : "",
+                j->no_batch ? " (own turn)" : "");
         }
     }
 
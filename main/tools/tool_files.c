@@ -1,19 +1,23 @@
 #include "tools/tool_files.h"
 #include "mimi_config.h"
+#include "memory/memory_index.h"
+#include "storage/storage.h"
+#include "storage/write_behind.h"
+#include "storage/fs_catalog.h"
+#include "storage/lzfile.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include <dirent.h>
+#include <limits.h>
 #include <sys/stat.h>
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "cJSON.h"
 
 static const char *TAG = "tool_files";
 
-#define MAX_FILE_SIZE (32 * 1024)
-
 /**
  * Validate that a path starts with MIMI_SPIFFS_BASE and contains no ".." traversal.
  */
@@ -27,11 +31,65 @@ static bool validate_path(const char *path)
         if (path[base_len] != '/') return false;
     }
     if (strstr(path, "..") != NULL) return false;
+    /* Manifest tools and their endpoint credentials are operator-only */
+    if (strstr(path, "//") != NULL) return false;
+    if (strncmp(path, MIMI_TOOL_MANIFEST_PREFIX, strlen(MIMI_TOOL_MANIFEST_PREFIX)) == 0) return false;
     return true;
 }
 
 /* ── read_file ─────────────────────────────────────────────── */
 
+/* Room kept at the end of the output for the "[... next offset=N]" footer */
+#define READ_FOOTER_RESERVE 128
+
+static long json_long(cJSON *root, const char *key, long def)
+{
+    cJSON *item = cJSON_GetObjectItem(root, key);
+    return cJSON_IsNumber(item) ? (long)item->valuedouble : def;
+}
+
+/* Copy lines [first, last] (1-based) into out; stops at a line boundary when full */
+static size_t read_lines(FILE *f, long first, long last, char *out, size_t cap,
+                         long *shown_last, long *total_lines)
+{
+    size_t off = 0;
+    size_t line_start = 0;      /* offset in out where the current line began */
+    long line = 1;
+    bool full = false;
+    int c = EOF, prev = '\n';
+
+    *shown_last = 0;
+    while ((c = getc(f)) != EOF) {
+        prev = c;
+        if (line >= first && line <= last && !full) {
+            if (off < cap) {
+                out[off++] = (char)c;
+            } else {
+                /* Drop the partial line unless it is the only one */
+                if (line_start > 0) off = line_start;
+                else *shown_last = line;
+                full = true;
+            }
+        }
+        if (c == '\n') {
+            if (line >= first && line <= last && !full) {
+                *shown_last = line;
+                line_start = off;
+            }
+            line++;
+        }
+    }
+    /* Last line without a trailing newline */
+    if (prev != '\n') {
+        if (line >= first && line <= last && !full) *shown_last = line;
+        line++;
+    }
+
+    out[off] = '\0';
+    *total_lines = line - 1;
+    return off;
+}
+
 esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t output_size)
 {
     cJSON *root = cJSON_Parse(input_json);
@@ -42,24 +100,71 @@ esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t ou
 
     const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
     if (!validate_path(path)) {
-        snprintf(output, output_size, "Error: path must start with %s/ and must not contain '..'", MIMI_SPIFFS_BASE);
+        snprintf(output, output_size, "Error: path must start with %s/, must not contain '..' "
+                 "and must not be under %s", MIMI_SPIFFS_BASE, MIMI_TOOL_MANIFEST_PREFIX);
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
 
-    FILE *f = fopen(path, "r");
+    long offset = json_long(root, "offset", 0);
+    long length = json_long(root, "length", 0);
+    long start_line = json_long(root, "start_line", 0);
+    long end_line = json_long(root, "end_line", 0);
+    if (offset < 0 || length < 0 || start_line < 0 || end_line < 0 ||
+        (end_line && start_line > end_line)) {
+        snprintf(output, output_size, "Error: invalid range");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    write_behind_sync(path);
+    char *hold;
+    FILE *f = lzfile_open(path, &hold);
     if (!f) {
         snprintf(output, output_size, "Error: file not found: %s", path);
         cJSON_Delete(root);
         return ESP_ERR_NOT_FOUND;
     }
 
-    size_t max_read = output_size - 1;
-    if (max_read > MAX_FILE_SIZE) max_read = MAX_FILE_SIZE;
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
 
-    size_t n = fread(output, 1, max_read, f);
-    output[n] = '\0';
+    size_t cap = output_size - 1;
+    if (cap > READ_FOOTER_RESERVE * 2) cap -= READ_FOOTER_RESERVE;
+
+    size_t n;
+    if (start_line || end_line) {
+        long first = start_line ? start_line : 1;
+        long last = end_line ? end_line : LONG_MAX;
+        long shown_last, total;
+        n = read_lines(f, first, last, output, cap, &shown_last, &total);
+        if (shown_last == 0) {
+            snprintf(output, output_size, "[no lines in range; %s has %ld lines]", path, total);
+        } else if (shown_last < total && shown_last < last) {
+            snprintf(output + n, output_size - n, "\n[lines %ld-%ld of %ld; next start_line=%ld]",
+                     first, shown_last, total, shown_last + 1);
+        } else if (first > 1 || shown_last < total) {
+            snprintf(output + n, output_size - n, "\n[lines %ld-%ld of %ld]", first, shown_last, total);
+        }
+    } else {
+        if (offset > file_size) offset = file_size;
+        size_t want = cap;
+        if (length && (size_t)length < want) want = length;
+        fseek(f, offset, SEEK_SET);
+        n = fread(output, 1, want, f);
+        output[n] = '\0';
+
+        long end = offset + (long)n;
+        if (end < file_size && (!length || (size_t)length > n)) {
+            snprintf(output + n, output_size - n, "\n[bytes %ld-%ld of %ld; next offset=%ld]",
+                     offset, end, file_size, end);
+        } else if (offset > 0 || end < file_size) {
+            snprintf(output + n, output_size - n, "\n[bytes %ld-%ld of %ld]", offset, end, file_size);
+        }
+    }
     fclose(f);
+    free(hold);
 
     ESP_LOGI(TAG, "read_file: %s (%d bytes)", path, (int)n);
     cJSON_Delete(root);
@@ -78,9 +183,11 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
 
     const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
     const char *content = cJSON_GetStringValue(cJSON_GetObjectItem(root, "content"));
+    const char *mode = cJSON_GetStringValue(cJSON_GetObjectItem(root, "mode"));
 
     if (!validate_path(path)) {
-        snprintf(output, output_size, "Error: path must start with %s/ and must not contain '..'", MIMI_SPIFFS_BASE);
+        snprintf(output, output_size, "Error: path must start with %s/, must not contain '..' "
+                 "and must not be under %s", MIMI_SPIFFS_BASE, MIMI_TOOL_MANIFEST_PREFIX);
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
@@ -89,8 +196,24 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
-
-    FILE *f = fopen(path, "w");
+    if (mode && strcmp(mode, "append") != 0 && strcmp(mode, "overwrite") != 0) {
+        snprintf(output, output_size, "Error: mode must be 'overwrite' or 'append'");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool append = mode && strcmp(mode, "append") == 0;
+
+    if (append) {
+        /* Land buffered appends first so the order is kept; a compressed file is unpacked */
+        write_behind_sync(path);
+        lzfile_restore(path);
+    } else {
+        /* Buffered appends and any compressed copy predate this write */
+        write_behind_discard(path);
+        lzfile_remove(path);
+    }
+    storage_make_parents(path);
+    FILE *f = fopen(path, append ? "a" : "w");
     if (!f) {
         snprintf(output, output_size, "Error: cannot open file for writing: %s", path);
         cJSON_Delete(root);
@@ -100,6 +223,7 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
     size_t len = strlen(content);
     size_t written = fwrite(content, 1, len, f);
     fclose(f);
+    fs_catalog_update(path);
 
     if (written != len) {
         snprintf(output, output_size, "Error: wrote %d of %d bytes to %s", (int)written, (int)len, path);
@@ -107,14 +231,77 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
         return ESP_FAIL;
     }
 
-    snprintf(output, output_size, "OK: wrote %d bytes to %s", (int)written, path);
-    ESP_LOGI(TAG, "write_file: %s (%d bytes)", path, (int)written);
+    if (append) {
+        memory_index_append_file(path);
+    } else {
+        memory_index_update_file(path);
+    }
+
+    snprintf(output, output_size, "OK: %s %d bytes to %s", append ? "appended" : "wrote", (int)written, path);
+    ESP_LOGI(TAG, "write_file: %s (%d bytes%s)", path, (int)written, append ? ", append" : "");
     cJSON_Delete(root);
     return ESP_OK;
 }
 
 /* ── edit_file ─────────────────────────────────────────────── */
 
+static const char *find_bytes(const char *hay, size_t hay_len, const char *needle, size_t needle_len)
+{
+    if (needle_len > hay_len) return NULL;
+    const char *end = hay + hay_len - needle_len;
+    for (const char *p = hay; p <= end; p++) {
+        p = memchr(p, needle[0], end - p + 1);
+        if (!p) return NULL;
+        if (memcmp(p, needle, needle_len) == 0) return p;
+    }
+    return NULL;
+}
+
+/*
+ * Copy in to out replacing old_str, one MIMI_FILE_EDIT_CHUNK at a time. The last
+ * old_len-1 bytes of each window are carried over so matches across chunk
+ * boundaries are found. Returns the number of replacements, or -1 on I/O error.
+ */
+static int edit_stream(FILE *in, FILE *out, char *buf,
+                       const char *old_str, size_t old_len,
+                       const char *new_str, size_t new_len, bool replace_all)
+{
+    int count = 0;
+    size_t have = 0;
+    bool ok = true;
+
+    while (ok) {
+        size_t n = fread(buf + have, 1, MIMI_FILE_EDIT_CHUNK, in);
+        have += n;
+
+        size_t pos = 0;
+        const char *m;
+        while ((replace_all || count == 0) &&
+               (m = find_bytes(buf + pos, have - pos, old_str, old_len)) != NULL) {
+            size_t at = m - buf;
+            ok = ok && fwrite(buf + pos, 1, at - pos, out) == at - pos;
+            ok = ok && fwrite(new_str, 1, new_len, out) == new_len;
+            pos = at + old_len;
+            count++;
+        }
+
+        if (n == 0) {
+            ok = ok && fwrite(buf + pos, 1, have - pos, out) == have - pos;
+            break;
+        }
+
+        /* A match may still start in the tail of this window */
+        size_t keep = (replace_all || count == 0) ? old_len - 1 : 0;
+        if (keep > have - pos) keep = have - pos;
+        size_t flush = have - pos - keep;
+        ok = ok && fwrite(buf + pos, 1, flush, out) == flush;
+        memmove(buf, buf + have - keep, keep);
+        have = keep;
+    }
+
+    return ok ? count : -1;
+}
+
 esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t output_size)
 {
     cJSON *root = cJSON_Parse(input_json);
@@ -126,9 +313,11 @@ esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t ou
     const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
     const char *old_str = cJSON_GetStringValue(cJSON_GetObjectItem(root, "old_string"));
     const char *new_str = cJSON_GetStringValue(cJSON_GetObjectItem(root, "new_string"));
+    bool replace_all = cJSON_IsTrue(cJSON_GetObjectItem(root, "replace_all"));
 
     if (!validate_path(path)) {
-        snprintf(output, output_size, "Error: path must start with %s/ and must not contain '..'", MIMI_SPIFFS_BASE);
+        snprintf(output, output_size, "Error: path must start with %s/, must not contain '..' "
+                 "and must not be under %s", MIMI_SPIFFS_BASE, MIMI_TOOL_MANIFEST_PREFIX);
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
@@ -138,84 +327,94 @@ esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t ou
         return ESP_ERR_INVALID_ARG;
     }
 
-    /* Read existing file */
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        snprintf(output, output_size, "Error: file not found: %s", path);
+    size_t old_len = strlen(old_str);
+    size_t new_len = strlen(new_str);
+    if (old_len == 0 || old_len > MIMI_FILE_EDIT_CHUNK) {
+        snprintf(output, output_size, "Error: old_string must be 1-%d bytes", MIMI_FILE_EDIT_CHUNK);
         cJSON_Delete(root);
-        return ESP_ERR_NOT_FOUND;
+        return ESP_ERR_INVALID_ARG;
     }
 
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (file_size <= 0 || file_size > MAX_FILE_SIZE) {
-        snprintf(output, output_size, "Error: file too large or empty (%ld bytes)", file_size);
-        fclose(f);
+    char tmp[160];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+        snprintf(output, output_size, "Error: path too long");
         cJSON_Delete(root);
-        return ESP_ERR_INVALID_SIZE;
+        return ESP_ERR_INVALID_ARG;
     }
 
-    /* Allocate buffer for the result (old content + possible expansion) */
-    size_t old_len = strlen(old_str);
-    size_t new_len = strlen(new_str);
-    size_t max_result = file_size + (new_len > old_len ? new_len - old_len : 0) + 1;
-    char *buf = malloc(file_size + 1);
-    char *result = malloc(max_result);
-    if (!buf || !result) {
-        free(buf);
-        free(result);
-        fclose(f);
-        snprintf(output, output_size, "Error: out of memory");
+    /* Read existing file */
+    write_behind_sync(path);
+    lzfile_restore(path);
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        snprintf(output, output_size, "Error: file not found: %s", path);
         cJSON_Delete(root);
-        return ESP_ERR_NO_MEM;
+        return ESP_ERR_NOT_FOUND;
     }
 
-    size_t n = fread(buf, 1, file_size, f);
-    buf[n] = '\0';
-    fclose(f);
-
-    /* Find and replace first occurrence */
-    char *pos = strstr(buf, old_str);
-    if (!pos) {
-        snprintf(output, output_size, "Error: old_string not found in %s", path);
+    char *buf = heap_caps_malloc(MIMI_FILE_EDIT_CHUNK + old_len, MALLOC_CAP_SPIRAM);
+    FILE *out = buf ? fopen(tmp, "w") : NULL;
+    if (!out) {
+        fclose(in);
+        snprintf(output, output_size, buf ? "Error: cannot open file for writing: %s" : "Error: out of memory", tmp);
         free(buf);
-        free(result);
         cJSON_Delete(root);
-        return ESP_ERR_NOT_FOUND;
+        return buf ? ESP_FAIL : ESP_ERR_NO_MEM;
     }
 
-    size_t prefix_len = pos - buf;
-    memcpy(result, buf, prefix_len);
-    memcpy(result + prefix_len, new_str, new_len);
-    size_t suffix_start = prefix_len + old_len;
-    size_t suffix_len = n - suffix_start;
-    memcpy(result + prefix_len + new_len, buf + suffix_start, suffix_len);
-    size_t total = prefix_len + new_len + suffix_len;
-    result[total] = '\0';
-
+    int count = edit_stream(in, out, buf, old_str, old_len, new_str, new_len, replace_all);
+    fclose(in);
+    if (fclose(out) != 0) count = -1;
     free(buf);
 
-    /* Write back */
-    f = fopen(path, "w");
-    if (!f) {
-        snprintf(output, output_size, "Error: cannot open file for writing: %s", path);
-        free(result);
+    if (count <= 0) {
+        remove(tmp);
+        if (count == 0) {
+            snprintf(output, output_size, "Error: old_string not found in %s", path);
+        } else {
+            snprintf(output, output_size, "Error: write failed, %s left unchanged", path);
+        }
+        cJSON_Delete(root);
+        return count == 0 ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+    }
+
+    /* Swap in the edited copy; a power loss mid-swap is undone by tool_files_init */
+    esp_err_t rc = lzfile_replace(tmp, path);
+    fs_catalog_update(tmp);
+    fs_catalog_update(path);
+    if (rc != ESP_OK) {
+        snprintf(output, output_size, "Error: cannot replace %s (edited copy kept at %s)", path, tmp);
         cJSON_Delete(root);
         return ESP_FAIL;
     }
 
-    fwrite(result, 1, total, f);
-    fclose(f);
-    free(result);
+    memory_index_update_file(path);
 
-    snprintf(output, output_size, "OK: edited %s (replaced %d bytes with %d bytes)", path, (int)old_len, (int)new_len);
-    ESP_LOGI(TAG, "edit_file: %s", path);
+    snprintf(output, output_size, "OK: edited %s (%d replacement%s of %d bytes with %d bytes)",
+             path, count, count == 1 ? "" : "s", (int)old_len, (int)new_len);
+    ESP_LOGI(TAG, "edit_file: %s (%d replacements)", path, count);
     cJSON_Delete(root);
     return ESP_OK;
 }
 
+void tool_files_init(void)
+{
+    /* edit_file leaves "<path>.tmp" if power is lost before the swap completes;
+     * compressed files recover their own ".lz.tmp" when opened */
+    fs_entry_t ent;
+    for (int i = 0; fs_catalog_query(MIMI_SPIFFS_BASE "/", i, &ent, 1) == 1; i++) {
+        size_t len = strlen(ent.path);
+        if (len < 5 || strcmp(ent.path + len - 4, ".tmp") != 0) continue;
+        if (len >= 7 && strcmp(ent.path + len - 7, ".lz.tmp") == 0) continue;
+
+        char path[sizeof(ent.path)];
+        snprintf(path, sizeof(path), "%.*s", (int)(len - 4), ent.path);
+        lzfile_recover_tmp(ent.path, path);
+        if (!fs_catalog_stat(ent.path, NULL)) i--;   /* the .tmp left the catalog */
+        memory_index_update_file(path);
+    }
+}
+
 /* ── list_dir ──────────────────────────────────────────────── */
 
 esp_err_t tool_list_dir_execute(const char *input_json, char *output, size_t output_size)
@@ -229,32 +428,26 @@ esp_err_t tool_list_dir_execute(const char *input_json, char *output, size_t out
         }
     }
 
-    DIR *dir = opendir(MIMI_SPIFFS_BASE);
-    if (!dir) {
-        snprintf(output, output_size, "Error: cannot open %s directory", MIMI_SPIFFS_BASE);
-        cJSON_Delete(root);
-        return ESP_FAIL;
-    }
-
+    /* Answered from the in-memory file catalog */
     size_t off = 0;
-    struct dirent *ent;
-    int count = 0;
-
-    while ((ent = readdir(dir)) != NULL && off < output_size - 1) {
-        /* Build full path: SPIFFS entries are just filenames with embedded slashes */
-        char full_path[512];
-        snprintf(full_path, sizeof(full_path), "%s/%s", MIMI_SPIFFS_BASE, ent->d_name);
-
-        if (prefix && strncmp(full_path, prefix, strlen(prefix)) != 0) {
-            continue;
+    int count = 0, n;
+    bool full = false;
+    fs_entry_t ents[8];
+    output[0] = '\0';
+    while (!full && (n = fs_catalog_query(prefix ? prefix : MIMI_SPIFFS_BASE "/", count, ents, 8)) > 0) {
+        for (int i = 0; i < n; i++) {
+            int len = snprintf(output + off, output_size - off, "%s (%u bytes)\n",
+                               ents[i].path, (unsigned)ents[i].size);
+            if (len < 0 || off + len >= output_size) {
+                output[off] = '\0';
+                full = true;
+                break;
+            }
+            off += len;
+            count++;
         }
-
-        off += snprintf(output + off, output_size - off, "%s\n", full_path);
-        count++;
     }
 
-    closedir(dir);
-
     if (count == 0) {
         snprintf(output, output_size, "(no files found)");
     }
@@ -4,23 +4,34 @@
 #include <stddef.h>
 
 /**
- * Read a file from SPIFFS.
- * Input JSON: {"path": "<MIMI_SPIFFS_BASE>/..."}
+ * Read a file, or a byte/line range of it. Compressed files ("x.md" stored
+ * as "x.md.lz") are read transparently. Output that does not cover the
+ * whole file ends with a "[bytes a-b of n; next offset=b]" style note.
+ * Input JSON: {"path": "<MIMI_SPIFFS_BASE>/...", "offset": 0, "length": 4096}
+ *          or {"path": "...", "start_line": 1, "end_line": 50}
  */
 esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t output_size);
 
 /**
- * Write/overwrite a file on SPIFFS.
- * Input JSON: {"path": "<MIMI_SPIFFS_BASE>/...", "content": "..."}
+ * Write/overwrite a file, or append to it.
+ * Input JSON: {"path": "<MIMI_SPIFFS_BASE>/...", "content": "...", "mode": "overwrite"|"append"}
  */
 esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t output_size);
 
 /**
- * Find-and-replace edit a file on SPIFFS.
- * Input JSON: {"path": "<MIMI_SPIFFS_BASE>/...", "old_string": "...", "new_string": "..."}
+ * Find-and-replace edit a file. Streams through the file in MIMI_FILE_EDIT_CHUNK
+ * pieces into "<path>.tmp" and renames it over the original (rename first;
+ * remove + rename only where the filesystem cannot replace a file).
+ * Input JSON: {"path": "<MIMI_SPIFFS_BASE>/...", "old_string": "...", "new_string": "...", "replace_all": false}
  */
 esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t output_size);
 
+/**
+ * Finish edits cut short by a power loss: a leftover "<path>.tmp" becomes
+ * path if path is missing, otherwise it is removed. Call once at boot.
+ */
+void tool_files_init(void);
+
 /**
  * List files on SPIFFS, optionally filtered by path prefix.
  * Input JSON: {"prefix": "<MIMI_SPIFFS_BASE>/..."} (prefix is optional)
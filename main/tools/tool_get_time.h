@@ -5,6 +5,7 @@
 
 /**
  * Execute get_current_time tool.
- * Fetches current time via HTTP Date header, sets system clock, returns time string.
+ * Answers from the system clock kept by time_sync; falls back to a one-off
+ * HTTP Date fetch only if the clock was never set.
  */
 esp_err_t tool_get_time_execute(const char *input_json, char *output, size_t output_size);
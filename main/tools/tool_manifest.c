@@ -0,0 +1,573 @@
+#include "tool_manifest.h"
+#include "tool_registry.h"
+#include "mimi_config.h"
+#include "storage/fs_catalog.h"
+#include "llm/llm_proxy.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+
+static const char *TAG = "tool_manifest";
+
+#define MANIFEST_NAME_MAX       MIMI_TOOL_NAME_MAX
+#define MANIFEST_ENDPOINTS_MAX  8
+#define MANIFEST_HINTS_MAX      128
+#define MANIFEST_TRUNC_NOTE     "\n[... truncated]"
+
+/* One configured endpoint from endpoints.json */
+typedef struct {
+    char name[32];
+    char url[MIMI_TOOL_HTTP_URL_MAX];          /* base, no trailing '/' */
+    char headers[MIMI_TOOL_HTTP_HEADERS_MAX];  /* "Name: value\n" lines */
+} endpoint_t;
+
+/*
+ * Everything a call needs, flat so the registry can copy it. The URL still
+ * holds the {field} placeholders; they are filled in per call.
+ */
+typedef struct {
+    esp_http_client_method_t method;
+    char url[MIMI_TOOL_HTTP_URL_MAX];
+    char headers[MIMI_TOOL_HTTP_HEADERS_MAX];
+    bool send_input;                           /* input JSON as the request body */
+    int timeout_ms;
+} http_tool_def_t;
+
+/* Names registered by the last load, to drop tools whose manifest is gone */
+static char s_loaded[MIMI_TOOL_MANIFEST_MAX][MANIFEST_NAME_MAX + 1];
+static int s_loaded_count = 0;
+
+/* ── HTTP call ────────────────────────────────────────────────── */
+
+static bool is_unreserved(char c)
+{
+    return isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~';
+}
+
+/* Append s to out at *off, percent-encoding everything but unreserved bytes */
+static bool url_encode_append(char *out, size_t size, size_t *off, const char *s)
+{
+    static const char HEX[] = "0123456789ABCDEF";
+    for (; *s; s++) {
+        if (is_unreserved(*s)) {
+            if (*off + 1 >= size) return false;
+            out[(*off)++] = *s;
+        } else {
+            if (*off + 3 >= size) return false;
+            out[(*off)++] = '%';
+            out[(*off)++] = HEX[(uint8_t)*s >> 4];
+            out[(*off)++] = HEX[(uint8_t)*s & 0x0F];
+        }
+    }
+    out[*off] = '\0';
+    return true;
+}
+
+/*
+ * Replace each {field} in the template with the URL-encoded input value.
+ * On failure the message is written to err.
+ */
+static bool expand_url(const char *tmpl, const cJSON *input, char *out, size_t size,
+                       char *err, size_t err_size)
+{
+    size_t off = 0;
+    out[0] = '\0';
+    for (const char *p = tmpl; *p; ) {
+        const char *close = (*p == '{') ? strchr(p, '}') : NULL;
+        if (!close) {
+            if (off + 1 >= size) goto too_long;
+            out[off++] = *p++;
+            out[off] = '\0';
+            continue;
+        }
+
+        char field[MANIFEST_NAME_MAX + 1];
+        size_t flen = close - p - 1;
+        if (flen == 0 || flen >= sizeof(field)) {
+            snprintf(err, err_size, "Error: bad placeholder in endpoint URL");
+            return false;
+        }
+        memcpy(field, p + 1, flen);
+        field[flen] = '\0';
+        p = close + 1;
+
+        const cJSON *item = input ? cJSON_GetObjectItem(input, field) : NULL;
+        char num[32];
+        const char *value = NULL;
+        if (cJSON_IsString(item)) {
+            value = item->valuestring;
+        } else if (cJSON_IsNumber(item)) {
+            snprintf(num, sizeof(num), "%.15g", item->valuedouble);
+            value = num;
+        } else if (cJSON_IsBool(item)) {
+            value = cJSON_IsTrue(item) ? "true" : "false";
+        }
+        if (!value) {
+            snprintf(err, err_size, "Error: '%s' is required", field);
+            return false;
+        }
+        if (!url_encode_append(out, size, &off, value)) goto too_long;
+    }
+    return true;
+
+too_long:
+    snprintf(err, err_size, "Error: request URL too long (max %d)", MIMI_TOOL_HTTP_URL_MAX - 1);
+    return false;
+}
+
+/* Set the "Name: value\n" lines kept for the endpoint */
+static void set_headers(esp_http_client_handle_t client, const char *headers)
+{
+    char line[MIMI_TOOL_HTTP_HEADERS_MAX];
+    while (*headers) {
+        size_t n = strcspn(headers, "\n");
+        if (n < sizeof(line)) {
+            memcpy(line, headers, n);
+            line[n] = '\0';
+            char *colon = strchr(line, ':');
+            if (colon) {
+                *colon = '\0';
+                char *value = colon + 1;
+                while (*value == ' ') value++;
+                esp_http_client_set_header(client, line, value);
+            }
+        }
+        headers += n;
+        if (*headers == '\n') headers++;
+    }
+}
+
+static esp_err_t http_tool_execute(const void *ctx, const char *input_json,
+                                   char *output, size_t output_size)
+{
+    const http_tool_def_t *def = ctx;
+
+    cJSON *input = cJSON_Parse(input_json);
+    if (!input && def->send_input) {
+        snprintf(output, output_size, "Error: Invalid input JSON");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char url[MIMI_TOOL_HTTP_URL_MAX];
+    bool ok = expand_url(def->url, input, url, sizeof(url), output, output_size);
+    cJSON_Delete(input);
+    if (!ok) return ESP_ERR_INVALID_ARG;
+
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = def->method,
+        .timeout_ms = def->timeout_ms,
+        .buffer_size = 1024,
+        .user_agent = MIMI_WEB_FETCH_USER_AGENT,
+        .disable_auto_redirect = true,         /* stay on the configured host */
+        .crt_bundle_attach = esp_crt_bundle_attach,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+        snprintf(output, output_size, "Error: Cannot create HTTP client");
+        return ESP_FAIL;
+    }
+
+    set_headers(client, def->headers);
+    int body_len = 0;
+    if (def->send_input) {
+        esp_http_client_set_header(client, "Content-Type", "application/json");
+        body_len = strlen(input_json);
+    }
+
+    int status = 0;
+    esp_err_t err = esp_http_client_open(client, body_len);
+    if (err == ESP_OK && body_len > 0 && esp_http_client_write(client, input_json, body_len) != body_len) {
+        err = ESP_ERR_HTTP_WRITE_DATA;
+    }
+    if (err == ESP_OK && esp_http_client_fetch_headers(client) < 0) {
+        err = ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    if (err != ESP_OK) {
+        esp_http_client_cleanup(client);
+        ESP_LOGW(TAG, "%s failed: %s", url, esp_err_to_name(err));
+        snprintf(output, output_size, "Error: Request failed (%s)", esp_err_to_name(err));
+        return err;
+    }
+    status = esp_http_client_get_status_code(client);
+
+    /* "HTTP <status>" line, then as much of the body as fits */
+    size_t reserve = sizeof(MANIFEST_TRUNC_NOTE);
+    size_t off = snprintf(output, output_size, "HTTP %d\n", status);
+    size_t limit = output_size > off + reserve ? output_size - reserve : off;
+    bool truncated = false;
+    while (1) {
+        if (off >= limit) {
+            char probe;
+            truncated = esp_http_client_read(client, &probe, 1) > 0;
+            break;
+        }
+        int n = esp_http_client_read(client, output + off, limit - off);
+        if (n <= 0) break;
+        off += n;
+    }
+    output[off < output_size ? off : output_size - 1] = '\0';
+    if (truncated) snprintf(output + off, output_size - off, "%s", MANIFEST_TRUNC_NOTE);
+
+    esp_http_client_cleanup(client);
+    ESP_LOGI(TAG, "%s -> HTTP %d, %d bytes", url, status, (int)off);
+    return (status >= 200 && status < 300) ? ESP_OK : ESP_FAIL;
+}
+
+/* ── Loading ──────────────────────────────────────────────────── */
+
+/* Whole small file into a PSRAM buffer; NULL if missing or too large */
+static char *read_small_file(const char *path, size_t max)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (fsize <= 0 || (size_t)fsize > max) {
+        ESP_LOGW(TAG, "%s: size %ld not in 1..%u", path, fsize, (unsigned)max);
+        fclose(f);
+        return NULL;
+    }
+
+    char *buf = heap_caps_malloc(fsize + 1, MALLOC_CAP_SPIRAM);
+    if (buf) {
+        size_t n = fread(buf, 1, fsize, f);
+        buf[n] = '\0';
+    }
+    fclose(f);
+    return buf;
+}
+
+/* Dotted-quad IPv4 literal in a loopback, private or link-local range */
+static bool is_local_ipv4(const char *host)
+{
+    unsigned a, b, c, d;
+    char end;
+    if (sscanf(host, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4) return false;
+    if (a > 255 || b > 255 || c > 255 || d > 255) return false;
+    return a == 127 || a == 10 || (a == 172 && b >= 16 && b <= 31) ||
+           (a == 192 && b == 168) || (a == 169 && b == 254);
+}
+
+/*
+ * Endpoints must be http(s) URLs on the local network: localhost, an mDNS
+ * name (*.local) or a private IPv4 address. No userinfo ("user@host").
+ */
+static bool is_local_url(const char *url)
+{
+    const char *h;
+    if (strncasecmp(url, "http://", 7) == 0) h = url + 7;
+    else if (strncasecmp(url, "https://", 8) == 0) h = url + 8;
+    else return false;
+
+    size_t alen = strcspn(h, "/?#");
+    if (memchr(h, '@', alen)) return false;
+
+    char host[64];
+    size_t hlen = strcspn(h, ":/?#");
+    if (hlen == 0 || hlen >= sizeof(host)) return false;
+    memcpy(host, h, hlen);
+    host[hlen] = '\0';
+
+    if (strcasecmp(host, "localhost") == 0 || is_local_ipv4(host)) return true;
+    return hlen > 6 && strcasecmp(host + hlen - 6, ".local") == 0;
+}
+
+/*
+ * endpoints.json: {"name": "http://host:port/base", ...}, or an object
+ * {"url": ..., "headers": {"Authorization": "..."}} for a value.
+ */
+static int load_endpoints(endpoint_t *eps, int max)
+{
+    char *buf = read_small_file(MIMI_TOOL_ENDPOINTS_FILE, MIMI_TOOL_MANIFEST_MAX_SIZE);
+    if (!buf) {
+        ESP_LOGI(TAG, "No %s, manifest tools disabled", MIMI_TOOL_ENDPOINTS_FILE);
+        return 0;
+    }
+    cJSON *root = cJSON_Parse(buf);
+    free(buf);
+    if (!cJSON_IsObject(root)) {
+        ESP_LOGW(TAG, "%s: not a JSON object", MIMI_TOOL_ENDPOINTS_FILE);
+        cJSON_Delete(root);
+        return 0;
+    }
+
+    int count = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, root) {
+        if (count == max) {
+            ESP_LOGW(TAG, "More than %d endpoints, rest ignored", max);
+            break;
+        }
+        cJSON *url = cJSON_IsObject(item) ? cJSON_GetObjectItem(item, "url") : item;
+        if (!cJSON_IsString(url) || !is_local_url(url->valuestring) ||
+            strlen(url->valuestring) >= sizeof(eps->url) || strlen(item->string) >= sizeof(eps->name)) {
+            ESP_LOGW(TAG, "Endpoint '%s': needs an http(s) URL on the local network", item->string);
+            continue;
+        }
+
+        endpoint_t *ep = &eps[count];
+        memset(ep, 0, sizeof(*ep));
+        strcpy(ep->name, item->string);
+        strcpy(ep->url, url->valuestring);
+        size_t len = strlen(ep->url);
+        while (len > 0 && ep->url[len - 1] == '/') ep->url[--len] = '\0';
+
+        cJSON *headers = cJSON_IsObject(item) ? cJSON_GetObjectItem(item, "headers") : NULL;
+        cJSON *h;
+        size_t off = 0;
+        cJSON_ArrayForEach(h, headers) {
+            if (!cJSON_IsString(h) || strpbrk(h->string, ":\r\n") || strpbrk(h->valuestring, "\r\n")) continue;
+            int n = snprintf(ep->headers + off, sizeof(ep->headers) - off, "%s: %s\n",
+                             h->string, h->valuestring);
+            if (n < 0 || (size_t)n >= sizeof(ep->headers) - off) {
+                ep->headers[off] = '\0';
+                ESP_LOGW(TAG, "Endpoint '%s': headers too long, rest dropped", ep->name);
+                break;
+            }
+            off += n;
+        }
+        count++;
+    }
+    cJSON_Delete(root);
+    return count;
+}
+
+/* The model calls a tool back by name; a cut-off name would be "unknown" */
+_Static_assert(MANIFEST_NAME_MAX < sizeof(((llm_tool_call_t *)0)->name),
+               "manifest tool names must fit llm_tool_call_t.name");
+
+static bool valid_name(const char *name)
+{
+    size_t len = strlen(name);
+    if (len == 0 || len > MANIFEST_NAME_MAX) return false;
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_' && name[i] != '-') return false;
+    }
+    return true;
+}
+
+static uint32_t parse_group(const cJSON *group)
+{
+    static const struct { const char *name; uint32_t bit; } GROUPS[] = {
+        { "core", TOOL_GROUP_CORE }, { "files", TOOL_GROUP_FILES }, { "memory", TOOL_GROUP_MEMORY },
+        { "web", TOOL_GROUP_WEB },   { "cron", TOOL_GROUP_CRON },
+    };
+    if (!cJSON_IsString(group)) return TOOL_GROUP_CORE;
+    for (size_t i = 0; i < sizeof(GROUPS) / sizeof(GROUPS[0]); i++) {
+        if (strcasecmp(group->valuestring, GROUPS[i].name) == 0) return GROUPS[i].bit;
+    }
+    return 0;
+}
+
+static bool parse_method(const char *s, esp_http_client_method_t *method)
+{
+    static const struct { const char *name; esp_http_client_method_t m; } METHODS[] = {
+        { "GET", HTTP_METHOD_GET },     { "POST", HTTP_METHOD_POST },
+        { "PUT", HTTP_METHOD_PUT },     { "PATCH", HTTP_METHOD_PATCH },
+        { "DELETE", HTTP_METHOD_DELETE },
+    };
+    for (size_t i = 0; i < sizeof(METHODS) / sizeof(METHODS[0]); i++) {
+        if (strcasecmp(s, METHODS[i].name) == 0) {
+            *method = METHODS[i].m;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Parse one manifest and register its tool; the name goes to name_out.
+ *
+ *   {"name": "lights_set", "description": "...", "input_schema": {...},
+ *    "group": "core", "hints": ["light", "lamp"],
+ *    "http": {"endpoint": "home", "path": "/lights/{room}", "method": "POST",
+ *             "body": "input", "timeout_ms": 5000}}
+ */
+static esp_err_t load_manifest(const char *path, const endpoint_t *eps, int ep_count,
+                               char *name_out)
+{
+    char *buf = read_small_file(path, MIMI_TOOL_MANIFEST_MAX_SIZE);
+    if (!buf) return ESP_ERR_INVALID_SIZE;
+    cJSON *root = cJSON_Parse(buf);
+    free(buf);
+    if (!cJSON_IsObject(root)) {
+        ESP_LOGW(TAG, "%s: invalid JSON", path);
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+    char *schema = NULL;
+    cJSON *name = cJSON_GetObjectItem(root, "name");
+    cJSON *desc = cJSON_GetObjectItem(root, "description");
+    cJSON *summary = cJSON_GetObjectItem(root, "summary");
+    cJSON *input_schema = cJSON_GetObjectItem(root, "input_schema");
+    cJSON *http = cJSON_GetObjectItem(root, "http");
+    cJSON *endpoint = cJSON_GetObjectItem(http, "endpoint");
+    cJSON *req_path = cJSON_GetObjectItem(http, "path");
+    cJSON *method = cJSON_GetObjectItem(http, "method");
+    cJSON *body = cJSON_GetObjectItem(http, "body");
+    cJSON *timeout = cJSON_GetObjectItem(http, "timeout_ms");
+    uint32_t group = parse_group(cJSON_GetObjectItem(root, "group"));
+
+    if (!cJSON_IsString(name) || !valid_name(name->valuestring)) {
+        ESP_LOGW(TAG, "%s: 'name' must match [A-Za-z0-9_-]{1,%d}", path, MANIFEST_NAME_MAX);
+        goto done;
+    }
+    if (!cJSON_IsString(desc) || !desc->valuestring[0]) {
+        ESP_LOGW(TAG, "%s: 'description' is required", path);
+        goto done;
+    }
+    if (input_schema && !cJSON_IsObject(input_schema)) {
+        ESP_LOGW(TAG, "%s: 'input_schema' must be an object", path);
+        goto done;
+    }
+    if (!group) {
+        ESP_LOGW(TAG, "%s: unknown 'group'", path);
+        goto done;
+    }
+    if (!cJSON_IsString(endpoint) || !cJSON_IsString(req_path) || req_path->valuestring[0] != '/') {
+        ESP_LOGW(TAG, "%s: 'http' needs an endpoint and a path starting with '/'", path);
+        goto done;
+    }
+
+    const endpoint_t *ep = NULL;
+    for (int i = 0; i < ep_count; i++) {
+        if (strcmp(eps[i].name, endpoint->valuestring) == 0) ep = &eps[i];
+    }
+    if (!ep) {
+        ESP_LOGW(TAG, "%s: endpoint '%s' is not in %s", path, endpoint->valuestring, MIMI_TOOL_ENDPOINTS_FILE);
+        goto done;
+    }
+
+    http_tool_def_t def = {
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = cJSON_IsNumber(timeout) && timeout->valueint > 0 ? timeout->valueint
+                                                                      : MIMI_TOOL_HTTP_TIMEOUT_MS,
+    };
+    if (method && (!cJSON_IsString(method) || !parse_method(method->valuestring, &def.method))) {
+        ESP_LOGW(TAG, "%s: 'method' must be GET, POST, PUT, PATCH or DELETE", path);
+        goto done;
+    }
+    def.send_input = def.method == HTTP_METHOD_POST || def.method == HTTP_METHOD_PUT ||
+                     def.method == HTTP_METHOD_PATCH;
+    if (cJSON_IsString(body)) def.send_input = strcmp(body->valuestring, "input") == 0;
+    if (snprintf(def.url, sizeof(def.url), "%s%s", ep->url, req_path->valuestring) >= (int)sizeof(def.url)) {
+        ESP_LOGW(TAG, "%s: URL too long", path);
+        goto done;
+    }
+    strcpy(def.headers, ep->headers);
+
+    char hints[MANIFEST_HINTS_MAX] = "";
+    size_t hoff = 0;
+    cJSON *hint;
+    cJSON_ArrayForEach(hint, cJSON_GetObjectItem(root, "hints")) {
+        if (!cJSON_IsString(hint) || !hint->valuestring[0] || strchr(hint->valuestring, ',')) continue;
+        int n = snprintf(hints + hoff, sizeof(hints) - hoff, "%s%s", hoff ? "," : "", hint->valuestring);
+        if (n < 0 || (size_t)n >= sizeof(hints) - hoff) {
+            hints[hoff] = '\0';
+            break;
+        }
+        hoff += n;
+    }
+
+    if (input_schema) {
+        char *printed = cJSON_PrintUnformatted(input_schema);
+        schema = printed ? strdup(printed) : NULL;
+        cJSON_free(printed);
+        if (!schema) {
+            err = ESP_ERR_NO_MEM;
+            goto done;
+        }
+    }
+
+    mimi_tool_t tool = {
+        .name = name->valuestring,
+        .description = desc->valuestring,
+        .summary = cJSON_IsString(summary) ? summary->valuestring : NULL,
+        .input_schema_json = schema ? schema : "{\"type\":\"object\",\"properties\":{}}",
+        .group = group,
+        .hints = hints[0] ? hints : NULL,
+        .execute_ctx = http_tool_execute,
+        .ctx = &def,
+        .ctx_size = sizeof(def),
+    };
+    err = tool_registry_register(&tool);
+    if (err == ESP_OK) strcpy(name_out, name->valuestring);
+
+done:
+    free(schema);
+    cJSON_Delete(root);
+    return err;
+}
+
+/* ── Public API ───────────────────────────────────────────────── */
+
+static bool name_in(const char names[][MANIFEST_NAME_MAX + 1], int count, const char *name)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return true;
+    }
+    return false;
+}
+
+int tool_manifest_reload(void)
+{
+    endpoint_t *eps = heap_caps_calloc(MANIFEST_ENDPOINTS_MAX, sizeof(endpoint_t), MALLOC_CAP_SPIRAM);
+    if (!eps) return 0;
+    int ep_count = load_endpoints(eps, MANIFEST_ENDPOINTS_MAX);
+
+    static char loaded[MIMI_TOOL_MANIFEST_MAX][MANIFEST_NAME_MAX + 1];
+    int count = 0;
+
+    fs_entry_t ents[8];
+    int skip = 0, n;
+    const char *endpoints_name = MIMI_TOOL_ENDPOINTS_FILE + strlen(MIMI_TOOL_MANIFEST_PREFIX);
+    while (ep_count > 0 && (n = fs_catalog_query(MIMI_TOOL_MANIFEST_PREFIX, skip, ents, 8)) > 0) {
+        skip += n;
+        for (int i = 0; i < n; i++) {
+            const char *file = ents[i].path + strlen(MIMI_TOOL_MANIFEST_PREFIX);
+            size_t len = strlen(file);
+            if (strchr(file, '/') || len < 6 || strcmp(file + len - 5, ".json") != 0) continue;
+            if (strcmp(file, endpoints_name) == 0) continue;
+            if (count == MIMI_TOOL_MANIFEST_MAX) {
+                ESP_LOGW(TAG, "More than %d manifests, %s ignored", MIMI_TOOL_MANIFEST_MAX, file);
+                continue;
+            }
+
+            char name[MANIFEST_NAME_MAX + 1];
+            if (load_manifest(ents[i].path, eps, ep_count, name) == ESP_OK &&
+                !name_in(loaded, count, name)) {
+                strcpy(loaded[count++], name);
+            }
+        }
+    }
+    free(eps);
+
+    /* Tools whose manifest was removed or no longer loads */
+    for (int i = 0; i < s_loaded_count; i++) {
+        if (!name_in(loaded, count, s_loaded[i])) tool_registry_unregister(s_loaded[i]);
+    }
+    memcpy(s_loaded, loaded, sizeof(loaded));
+    s_loaded_count = count;
+
+    ESP_LOGI(TAG, "%d manifest tools from %s (%d endpoints)", count, MIMI_TOOL_MANIFEST_PREFIX, ep_count);
+    return count;
+}
+
+esp_err_t tool_manifest_init(void)
+{
+    tool_manifest_reload();
+    return ESP_OK;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "esp_err.h"
+
+/**
+ * Tools defined by JSON manifests in MIMI_TOOL_MANIFEST_PREFIX.
+ *
+ * Each /spiffs/tools/<name>.json describes one tool (name, description,
+ * input schema, group, hints) and the HTTP request it makes against an
+ * endpoint named in /spiffs/tools/endpoints.json. Endpoints must be on the
+ * local network (localhost, *.local, private IPv4) and are called directly,
+ * never through the proxy, without following redirects. The file tools
+ * refuse paths under MIMI_TOOL_MANIFEST_PREFIX, so only the operator
+ * (through the flashed filesystem image) can add tools or see endpoint headers.
+ * Manifests are read at boot and on tool_manifest_reload().
+ */
+
+/**
+ * Load the manifests present at boot. Bad manifests are logged and skipped.
+ */
+esp_err_t tool_manifest_init(void);
+
+/**
+ * Read endpoints.json and the manifests again: new and changed tools are
+ * (re)registered, tools whose manifest is gone are unregistered.
+ *
+ * @return number of manifest tools registered
+ */
+int tool_manifest_reload(void);
@@ -0,0 +1,154 @@
+#include "tools/tool_memory.h"
+#include "memory/memory_index.h"
+#include "memory/fact_store.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "cJSON.h"
+
+static const char *TAG = "tool_memory";
+
+#define SEARCH_DEFAULT_LIMIT  5
+#define SEARCH_MAX_LIMIT      8
+
+/* ── memory_search ────────────────────────────────────────────── */
+
+esp_err_t tool_memory_search_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *query = cJSON_GetStringValue(cJSON_GetObjectItem(root, "query"));
+    if (!query || !query[0]) {
+        snprintf(output, output_size, "Error: missing 'query' field");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int limit = SEARCH_DEFAULT_LIMIT;
+    cJSON *lim = cJSON_GetObjectItem(root, "limit");
+    if (cJSON_IsNumber(lim) && lim->valueint > 0) {
+        limit = lim->valueint > SEARCH_MAX_LIMIT ? SEARCH_MAX_LIMIT : lim->valueint;
+    }
+
+    memidx_hit_t hits[SEARCH_MAX_LIMIT];
+    int n = memory_index_search(query, hits, limit);
+    if (n == 0) {
+        snprintf(output, output_size, "No memory matches for: %s", query);
+        ESP_LOGI(TAG, "memory_search: '%s' -> 0 hits", query);
+        cJSON_Delete(root);
+        return ESP_OK;
+    }
+
+    size_t off = 0;
+    for (int i = 0; i < n && off < output_size - 1; i++) {
+        off += snprintf(output + off, output_size - off, "%s[%d] %s @%u (score %.2f)\n",
+                        i ? "\n" : "", i + 1, hits[i].path, (unsigned)hits[i].offset, hits[i].score);
+        if (off >= output_size - 1) break;
+        off += memory_index_read_hit(&hits[i], output + off, output_size - off);
+        if (off < output_size - 1) {
+            output[off++] = '\n';
+            output[off] = '\0';
+        }
+    }
+
+    ESP_LOGI(TAG, "memory_search: '%s' -> %d hits", query, n);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+/* ── memory_upsert ────────────────────────────────────────────── */
+
+esp_err_t tool_memory_upsert_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *key = cJSON_GetStringValue(cJSON_GetObjectItem(root, "key"));
+    const char *value = cJSON_GetStringValue(cJSON_GetObjectItem(root, "value"));
+    const char *category = cJSON_GetStringValue(cJSON_GetObjectItem(root, "category"));
+
+    bool created = false;
+    esp_err_t err = fact_upsert(key, category, value, &created);
+    if (err == ESP_OK) {
+        snprintf(output, output_size, "OK: %s %s", created ? "saved" : "updated", key);
+        ESP_LOGI(TAG, "memory_upsert: %s (%s)", key, created ? "new" : "update");
+    } else if (err == ESP_ERR_INVALID_ARG) {
+        snprintf(output, output_size,
+                 "Error: need non-empty 'key' (< %d bytes) and 'value' (< %d bytes), category < %d bytes",
+                 MIMI_FACT_KEY_LEN, MIMI_FACT_VALUE_LEN, MIMI_FACT_CAT_LEN);
+    } else if (err == ESP_ERR_NO_MEM) {
+        snprintf(output, output_size, "Error: fact store full (%d facts), delete something first", MIMI_FACT_MAX);
+    } else {
+        snprintf(output, output_size, "Error: could not save fact (%s)", esp_err_to_name(err));
+    }
+
+    cJSON_Delete(root);
+    return err;
+}
+
+/* ── memory_get ───────────────────────────────────────────────── */
+
+esp_err_t tool_memory_get_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    const char *key = NULL, *category = NULL, *prefix = NULL;
+    if (root) {
+        key = cJSON_GetStringValue(cJSON_GetObjectItem(root, "key"));
+        category = cJSON_GetStringValue(cJSON_GetObjectItem(root, "category"));
+        prefix = cJSON_GetStringValue(cJSON_GetObjectItem(root, "prefix"));
+    }
+
+    esp_err_t err = ESP_OK;
+    if (key && key[0]) {
+        fact_t fact;
+        err = fact_get(key, &fact);
+        if (err == ESP_OK) {
+            snprintf(output, output_size, "%s [%s]: %s", fact.key, fact.category, fact.value);
+        } else {
+            snprintf(output, output_size, "No fact with key '%s'", key);
+        }
+    } else if (fact_store_list(category, prefix, output, output_size) == 0) {
+        snprintf(output, output_size, "No matching facts");
+    }
+
+    cJSON_Delete(root);
+    return err;
+}
+
+/* ── memory_delete ────────────────────────────────────────────── */
+
+esp_err_t tool_memory_delete_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *key = cJSON_GetStringValue(cJSON_GetObjectItem(root, "key"));
+    if (!key || !key[0]) {
+        snprintf(output, output_size, "Error: missing 'key' field");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = fact_delete(key);
+    if (err == ESP_OK) {
+        snprintf(output, output_size, "OK: deleted %s", key);
+        ESP_LOGI(TAG, "memory_delete: %s", key);
+    } else {
+        snprintf(output, output_size, "No fact with key '%s'", key);
+    }
+
+    cJSON_Delete(root);
+    return err;
+}
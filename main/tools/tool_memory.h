@@ -0,0 +1,28 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+/**
+ * Full-text search over long-term memory and daily notes.
+ * Input JSON: {"query": "...", "limit": 5} (limit is optional)
+ */
+esp_err_t tool_memory_search_execute(const char *input_json, char *output, size_t output_size);
+
+/**
+ * Insert or update a structured fact.
+ * Input JSON: {"key": "...", "value": "...", "category": "..."} (category is optional)
+ */
+esp_err_t tool_memory_upsert_execute(const char *input_json, char *output, size_t output_size);
+
+/**
+ * Look up structured facts.
+ * Input JSON: {"key": "..."} or {"category": "...", "prefix": "..."} (all optional)
+ */
+esp_err_t tool_memory_get_execute(const char *input_json, char *output, size_t output_size);
+
+/**
+ * Delete a structured fact.
+ * Input JSON: {"key": "..."}
+ */
+esp_err_t tool_memory_delete_execute(const char *input_json, char *output, size_t output_size);
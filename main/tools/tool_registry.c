@@ -1,59 +1,284 @@
 #include "tool_registry.h"
 #include "mimi_config.h"
 #include "tools/tool_web_search.h"
+#include "tools/tool_web_fetch.h"
 #include "tools/tool_get_time.h"
 #include "tools/tool_files.h"
 #include "tools/tool_cron.h"
+#include "tools/tool_memory.h"
 
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "cJSON.h"
+#include "bus/message_bus.h"
+#include "skills/skill_loader.h"
 
 static const char *TAG = "tools";
 
-#define MAX_TOOLS 12
+typedef struct {
+    mimi_tool_t tool;
+    char *json;                        /* {"name",...} object for the API request */
+    size_t json_len;
+    bool owned;                        /* registered at runtime: strings and ctx are heap copies */
+} tool_entry_t;
 
-static mimi_tool_t s_tools[MAX_TOOLS];
+static tool_entry_t *s_tools = NULL;   /* registration order */
 static int s_tool_count = 0;
-static char *s_tools_json = NULL;  /* cached JSON array string */
+static int s_tool_cap = 0;
+static int16_t *s_index = NULL;        /* open addressing by name hash, -1 = empty */
+static int s_index_size = 0;
+static SemaphoreHandle_t s_lock = NULL;
 
-static void register_tool(const mimi_tool_t *tool)
+/* Arrays are re-joined from the per-tool objects when the table changed */
+static uint32_t s_gen = 1;             /* bumped on every (un)registration */
+static char *s_tools_json = NULL;      /* all tools */
+static size_t s_tools_json_cap = 0;
+static uint32_t s_tools_json_gen = 0;
+static char *s_subset_json = NULL;     /* last per-turn subset */
+static size_t s_subset_json_cap = 0;
+static uint32_t s_subset_gen = 0;
+static uint32_t s_subset_groups = 0;
+
+/* ── Table and index ──────────────────────────────────────────── */
+
+static uint32_t name_hash(const char *name)
 {
-    if (s_tool_count >= MAX_TOOLS) {
-        ESP_LOGE(TAG, "Tool registry full");
-        return;
+    uint32_t h = 2166136261u;
+    for (; *name; name++) {
+        h ^= (uint8_t)*name;
+        h *= 16777619u;
     }
-    s_tools[s_tool_count++] = *tool;
-    ESP_LOGI(TAG, "Registered tool: %s", tool->name);
+    return h;
 }
 
-static void build_tools_json(void)
+static int index_find(const char *name)
 {
-    cJSON *arr = cJSON_CreateArray();
+    if (!s_index) return -1;
+    int mask = s_index_size - 1;
+    for (int i = name_hash(name) & mask; ; i = (i + 1) & mask) {
+        int t = s_index[i];
+        if (t < 0) return -1;
+        if (strcmp(s_tools[t].tool.name, name) == 0) return t;
+    }
+}
 
-    for (int i = 0; i < s_tool_count; i++) {
-        cJSON *tool = cJSON_CreateObject();
-        cJSON_AddStringToObject(tool, "name", s_tools[i].name);
-        cJSON_AddStringToObject(tool, "description", s_tools[i].description);
+/* Re-hash every tool; the index is kept at least twice the table capacity */
+static esp_err_t index_rebuild(void)
+{
+    int size = 16;
+    while (size < 2 * s_tool_cap) size *= 2;
+    if (size != s_index_size) {
+        int16_t *index = heap_caps_realloc(s_index, size * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+        if (!index) return ESP_ERR_NO_MEM;
+        s_index = index;
+        s_index_size = size;
+    }
+    memset(s_index, 0xFF, s_index_size * sizeof(int16_t));
 
-        cJSON *schema = cJSON_Parse(s_tools[i].input_schema_json);
-        if (schema) {
-            cJSON_AddItemToObject(tool, "input_schema", schema);
-        }
+    int mask = s_index_size - 1;
+    for (int t = 0; t < s_tool_count; t++) {
+        int i = name_hash(s_tools[t].tool.name) & mask;
+        while (s_index[i] >= 0) i = (i + 1) & mask;
+        s_index[i] = t;
+    }
+    return ESP_OK;
+}
+
+/* Make room for `need` tools */
+static esp_err_t tools_reserve(int need)
+{
+    if (need <= s_tool_cap) return ESP_OK;
+    if (need > MIMI_TOOLS_MAX) return ESP_ERR_NO_MEM;
+
+    int cap = s_tool_cap ? s_tool_cap : MIMI_TOOLS_INIT;
+    while (cap < need) cap *= 2;
+    if (cap > MIMI_TOOLS_MAX) cap = MIMI_TOOLS_MAX;
+
+    tool_entry_t *tools = heap_caps_realloc(s_tools, cap * sizeof(tool_entry_t), MALLOC_CAP_SPIRAM);
+    if (!tools) return ESP_ERR_NO_MEM;
+    s_tools = tools;
+    s_tool_cap = cap;
+    return ESP_OK;
+}
+
+static void entry_free(tool_entry_t *e)
+{
+    free(e->json);
+    if (e->owned) {
+        free((char *)e->tool.name);
+        free((char *)e->tool.description);
+        free((char *)e->tool.summary);
+        free((char *)e->tool.input_schema_json);
+        free((char *)e->tool.hints);
+        free((void *)e->tool.ctx);
+    }
+    memset(e, 0, sizeof(*e));
+}
+
+/* ── Registration ─────────────────────────────────────────────── */
+
+/* Serialize one tool for the API request (plain heap, never the turn arena) */
+static char *tool_json(const mimi_tool_t *tool)
+{
+    cJSON *schema = cJSON_Parse(tool->input_schema_json);
+    if (!schema) return NULL;
+
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddStringToObject(obj, "name", tool->name);
+    cJSON_AddStringToObject(obj, "description", tool->description);
+    cJSON_AddItemToObject(obj, "input_schema", schema);
+
+    char *printed = cJSON_PrintUnformatted(obj);
+    cJSON_Delete(obj);
+    char *json = printed ? strdup(printed) : NULL;
+    cJSON_free(printed);
+    return json;
+}
+
+static char *dup_or_null(const char *s)
+{
+    return s ? strdup(s) : NULL;
+}
+
+/* Copy the tool's strings and context so the caller's may go away */
+static bool entry_copy(tool_entry_t *e, const mimi_tool_t *tool)
+{
+    e->owned = true;
+    e->tool.name = strdup(tool->name);
+    e->tool.description = strdup(tool->description);
+    e->tool.summary = dup_or_null(tool->summary);
+    e->tool.input_schema_json = strdup(tool->input_schema_json);
+    e->tool.hints = dup_or_null(tool->hints);
+    if (tool->ctx && tool->ctx_size) {
+        void *ctx = malloc(tool->ctx_size);
+        if (ctx) memcpy(ctx, tool->ctx, tool->ctx_size);
+        e->tool.ctx = ctx;
+    }
+    return e->tool.name && e->tool.description && e->tool.input_schema_json &&
+           (!tool->summary || e->tool.summary) && (!tool->hints || e->tool.hints) &&
+           (!tool->ctx_size || e->tool.ctx);
+}
+
+static esp_err_t add_tool(const mimi_tool_t *tool, bool copy)
+{
+    if (!tool->name || !tool->name[0] || strlen(tool->name) > MIMI_TOOL_NAME_MAX ||
+        !tool->description || !tool->input_schema_json ||
+        (!tool->execute && !tool->execute_ctx)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    tool_entry_t e = { .tool = *tool };
+    e.json = tool_json(tool);
+    if (!e.json) {
+        ESP_LOGE(TAG, "Tool %s: invalid input schema", tool->name);
+        return ESP_ERR_INVALID_ARG;
+    }
+    e.json_len = strlen(e.json);
+    if (copy && !entry_copy(&e, tool)) {
+        entry_free(&e);
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    int i = index_find(tool->name);
+    if (i >= 0 && !s_tools[i].owned) {
+        err = ESP_ERR_INVALID_STATE;           /* built-ins cannot be replaced */
+    } else if (i >= 0) {
+        /* Same name: replace in place, keeping its position */
+        entry_free(&s_tools[i]);
+        s_tools[i] = e;
+    } else if ((err = tools_reserve(s_tool_count + 1)) == ESP_OK) {
+        s_tools[s_tool_count++] = e;
+        err = index_rebuild();
+        if (err != ESP_OK) s_tool_count--;
+    }
+    if (err == ESP_OK) s_gen++;
+    xSemaphoreGive(s_lock);
 
-        cJSON_AddItemToArray(arr, tool);
+    if (err != ESP_OK) {
+        entry_free(&e);
+        ESP_LOGE(TAG, "Cannot register tool %s: %s", tool->name, esp_err_to_name(err));
+        return err;
     }
+    ESP_LOGI(TAG, "Registered tool: %s", tool->name);
+    return ESP_OK;
+}
+
+static void register_tool(const mimi_tool_t *tool)
+{
+    add_tool(tool, false);
+}
+
+esp_err_t tool_registry_register(const mimi_tool_t *tool)
+{
+    return add_tool(tool, true);
+}
 
-    free(s_tools_json);
-    s_tools_json = cJSON_PrintUnformatted(arr);
-    cJSON_Delete(arr);
+esp_err_t tool_registry_unregister(const char *name)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = index_find(name);
+    esp_err_t err = ESP_OK;
+    if (i < 0) {
+        err = ESP_ERR_NOT_FOUND;
+    } else if (!s_tools[i].owned) {
+        err = ESP_ERR_NOT_SUPPORTED;
+    } else {
+        entry_free(&s_tools[i]);
+        memmove(&s_tools[i], &s_tools[i + 1], (s_tool_count - i - 1) * sizeof(tool_entry_t));
+        s_tool_count--;
+        index_rebuild();
+        s_gen++;
+    }
+    xSemaphoreGive(s_lock);
 
-    ESP_LOGI(TAG, "Tools JSON built (%d tools)", s_tool_count);
+    if (err == ESP_OK) ESP_LOGI(TAG, "Unregistered tool: %s", name);
+    return err;
+}
+
+/* ── Tools JSON ───────────────────────────────────────────────── */
+
+/* "[" + the objects of the tools in groups + "]" into *buf, grown as needed */
+static const char *join_tools_json(uint32_t groups, char **buf, size_t *cap)
+{
+    size_t need = 3;
+    for (int i = 0; i < s_tool_count; i++) {
+        if (s_tools[i].tool.group & groups) need += s_tools[i].json_len + 1;
+    }
+    if (need > *cap) {
+        char *grown = heap_caps_realloc(*buf, need, MALLOC_CAP_SPIRAM);
+        if (!grown) return NULL;
+        *buf = grown;
+        *cap = need;
+    }
+
+    char *out = *buf;
+    size_t off = 0;
+    out[off++] = '[';
+    for (int i = 0; i < s_tool_count; i++) {
+        if (!(s_tools[i].tool.group & groups)) continue;
+        if (off > 1) out[off++] = ',';
+        memcpy(out + off, s_tools[i].json, s_tools[i].json_len);
+        off += s_tools[i].json_len;
+    }
+    out[off++] = ']';
+    out[off] = '\0';
+    return out;
 }
 
 esp_err_t tool_registry_init(void)
 {
-    s_tool_count = 0;
+    if (!s_lock) s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) return ESP_ERR_NO_MEM;
+
+    tool_files_init();
 
     /* Register web_search */
     tool_web_search_init();
@@ -61,62 +286,96 @@ esp_err_t tool_registry_init(void)
     mimi_tool_t ws = {
         .name = "web_search",
         .description = "Search the web for current information. Use this when you need up-to-date facts, news, weather, or anything beyond your training data.",
+        .summary = "Search the web for current information. Use this when you need up-to-date facts, news, weather, or anything beyond your training data.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{\"query\":{\"type\":\"string\",\"description\":\"The search query\"}},"
             "\"required\":[\"query\"]}",
         .execute = tool_web_search_execute,
+        .group = TOOL_GROUP_WEB,
     };
     register_tool(&ws);
 
+    /* Register web_fetch */
+    mimi_tool_t wfe = {
+        .name = "web_fetch",
+        .description = "Fetch a web page and return its readable text (headings, paragraphs, lists and links; scripts and styling removed). "
+                       "Use this to read a page found with web_search or a URL the user gives you. Long pages are cut off.",
+        .summary = "Read the text of a web page by URL, e.g. a search result worth opening.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"url\":{\"type\":\"string\",\"description\":\"http:// or https:// URL of the page\"},"
+            "\"max_chars\":{\"type\":\"integer\",\"description\":\"Optional smaller limit on the returned text, in characters\"}},"
+            "\"required\":[\"url\"]}",
+        .execute = tool_web_fetch_execute,
+        .group = TOOL_GROUP_WEB,
+    };
+    register_tool(&wfe);
+
     /* Register get_current_time */
     mimi_tool_t gt = {
         .name = "get_current_time",
-        .description = "Get the current date and time. Also sets the system clock. Call this when you need to know what time or date it is.",
+        .description = "Get the current date and time from the device clock (kept in sync over NTP). Call this when you need to know what time or date it is.",
+        .summary = "Get the current date and time. You do NOT have an internal clock — always use this tool when you need to know the time or date.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{},"
             "\"required\":[]}",
         .execute = tool_get_time_execute,
+        .group = TOOL_GROUP_CORE,
     };
     register_tool(&gt);
 
     /* Register read_file */
     mimi_tool_t rf = {
         .name = "read_file",
-        .description = "Read a file from SPIFFS storage. Path must start with " MIMI_SPIFFS_BASE "/.",
+        .description = "Read a file from storage. Path must start with " MIMI_SPIFFS_BASE "/. "
+                       "Large files come back in pages ending with a [... next offset=N] or [... next start_line=N] note; "
+                       "pass that value to read the next page.",
+        .summary = "Read a file (path must start with " MIMI_SPIFFS_BASE "/).",
         .input_schema_json =
             "{\"type\":\"object\","
-            "\"properties\":{\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with " MIMI_SPIFFS_BASE "/\"}},"
+            "\"properties\":{\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with " MIMI_SPIFFS_BASE "/\"},"
+            "\"offset\":{\"type\":\"integer\",\"description\":\"Byte offset to start reading at\"},"
+            "\"length\":{\"type\":\"integer\",\"description\":\"Maximum bytes to read\"},"
+            "\"start_line\":{\"type\":\"integer\",\"description\":\"First line to return (1-based); use instead of offset\"},"
+            "\"end_line\":{\"type\":\"integer\",\"description\":\"Last line to return (inclusive)\"}},"
             "\"required\":[\"path\"]}",
         .execute = tool_read_file_execute,
+        .group = TOOL_GROUP_FILES,
     };
     register_tool(&rf);
 
     /* Register write_file */
     mimi_tool_t wf = {
         .name = "write_file",
-        .description = "Write or overwrite a file on SPIFFS storage. Path must start with " MIMI_SPIFFS_BASE "/.",
+        .description = "Write, overwrite or append to a file on storage. Path must start with " MIMI_SPIFFS_BASE "/.",
+        .summary = "Write/overwrite or append to a file.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with " MIMI_SPIFFS_BASE "/\"},"
-            "\"content\":{\"type\":\"string\",\"description\":\"File content to write\"}},"
+            "\"content\":{\"type\":\"string\",\"description\":\"File content to write\"},"
+            "\"mode\":{\"type\":\"string\",\"enum\":[\"overwrite\",\"append\"],\"description\":\"overwrite (default) or append to the end\"}},"
             "\"required\":[\"path\",\"content\"]}",
         .execute = tool_write_file_execute,
+        .group = TOOL_GROUP_FILES,
     };
     register_tool(&wf);
 
     /* Register edit_file */
     mimi_tool_t ef = {
         .name = "edit_file",
-        .description = "Find and replace text in a file on SPIFFS. Replaces first occurrence of old_string with new_string.",
+        .description = "Find and replace text in a file on storage. Replaces the first occurrence of old_string with new_string, or every occurrence with replace_all.",
+        .summary = "Find-and-replace edit a file.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with " MIMI_SPIFFS_BASE "/\"},"
             "\"old_string\":{\"type\":\"string\",\"description\":\"Text to find\"},"
-            "\"new_string\":{\"type\":\"string\",\"description\":\"Replacement text\"}},"
+            "\"new_string\":{\"type\":\"string\",\"description\":\"Replacement text\"},"
+            "\"replace_all\":{\"type\":\"boolean\",\"description\":\"Replace every occurrence (default false)\"}},"
             "\"required\":[\"path\",\"old_string\",\"new_string\"]}",
         .execute = tool_edit_file_execute,
+        .group = TOOL_GROUP_FILES,
     };
     register_tool(&ef);
 
@@ -124,31 +383,98 @@ esp_err_t tool_registry_init(void)
     mimi_tool_t ld = {
         .name = "list_dir",
         .description = "List files on SPIFFS storage, optionally filtered by path prefix.",
+        .summary = "List files, optionally filter by prefix.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{\"prefix\":{\"type\":\"string\",\"description\":\"Optional path prefix filter, e.g. " MIMI_SPIFFS_BASE "/memory/\"}},"
             "\"required\":[]}",
         .execute = tool_list_dir_execute,
+        .group = TOOL_GROUP_FILES,
     };
     register_tool(&ld);
 
+    /* Register memory_search */
+    mimi_tool_t ms = {
+        .name = "memory_search",
+        .description = "Full-text search over long-term memory and all daily notes, best matches first. Use this to recall facts or past events not shown in the prompt.",
+        .summary = "Full-text search over MEMORY.md and all daily notes.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"query\":{\"type\":\"string\",\"description\":\"Keywords to look for\"},"
+            "\"limit\":{\"type\":\"integer\",\"description\":\"Max results (default 5, max 8)\"}},"
+            "\"required\":[\"query\"]}",
+        .execute = tool_memory_search_execute,
+        .group = TOOL_GROUP_MEMORY,
+    };
+    register_tool(&ms);
+
+    /* Register memory_upsert */
+    mimi_tool_t mu = {
+        .name = "memory_upsert",
+        .description = "Save or update one fact about the user or the world in the structured fact store (shown in every prompt). Prefer this over editing MEMORY.md for names, preferences and settings.",
+        .summary = "Save or update a single key/value fact.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"key\":{\"type\":\"string\",\"description\":\"Short unique key, e.g. user.name or pref.coffee\"},"
+            "\"value\":{\"type\":\"string\",\"description\":\"The fact, max 255 bytes\"},"
+            "\"category\":{\"type\":\"string\",\"description\":\"Optional group, e.g. user, preferences, devices\"}},"
+            "\"required\":[\"key\",\"value\"]}",
+        .execute = tool_memory_upsert_execute,
+        .group = TOOL_GROUP_MEMORY,
+    };
+    register_tool(&mu);
+
+    /* Register memory_get */
+    mimi_tool_t mg = {
+        .name = "memory_get",
+        .description = "Look up facts in the structured fact store by key, category or key prefix. With no arguments lists all facts.",
+        .summary = "Look up key/value facts by key, category or prefix.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"key\":{\"type\":\"string\",\"description\":\"Exact key\"},"
+            "\"category\":{\"type\":\"string\",\"description\":\"Only facts in this category\"},"
+            "\"prefix\":{\"type\":\"string\",\"description\":\"Only keys starting with this\"}},"
+            "\"required\":[]}",
+        .execute = tool_memory_get_execute,
+        .group = TOOL_GROUP_MEMORY,
+    };
+    register_tool(&mg);
+
+    /* Register memory_delete */
+    mimi_tool_t md = {
+        .name = "memory_delete",
+        .description = "Delete a fact from the structured fact store by key.",
+        .summary = "Remove a key/value fact.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"key\":{\"type\":\"string\",\"description\":\"Key to delete\"}},"
+            "\"required\":[\"key\"]}",
+        .execute = tool_memory_delete_execute,
+        .group = TOOL_GROUP_MEMORY,
+    };
+    register_tool(&md);
+
     /* Register cron_add */
     mimi_tool_t ca = {
         .name = "cron_add",
-        .description = "Schedule a recurring or one-shot task. The message will trigger an agent turn when the job fires.",
+        .description = "Schedule a recurring, one-shot or cron-expression task. The message will trigger an agent turn when the job fires.",
+        .summary = "Schedule a recurring, one-shot or calendar (cron expression, local time) task. The message will trigger an agent turn when the job fires.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{"
             "\"name\":{\"type\":\"string\",\"description\":\"Short name for the job\"},"
-            "\"schedule_type\":{\"type\":\"string\",\"description\":\"'every' for recurring interval or 'at' for one-shot at a unix timestamp\"},"
+            "\"schedule_type\":{\"type\":\"string\",\"description\":\"'every' for recurring interval, 'at' for one-shot at a unix timestamp, 'cron' for a calendar schedule\"},"
             "\"interval_s\":{\"type\":\"integer\",\"description\":\"Interval in seconds (required for 'every')\"},"
             "\"at_epoch\":{\"type\":\"integer\",\"description\":\"Unix timestamp to fire at (required for 'at')\"},"
+            "\"expr\":{\"type\":\"string\",\"description\":\"5-field cron expression in local time: minute hour day-of-month month day-of-week, e.g. '0 8 * * mon-fri' (required for 'cron')\"},"
             "\"message\":{\"type\":\"string\",\"description\":\"Message to inject when the job fires, triggering an agent turn\"},"
             "\"channel\":{\"type\":\"string\",\"description\":\"Optional reply channel (e.g. 'telegram'). If omitted, current turn channel is used when available\"},"
-            "\"chat_id\":{\"type\":\"string\",\"description\":\"Optional reply chat_id. Required when channel='telegram'. If omitted during a Telegram turn, current chat_id is used\"}"
+            "\"chat_id\":{\"type\":\"string\",\"description\":\"Optional reply chat_id. Required when channel='telegram'. If omitted during a Telegram turn, current chat_id is used\"},"
+            "\"batch\":{\"type\":\"boolean\",\"description\":\"Default true: jobs due at the same time for the same chat are handled in one turn. Set false to always run this job on its own\"}"
             "},"
             "\"required\":[\"name\",\"schedule_type\",\"message\"]}",
         .execute = tool_cron_add_execute,
+        .group = TOOL_GROUP_CRON,
     };
     register_tool(&ca);
 
@@ -156,11 +482,13 @@ esp_err_t tool_registry_init(void)
     mimi_tool_t cl = {
         .name = "cron_list",
         .description = "List all scheduled cron jobs with their status, schedule, and IDs.",
+        .summary = "List all scheduled cron jobs.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{},"
             "\"required\":[]}",
         .execute = tool_cron_list_execute,
+        .group = TOOL_GROUP_CRON,
     };
     register_tool(&cl);
 
@@ -168,36 +496,320 @@ esp_err_t tool_registry_init(void)
     mimi_tool_t cr = {
         .name = "cron_remove",
         .description = "Remove a scheduled cron job by its ID.",
+        .summary = "Remove a scheduled cron job by ID.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{\"job_id\":{\"type\":\"string\",\"description\":\"The 8-character job ID to remove\"}},"
             "\"required\":[\"job_id\"]}",
         .execute = tool_cron_remove_execute,
+        .group = TOOL_GROUP_CRON,
     };
     register_tool(&cr);
 
-    build_tools_json();
-
-    ESP_LOGI(TAG, "Tool registry initialized");
+    ESP_LOGI(TAG, "Tool registry initialized (%d tools)", s_tool_count);
     return ESP_OK;
 }
 
 const char *tool_registry_get_tools_json(void)
 {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_tools_json_gen != s_gen && join_tools_json(TOOL_GROUP_ALL, &s_tools_json, &s_tools_json_cap)) {
+        s_tools_json_gen = s_gen;
+        ESP_LOGI(TAG, "Tools JSON built (%d tools, %d bytes)", s_tool_count, (int)strlen(s_tools_json));
+    }
+    xSemaphoreGive(s_lock);
     return s_tools_json;
 }
 
+/* ── Per-turn selection ───────────────────────────────────────── */
+
+/* Words (case-insensitive, whole words) that pull a group into the turn */
+static const char *const WEB_HINTS[] = {
+    "search", "google", "look up", "lookup", "find out", "news", "weather", "forecast",
+    "price", "stock", "temperature", "bitcoin", "crypto", "exchange rate", "latest",
+    "http", "www.", "website", "web", "internet", "url", "article", "who won",
+    "搜索", "新闻", "天气", "网页", "最新", NULL
+};
+
+static const char *const CRON_HINTS[] = {
+    "remind", "reminder", "schedule", "scheduled", "cron", "every day", "every week",
+    "every hour", "every morning", "every night", "daily", "weekly", "hourly", "monthly",
+    "alarm", "timer", "o'clock", "recurring", "提醒", "定时", "每天", "每周", NULL
+};
+
+/* ASCII letters and digits; CJK text has no word breaks to honour */
+static bool is_word_char(char c)
+{
+    return (unsigned char)c < 0x80 && isalnum((unsigned char)c);
+}
+
+/*
+ * Case-insensitive match of word on word boundaries, so "web" does not fire
+ * on "cobweb" nor "news" on "newsletter"; a plural "s" is allowed. An end of
+ * the word that is not a letter or digit ("www.", CJK) needs no boundary.
+ */
+static bool has_word(const char *text, const char *word)
+{
+    size_t n = strlen(word);
+    if (n == 0) return false;
+    bool left = is_word_char(word[0]), right = is_word_char(word[n - 1]);
+    for (const char *p = text; (p = strcasestr(p, word)) != NULL; p++) {
+        if (left && p > text && is_word_char(p[-1])) continue;
+        const char *end = p + n;
+        if (right && (*end == 's' || *end == 'S')) end++;
+        if (right && is_word_char(*end)) continue;
+        return true;
+    }
+    return false;
+}
+
+static bool has_hint(const char *const *hints, const char *text)
+{
+    if (!text) return false;
+    for (int i = 0; hints[i]; i++) {
+        if (has_word(text, hints[i])) return true;
+    }
+    return false;
+}
+
+/* Same for a tool's own comma-separated hint list */
+static bool has_tool_hint(const char *hints, const char *text)
+{
+    if (!text) return false;
+    while (*hints) {
+        size_t n = strcspn(hints, ",");
+        char word[32];
+        if (n > 0 && n < sizeof(word)) {
+            memcpy(word, hints, n);
+            word[n] = '\0';
+            if (has_word(text, word)) return true;
+        }
+        hints += n;
+        if (*hints == ',') hints++;
+    }
+    return false;
+}
+
+/*
+ * A reply means the model missed a group's tools only when one sentence both
+ * declines and names what the group provides ("I can't browse the internet",
+ * "I'm unable to set reminders"); either alone is ordinary prose.
+ */
+static const char *const DECLINE_HINTS[] = {
+    "don't", "don’t", "do not", "can't", "can’t", "cannot", "can not", "unable",
+    "not able", "no access", "without access", "无法", "不能", "没有", NULL
+};
+
+static const char *const WEB_LACK_HINTS[] = {
+    "real-time", "real time", "up-to-date", "up to date", "live data", "internet",
+    "browse", "browsing", "search the web", "look it up", "current information",
+    "实时", "联网", "上网", NULL
+};
+
+static const char *const CRON_LACK_HINTS[] = {
+    "remind", "reminder", "schedule", "alarm", "timer", "提醒", "定时", NULL
+};
+
+static const struct {
+    uint32_t group;
+    const char *const *hints;
+} LACK_HINTS[] = {
+    { TOOL_GROUP_WEB,  WEB_LACK_HINTS },
+    { TOOL_GROUP_CRON, CRON_LACK_HINTS },
+};
+
+/* Bytes up to the end of the sentence at p: . ! ? newline, or a CJK 。！？ */
+static size_t sentence_len(const char *p)
+{
+    size_t i = 0;
+    for (; p[i]; i++) {
+        if (p[i] == '.' || p[i] == '!' || p[i] == '?' || p[i] == '\n') break;
+        if (strncmp(p + i, "。", 3) == 0 || strncmp(p + i, "！", 3) == 0 ||
+            strncmp(p + i, "？", 3) == 0) {
+            break;
+        }
+    }
+    return i;
+}
+
+/* Groups of the tools whose names appear in text (caller holds s_lock) */
+static uint32_t groups_named_in(const char *text)
+{
+    uint32_t groups = 0;
+    for (int i = 0; i < s_tool_count; i++) {
+        if (strstr(text, s_tools[i].tool.name)) groups |= s_tools[i].tool.group;
+    }
+    return groups;
+}
+
+/* Skills the turn refers to bring in the tools they tell the model to use */
+static uint32_t skill_groups(const char *text, const char *tail)
+{
+    char *buf = heap_caps_malloc(MIMI_TOOLS_SKILL_SCAN, MALLOC_CAP_SPIRAM);
+    if (!buf) return 0;
+
+    uint32_t groups = 0;
+    const char *scan[] = { text, tail };
+    for (int i = 0; i < 2; i++) {
+        if (!scan[i]) continue;
+        if (skill_loader_read_matching(scan[i], buf, MIMI_TOOLS_SKILL_SCAN) == 0) continue;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        groups |= groups_named_in(buf);
+        xSemaphoreGive(s_lock);
+    }
+    free(buf);
+    return groups;
+}
+
+uint32_t tool_registry_select(const mimi_msg_t *msg, const char *history)
+{
+    /* CLI turns and scheduled turns (cron, heartbeat) cannot ask for a retry */
+    if (!MIMI_TOOLS_SELECT || strcmp(msg->channel, MIMI_CHAN_CLI) == 0 ||
+        msg->origin != MIMI_ORIGIN_USER) {
+        return TOOL_GROUP_ALL;
+    }
+    const char *text = msg->content;
+
+    /* A follow-up like "and tomorrow?" leans on the previous exchange */
+    const char *tail = NULL;
+    if (history) {
+        size_t len = strlen(history);
+        tail = history + (len > MIMI_TOOLS_HINT_TAIL ? len - MIMI_TOOLS_HINT_TAIL : 0);
+    }
+
+    uint32_t groups = TOOL_GROUP_CORE | TOOL_GROUP_FILES | TOOL_GROUP_MEMORY;
+    if (has_hint(WEB_HINTS, text) || has_hint(WEB_HINTS, tail)) groups |= TOOL_GROUP_WEB;
+    if (has_hint(CRON_HINTS, text) || has_hint(CRON_HINTS, tail)) groups |= TOOL_GROUP_CRON;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < s_tool_count; i++) {
+        const mimi_tool_t *t = &s_tools[i].tool;
+        if (t->hints && !(groups & t->group) &&
+            (has_tool_hint(t->hints, text) || has_tool_hint(t->hints, tail))) {
+            groups |= t->group;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    groups |= skill_groups(text, tail);
+    return groups;
+}
+
+uint32_t tool_registry_missing_groups(const char *reply, uint32_t groups)
+{
+    uint32_t missing = 0;
+    char sentence[MIMI_TOOLS_LACK_SENTENCE];
+
+    while (reply && *reply) {
+        size_t n = sentence_len(reply);
+        size_t len = n < sizeof(sentence) - 1 ? n : sizeof(sentence) - 1;
+        memcpy(sentence, reply, len);
+        sentence[len] = '\0';
+        reply += n;
+        if (*reply) reply += (unsigned char)*reply < 0x80 ? 1 : 3;
+
+        if (!has_hint(DECLINE_HINTS, sentence)) continue;
+        for (size_t i = 0; i < sizeof(LACK_HINTS) / sizeof(LACK_HINTS[0]); i++) {
+            if (!(groups & LACK_HINTS[i].group) && has_hint(LACK_HINTS[i].hints, sentence)) {
+                missing |= LACK_HINTS[i].group;
+            }
+        }
+    }
+    return missing;
+}
+
+const char *tool_registry_get_tools_json_for(uint32_t groups)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool all = true;
+    for (int i = 0; i < s_tool_count; i++) {
+        if (!(s_tools[i].tool.group & groups)) all = false;
+    }
+    xSemaphoreGive(s_lock);
+    if (all) return tool_registry_get_tools_json();
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    const char *json = s_subset_json;
+    if (s_subset_gen != s_gen || s_subset_groups != groups) {
+        json = join_tools_json(groups, &s_subset_json, &s_subset_json_cap);
+        s_subset_gen = json ? s_gen : 0;
+        s_subset_groups = groups;
+    }
+    xSemaphoreGive(s_lock);
+    return json;
+}
+
+size_t tool_registry_build_prompt(uint32_t groups, char *buf, size_t size)
+{
+    size_t off = 0;
+    if (size == 0) return 0;
+    buf[0] = '\0';
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < s_tool_count && off < size - 1; i++) {
+        const mimi_tool_t *t = &s_tools[i].tool;
+        if (!(t->group & groups)) continue;
+        int n = snprintf(buf + off, size - off, "- %s: %s\n",
+                         t->name, t->summary ? t->summary : t->description);
+        if (n < 0) break;
+        off += (size_t)n < size - off ? (size_t)n : size - off - 1;
+    }
+    xSemaphoreGive(s_lock);
+    return off;
+}
+
 esp_err_t tool_registry_execute(const char *name, const char *input_json,
                                 char *output, size_t output_size)
 {
-    for (int i = 0; i < s_tool_count; i++) {
-        if (strcmp(s_tools[i].name, name) == 0) {
-            ESP_LOGI(TAG, "Executing tool: %s", name);
-            return s_tools[i].execute(input_json, output, output_size);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = index_find(name);
+    mimi_tool_t tool = {0};
+    void *ctx = NULL;
+    if (i >= 0) {
+        tool = s_tools[i].tool;
+        /* A private copy, so the tool may be unregistered while it runs */
+        if (tool.ctx && tool.ctx_size) {
+            ctx = malloc(tool.ctx_size);
+            if (ctx) memcpy(ctx, tool.ctx, tool.ctx_size);
         }
     }
+    xSemaphoreGive(s_lock);
 
-    ESP_LOGW(TAG, "Unknown tool: %s", name);
-    snprintf(output, output_size, "Error: unknown tool '%s'", name);
-    return ESP_ERR_NOT_FOUND;
+    if (i < 0) {
+        ESP_LOGW(TAG, "Unknown tool: %s", name);
+        snprintf(output, output_size, "Error: unknown tool '%s'", name);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (tool.ctx_size && !ctx) {
+        snprintf(output, output_size, "Error: Out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Executing tool: %s", name);
+    esp_err_t err = tool.execute_ctx ? tool.execute_ctx(ctx, input_json, output, output_size)
+                                     : tool.execute(input_json, output, output_size);
+    free(ctx);
+    return err;
+}
+
+void tool_registry_print(void)
+{
+    static const char *const GROUP_NAMES[] = { "core", "files", "memory", "web", "cron" };
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    size_t bytes = 0;
+    printf("%-18s %-7s %-9s %s\n", "NAME", "GROUP", "ORIGIN", "SCHEMA");
+    for (int i = 0; i < s_tool_count; i++) {
+        const tool_entry_t *e = &s_tools[i];
+        const char *group = "?";
+        for (int g = 0; g < 5; g++) {
+            if (e->tool.group == (1u << g)) group = GROUP_NAMES[g];
+        }
+        printf("%-18s %-7s %-9s %u B\n", e->tool.name, group,
+               e->owned ? "manifest" : "built-in", (unsigned)e->json_len);
+        bytes += e->json_len + 1;
+    }
+    printf("%d tools (capacity %d, max %d), %u bytes of schemas\n",
+           s_tool_count, s_tool_cap, MIMI_TOOLS_MAX, (unsigned)bytes);
+    xSemaphoreGive(s_lock);
 }
@@ -1,13 +1,32 @@
 #pragma once
 
 #include "esp_err.h"
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include "bus/message_bus.h"
+
+/* Tool groups; a turn is offered only the groups it is likely to need */
+#define TOOL_GROUP_CORE     (1u << 0)   /* get_current_time */
+#define TOOL_GROUP_FILES    (1u << 1)   /* read/write/edit_file, list_dir */
+#define TOOL_GROUP_MEMORY   (1u << 2)   /* memory_* */
+#define TOOL_GROUP_WEB      (1u << 3)   /* web_search, web_fetch */
+#define TOOL_GROUP_CRON     (1u << 4)   /* cron_* */
+#define TOOL_GROUP_ALL      0xFFFFFFFFu
 
 typedef struct {
-    const char *name;
+    const char *name;               /* [A-Za-z0-9_-], up to MIMI_TOOL_NAME_MAX chars */
     const char *description;
+    const char *summary;            /* one line for the system prompt (NULL: description) */
     const char *input_schema_json;  /* JSON Schema string for input */
     esp_err_t (*execute)(const char *input_json, char *output, size_t output_size);
+    uint32_t group;                 /* one TOOL_GROUP_* bit */
+    const char *hints;              /* comma-separated words that pull the group into a turn (may be NULL) */
+    /* Alternative to execute for tools that carry state; ctx_size bytes of
+     * ctx are copied at registration and again for each call */
+    esp_err_t (*execute_ctx)(const void *ctx, const char *input_json, char *output, size_t output_size);
+    const void *ctx;
+    size_t ctx_size;
 } mimi_tool_t;
 
 /**
@@ -16,11 +35,61 @@ typedef struct {
 esp_err_t tool_registry_init(void);
 
 /**
- * Get the pre-built tools JSON array string for the API request.
- * Returns NULL if no tools are registered.
+ * Register a tool at runtime. All strings, hints and ctx are copied. A tool
+ * registered earlier under the same name is replaced; built-in tools cannot be.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad name or schema,
+ *         ESP_ERR_INVALID_STATE for a built-in name, ESP_ERR_NO_MEM when full
+ */
+esp_err_t tool_registry_register(const mimi_tool_t *tool);
+
+/**
+ * Remove a tool registered with tool_registry_register().
+ * @return ESP_OK, ESP_ERR_NOT_FOUND, or ESP_ERR_NOT_SUPPORTED for built-ins
+ */
+esp_err_t tool_registry_unregister(const char *name);
+
+/**
+ * Get the tools JSON array string for the API request. It is rebuilt from
+ * the per-tool cache only after the registry changes, and is valid until
+ * the next call (agent task only). Returns NULL if no tools are registered.
  */
 const char *tool_registry_get_tools_json(void);
 
+/**
+ * Choose the tool groups for a turn. Every turn gets core, file and memory
+ * tools; web and cron tools are added when the message or the tail of the
+ * conversation contains one of their keywords as a whole word, or when a
+ * skill it refers to names one of their tools. CLI, cron and heartbeat turns
+ * get everything.
+ *
+ * @param msg      Incoming message (channel, origin, content)
+ * @param history  Session history JSON (may be NULL); only its tail is scanned
+ * @return TOOL_GROUP_* mask (TOOL_GROUP_ALL when MIMI_TOOLS_SELECT is 0)
+ */
+uint32_t tool_registry_select(const mimi_msg_t *msg, const char *history);
+
+/**
+ * Groups left out of `groups` that a final reply says it is missing: one
+ * sentence declines ("I can't", "unable") and names what the group provides
+ * ("real-time", "browse" for web; "reminder", "schedule" for cron). The agent
+ * then retries the turn once with those groups added.
+ * @return TOOL_GROUP_* mask, 0 when nothing lines up
+ */
+uint32_t tool_registry_missing_groups(const char *reply, uint32_t groups);
+
+/**
+ * Tools JSON array with only the tools in groups. The returned string is
+ * valid until the next call.
+ */
+const char *tool_registry_get_tools_json_for(uint32_t groups);
+
+/**
+ * Write "- name: summary" lines for the tools in groups.
+ * @return bytes written (excluding the NUL)
+ */
+size_t tool_registry_build_prompt(uint32_t groups, char *buf, size_t size);
+
 /**
  * Execute a tool by name.
  *
@@ -32,3 +101,8 @@ const char *tool_registry_get_tools_json(void);
  */
 esp_err_t tool_registry_execute(const char *name, const char *input_json,
                                 char *output, size_t output_size);
+
+/**
+ * Print the registered tools (for CLI debug).
+ */
+void tool_registry_print(void);
@@ -0,0 +1,316 @@
+#include "tool_web_fetch.h"
+#include "mimi_config.h"
+#include "proxy/http_proxy.h"
+#include "tools/html_text.h"
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+
+static const char *TAG = "web_fetch";
+
+#define FETCH_READ_CHUNK    1024
+#define FETCH_URL_MAX       HTML_TEXT_BASE_MAX
+#define FETCH_HEAD_RESERVE  400        /* "URL: ..." line and trailing note */
+#define FETCH_ACCEPT        "text/html,application/xhtml+xml,text/plain;q=0.9,*/*;q=0.5"
+
+/*
+ * One fetch: the converter writes straight into the tool output buffer and
+ * the URL line is put in front once the final (redirected) URL is known.
+ */
+typedef struct {
+    html_text_t ht;
+    char url[FETCH_URL_MAX];           /* current URL, final after redirects */
+    proxy_resp_info_t info;            /* status and headers of the last response */
+    char *out;
+    size_t cap;
+    bool started;                      /* ht initialised for a 200 text response */
+    bool unsupported;                  /* not a text content type */
+    bool capped;                       /* MIMI_WEB_FETCH_MAX_BYTES reached */
+    size_t bytes;                      /* body bytes received */
+} fetch_state_t;
+
+static bool is_redirect(int status)
+{
+    return status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+}
+
+/* Pick the converter mode from Content-Type; false for binary content */
+static bool fetch_begin(fetch_state_t *st)
+{
+    const char *ct = st->info.content_type;
+    html_text_mode_t mode;
+
+    if (!ct[0]) {
+        mode = HTML_TEXT_AUTO;
+    } else if (strcasestr(ct, "html") || strcasestr(ct, "xml")) {
+        mode = HTML_TEXT_HTML;
+    } else if (strncasecmp(ct, "text/", 5) == 0 || strcasestr(ct, "json")) {
+        mode = HTML_TEXT_PLAIN;
+    } else {
+        st->unsupported = true;
+        return false;
+    }
+
+    html_text_init(&st->ht, st->out, st->cap, mode, st->url);
+    st->started = true;
+    return true;
+}
+
+/* Body bytes from either transport; false stops the download */
+static bool fetch_feed(fetch_state_t *st, const char *data, size_t len)
+{
+    if (st->bytes + len > MIMI_WEB_FETCH_MAX_BYTES) {
+        len = MIMI_WEB_FETCH_MAX_BYTES - st->bytes;
+        st->capped = true;
+    }
+    st->bytes += len;
+    return html_text_feed(&st->ht, data, len) && !st->capped;
+}
+
+/* ── Direct HTTP(S) request ───────────────────────────────────── */
+
+static esp_err_t fetch_event_handler(esp_http_client_event_t *evt)
+{
+    fetch_state_t *st = evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER && st &&
+        strcasecmp(evt->header_key, "Content-Type") == 0) {
+        strncpy(st->info.content_type, evt->header_value, sizeof(st->info.content_type) - 1);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t fetch_direct(fetch_state_t *st)
+{
+    esp_http_client_config_t config = {
+        .url = st->url,
+        .timeout_ms = MIMI_WEB_FETCH_TIMEOUT_MS,
+        .buffer_size = 2048,
+        .user_agent = MIMI_WEB_FETCH_USER_AGENT,
+        .event_handler = fetch_event_handler,
+        .user_data = st,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+    };
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return ESP_FAIL;
+
+    esp_http_client_set_header(client, "Accept", FETCH_ACCEPT);
+
+    /* open/read instead of perform(): redirects are followed by hand and
+     * the download can stop as soon as the text budget is used up */
+    esp_err_t err = ESP_OK;
+    for (int hop = 0; ; hop++) {
+        memset(&st->info, 0, sizeof(st->info));
+        err = esp_http_client_open(client, 0);
+        if (err != ESP_OK) break;
+        if (esp_http_client_fetch_headers(client) < 0) {
+            err = ESP_ERR_HTTP_FETCH_HEADER;
+            break;
+        }
+        st->info.status = esp_http_client_get_status_code(client);
+        if (!is_redirect(st->info.status) || hop == MIMI_WEB_FETCH_MAX_REDIRECTS) break;
+
+        esp_http_client_flush_response(client, NULL);
+        if (esp_http_client_set_redirection(client) != ESP_OK) break;
+        esp_http_client_close(client);
+        esp_http_client_get_url(client, st->url, sizeof(st->url));
+        ESP_LOGI(TAG, "Redirected to %s", st->url);
+    }
+
+    if (err == ESP_OK && st->info.status == 200 && fetch_begin(st)) {
+        char buf[FETCH_READ_CHUNK];
+        while (1) {
+            int n = esp_http_client_read(client, buf, sizeof(buf));
+            if (n < 0) {
+                err = ESP_ERR_TIMEOUT;
+                break;
+            }
+            if (n == 0 || !fetch_feed(st, buf, n)) break;
+        }
+    }
+
+    esp_http_client_cleanup(client);
+    return err;
+}
+
+/* ── Proxy HTTPS request ──────────────────────────────────────── */
+
+/* Split "https://host[:port]/path"; path points into url */
+static bool split_url(const char *url, char *host, size_t host_size, int *port, const char **path)
+{
+    const char *h = url + strlen("https://");
+    size_t hlen = strcspn(h, ":/?#");
+    if (hlen == 0 || hlen >= host_size) return false;
+    memcpy(host, h, hlen);
+    host[hlen] = '\0';
+
+    const char *p = h + hlen;
+    *port = 443;
+    if (*p == ':') {
+        *port = atoi(p + 1);
+        p += 1 + strspn(p + 1, "0123456789");
+    }
+    *path = (*p == '/') ? p : "/";
+    return *port > 0 && *port < 65536;
+}
+
+static bool proxy_feed(void *ctx, const char *data, size_t len)
+{
+    fetch_state_t *st = ctx;
+    if (st->info.status != 200) return false;  /* redirect or error body */
+    if (!st->started && !fetch_begin(st)) return false;
+    return fetch_feed(st, data, len);
+}
+
+static esp_err_t fetch_via_proxy(fetch_state_t *st)
+{
+    for (int hop = 0; ; hop++) {
+        char host[128];
+        int port;
+        const char *path;
+
+        if (strncasecmp(st->url, "https://", 8) != 0) return ESP_ERR_NOT_SUPPORTED;
+        if (!split_url(st->url, host, sizeof(host), &port, &path)) return ESP_ERR_INVALID_ARG;
+
+        proxy_conn_t *conn = proxy_conn_open(host, port, MIMI_WEB_FETCH_TIMEOUT_MS);
+        if (!conn) return ESP_ERR_HTTP_CONNECT;
+
+        char port_suffix[8] = "";
+        if (port != 443) snprintf(port_suffix, sizeof(port_suffix), ":%d", port);
+
+        char header[1024];
+        int hlen = snprintf(header, sizeof(header),
+            "GET %s HTTP/1.1\r\n"
+            "Host: %s%s\r\n"
+            "User-Agent: " MIMI_WEB_FETCH_USER_AGENT "\r\n"
+            "Accept: " FETCH_ACCEPT "\r\n"
+            "Accept-Encoding: identity\r\n"
+            "Connection: close\r\n\r\n",
+            path, host, port_suffix);
+
+        if (hlen >= (int)sizeof(header) || proxy_conn_write(conn, header, hlen) < 0) {
+            proxy_conn_close(conn);
+            return ESP_ERR_HTTP_WRITE_DATA;
+        }
+
+        memset(&st->info, 0, sizeof(st->info));
+        int status = proxy_conn_read_response(conn, MIMI_WEB_FETCH_TIMEOUT_MS, &st->info, proxy_feed, st);
+        proxy_conn_close(conn);
+        if (status < 0) return ESP_FAIL;
+
+        if (!is_redirect(status) || !st->info.location[0] || hop == MIMI_WEB_FETCH_MAX_REDIRECTS) break;
+
+        char next[FETCH_URL_MAX];
+        html_text_resolve_url(st->url, st->info.location, next, sizeof(next));
+        if (!next[0]) break;
+        strcpy(st->url, next);
+        ESP_LOGI(TAG, "Redirected to %s", st->url);
+    }
+
+    /* A 200 with an empty body never reached proxy_feed */
+    if (st->info.status == 200 && !st->started) fetch_begin(st);
+    return ESP_OK;
+}
+
+/* ── Execute ──────────────────────────────────────────────────── */
+
+static void fetch_error(const fetch_state_t *st, esp_err_t err, char *output, size_t output_size)
+{
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+        snprintf(output, output_size, "Error: Only https:// URLs can be fetched through the proxy");
+    } else if (st->unsupported) {
+        snprintf(output, output_size, "Error: Not a text page (Content-Type: %s)", st->info.content_type);
+    } else if (is_redirect(st->info.status)) {
+        snprintf(output, output_size, "Error: Too many redirects (last: %s)", st->url);
+    } else if (st->info.status > 0) {
+        snprintf(output, output_size, "Error: HTTP %d fetching %s", st->info.status, st->url);
+    } else {
+        snprintf(output, output_size, "Error: Fetch failed (%s)", esp_err_to_name(err));
+    }
+}
+
+esp_err_t tool_web_fetch_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *input = cJSON_Parse(input_json);
+    if (!input) {
+        snprintf(output, output_size, "Error: Invalid input JSON");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cJSON *url = cJSON_GetObjectItem(input, "url");
+    if (!url || !cJSON_IsString(url) ||
+        (strncasecmp(url->valuestring, "http://", 7) != 0 &&
+         strncasecmp(url->valuestring, "https://", 8) != 0)) {
+        cJSON_Delete(input);
+        snprintf(output, output_size, "Error: 'url' must be an http:// or https:// URL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strlen(url->valuestring) >= FETCH_URL_MAX) {
+        cJSON_Delete(input);
+        snprintf(output, output_size, "Error: URL too long (max %d)", FETCH_URL_MAX - 1);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t max_chars = MIMI_WEB_FETCH_MAX_TEXT;
+    cJSON *mc = cJSON_GetObjectItem(input, "max_chars");
+    if (cJSON_IsNumber(mc) && mc->valuedouble >= 1 && mc->valuedouble < max_chars) {
+        max_chars = (size_t)mc->valuedouble;
+    }
+    if (max_chars + FETCH_HEAD_RESERVE + 1 > output_size) {
+        max_chars = output_size > FETCH_HEAD_RESERVE + 1 ? output_size - FETCH_HEAD_RESERVE - 1 : 0;
+    }
+
+    fetch_state_t *st = heap_caps_calloc(1, sizeof(*st), MALLOC_CAP_SPIRAM);
+    if (!st || max_chars == 0) {
+        free(st);
+        cJSON_Delete(input);
+        snprintf(output, output_size, "Error: Out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+    strcpy(st->url, url->valuestring);
+    cJSON_Delete(input);
+    st->out = output;
+    st->cap = max_chars + 1;
+    output[0] = '\0';
+
+    ESP_LOGI(TAG, "Fetching %s", st->url);
+    esp_err_t err = http_proxy_is_enabled() ? fetch_via_proxy(st) : fetch_direct(st);
+
+    if (!st->started) {
+        fetch_error(st, err, output, output_size);
+        ESP_LOGW(TAG, "%s", output);
+        free(st);
+        return err != ESP_OK ? err : ESP_FAIL;
+    }
+
+    /* Text is at the start of output; put the URL line in front of it */
+    size_t len = html_text_finish(&st->ht);
+    char head[FETCH_URL_MAX / 2 + 16];
+    int hlen = snprintf(head, sizeof(head), "URL: %.*s\n\n", FETCH_URL_MAX / 2, st->url);
+    memmove(output + hlen, output, len + 1);
+    memcpy(output, head, hlen);
+
+    size_t off = hlen + len;
+    if (len == 0) {
+        off += snprintf(output + off, output_size - off, "(no readable text)");
+    }
+    if (st->ht.full) {
+        snprintf(output + off, output_size - off, "\n\n[... truncated at %u chars]", (unsigned)max_chars);
+    } else if (st->capped) {
+        snprintf(output + off, output_size - off, "\n\n[... page cut off after %u KB]",
+                 (unsigned)(MIMI_WEB_FETCH_MAX_BYTES / 1024));
+    } else if (err != ESP_OK) {
+        snprintf(output + off, output_size - off, "\n\n[... connection dropped, text may be incomplete]");
+    }
+
+    ESP_LOGI(TAG, "Read %u bytes, %u chars of text%s", (unsigned)st->bytes, (unsigned)len,
+             st->ht.full ? ", stopped early" : "");
+    free(st);
+    return ESP_OK;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+/**
+ * Execute web_fetch: download a page and return it as compact text.
+ *
+ * The body is converted while it streams in (see html_text.h), so memory
+ * use does not depend on the page size. Reading stops once the text budget
+ * or MIMI_WEB_FETCH_MAX_BYTES is reached. Redirects are followed.
+ *
+ * @param input_json   JSON string with "url" and optional "max_chars"
+ * @param output       Output buffer for the page text
+ * @param output_size  Size of output buffer
+ * @return ESP_OK on success
+ */
+esp_err_t tool_web_fetch_execute(const char *input_json, char *output, size_t output_size);
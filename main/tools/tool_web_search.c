@@ -1,10 +1,13 @@
 #include "tool_web_search.h"
 #include "mimi_config.h"
 #include "proxy/http_proxy.h"
+#include "tools/search_cache.h"
+#include "tools/json_stream.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_heap_caps.h"
@@ -15,30 +18,8 @@ static const char *TAG = "web_search";
 
 static char s_search_key[128] = {0};
 
-#define SEARCH_BUF_SIZE     (16 * 1024)
 #define SEARCH_RESULT_COUNT 5
-
-/* ── Response accumulator ─────────────────────────────────────── */
-
-typedef struct {
-    char *data;
-    size_t len;
-    size_t cap;
-} search_buf_t;
-
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
-{
-    search_buf_t *sb = (search_buf_t *)evt->user_data;
-    if (evt->event_id == HTTP_EVENT_ON_DATA) {
-        size_t needed = sb->len + evt->data_len;
-        if (needed < sb->cap) {
-            memcpy(sb->data + sb->len, evt->data, evt->data_len);
-            sb->len += evt->data_len;
-            sb->data[sb->len] = '\0';
-        }
-    }
-    return ESP_OK;
-}
+#define SEARCH_READ_CHUNK   1024
 
 /* ── Init ─────────────────────────────────────────────────────── */
 
@@ -60,6 +41,8 @@ esp_err_t tool_web_search_init(void)
         nvs_close(nvs);
     }
 
+    search_cache_init();
+
     if (s_search_key[0]) {
         ESP_LOGI(TAG, "Web search initialized (key configured)");
     } else {
@@ -92,52 +75,74 @@ static size_t url_encode(const char *src, char *dst, size_t dst_size)
     return pos;
 }
 
-/* ── Format results as readable text ──────────────────────────── */
+/* ── Streaming result extraction ──────────────────────────────── */
 
-static void format_results(cJSON *root, char *output, size_t output_size)
+/*
+ * The response is scanned as it arrives: only web.results[].title/url/
+ * description are kept, each result is formatted into the output when its
+ * object closes, and reading stops after SEARCH_RESULT_COUNT results. Memory
+ * use does not depend on the response size.
+ */
+typedef struct {
+    json_stream_t js;
+    char val[1024];                    /* scalar being scanned */
+    char title[256];
+    char url[512];
+    char desc[1024];
+    int count;
+    size_t bytes;                      /* body bytes received */
+    char *output;
+    size_t output_size;
+    size_t off;
+} search_scan_t;
+
+static void copy_field(char *dst, size_t size, const char *val)
 {
-    cJSON *web = cJSON_GetObjectItem(root, "web");
-    if (!web) {
-        snprintf(output, output_size, "No web results found.");
-        return;
-    }
+    strncpy(dst, val, size - 1);
+    dst[size - 1] = '\0';
+}
 
-    cJSON *results = cJSON_GetObjectItem(web, "results");
-    if (!results || !cJSON_IsArray(results) || cJSON_GetArraySize(results) == 0) {
-        snprintf(output, output_size, "No web results found.");
-        return;
+static bool scan_event(void *ctx, const json_stream_t *js, json_ev_t ev, const char *val, size_t len)
+{
+    search_scan_t *sc = ctx;
+
+    if (ev == JSON_EV_END) {
+        if (!json_stream_match(js, "web.results[]")) return true;
+
+        if (sc->off < sc->output_size - 1) {
+            sc->off += snprintf(sc->output + sc->off, sc->output_size - sc->off,
+                "%d. %s\n   %s\n   %s\n\n",
+                sc->count + 1, sc->title[0] ? sc->title : "(no title)", sc->url, sc->desc);
+        }
+        sc->title[0] = sc->url[0] = sc->desc[0] = '\0';
+        return ++sc->count < SEARCH_RESULT_COUNT;
     }
 
-    size_t off = 0;
-    int idx = 0;
-    cJSON *item;
-    cJSON_ArrayForEach(item, results) {
-        if (idx >= SEARCH_RESULT_COUNT) break;
-
-        cJSON *title = cJSON_GetObjectItem(item, "title");
-        cJSON *url = cJSON_GetObjectItem(item, "url");
-        cJSON *desc = cJSON_GetObjectItem(item, "description");
-
-        off += snprintf(output + off, output_size - off,
-            "%d. %s\n   %s\n   %s\n\n",
-            idx + 1,
-            (title && cJSON_IsString(title)) ? title->valuestring : "(no title)",
-            (url && cJSON_IsString(url)) ? url->valuestring : "",
-            (desc && cJSON_IsString(desc)) ? desc->valuestring : "");
-
-        if (off >= output_size - 1) break;
-        idx++;
+    if (ev != JSON_EV_STRING) return true;
+    if (json_stream_match(js, "web.results[].title")) {
+        copy_field(sc->title, sizeof(sc->title), val);
+    } else if (json_stream_match(js, "web.results[].url")) {
+        copy_field(sc->url, sizeof(sc->url), val);
+    } else if (json_stream_match(js, "web.results[].description")) {
+        copy_field(sc->desc, sizeof(sc->desc), val);
     }
+    return true;
+}
+
+/* Body bytes from either transport; false stops the download */
+static bool scan_feed(void *ctx, const char *data, size_t len)
+{
+    search_scan_t *sc = ctx;
+    sc->bytes += len;
+    return json_stream_feed(&sc->js, data, len) == JSON_STREAM_OK;
 }
 
 /* ── Direct HTTPS request ─────────────────────────────────────── */
 
-static esp_err_t search_direct(const char *url, search_buf_t *sb)
+static esp_err_t search_direct(const char *url, search_scan_t *sc)
 {
     esp_http_client_config_t config = {
         .url = url,
-        .event_handler = http_event_handler,
-        .user_data = sb,
         .timeout_ms = 15000,
         .buffer_size = 4096,
         .crt_bundle_attach = esp_crt_bundle_attach,
@@ -149,21 +154,41 @@ static esp_err_t search_direct(const char *url, search_buf_t *sb)
     esp_http_client_set_header(client, "Accept", "application/json");
     esp_http_client_set_header(client, "X-Subscription-Token", s_search_key);
 
-    esp_err_t err = esp_http_client_perform(client);
-    int status = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    /* open/read instead of perform() so the download can stop early */
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err != ESP_OK) {
+        esp_http_client_cleanup(client);
+        return err;
+    }
+    if (esp_http_client_fetch_headers(client) < 0) {
+        esp_http_client_cleanup(client);
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
 
-    if (err != ESP_OK) return err;
+    int status = esp_http_client_get_status_code(client);
     if (status != 200) {
         ESP_LOGE(TAG, "Search API returned %d", status);
+        esp_http_client_cleanup(client);
         return ESP_FAIL;
     }
-    return ESP_OK;
+
+    char buf[SEARCH_READ_CHUNK];
+    while (1) {
+        int n = esp_http_client_read(client, buf, sizeof(buf));
+        if (n < 0) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        if (n == 0 || !scan_feed(sc, buf, n)) break;
+    }
+
+    esp_http_client_cleanup(client);
+    return err;
 }
 
 /* ── Proxy HTTPS request ──────────────────────────────────────── */
 
-static esp_err_t search_via_proxy(const char *path, search_buf_t *sb)
+static esp_err_t search_via_proxy(const char *path, search_scan_t *sc)
 {
     proxy_conn_t *conn = proxy_conn_open("api.search.brave.com", 443, 15000);
     if (!conn) return ESP_ERR_HTTP_CONNECT;
@@ -182,39 +207,9 @@ static esp_err_t search_via_proxy(const char *path, search_buf_t *sb)
         return ESP_ERR_HTTP_WRITE_DATA;
     }
 
-    /* Read full response */
-    char tmp[4096];
-    size_t total = 0;
-    while (1) {
-        int n = proxy_conn_read(conn, tmp, sizeof(tmp), 15000);
-        if (n <= 0) break;
-        size_t copy = (total + n < sb->cap - 1) ? (size_t)n : sb->cap - 1 - total;
-        if (copy > 0) {
-            memcpy(sb->data + total, tmp, copy);
-            total += copy;
-        }
-    }
-    sb->data[total] = '\0';
-    sb->len = total;
+    int status = proxy_conn_read_response(conn, 15000, NULL, scan_feed, sc);
     proxy_conn_close(conn);
 
-    /* Check status */
-    int status = 0;
-    if (total > 5 && strncmp(sb->data, "HTTP/", 5) == 0) {
-        const char *sp = strchr(sb->data, ' ');
-        if (sp) status = atoi(sp + 1);
-    }
-
-    /* Strip headers */
-    char *body = strstr(sb->data, "\r\n\r\n");
-    if (body) {
-        body += 4;
-        size_t blen = total - (body - sb->data);
-        memmove(sb->data, body, blen);
-        sb->len = blen;
-        sb->data[sb->len] = '\0';
-    }
-
     if (status != 200) {
         ESP_LOGE(TAG, "Search API returned %d via proxy", status);
         return ESP_FAIL;
@@ -224,77 +219,101 @@ static esp_err_t search_via_proxy(const char *path, search_buf_t *sb)
 
 /* ── Execute ──────────────────────────────────────────────────── */
 
-esp_err_t tool_web_search_execute(const char *input_json, char *output, size_t output_size)
+/* *complete is false when the results may be cut short (not worth caching) */
+static esp_err_t search_fetch(const char *query, char *output, size_t output_size, bool *complete)
 {
-    if (s_search_key[0] == '\0') {
-        snprintf(output, output_size, "Error: No search API key configured. Set MIMI_SECRET_SEARCH_KEY in mimi_secrets.h");
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    /* Parse input to get query */
-    cJSON *input = cJSON_Parse(input_json);
-    if (!input) {
-        snprintf(output, output_size, "Error: Invalid input JSON");
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    cJSON *query = cJSON_GetObjectItem(input, "query");
-    if (!query || !cJSON_IsString(query) || query->valuestring[0] == '\0') {
-        cJSON_Delete(input);
-        snprintf(output, output_size, "Error: Missing 'query' field");
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    ESP_LOGI(TAG, "Searching: %s", query->valuestring);
-
     /* Build URL */
     char encoded_query[256];
-    url_encode(query->valuestring, encoded_query, sizeof(encoded_query));
-    cJSON_Delete(input);
+    url_encode(query, encoded_query, sizeof(encoded_query));
 
     char path[384];
     snprintf(path, sizeof(path),
              "/res/v1/web/search?q=%s&count=%d", encoded_query, SEARCH_RESULT_COUNT);
 
-    /* Allocate response buffer from PSRAM */
-    search_buf_t sb = {0};
-    sb.data = heap_caps_calloc(1, SEARCH_BUF_SIZE, MALLOC_CAP_SPIRAM);
-    if (!sb.data) {
+    search_scan_t *sc = heap_caps_calloc(1, sizeof(*sc), MALLOC_CAP_SPIRAM);
+    if (!sc) {
         snprintf(output, output_size, "Error: Out of memory");
         return ESP_ERR_NO_MEM;
     }
-    sb.cap = SEARCH_BUF_SIZE;
+    sc->output = output;
+    sc->output_size = output_size;
+    output[0] = '\0';
+    json_stream_init(&sc->js, sc->val, sizeof(sc->val), scan_event, sc);
 
     /* Make HTTP request */
     esp_err_t err;
     if (http_proxy_is_enabled()) {
-        err = search_via_proxy(path, &sb);
+        err = search_via_proxy(path, sc);
     } else {
         char url[512];
         snprintf(url, sizeof(url), "https://api.search.brave.com%s", path);
-        err = search_direct(url, &sb);
+        err = search_direct(url, sc);
     }
 
+    int count = sc->count;
+    json_stream_status_t scan = sc->js.status;
+    /* Whole document read, or scanning stopped because we had enough */
+    *complete = err == ESP_OK &&
+                (scan == JSON_STREAM_STOPPED || (scan == JSON_STREAM_OK && sc->js.depth == 0 && sc->bytes > 0));
+    ESP_LOGI(TAG, "Read %u bytes for %d results%s", (unsigned)sc->bytes, count,
+             scan == JSON_STREAM_STOPPED ? ", stopped early" : "");
+    free(sc);
+
+    /* Results that arrived before a dropped connection are still good, just not cached */
+    if (count > 0) return ESP_OK;
+
     if (err != ESP_OK) {
-        free(sb.data);
         snprintf(output, output_size, "Error: Search request failed");
         return err;
     }
-
-    /* Parse and format results */
-    cJSON *root = cJSON_Parse(sb.data);
-    free(sb.data);
-
-    if (!root) {
+    if (scan == JSON_STREAM_ERROR) {
         snprintf(output, output_size, "Error: Failed to parse search results");
         return ESP_FAIL;
     }
+    snprintf(output, output_size, "No web results found.");
+    return ESP_OK;
+}
 
-    format_results(root, output, output_size);
-    cJSON_Delete(root);
+esp_err_t tool_web_search_execute(const char *input_json, char *output, size_t output_size)
+{
+    if (s_search_key[0] == '\0') {
+        snprintf(output, output_size, "Error: No search API key configured. Set MIMI_SECRET_SEARCH_KEY in mimi_secrets.h");
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    ESP_LOGI(TAG, "Search complete, %d bytes result", (int)strlen(output));
-    return ESP_OK;
+    /* Parse input to get query */
+    cJSON *input = cJSON_Parse(input_json);
+    if (!input) {
+        snprintf(output, output_size, "Error: Invalid input JSON");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cJSON *query = cJSON_GetObjectItem(input, "query");
+    if (!query || !cJSON_IsString(query) || query->valuestring[0] == '\0') {
+        cJSON_Delete(input);
+        snprintf(output, output_size, "Error: Missing 'query' field");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (search_cache_lookup(query->valuestring, output, output_size) == SEARCH_CACHE_HIT) {
+        ESP_LOGI(TAG, "Cache hit: %s", query->valuestring);
+        cJSON_Delete(input);
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Searching: %s", query->valuestring);
+
+    int64_t t0 = esp_timer_get_time();
+    bool complete = false;
+    esp_err_t err = search_fetch(query->valuestring, output, output_size, &complete);
+    search_cache_complete(query->valuestring, err == ESP_OK && complete ? output : NULL,
+                          esp_timer_get_time() - t0);
+    cJSON_Delete(input);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Search complete, %d bytes result", (int)strlen(output));
+    }
+    return err;
 }
 
 esp_err_t tool_web_search_set_key(const char *api_key)
@@ -0,0 +1,332 @@
+#include "dlog.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+static const char *TAG = "dlog";
+
+#define DLOG_MAX_ARGS   8
+#define DLOG_ALIGN      8
+#define DLOG_MSG_MAX    384
+
+enum {
+    REC_EMPTY = 0,              /* being written, or already consumed (span zeroed) */
+    REC_READY,
+    REC_PAD,                    /* skip to the start of the ring */
+};
+
+/* Record layout in the ring: header, then string bytes referenced by args */
+typedef struct {
+    uint16_t len;               /* whole record incl. strings, multiple of DLOG_ALIGN */
+    volatile uint8_t state;
+    uint8_t level;
+    uint8_t nargs;
+    uint8_t types[DLOG_MAX_ARGS];
+    uint32_t ts_ms;
+    const char *tag;
+    const char *fmt;
+    union {
+        int64_t i;
+        double d;
+        uint32_t str_off;       /* offset of the copied string from the record start */
+        const void *p;
+    } vals[DLOG_MAX_ARGS];
+} dlog_rec_t;
+
+static uint8_t *s_ring = NULL;          /* PSRAM, MIMI_DLOG_RING_SIZE bytes */
+/* Monotonic byte positions; kept in internal RAM so the atomics work */
+static uint32_t s_head = 0;             /* next byte to reserve */
+static uint32_t s_tail = 0;             /* next byte to consume */
+static uint32_t s_dropped = 0;
+static uint32_t s_dropped_reported = 0;
+static uint32_t s_draining = 0;          /* single consumer: drain task vs. dlog_flush() */
+
+_Static_assert(MIMI_DLOG_RING_SIZE % DLOG_ALIGN == 0 && MIMI_DLOG_RING_SIZE <= 65535,
+               "record len is 16 bits and must stay aligned across the wrap");
+
+/* ── Formatting ───────────────────────────────────────────────── */
+
+static bool is_conversion(char c)
+{
+    return c && strchr("diouxXcspfFeEgGaA", c) != NULL;
+}
+
+/* Render fmt with args into out, one conversion spec at a time through snprintf */
+static void dlog_format(char *out, size_t size, const char *fmt, const dlog_arg_t *args, int nargs)
+{
+    size_t o = 0;
+    int ai = 0;
+    const char *p = fmt;
+
+    while (*p && o + 1 < size) {
+        if (*p != '%') {
+            out[o++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[o++] = '%';
+            p += 2;
+            continue;
+        }
+
+        /* Copy flags/width/precision, drop length modifiers, find the conversion */
+        char spec[24];
+        size_t sl = 0;
+        const char *q = p + 1;
+        spec[sl++] = '%';
+        while (*q && strchr("-+ #0123456789.", *q) && sl < sizeof(spec) - 4) {
+            spec[sl++] = *q++;
+        }
+        bool long_mod = false;
+        while (*q && strchr("hlljzt", *q)) {
+            if (*q == 'l' || *q == 'j') long_mod = true;
+            q++;
+        }
+        char conv = *q;
+        if (!is_conversion(conv) || ai >= nargs) {
+            /* Unsupported or missing argument: emit the spec verbatim */
+            size_t n = (size_t)(q - p) + (conv ? 1 : 0);
+            if (n > size - 1 - o) n = size - 1 - o;
+            memcpy(out + o, p, n);
+            o += n;
+            p = q + (conv ? 1 : 0);
+            continue;
+        }
+
+        const dlog_arg_t *a = &args[ai++];
+        int n = 0;
+        size_t room = size - o;
+        switch (conv) {
+        case 'd': case 'i':
+            memcpy(spec + sl, "ll", 2);
+            spec[sl + 2] = conv;
+            spec[sl + 3] = '\0';
+            n = snprintf(out + o, room, spec, (long long)a->i);
+            break;
+        case 'o': case 'u': case 'x': case 'X': {
+            unsigned long long v = (unsigned long long)a->i;
+            if (!long_mod) v &= 0xffffffffULL;      /* %x of a negative int */
+            memcpy(spec + sl, "ll", 2);
+            spec[sl + 2] = conv;
+            spec[sl + 3] = '\0';
+            n = snprintf(out + o, room, spec, v);
+            break;
+        }
+        case 'c':
+            spec[sl] = 'c';
+            spec[sl + 1] = '\0';
+            n = snprintf(out + o, room, spec, (int)a->i);
+            break;
+        case 's':
+            spec[sl] = 's';
+            spec[sl + 1] = '\0';
+            n = snprintf(out + o, room, spec, a->type == DLOG_ARG_STR && a->s ? a->s : "(?)");
+            break;
+        case 'p':
+            n = snprintf(out + o, room, "%p", a->type == DLOG_ARG_PTR ? a->p : (const void *)(uintptr_t)a->i);
+            break;
+        default:
+            spec[sl] = conv;
+            spec[sl + 1] = '\0';
+            n = snprintf(out + o, room, spec, a->type == DLOG_ARG_DBL ? a->d : (double)a->i);
+            break;
+        }
+        if (n > 0) o += ((size_t)n < room) ? (size_t)n : room - 1;
+        p = q + 1;
+    }
+    out[o] = '\0';
+
+    /* One record, one line */
+    for (size_t i = 0; i < o; i++) {
+        if (out[i] == '\n' || out[i] == '\r' || out[i] == '\t') out[i] = ' ';
+    }
+}
+
+static void dlog_emit(esp_log_level_t level, const char *tag, const char *fmt,
+                      const dlog_arg_t *args, int nargs, uint32_t ts_ms)
+{
+    static const char letters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+    char msg[DLOG_MSG_MAX];
+    dlog_format(msg, sizeof(msg), fmt, args, nargs);
+    esp_log_write(level, tag, "%c (%u) %s: %s\n",
+                  letters[level < sizeof(letters) ? level : 0], (unsigned)ts_ms, tag, msg);
+}
+
+/* ── Producer ─────────────────────────────────────────────────── */
+
+void dlog_write(esp_log_level_t level, const char *tag, const char *fmt,
+                const dlog_arg_t *args, int nargs)
+{
+    if (nargs > DLOG_MAX_ARGS) nargs = DLOG_MAX_ARGS;
+
+    size_t slen[DLOG_MAX_ARGS];
+    size_t need = sizeof(dlog_rec_t);
+    for (int i = 0; i < nargs; i++) {
+        if (args[i].type == DLOG_ARG_STR) {
+            slen[i] = args[i].s ? strnlen(args[i].s, MIMI_DLOG_STR_MAX) : 0;
+            need += slen[i] + 1;
+        }
+    }
+    uint32_t len = (need + DLOG_ALIGN - 1) & ~(uint32_t)(DLOG_ALIGN - 1);
+
+    if (!s_ring) {
+        /* Before dlog_init(): format on the spot */
+        dlog_emit(level, tag, fmt, args, nargs, esp_log_timestamp());
+        return;
+    }
+
+    /* Reserve space with a CAS on the head; wrap with a padding record */
+    uint32_t head, pad, next;
+    do {
+        head = __atomic_load_n(&s_head, __ATOMIC_RELAXED);
+        uint32_t pos = head % MIMI_DLOG_RING_SIZE;
+        pad = (pos + len > MIMI_DLOG_RING_SIZE) ? MIMI_DLOG_RING_SIZE - pos : 0;
+        next = head + pad + len;
+        uint32_t tail = __atomic_load_n(&s_tail, __ATOMIC_ACQUIRE);
+        if (next - tail > MIMI_DLOG_RING_SIZE) {
+            __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&s_head, &head, next, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    uint32_t pos = head % MIMI_DLOG_RING_SIZE;
+    if (pad) {
+        dlog_rec_t *p = (dlog_rec_t *)(s_ring + pos);
+        p->len = pad;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        p->state = REC_PAD;
+        pos = 0;
+    }
+
+    dlog_rec_t *rec = (dlog_rec_t *)(s_ring + pos);
+    rec->len = len;
+    rec->level = level;
+    rec->nargs = nargs;
+    rec->ts_ms = esp_log_timestamp();
+    rec->tag = tag;
+    rec->fmt = fmt;
+
+    uint32_t off = sizeof(dlog_rec_t);
+    for (int i = 0; i < nargs; i++) {
+        rec->types[i] = args[i].type;
+        switch (args[i].type) {
+        case DLOG_ARG_STR:
+            memcpy((uint8_t *)rec + off, args[i].s ? args[i].s : "", slen[i]);
+            ((uint8_t *)rec)[off + slen[i]] = '\0';
+            rec->vals[i].str_off = off;
+            off += slen[i] + 1;
+            break;
+        case DLOG_ARG_DBL:
+            rec->vals[i].d = args[i].d;
+            break;
+        case DLOG_ARG_PTR:
+            rec->vals[i].p = args[i].p;
+            break;
+        default:
+            rec->vals[i].i = args[i].i;
+            break;
+        }
+    }
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    rec->state = REC_READY;
+}
+
+/* ── Drain ────────────────────────────────────────────────────── */
+
+/* Format every committed record; returns the number handled */
+static int dlog_drain_pending(void)
+{
+    int handled = 0;
+    dlog_arg_t args[DLOG_MAX_ARGS];
+
+    if (__atomic_exchange_n(&s_draining, 1, __ATOMIC_ACQUIRE)) return 0;
+
+    uint32_t tail = s_tail;
+    uint32_t head = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+
+    while (tail != head) {
+        dlog_rec_t *rec = (dlog_rec_t *)(s_ring + tail % MIMI_DLOG_RING_SIZE);
+        uint8_t state = rec->state;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (state == REC_EMPTY) break;          /* producer still writing */
+
+        uint32_t len = rec->len;
+        if (state == REC_READY) {
+            for (int i = 0; i < rec->nargs; i++) {
+                args[i].type = rec->types[i];
+                switch (rec->types[i]) {
+                case DLOG_ARG_STR: args[i].s = (const char *)rec + rec->vals[i].str_off; break;
+                case DLOG_ARG_DBL: args[i].d = rec->vals[i].d; break;
+                case DLOG_ARG_PTR: args[i].p = rec->vals[i].p; break;
+                default:           args[i].i = rec->vals[i].i; break;
+                }
+            }
+            dlog_emit(rec->level, rec->tag, rec->fmt, args, rec->nargs, rec->ts_ms);
+            handled++;
+        }
+
+        /* Clear the whole span, not just this header: a later record may
+         * put its header anywhere in here, and until its producer writes
+         * it the consumer must read REC_EMPTY rather than stale bytes */
+        memset(rec, 0, len);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        tail += len;
+        __atomic_store_n(&s_tail, tail, __ATOMIC_RELEASE);
+    }
+
+    uint32_t dropped = __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+    if (dropped != s_dropped_reported) {
+        esp_log_write(ESP_LOG_WARN, TAG, "W (%u) %s: %u records dropped (ring full)\n",
+                      (unsigned)esp_log_timestamp(), TAG, (unsigned)(dropped - s_dropped_reported));
+        s_dropped_reported = dropped;
+    }
+
+    __atomic_store_n(&s_draining, 0, __ATOMIC_RELEASE);
+    return handled;
+}
+
+static void dlog_drain_task(void *arg)
+{
+    while (1) {
+        dlog_drain_pending();
+        vTaskDelay(pdMS_TO_TICKS(MIMI_DLOG_DRAIN_MS));
+    }
+}
+
+esp_err_t dlog_init(void)
+{
+    s_ring = heap_caps_calloc(1, MIMI_DLOG_RING_SIZE, MALLOC_CAP_SPIRAM);
+    if (!s_ring) {
+        ESP_LOGW(TAG, "No PSRAM for log ring, logging synchronously");
+        return ESP_OK;
+    }
+
+    if (xTaskCreatePinnedToCore(dlog_drain_task, "dlog", MIMI_DLOG_DRAIN_STACK, NULL,
+                                MIMI_DLOG_DRAIN_PRIO, NULL, MIMI_DLOG_DRAIN_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create drain task");
+        free(s_ring);
+        s_ring = NULL;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Deferred log ring: %d bytes", MIMI_DLOG_RING_SIZE);
+    return ESP_OK;
+}
+
+void dlog_flush(void)
+{
+    if (s_ring) dlog_drain_pending();
+}
+
+uint32_t dlog_dropped(void)
+{
+    return __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
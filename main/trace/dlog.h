@@ -0,0 +1,113 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include <stdint.h>
+
+#include "mimi_config.h"
+
+/**
+ * Deferred logging for hot paths.
+ *
+ *   DLOGI(TAG, "Tool %s result: %d bytes", name, len);
+ *
+ * The call site only stores the format pointer, tag pointer, timestamp and the
+ * raw arguments (strings are copied, truncated to MIMI_DLOG_STR_MAX) into a
+ * PSRAM ring. A low-priority drain task formats the records and writes them
+ * through esp_log_write(), so per-tag log levels still apply.
+ *
+ * Format strings and tags must be string literals / static storage.
+ * Supported conversions: d i u o x X c s p and f e g (length modifiers are
+ * accepted and ignored; integers are carried as 64 bits). '*' width is not
+ * supported. At most 8 arguments.
+ */
+
+typedef enum {
+    DLOG_ARG_INT = 0,
+    DLOG_ARG_DBL,
+    DLOG_ARG_STR,
+    DLOG_ARG_PTR,
+} dlog_arg_type_t;
+
+typedef struct {
+    dlog_arg_type_t type;
+    union {
+        int64_t i;
+        double d;
+        const char *s;
+        const void *p;
+    };
+} dlog_arg_t;
+
+static inline dlog_arg_t dlog_arg_int(int64_t v) { dlog_arg_t a = { .type = DLOG_ARG_INT, .i = v }; return a; }
+static inline dlog_arg_t dlog_arg_u64(uint64_t v) { dlog_arg_t a = { .type = DLOG_ARG_INT, .i = (int64_t)v }; return a; }
+static inline dlog_arg_t dlog_arg_dbl(double v) { dlog_arg_t a = { .type = DLOG_ARG_DBL, .d = v }; return a; }
+static inline dlog_arg_t dlog_arg_str(const char *v) { dlog_arg_t a = { .type = DLOG_ARG_STR, .s = v }; return a; }
+static inline dlog_arg_t dlog_arg_ptr(const void *v) { dlog_arg_t a = { .type = DLOG_ARG_PTR, .p = v }; return a; }
+
+#define DLOG_ARG(x) _Generic((x),                                   \
+    char *: dlog_arg_str, const char *: dlog_arg_str,               \
+    float: dlog_arg_dbl, double: dlog_arg_dbl,                      \
+    unsigned long long: dlog_arg_u64,                               \
+    void *: dlog_arg_ptr, const void *: dlog_arg_ptr,               \
+    default: dlog_arg_int)(x)
+
+/* Map DLOG_ARG over 0..8 arguments, each followed by a comma */
+#define DLOG_NARG(...) DLOG_NARG_(_, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARG_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+#define DLOG_CAT(a, b) DLOG_CAT_(a, b)
+#define DLOG_CAT_(a, b) a##b
+#define DLOG_MAP_0()
+#define DLOG_MAP_1(a) DLOG_ARG(a),
+#define DLOG_MAP_2(a, ...) DLOG_ARG(a), DLOG_MAP_1(__VA_ARGS__)
+#define DLOG_MAP_3(a, ...) DLOG_ARG(a), DLOG_MAP_2(__VA_ARGS__)
+#define DLOG_MAP_4(a, ...) DLOG_ARG(a), DLOG_MAP_3(__VA_ARGS__)
+#define DLOG_MAP_5(a, ...) DLOG_ARG(a), DLOG_MAP_4(__VA_ARGS__)
+#define DLOG_MAP_6(a, ...) DLOG_ARG(a), DLOG_MAP_5(__VA_ARGS__)
+#define DLOG_MAP_7(a, ...) DLOG_ARG(a), DLOG_MAP_6(__VA_ARGS__)
+#define DLOG_MAP_8(a, ...) DLOG_ARG(a), DLOG_MAP_7(__VA_ARGS__)
+#define DLOG_MAP(...) DLOG_CAT(DLOG_MAP_, DLOG_NARG(__VA_ARGS__))(__VA_ARGS__)
+
+#if MIMI_DLOG_ENABLED
+
+#define DLOG_LEVEL(level, tag, fmt, ...) do {                                   \
+        if ((level) <= LOG_LOCAL_LEVEL) {                                       \
+            const dlog_arg_t _dlog_args[] = { dlog_arg_int(0), DLOG_MAP(__VA_ARGS__) }; \
+            dlog_write((level), (tag), (fmt), _dlog_args + 1,                   \
+                       (int)(sizeof(_dlog_args) / sizeof(_dlog_args[0])) - 1);  \
+        }                                                                       \
+    } while (0)
+
+#else
+
+#define DLOG_LEVEL(level, tag, fmt, ...) \
+    ESP_LOG_LEVEL_LOCAL((level), (tag), fmt, ##__VA_ARGS__)
+
+#endif
+
+#define DLOGE(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_WARN,  tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_INFO,  tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+
+/**
+ * Allocate the ring in PSRAM and start the drain task. Records written
+ * before this are formatted synchronously.
+ */
+esp_err_t dlog_init(void);
+
+/**
+ * Record one log entry (use the DLOGx macros).
+ */
+void dlog_write(esp_log_level_t level, const char *tag, const char *fmt,
+                const dlog_arg_t *args, int nargs);
+
+/**
+ * Format and output everything pending on the calling task (e.g. before restart).
+ */
+void dlog_flush(void);
+
+/**
+ * Number of records dropped because the ring was full.
+ */
+uint32_t dlog_dropped(void);
@@ -0,0 +1,219 @@
+#include "heap_sampler.h"
+#include "trace/turn_trace.h"
+#include "mimi_config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "heap_mon";
+
+typedef struct {
+    uint32_t free;
+    uint32_t largest;
+    uint32_t min_free;
+} heap_region_t;
+
+typedef struct {
+    int64_t ts_us;
+    uint32_t turn_id;           /* 0 = idle */
+    const char *reason;         /* static string */
+    heap_region_t internal;
+    heap_region_t psram;
+} heap_sample_t;
+
+typedef struct {
+    int64_t ts_us;
+    uint32_t turn_id;
+    uint32_t size;
+    uint32_t caps;
+    char task[16];
+    const char *func;           /* allocator entry point, static string */
+} heap_failure_t;
+
+static heap_sample_t *s_samples = NULL;     /* MIMI_HEAP_SAMPLE_RING entries, PSRAM */
+static int s_sample_head = 0;
+static int s_sample_count = 0;
+
+/* Kept in internal RAM: the hook must not allocate and may run when PSRAM is the problem */
+static heap_failure_t s_failures[MIMI_HEAP_FAIL_RING];
+static int s_fail_head = 0;
+static int s_fail_count = 0;
+static uint32_t s_fail_total = 0;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static TimerHandle_t s_timer = NULL;
+
+static void region_read(uint32_t caps, heap_region_t *out)
+{
+    out->free = heap_caps_get_free_size(caps);
+    out->largest = heap_caps_get_largest_free_block(caps);
+    out->min_free = heap_caps_get_minimum_free_size(caps);
+}
+
+static void failed_alloc_hook(size_t size, uint32_t caps, const char *function_name)
+{
+    const char *task = pcTaskGetName(NULL);
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+    heap_failure_t *f = &s_failures[s_fail_head];
+    f->ts_us = esp_timer_get_time();
+    f->turn_id = turn_trace_active_id();
+    f->size = (uint32_t)size;
+    f->caps = caps;
+    f->func = function_name;
+    strncpy(f->task, task ? task : "?", sizeof(f->task) - 1);
+    f->task[sizeof(f->task) - 1] = '\0';
+    s_fail_head = (s_fail_head + 1) % MIMI_HEAP_FAIL_RING;
+    if (s_fail_count < MIMI_HEAP_FAIL_RING) s_fail_count++;
+    s_fail_total++;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+esp_err_t heap_sampler_init(void)
+{
+    s_samples = heap_caps_calloc(MIMI_HEAP_SAMPLE_RING, sizeof(heap_sample_t), MALLOC_CAP_SPIRAM);
+    if (!s_samples) {
+        ESP_LOGE(TAG, "Failed to allocate sample ring");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = heap_caps_register_failed_alloc_callback(failed_alloc_hook);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed-alloc hook not registered: %s", esp_err_to_name(err));
+    }
+
+    heap_sampler_sample("boot");
+    ESP_LOGI(TAG, "Heap sampler initialized (%d samples, every %ds)",
+             MIMI_HEAP_SAMPLE_RING, MIMI_HEAP_SAMPLE_INTERVAL_MS / 1000);
+    return ESP_OK;
+}
+
+void heap_sampler_sample(const char *reason)
+{
+    if (!s_samples) return;
+
+    heap_sample_t s = {
+        .ts_us = esp_timer_get_time(),
+        .turn_id = turn_trace_active_id(),
+        .reason = reason,
+    };
+    region_read(MALLOC_CAP_INTERNAL, &s.internal);
+    region_read(MALLOC_CAP_SPIRAM, &s.psram);
+
+    portENTER_CRITICAL(&s_lock);
+    s_samples[s_sample_head] = s;
+    s_sample_head = (s_sample_head + 1) % MIMI_HEAP_SAMPLE_RING;
+    if (s_sample_count < MIMI_HEAP_SAMPLE_RING) s_sample_count++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void sampler_timer_callback(TimerHandle_t xTimer)
+{
+    (void)xTimer;
+    heap_sampler_sample("periodic");
+}
+
+esp_err_t heap_sampler_start(void)
+{
+    if (s_timer) return ESP_OK;
+
+    s_timer = xTimerCreate("heap_mon", pdMS_TO_TICKS(MIMI_HEAP_SAMPLE_INTERVAL_MS),
+                           pdTRUE, NULL, sampler_timer_callback);
+    if (!s_timer || xTimerStart(s_timer, pdMS_TO_TICKS(1000)) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start sampler timer");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/* Copy out the n-th newest sample */
+static bool sample_get(int n, heap_sample_t *out)
+{
+    bool ok = false;
+    portENTER_CRITICAL(&s_lock);
+    if (n < s_sample_count) {
+        *out = s_samples[(s_sample_head - 1 - n + MIMI_HEAP_SAMPLE_RING) % MIMI_HEAP_SAMPLE_RING];
+        ok = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ok;
+}
+
+static bool failure_get(int n, heap_failure_t *out)
+{
+    bool ok = false;
+    portENTER_CRITICAL(&s_lock);
+    if (n < s_fail_count) {
+        *out = s_failures[(s_fail_head - 1 - n + MIMI_HEAP_FAIL_RING) % MIMI_HEAP_FAIL_RING];
+        ok = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ok;
+}
+
+void heap_sampler_print(int count)
+{
+    heap_sample_t s;
+    printf("%8s %-10s %5s | %8s %8s %8s | %8s %8s %8s\n",
+           "t(s)", "reason", "turn", "int_free", "int_lrg", "int_min", "ps_free", "ps_lrg", "ps_min");
+    for (int n = 0; n < count && sample_get(n, &s); n++) {
+        printf("%8lld %-10s %5u | %8u %8u %8u | %8u %8u %8u\n",
+               (long long)(s.ts_us / 1000000), s.reason ? s.reason : "", (unsigned)s.turn_id,
+               (unsigned)s.internal.free, (unsigned)s.internal.largest, (unsigned)s.internal.min_free,
+               (unsigned)s.psram.free, (unsigned)s.psram.largest, (unsigned)s.psram.min_free);
+    }
+
+    heap_failure_t f;
+    printf("Allocation failures: %u\n", (unsigned)s_fail_total);
+    for (int n = 0; n < MIMI_HEAP_FAIL_RING && failure_get(n, &f); n++) {
+        printf("  t=%llds task=%s turn=%u size=%u caps=0x%x (%s)\n",
+               (long long)(f.ts_us / 1000000), f.task, (unsigned)f.turn_id,
+               (unsigned)f.size, (unsigned)f.caps, f.func ? f.func : "?");
+    }
+}
+
+static cJSON *region_json(const heap_region_t *r)
+{
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddNumberToObject(obj, "free", r->free);
+    cJSON_AddNumberToObject(obj, "largest", r->largest);
+    cJSON_AddNumberToObject(obj, "min_free", r->min_free);
+    return obj;
+}
+
+cJSON *heap_sampler_to_json(int count)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *samples = cJSON_AddArrayToObject(root, "samples");
+    heap_sample_t s;
+    for (int n = 0; n < count && sample_get(n, &s); n++) {
+        cJSON *obj = cJSON_CreateObject();
+        cJSON_AddNumberToObject(obj, "ts_ms", (double)(s.ts_us / 1000));
+        cJSON_AddStringToObject(obj, "reason", s.reason ? s.reason : "");
+        cJSON_AddNumberToObject(obj, "turn", s.turn_id);
+        cJSON_AddItemToObject(obj, "internal", region_json(&s.internal));
+        cJSON_AddItemToObject(obj, "psram", region_json(&s.psram));
+        cJSON_AddItemToArray(samples, obj);
+    }
+
+    cJSON_AddNumberToObject(root, "failures_total", s_fail_total);
+    cJSON *failures = cJSON_AddArrayToObject(root, "failures");
+    heap_failure_t f;
+    for (int n = 0; n < MIMI_HEAP_FAIL_RING && failure_get(n, &f); n++) {
+        cJSON *obj = cJSON_CreateObject();
+        cJSON_AddNumberToObject(obj, "ts_ms", (double)(f.ts_us / 1000));
+        cJSON_AddStringToObject(obj, "task", f.task);
+        cJSON_AddNumberToObject(obj, "turn", f.turn_id);
+        cJSON_AddNumberToObject(obj, "size", f.size);
+        cJSON_AddNumberToObject(obj, "caps", f.caps);
+        cJSON_AddStringToObject(obj, "func", f.func ? f.func : "");
+        cJSON_AddItemToArray(failures, obj);
+    }
+    return root;
+}
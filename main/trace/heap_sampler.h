@@ -0,0 +1,38 @@
+#pragma once
+
+#include "esp_err.h"
+#include "cJSON.h"
+#include <stdint.h>
+
+/**
+ * Heap telemetry. A timer samples free / largest free block / minimum-ever
+ * free for the internal and PSRAM heaps into a ring buffer; samples are also
+ * taken at turn boundaries and tagged with the active turn id. Failed
+ * allocations are recorded with the calling task and the active turn.
+ */
+
+/**
+ * Allocate the rings and register the failed-allocation hook.
+ */
+esp_err_t heap_sampler_init(void);
+
+/**
+ * Start the periodic sampling timer (MIMI_HEAP_SAMPLE_INTERVAL_MS).
+ */
+esp_err_t heap_sampler_start(void);
+
+/**
+ * Take a sample now. `reason` is a short static tag ("turn_begin", ...).
+ */
+void heap_sampler_sample(const char *reason);
+
+/**
+ * Print the last `count` samples and recent allocation failures to stdout.
+ */
+void heap_sampler_print(int count);
+
+/**
+ * Build {"samples":[...],"failures":[...]} with the last `count` samples
+ * (newest first). Caller must cJSON_Delete.
+ */
+cJSON *heap_sampler_to_json(int count);
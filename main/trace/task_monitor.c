@@ -0,0 +1,234 @@
+#include "task_monitor.h"
+#include "mimi_config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "taskmon";
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+#define TASKMON_CPU_STATS 1
+#else
+#define TASKMON_CPU_STATS 0
+#endif
+
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t number;
+    int core;                   /* -1 = not pinned */
+    UBaseType_t prio;
+    uint16_t cpu_x10;           /* CPU % of one core over the interval, x10 */
+    uint32_t stack_free;        /* minimum free stack ever, bytes */
+} taskmon_entry_t;
+
+typedef struct {
+    int64_t ts_us;
+    uint32_t interval_ms;
+    int count;
+    uint16_t core_busy_x10[configNUM_CORES];
+    taskmon_entry_t tasks[MIMI_TASKMON_MAX_TASKS];
+} taskmon_snapshot_t;
+
+/* Previous sample per task, matched by task number */
+typedef struct {
+    UBaseType_t number;
+    uint32_t runtime;
+    uint32_t stack_free;
+} taskmon_prev_t;
+
+static TaskStatus_t s_status[MIMI_TASKMON_MAX_TASKS];
+static taskmon_prev_t s_prev[MIMI_TASKMON_MAX_TASKS];
+static int s_prev_count = 0;
+static uint32_t s_prev_total = 0;
+static int64_t s_prev_ts = 0;
+
+static taskmon_snapshot_t s_work;
+static taskmon_snapshot_t s_snap;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static TimerHandle_t s_timer = NULL;
+
+static const taskmon_prev_t *prev_find(UBaseType_t number)
+{
+    for (int i = 0; i < s_prev_count; i++) {
+        if (s_prev[i].number == number) return &s_prev[i];
+    }
+    return NULL;
+}
+
+static void task_monitor_sample(void)
+{
+    uint32_t total = 0;
+    UBaseType_t n = uxTaskGetSystemState(s_status, MIMI_TASKMON_MAX_TASKS, &total);
+    if (n == 0) {
+        /* More tasks than MIMI_TASKMON_MAX_TASKS */
+        ESP_LOGW(TAG, "Task table too small (%u tasks)", (unsigned)uxTaskGetNumberOfTasks());
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    uint32_t elapsed = total - s_prev_total;    /* run-time counter ticks, wraps safely */
+    bool have_prev = s_prev_ts != 0 && elapsed > 0;
+
+    memset(&s_work, 0, sizeof(s_work));
+    s_work.ts_us = now;
+    s_work.interval_ms = have_prev ? (uint32_t)((now - s_prev_ts) / 1000) : 0;
+    s_work.count = (int)n;
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        const TaskStatus_t *st = &s_status[i];
+        taskmon_entry_t *e = &s_work.tasks[i];
+        strncpy(e->name, st->pcTaskName, sizeof(e->name) - 1);
+        e->number = st->xTaskNumber;
+        e->core = (st->xCoreID == tskNO_AFFINITY) ? -1 : (int)st->xCoreID;
+        e->prio = st->uxCurrentPriority;
+        e->stack_free = st->usStackHighWaterMark;   /* bytes on ESP-IDF */
+
+        const taskmon_prev_t *prev = prev_find(st->xTaskNumber);
+#if TASKMON_CPU_STATS
+        if (have_prev && prev) {
+            uint64_t pct_x10 = (uint64_t)(st->ulRunTimeCounter - prev->runtime) * 1000 / elapsed;
+            e->cpu_x10 = pct_x10 > 1000 ? 1000 : (uint16_t)pct_x10;
+        }
+        /* Core load = 100% minus that core's idle task */
+        if (strncmp(st->pcTaskName, "IDLE", 4) == 0 && e->core >= 0 && e->core < configNUM_CORES) {
+            s_work.core_busy_x10[e->core] = 1000 - e->cpu_x10;
+        }
+#endif
+
+        /* Warn once, when a task first drops below the threshold */
+        if (e->stack_free < MIMI_TASKMON_STACK_WARN &&
+            (!prev || prev->stack_free >= MIMI_TASKMON_STACK_WARN)) {
+            ESP_LOGW(TAG, "Task %s stack headroom low: %u bytes", e->name, (unsigned)e->stack_free);
+        }
+    }
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        s_prev[i].number = s_status[i].xTaskNumber;
+        s_prev[i].runtime = s_status[i].ulRunTimeCounter;
+        s_prev[i].stack_free = s_status[i].usStackHighWaterMark;
+    }
+    s_prev_count = (int)n;
+    s_prev_total = total;
+    s_prev_ts = now;
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(&s_snap, &s_work, sizeof(s_snap));
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void taskmon_timer_callback(TimerHandle_t xTimer)
+{
+    (void)xTimer;
+    task_monitor_sample();
+}
+
+esp_err_t task_monitor_start(void)
+{
+    if (s_timer) return ESP_OK;
+
+    task_monitor_sample();      /* baseline for the first interval */
+
+    s_timer = xTimerCreate("taskmon", pdMS_TO_TICKS(MIMI_TASKMON_INTERVAL_MS),
+                           pdTRUE, NULL, taskmon_timer_callback);
+    if (!s_timer || xTimerStart(s_timer, pdMS_TO_TICKS(1000)) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start task monitor timer");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Task monitor started (every %ds)", MIMI_TASKMON_INTERVAL_MS / 1000);
+    return ESP_OK;
+}
+
+static int cmp_cpu_desc(const void *a, const void *b)
+{
+    const taskmon_entry_t *x = a, *y = b;
+    if (x->cpu_x10 != y->cpu_x10) return (int)y->cpu_x10 - (int)x->cpu_x10;
+    return (int)x->stack_free - (int)y->stack_free;
+}
+
+/* Copy and sort the last snapshot; returns NULL before the first sample */
+static taskmon_snapshot_t *snapshot_copy(void)
+{
+    taskmon_snapshot_t *snap = malloc(sizeof(*snap));
+    if (!snap) return NULL;
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(snap, &s_snap, sizeof(*snap));
+    portEXIT_CRITICAL(&s_lock);
+
+    if (snap->count == 0) {
+        free(snap);
+        return NULL;
+    }
+    qsort(snap->tasks, snap->count, sizeof(taskmon_entry_t), cmp_cpu_desc);
+    return snap;
+}
+
+void task_monitor_print(void)
+{
+    taskmon_snapshot_t *snap = snapshot_copy();
+    if (!snap) {
+        printf("No task samples yet.\n");
+        return;
+    }
+
+#if TASKMON_CPU_STATS
+    printf("Interval %u ms, load:", (unsigned)snap->interval_ms);
+    for (int c = 0; c < configNUM_CORES; c++) {
+        printf("  core%d %u.%u%%", c, snap->core_busy_x10[c] / 10, snap->core_busy_x10[c] % 10);
+    }
+    printf("\n");
+#else
+    printf("CPU stats off (enable CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)\n");
+#endif
+    printf("%-16s %4s %4s %7s %10s\n", "TASK", "CORE", "PRIO", "CPU%", "STACK_FREE");
+    for (int i = 0; i < snap->count; i++) {
+        const taskmon_entry_t *e = &snap->tasks[i];
+        char core[6];
+        if (e->core < 0) {
+            snprintf(core, sizeof(core), "any");
+        } else {
+            snprintf(core, sizeof(core), "%d", e->core);
+        }
+        printf("%-16s %4s %4u %5u.%u %10u%s\n", e->name, core, (unsigned)e->prio,
+               e->cpu_x10 / 10, e->cpu_x10 % 10, (unsigned)e->stack_free,
+               e->stack_free < MIMI_TASKMON_STACK_WARN ? "  LOW" : "");
+    }
+    free(snap);
+}
+
+cJSON *task_monitor_to_json(void)
+{
+    cJSON *root = cJSON_CreateObject();
+    taskmon_snapshot_t *snap = snapshot_copy();
+    if (!snap) {
+        cJSON_AddArrayToObject(root, "tasks");
+        return root;
+    }
+
+    cJSON_AddNumberToObject(root, "interval_ms", snap->interval_ms);
+    cJSON_AddBoolToObject(root, "cpu_stats", TASKMON_CPU_STATS);
+    cJSON *cores = cJSON_AddArrayToObject(root, "cores");
+    for (int c = 0; c < configNUM_CORES; c++) {
+        cJSON_AddItemToArray(cores, cJSON_CreateNumber(snap->core_busy_x10[c] / 10.0));
+    }
+
+    cJSON *tasks = cJSON_AddArrayToObject(root, "tasks");
+    for (int i = 0; i < snap->count; i++) {
+        const taskmon_entry_t *e = &snap->tasks[i];
+        cJSON *obj = cJSON_CreateObject();
+        cJSON_AddStringToObject(obj, "name", e->name);
+        cJSON_AddNumberToObject(obj, "core", e->core);
+        cJSON_AddNumberToObject(obj, "prio", e->prio);
+        cJSON_AddNumberToObject(obj, "cpu", e->cpu_x10 / 10.0);
+        cJSON_AddNumberToObject(obj, "stack_free", e->stack_free);
+        cJSON_AddItemToArray(tasks, obj);
+    }
+    free(snap);
+    return root;
+}
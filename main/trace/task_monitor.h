@@ -0,0 +1,30 @@
+#pragma once
+
+#include "esp_err.h"
+#include "cJSON.h"
+
+/**
+ * "top" for the firmware. A timer samples FreeRTOS run-time stats every
+ * MIMI_TASKMON_INTERVAL_MS and keeps the last snapshot: per-task CPU % over
+ * the interval, core affinity, priority and stack headroom (minimum free
+ * stack ever, from the high-water mark), plus per-core load.
+ *
+ * CPU figures need CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; without it only
+ * stack headroom is reported.
+ */
+
+/**
+ * Take the baseline sample and start the sampling timer.
+ */
+esp_err_t task_monitor_start(void);
+
+/**
+ * Print the last snapshot, busiest task first.
+ */
+void task_monitor_print(void);
+
+/**
+ * Build {"interval_ms":..,"cores":[..],"tasks":[..]} from the last snapshot.
+ * Caller must cJSON_Delete.
+ */
+cJSON *task_monitor_to_json(void);
@@ -0,0 +1,291 @@
+#include "turn_trace.h"
+#include "mimi_config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "trace";
+
+typedef struct {
+    uint8_t stage;
+    char label[23];
+    uint32_t start_off_us;      /* relative to trace start */
+    uint32_t dur_us;
+} trace_span_t;
+
+typedef struct {
+    uint32_t id;
+    char channel[16];
+    char chat_id[32];
+    int64_t start_us;           /* queued on the bus */
+    int64_t begin_us;           /* dequeued; spans starting earlier belong to another turn */
+    int64_t end_us;             /* 0 while the turn is running */
+    esp_err_t result;
+    uint16_t span_count;
+    uint16_t dropped;
+    trace_span_t spans[MIMI_TRACE_MAX_SPANS];
+} turn_trace_t;
+
+static const char *s_stage_names[TRACE_STAGE_MAX] = {
+    [TRACE_BUS_WAIT]      = "bus_wait",
+    [TRACE_PROMPT_BUILD]  = "prompt_build",
+    [TRACE_SESSION_LOAD]  = "session_load",
+    [TRACE_LLM_SERIALIZE] = "llm_serialize",
+    [TRACE_LLM_CONNECT]   = "llm_connect",
+    [TRACE_LLM_TLS]       = "llm_tls",
+    [TRACE_LLM_TTFB]      = "llm_ttfb",
+    [TRACE_LLM_RECV]      = "llm_recv",
+    [TRACE_LLM_PARSE]     = "llm_parse",
+    [TRACE_TOOL]          = "tool",
+    [TRACE_SESSION_SAVE]  = "session_save",
+    [TRACE_LOCAL_CMD]     = "local_cmd",
+    [TRACE_OUTBOUND]      = "outbound",
+};
+
+static turn_trace_t *s_ring = NULL;     /* MIMI_TRACE_RING_LEN entries, PSRAM */
+static int s_head = 0;                  /* next slot to use */
+static int s_count = 0;
+static int s_active = -1;               /* slot of the running turn */
+static uint32_t s_next_id = 1;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t turn_trace_init(void)
+{
+    s_ring = heap_caps_calloc(MIMI_TRACE_RING_LEN, sizeof(turn_trace_t), MALLOC_CAP_SPIRAM);
+    if (!s_ring) {
+        ESP_LOGE(TAG, "Failed to allocate trace ring");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Turn tracing ready (%d traces, %d bytes)",
+             MIMI_TRACE_RING_LEN, (int)(MIMI_TRACE_RING_LEN * sizeof(turn_trace_t)));
+    return ESP_OK;
+}
+
+/* Caller holds s_lock */
+static void span_put(turn_trace_t *t, trace_stage_t stage, const char *label,
+                     int64_t start_us, int64_t end_us)
+{
+    if (t->span_count >= MIMI_TRACE_MAX_SPANS) {
+        t->dropped++;
+        return;
+    }
+    trace_span_t *sp = &t->spans[t->span_count++];
+    sp->stage = (uint8_t)stage;
+    sp->label[0] = '\0';
+    if (label) {
+        strncpy(sp->label, label, sizeof(sp->label) - 1);
+        sp->label[sizeof(sp->label) - 1] = '\0';
+    }
+    sp->start_off_us = start_us > t->start_us ? (uint32_t)(start_us - t->start_us) : 0;
+    sp->dur_us = end_us > start_us ? (uint32_t)(end_us - start_us) : 0;
+}
+
+void turn_trace_begin(const mimi_msg_t *msg)
+{
+    if (!s_ring) return;
+
+    int64_t now = esp_timer_get_time();
+    int64_t queued = (msg->queued_us > 0 && msg->queued_us <= now) ? msg->queued_us : now;
+
+    portENTER_CRITICAL(&s_lock);
+    turn_trace_t *t = &s_ring[s_head];
+    memset(t, 0, sizeof(*t));
+    t->id = s_next_id++;
+    strncpy(t->channel, msg->channel, sizeof(t->channel) - 1);
+    strncpy(t->chat_id, msg->chat_id, sizeof(t->chat_id) - 1);
+    t->start_us = queued;
+    t->begin_us = now;
+    t->result = ESP_OK;
+    span_put(t, TRACE_BUS_WAIT, NULL, queued, now);
+
+    s_active = s_head;
+    s_head = (s_head + 1) % MIMI_TRACE_RING_LEN;
+    if (s_count < MIMI_TRACE_RING_LEN) s_count++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void turn_trace_span(trace_stage_t stage, const char *label, int64_t start_us, int64_t end_us)
+{
+    if (!s_ring || stage >= TRACE_STAGE_MAX) return;
+
+    portENTER_CRITICAL(&s_lock);
+    /* Late spans from a previous turn (e.g. a cancelled hedge) are dropped */
+    if (s_active >= 0 && start_us >= s_ring[s_active].begin_us) {
+        span_put(&s_ring[s_active], stage, label, start_us, end_us);
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void turn_trace_end(esp_err_t result)
+{
+    if (!s_ring) return;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_active >= 0) {
+        s_ring[s_active].end_us = esp_timer_get_time();
+        s_ring[s_active].result = result;
+        s_active = -1;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t turn_trace_active_id(void)
+{
+    uint32_t id = 0;
+    portENTER_CRITICAL_SAFE(&s_lock);
+    if (s_ring && s_active >= 0) {
+        id = s_ring[s_active].id;
+    }
+    portEXIT_CRITICAL_SAFE(&s_lock);
+    return id;
+}
+
+uint32_t turn_trace_record(const mimi_msg_t *msg, trace_stage_t stage, const char *label,
+                           int64_t start_us, int64_t end_us)
+{
+    if (!s_ring || stage >= TRACE_STAGE_MAX) return 0;
+
+    uint32_t id = 0;
+    portENTER_CRITICAL(&s_lock);
+    /* Never reuse the running turn's slot; a reply this rare can go untraced */
+    if (s_head != s_active) {
+        turn_trace_t *t = &s_ring[s_head];
+        memset(t, 0, sizeof(*t));
+        t->id = id = s_next_id++;
+        strncpy(t->channel, msg->channel, sizeof(t->channel) - 1);
+        strncpy(t->chat_id, msg->chat_id, sizeof(t->chat_id) - 1);
+        t->start_us = start_us;
+        t->begin_us = start_us;
+        t->end_us = end_us;
+        t->result = ESP_OK;
+        span_put(t, stage, label, start_us, end_us);
+
+        s_head = (s_head + 1) % MIMI_TRACE_RING_LEN;
+        if (s_count < MIMI_TRACE_RING_LEN) s_count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return id;
+}
+
+void turn_trace_outbound(uint32_t trace_id, int64_t start_us, int64_t end_us)
+{
+    if (!s_ring || trace_id == 0) return;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < s_count; i++) {
+        turn_trace_t *t = &s_ring[(s_head - 1 - i + MIMI_TRACE_RING_LEN) % MIMI_TRACE_RING_LEN];
+        if (t->id != trace_id) continue;
+
+        trace_span_t *existing = NULL;
+        for (int s = 0; s < t->span_count; s++) {
+            if (t->spans[s].stage == TRACE_OUTBOUND) {
+                existing = &t->spans[s];
+                break;
+            }
+        }
+        if (existing) {
+            existing->start_off_us = (uint32_t)(start_us - t->start_us);
+            existing->dur_us = end_us > start_us ? (uint32_t)(end_us - start_us) : 0;
+        } else {
+            span_put(t, TRACE_OUTBOUND, NULL, start_us, end_us);
+        }
+        break;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* Copy out the n-th newest trace so it can be formatted without the lock */
+static bool trace_snapshot(int n, turn_trace_t *out)
+{
+    bool ok = false;
+    portENTER_CRITICAL(&s_lock);
+    if (n < s_count) {
+        *out = s_ring[(s_head - 1 - n + MIMI_TRACE_RING_LEN) % MIMI_TRACE_RING_LEN];
+        ok = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ok;
+}
+
+void turn_trace_print(int count)
+{
+    if (!s_ring) {
+        printf("Tracing not initialized.\n");
+        return;
+    }
+
+    turn_trace_t *t = heap_caps_malloc(sizeof(turn_trace_t), MALLOC_CAP_SPIRAM);
+    if (!t) return;
+
+    int shown = 0;
+    for (int n = 0; n < count && trace_snapshot(n, t); n++) {
+        if (t->end_us) {
+            printf("#%u %s:%s  total %lld ms  %s\n", (unsigned)t->id, t->channel, t->chat_id,
+                   (long long)((t->end_us - t->start_us) / 1000), esp_err_to_name(t->result));
+        } else {
+            printf("#%u %s:%s  (running)\n", (unsigned)t->id, t->channel, t->chat_id);
+        }
+        for (int s = 0; s < t->span_count; s++) {
+            const trace_span_t *sp = &t->spans[s];
+            printf("  %-14s %-22s +%6u ms %7u.%03u ms\n",
+                   s_stage_names[sp->stage], sp->label,
+                   (unsigned)(sp->start_off_us / 1000),
+                   (unsigned)(sp->dur_us / 1000), (unsigned)(sp->dur_us % 1000));
+        }
+        if (t->dropped) {
+            printf("  (%u spans dropped)\n", (unsigned)t->dropped);
+        }
+        shown++;
+    }
+    if (shown == 0) {
+        printf("No traces yet.\n");
+    }
+    free(t);
+}
+
+cJSON *turn_trace_to_json(int count)
+{
+    cJSON *arr = cJSON_CreateArray();
+    if (!arr || !s_ring) return arr;
+
+    turn_trace_t *t = heap_caps_malloc(sizeof(turn_trace_t), MALLOC_CAP_SPIRAM);
+    if (!t) return arr;
+
+    for (int n = 0; n < count && trace_snapshot(n, t); n++) {
+        cJSON *obj = cJSON_CreateObject();
+        cJSON_AddNumberToObject(obj, "id", t->id);
+        cJSON_AddStringToObject(obj, "channel", t->channel);
+        cJSON_AddStringToObject(obj, "chat_id", t->chat_id);
+        cJSON_AddNumberToObject(obj, "start_ms", (double)(t->start_us / 1000));
+        if (t->end_us) {
+            cJSON_AddNumberToObject(obj, "total_us", (double)(t->end_us - t->start_us));
+            cJSON_AddStringToObject(obj, "result", esp_err_to_name(t->result));
+        } else {
+            cJSON_AddBoolToObject(obj, "running", true);
+        }
+        if (t->dropped) {
+            cJSON_AddNumberToObject(obj, "dropped", t->dropped);
+        }
+
+        cJSON *spans = cJSON_AddArrayToObject(obj, "spans");
+        for (int s = 0; s < t->span_count; s++) {
+            const trace_span_t *sp = &t->spans[s];
+            cJSON *span = cJSON_CreateObject();
+            cJSON_AddStringToObject(span, "stage", s_stage_names[sp->stage]);
+            if (sp->label[0]) {
+                cJSON_AddStringToObject(span, "label", sp->label);
+            }
+            cJSON_AddNumberToObject(span, "start_us", sp->start_off_us);
+            cJSON_AddNumberToObject(span, "dur_us", sp->dur_us);
+            cJSON_AddItemToArray(spans, span);
+        }
+        cJSON_AddItemToArray(arr, obj);
+    }
+    free(t);
+    return arr;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "esp_err.h"
+#include "cJSON.h"
+#include <stdint.h>
+
+#include "bus/message_bus.h"
+
+/**
+ * Per-turn tracing. Each agent turn gets one trace holding timed spans for
+ * its stages; the last MIMI_TRACE_RING_LEN traces are kept in a PSRAM ring.
+ * Spans may be recorded from any task (e.g. LLM hedge workers).
+ */
+
+typedef enum {
+    TRACE_BUS_WAIT = 0,     /* message queued on the inbound bus */
+    TRACE_PROMPT_BUILD,
+    TRACE_SESSION_LOAD,
+    TRACE_LLM_SERIALIZE,
+    TRACE_LLM_CONNECT,      /* TCP (+ proxy tunnel); includes TLS on the direct path */
+    TRACE_LLM_TLS,          /* TLS handshake, proxy path only */
+    TRACE_LLM_TTFB,         /* request sent -> first response byte */
+    TRACE_LLM_RECV,         /* rest of the response body */
+    TRACE_LLM_PARSE,
+    TRACE_TOOL,
+    TRACE_SESSION_SAVE,
+    TRACE_LOCAL_CMD,        /* slash command answered without the agent */
+    TRACE_OUTBOUND,         /* channel delivery of the reply, from dequeue to sent */
+    TRACE_STAGE_MAX,
+} trace_stage_t;
+
+/**
+ * Allocate the trace ring in PSRAM.
+ */
+esp_err_t turn_trace_init(void);
+
+/**
+ * Start the trace for a turn. Records the bus wait span from msg->queued_us.
+ */
+void turn_trace_begin(const mimi_msg_t *msg);
+
+/**
+ * Record a span in the active trace. start_us/end_us come from esp_timer_get_time().
+ * @param label  Optional detail (tool name, provider), may be NULL
+ */
+void turn_trace_span(trace_stage_t stage, const char *label, int64_t start_us, int64_t end_us);
+
+/**
+ * Close the active trace.
+ */
+void turn_trace_end(esp_err_t result);
+
+/**
+ * Id of the running turn, 0 when the agent is idle.
+ */
+uint32_t turn_trace_active_id(void);
+
+/**
+ * Record a finished one-span trace for work done outside the agent turn
+ * (a local command reply). Does not disturb the running turn's trace.
+ * @return trace id for the reply's mimi_msg_t.trace_id, 0 if not recorded
+ */
+uint32_t turn_trace_record(const mimi_msg_t *msg, trace_stage_t stage, const char *label,
+                           int64_t start_us, int64_t end_us);
+
+/**
+ * Attach the outbound delivery span to trace trace_id (from the reply's
+ * mimi_msg_t.trace_id). Nothing is recorded if the trace has left the ring.
+ */
+void turn_trace_outbound(uint32_t trace_id, int64_t start_us, int64_t end_us);
+
+/**
+ * Print the last `count` traces (newest first) to stdout.
+ */
+void turn_trace_print(int count);
+
+/**
+ * Build a JSON array of the last `count` traces (newest first). Caller must cJSON_Delete.
+ */
+cJSON *turn_trace_to_json(int count);
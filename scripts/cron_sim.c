@@ -0,0 +1,324 @@
+/*
+ * Host simulation of the cron scheduler (main/cron/cron_service.c).
+ *
+ *   cc -g -Iscripts/host -Imain -I$IDF_PATH/components/json/cJSON \
+ *      -o /tmp/cron_sim scripts/cron_sim.c main/cron/cron_expr.c \
+ *      $IDF_PATH/components/json/cJSON/cJSON.c
+ *   /tmp/cron_sim            # exits non-zero if any check fails
+ *
+ * Loads MIMI_CRON_MAX_JOBS jobs (intervals, cron expressions, one-shots,
+ * a handful of destinations, some no_batch) straight into the job table and
+ * drives the task loop's two steps, cron_collect_due() and cron_wait_ms(),
+ * on a simulated clock. After every pass it checks that the heap is a valid
+ * min-heap over exactly the enabled jobs, that every due job fired (or the
+ * batch was full), that due jobs for one destination were merged into one
+ * turn by cron_merge_into() with each message present once, and that the
+ * sleep never exceeds MIMI_CRON_MAX_SLEEP_MS. Fire counts are compared with
+ * a brute-force schedule; a final phase jumps the wall clock forward.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cron/cron_service.c"
+
+#define SIM_START   1767225600LL          /* 2026-01-01 00:00:00 UTC */
+#define SIM_HOURS   48
+#define SIM_CHATS   5
+
+/* ── Stubs for the rest of the firmware ───────────────────────── */
+
+void fs_catalog_update(const char *path) { (void)path; }
+
+esp_err_t message_bus_push_inbound(const mimi_msg_t *msg)
+{
+    free(msg->content);
+    return ESP_OK;
+}
+
+/* ── Checks ───────────────────────────────────────────────────── */
+
+static int s_failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+    if (!(cond)) {                                              \
+        fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+        fprintf(stderr, __VA_ARGS__);                           \
+        fprintf(stderr, "\n");                                  \
+        if (++s_failures >= 10) exit(1);                        \
+    }                                                           \
+} while (0)
+
+/* Heap holds each enabled, scheduled job once, and no child precedes its parent */
+static void check_heap(void)
+{
+    static uint8_t seen[MAX_CRON_JOBS];
+    memset(seen, 0, sizeof(seen));
+    for (int i = 0; i < s_heap_len; i++) {
+        int j = s_heap[i];
+        CHECK(j >= 0 && j < s_job_count, "heap slot %d holds bad index %d", i, j);
+        CHECK(!seen[j], "job %d is in the heap twice", j);
+        seen[j] = 1;
+        CHECK(s_jobs[j].enabled && s_jobs[j].next_run > 0, "unscheduled job %d in heap", j);
+        if (i > 0) CHECK(!heap_before(i, (i - 1) / 2), "heap order broken at slot %d", i);
+    }
+    for (int j = 0; j < s_job_count; j++) {
+        if (s_jobs[j].enabled && s_jobs[j].next_run > 0) {
+            CHECK(seen[j], "scheduled job %d missing from heap", j);
+        }
+    }
+}
+
+/* Independent matcher for the parsed expression (TZ is UTC, so no DST) */
+static bool expr_matches(const cron_expr_t *e, time_t t)
+{
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    if (!(e->minutes & (1ULL << tm.tm_min)) || !(e->hours & (1u << tm.tm_hour)) ||
+        !(e->months & (1u << (tm.tm_mon + 1)))) {
+        return false;
+    }
+    bool md = (e->mdays >> tm.tm_mday) & 1, wd = (e->wdays >> tm.tm_wday) & 1;
+    if (e->mday_any || e->wday_any) return md && wd;
+    return md || wd;
+}
+
+/* ── Job mix ──────────────────────────────────────────────────── */
+
+static const char *const s_exprs[] = {
+    "*/5 * * * *", "0 * * * *", "30 8 * * *", "15,45 9-17 * * MON-FRI",
+    "0 0 * * *", "*/15 * * * *", "0 12 1 * *", "@hourly",
+};
+
+/* Per-job fire counts, indexed by the numeric tail of the job name */
+static int s_fires[MAX_CRON_JOBS];
+
+static void add_job(int k, int64_t start)
+{
+    cron_job_t *job = &s_jobs[s_job_count];
+    memset(job, 0, sizeof(*job));
+    snprintf(job->id, sizeof(job->id), "%08x", k);
+    snprintf(job->name, sizeof(job->name), "job%d", k);
+    snprintf(job->message, sizeof(job->message), "message from job %d", k);
+    strcpy(job->channel, k % 7 == 0 ? "system" : "telegram");
+    snprintf(job->chat_id, sizeof(job->chat_id), "%d", k % SIM_CHATS);
+    job->enabled = true;
+    job->no_batch = (k % 11 == 0);
+
+    switch (k % 4) {
+    case 0:
+    case 1:
+        job->kind = CRON_KIND_EVERY;
+        job->interval_s = 60 * (1 + (k * 37) % 180);   /* 1 min to 3 h */
+        break;
+    case 2:
+        job->kind = CRON_KIND_CRON;
+        strcpy(job->expr, s_exprs[k % (sizeof(s_exprs) / sizeof(s_exprs[0]))]);
+        if (!cron_expr_parse(job->expr, &job->cexpr)) {
+            CHECK(false, "bad test expression %s", job->expr);
+        }
+        break;
+    default:
+        job->kind = CRON_KIND_AT;
+        job->at_epoch = start + 60 * ((k * 53) % (SIM_HOURS * 60));
+        job->delete_after_run = (k % 8 == 3);
+        break;
+    }
+    job->next_run = job->kind == CRON_KIND_AT ? job->at_epoch : cron_next_after(job, start);
+    s_job_count++;
+}
+
+/* Expected fires over [start, end] with no outages */
+static int expected_fires(const cron_job_t *job, int64_t start, int64_t end)
+{
+    switch (job->kind) {
+    case CRON_KIND_EVERY:
+        return (int)((end - start) / job->interval_s);
+    case CRON_KIND_CRON: {
+        int n = 0;
+        for (int64_t t = start + 60 - start % 60; t <= end; t += 60) {
+            n += expr_matches(&job->cexpr, (time_t)t);
+        }
+        return n;
+    }
+    default:
+        return job->at_epoch > start && job->at_epoch <= end;
+    }
+}
+
+static int job_number(const char *name)
+{
+    return atoi(name + 3);
+}
+
+/* ── One pass of the task loop ────────────────────────────────── */
+
+typedef struct {
+    int passes;
+    int full_batches;
+    int merged_turns;
+    int capped_sleeps;
+} sim_stats_t;
+
+static int64_t run_pass(int64_t t_ms, sim_stats_t *st)
+{
+    int64_t now = t_ms / 1000;
+
+    /* Snapshot the table to see afterwards what fired and where it went */
+    static cron_job_t before[MAX_CRON_JOBS];
+    static bool due[MAX_CRON_JOBS];
+    int before_count = s_job_count;
+    memcpy(before, s_jobs, sizeof(cron_job_t) * s_job_count);
+    for (int i = 0; i < before_count; i++) {
+        due[i] = before[i].enabled && before[i].next_run > 0 && before[i].next_run <= now;
+    }
+
+    mimi_msg_t batch[CRON_FIRE_BATCH];
+    bool deleted = false;
+    int n = cron_collect_due(t_ms, batch, CRON_FIRE_BATCH, &deleted);
+    st->passes++;
+
+    /* Every fired job was due; unless the batch filled up, every due job fired */
+    int fired = 0;
+    for (int i = 0; i < before_count; i++) {
+        const cron_job_t *job = &before[i], *after = NULL;
+        for (int j = 0; j < s_job_count && !after; j++) {
+            if (strcmp(s_jobs[j].id, job->id) == 0) after = &s_jobs[j];
+        }
+        /* Only fired one-shots leave the table */
+        bool ran = after ? after->last_run == now && job->last_run != now : true;
+        if (ran) {
+            CHECK(due[i], "%s fired before it was due", job->name);
+            CHECK(!after || after->next_run == 0 || after->next_run > now,
+                  "%s rescheduled into the past", job->name);
+            s_fires[job_number(job->name)]++;
+            fired++;
+        } else if (n < CRON_FIRE_BATCH) {
+            CHECK(!due[i], "%s was due at %lld but did not fire", job->name, (long long)now);
+        }
+    }
+
+    /*
+     * Batching: every fired job's message appears once, in a turn for its own
+     * chat; no_batch jobs are alone; other turns have distinct destinations.
+     */
+    int listed = 0;
+    for (int i = 0; i < n; i++) {
+        const char *c = batch[i].content;
+        bool composite = strncmp(c, "Several scheduled tasks", 23) == 0;
+        st->merged_turns += composite;
+        CHECK(batch[i].origin == MIMI_ORIGIN_CRON, "turn %d has origin %d", i, batch[i].origin);
+
+        for (const char *p = c; (p = strstr(p, "message from job ")); p++) {
+            int k = atoi(p + 17);
+            listed++;
+            CHECK(!composite || k % 11 != 0, "no_batch job%d was merged", k);
+            char chat[8];
+            snprintf(chat, sizeof(chat), "%d", k % SIM_CHATS);
+            CHECK(strcmp(batch[i].chat_id, chat) == 0 &&
+                  strcmp(batch[i].channel, k % 7 == 0 ? "system" : "telegram") == 0,
+                  "job%d delivered to %s:%s", k, batch[i].channel, batch[i].chat_id);
+        }
+
+        bool solo_i = !composite && atoi(c + 17) % 11 == 0;
+        for (int j = 0; j < i && !solo_i; j++) {
+            const char *o = batch[j].content;
+            bool solo_j = strncmp(o, "Several", 7) != 0 && atoi(o + 17) % 11 == 0;
+            CHECK(solo_j || strcmp(batch[i].channel, batch[j].channel) != 0 ||
+                  strcmp(batch[i].chat_id, batch[j].chat_id) != 0,
+                  "two batchable turns for %s:%s", batch[i].channel, batch[i].chat_id);
+        }
+    }
+    CHECK(listed == fired, "%d jobs fired but %d listed in turns", fired, listed);
+    for (int i = 0; i < n; i++) free(batch[i].content);
+
+    check_heap();
+
+    /* Sleep: 0 after a full batch, else up to the next deadline, never past the cap */
+    int64_t wait_ms = cron_wait_ms(n, t_ms);
+    CHECK(wait_ms >= 0 && wait_ms <= MIMI_CRON_MAX_SLEEP_MS, "sleep %lld ms", (long long)wait_ms);
+    if (n == CRON_FIRE_BATCH) {
+        st->full_batches++;
+        CHECK(wait_ms == 0, "full batch but sleeping %lld ms", (long long)wait_ms);
+    } else {
+        CHECK(wait_ms > 0, "nothing due but not sleeping");
+        if (s_heap_len > 0) {
+            int64_t next_ms = s_jobs[s_heap[0]].next_run * 1000;
+            CHECK(t_ms + wait_ms <= next_ms, "sleep overshoots the next deadline");
+            st->capped_sleeps += t_ms + wait_ms < next_ms;
+        }
+    }
+    return wait_ms;
+}
+
+int main(void)
+{
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    CHECK(cron_reserve(MAX_CRON_JOBS) == ESP_OK, "cannot reserve %d jobs", MAX_CRON_JOBS);
+    for (int k = 0; k < MAX_CRON_JOBS; k++) add_job(k, SIM_START);
+    heap_rebuild();
+    check_heap();
+
+    static int expect[MAX_CRON_JOBS];
+    int64_t end = SIM_START + SIM_HOURS * 3600;
+    for (int i = 0; i < s_job_count; i++) {
+        expect[job_number(s_jobs[i].name)] = expected_fires(&s_jobs[i], SIM_START, end);
+    }
+
+    /* Phase 1: dense schedule, woken exactly at each deadline */
+    sim_stats_t st = {0};
+    int64_t t_ms = SIM_START * 1000;
+    while (t_ms <= end * 1000) {
+        t_ms += run_pass(t_ms, &st);
+    }
+    for (int k = 0; k < MAX_CRON_JOBS; k++) {
+        CHECK(s_fires[k] == expect[k], "job%d fired %d times, expected %d", k, s_fires[k], expect[k]);
+    }
+    CHECK(s_max_late_ms == 0, "a job fired %lld ms late", (long long)s_max_late_ms);
+    CHECK(st.full_batches > 0 && st.merged_turns > 0, "batching was not exercised");
+    printf("dense:  %d jobs, %d passes, %lu fired in %lu turns, %d merged, %d full batches\n",
+           MAX_CRON_JOBS, st.passes, (unsigned long)s_fired, (unsigned long)s_turns,
+           st.merged_turns, st.full_batches);
+
+    /* Phase 2: only a far-off job is left, so every sleep is the cap */
+    s_job_count = 0;
+    add_job(3, end);
+    s_jobs[0].at_epoch = s_jobs[0].next_run = end + 10 * 3600 + 1800;
+    heap_rebuild();
+    sim_stats_t sparse = {0};
+    t_ms = end * 1000;
+    int fired_before = (int)s_fired;
+    while (s_heap_len > 0) {
+        t_ms += run_pass(t_ms, &sparse);
+    }
+    CHECK(sparse.capped_sleeps == 10, "%d capped sleeps before a job 10.5 h out", sparse.capped_sleeps);
+    CHECK((int)s_fired == fired_before + 1, "far-off job fired %d times", (int)s_fired - fired_before);
+    CHECK(cron_wait_ms(0, t_ms) == MIMI_CRON_MAX_SLEEP_MS, "empty heap does not sleep the cap");
+
+    /* Phase 3: the wall clock jumps 5 h while asleep; each job fires once, not per missed slot */
+    s_job_count = 0;
+    for (int k = 0; k < 40; k++) add_job(k * 4, end);   /* interval jobs only */
+    heap_rebuild();
+    t_ms = end * 1000;
+    t_ms += run_pass(t_ms, &st);
+    memset(s_fires, 0, sizeof(s_fires));
+    t_ms += 5 * 3600 * 1000LL;
+    while (run_pass(t_ms, &st) == 0) {
+    }
+    for (int k = 0; k < 40; k++) {
+        CHECK(s_fires[k * 4] == 1, "job%d fired %d times after the jump", k * 4, s_fires[k * 4]);
+    }
+
+    if (s_failures) {
+        fprintf(stderr, "%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("sparse: %d capped sleeps of %d ms before a job 10.5 h out\n",
+           sparse.capped_sleeps, MIMI_CRON_MAX_SLEEP_MS);
+    printf("clock jump: ok\n");
+    return 0;
+}
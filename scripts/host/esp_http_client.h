@@ -0,0 +1,39 @@
+#pragma once
+
+#include "esp_err.h"
+
+/* Declarations only: a harness that makes HTTP calls supplies a fake client */
+
+#define ESP_ERR_HTTP_BASE          0x7000
+#define ESP_ERR_HTTP_CONNECT       (ESP_ERR_HTTP_BASE + 4)
+#define ESP_ERR_HTTP_WRITE_DATA    (ESP_ERR_HTTP_BASE + 5)
+#define ESP_ERR_HTTP_FETCH_HEADER  (ESP_ERR_HTTP_BASE + 6)
+
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef enum {
+    HTTP_METHOD_GET = 0,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_PUT,
+    HTTP_METHOD_PATCH,
+    HTTP_METHOD_DELETE,
+} esp_http_client_method_t;
+
+typedef struct {
+    const char *url;
+    esp_http_client_method_t method;
+    int timeout_ms;
+    int buffer_size;
+    const char *user_agent;
+    bool disable_auto_redirect;
+    esp_err_t (*crt_bundle_attach)(void *conf);
+} esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value);
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len);
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len);
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client);
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
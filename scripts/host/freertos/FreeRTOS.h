@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void *QueueHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define portMAX_DELAY     0xffffffffu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdPASS            1
+#define pdFAIL            0
+#define pdTRUE            1
+#define pdFALSE           0
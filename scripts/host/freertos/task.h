@@ -0,0 +1,13 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+/* No scheduler on the host: tasks are never started, notifications are no-ops */
+static inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                                     void *arg, UBaseType_t prio, TaskHandle_t *handle)
+{
+    return pdFAIL;
+}
+static inline void vTaskDelete(TaskHandle_t task) { }
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t task) { return pdPASS; }
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) { return 0; }
@@ -0,0 +1,227 @@
+/*
+ * Host benchmark for the at-rest codec (main/storage/lz.c).
+ *
+ *   cc -O2 -Imain/storage -o /tmp/lz_bench scripts/lz_bench.c main/storage/lz.c
+ *   /tmp/lz_bench                          # synthetic chat logs + daily notes
+ *   /tmp/lz_bench session.jsonl notes.md   # or real files pulled off a device
+ *
+ * Files are split into blocks of the same size the firmware uses
+ * (MIMI_LZ_BLOCK_SIZE) and each block is compressed on its own, exactly like
+ * an .lz file on flash. Prints ratio and compress/decode throughput;
+ * decode is what a read of a cold session or note pays.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lz.h"
+
+#define BLOCK_SIZE  (16 * 1024)
+#define ROUNDS      20
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ── Synthetic corpus ─────────────────────────────────────────── */
+
+static const char *const s_user[] = {
+    "What's the weather like in Tokyo today?",
+    "Remind me to call mom tomorrow at 6pm",
+    "Can you summarize the news about the ESP32-S3 release?",
+    "How many steps did I walk yesterday?",
+    "Add milk, eggs and coffee beans to my shopping list",
+    "What did we talk about last week regarding the trip to Kyoto?",
+    "Translate 'good morning, how are you' into Japanese",
+    "Set a daily briefing for 8am please",
+};
+
+static const char *const s_asst[] = {
+    "Tokyo: 8\\u00b0C, partly cloudy. High 12\\u00b0C, low 4\\u00b0C. Light wind from the north.",
+    "Done! I've scheduled a reminder for tomorrow at 18:00 to call your mom.",
+    "Here's a quick summary:\\n- Dual-core Xtensa LX7 at 240 MHz\\n- 8 MB PSRAM on most modules\\n- USB OTG and vector instructions for AI workloads",
+    "I don't have access to step data, but you mentioned walking to the station both ways yesterday.",
+    "Added to your shopping list: milk, eggs, coffee beans. Anything else?",
+    "Last week we planned the Kyoto trip: 3 nights near Gion, a day trip to Nara, and the Fushimi Inari hike early in the morning.",
+    "\\u304a\\u306f\\u3088\\u3046\\u3054\\u3056\\u3044\\u307e\\u3059\\u3001\\u304a\\u5143\\u6c17\\u3067\\u3059\\u304b\\uff1f (Ohayou gozaimasu, ogenki desu ka?)",
+    "Daily briefing scheduled for 08:00 every day. I'll include weather, calendar and top news.",
+};
+
+static const char *const s_note[] = {
+    "- User prefers metric units and 24h time",
+    "- Planned Kyoto trip for April, staying near Gion",
+    "- Reminder set: call mom (18:00)",
+    "- Asked about ESP32-S3 specs; interested in PSRAM options",
+    "- Shopping list: milk, eggs, coffee beans",
+    "- Daily briefing cron job created for 08:00",
+};
+
+static const char *const s_words[] = {
+    "the", "a", "and", "to", "of", "in", "is", "you", "that", "it", "for", "on", "with", "as",
+    "was", "at", "be", "this", "have", "from", "or", "by", "not", "but", "what", "all", "were",
+    "when", "we", "there", "can", "an", "your", "which", "their", "said", "if", "will", "each",
+    "about", "how", "up", "out", "them", "then", "she", "many", "some", "so", "these", "would",
+    "other", "into", "has", "more", "her", "two", "like", "him", "see", "time", "could", "no",
+    "make", "than", "first", "been", "its", "who", "now", "people", "my", "made", "over", "did",
+    "down", "only", "way", "find", "use", "may", "water", "long", "little", "very", "after",
+    "words", "called", "just", "where", "most", "know", "weather", "meeting", "tomorrow",
+    "reminder", "train", "station", "coffee", "project", "deadline", "weekend", "dinner",
+    "flight", "hotel", "budget", "email", "battery", "sensor", "firmware", "update", "schedule",
+    "Kyoto", "Tokyo", "Monday", "Friday", "morning", "evening", "minutes", "temperature",
+};
+
+/* Random prose so the corpus is not just a few repeated lines */
+static size_t gen_prose(char *out, unsigned *r, int words)
+{
+    size_t off = 0;
+    for (int w = 0; w < words; w++) {
+        *r = *r * 1103515245 + 12345;
+        const char *word = s_words[(*r >> 16) % (sizeof(s_words) / sizeof(s_words[0]))];
+        off += sprintf(out + off, "%s%s", w ? " " : "", word);
+        if ((*r >> 8) % 11 == 0) off += sprintf(out + off, "%s", (*r >> 4) % 2 ? "," : ".");
+    }
+    return off;
+}
+
+static char *gen_session(size_t target, size_t *len)
+{
+    char *buf = malloc(target + 4096);
+    char prose[2048];
+    size_t off = 0;
+    long ts = 1767225600;
+    unsigned r = 12345;
+    while (off < target) {
+        r = r * 1103515245 + 12345;
+        int i = (r >> 16) % 8;
+        ts += 30 + (r >> 8) % 600;
+        if ((r >> 12) % 2) {
+            off += sprintf(buf + off, "{\"role\":\"user\",\"content\":\"%s\",\"ts\":%ld}\n", s_user[i], ts);
+        } else {
+            gen_prose(prose, &r, 6 + (r >> 20) % 14);
+            off += sprintf(buf + off, "{\"role\":\"user\",\"content\":\"%s?\",\"ts\":%ld}\n", prose, ts);
+        }
+        ts += 3 + (r >> 4) % 20;
+        size_t p = sprintf(prose, "%s ", s_asst[(i + (r >> 20) % 3) % 8]);
+        gen_prose(prose + p, &r, 10 + (r >> 18) % 60);
+        off += sprintf(buf + off, "{\"role\":\"assistant\",\"content\":\"%s\",\"ts\":%ld}\n", prose, ts);
+    }
+    *len = off;
+    return buf;
+}
+
+static char *gen_note(size_t target, size_t *len)
+{
+    char *buf = malloc(target + 1024);
+    size_t off = sprintf(buf, "# 2026-01-15\n\n");
+    unsigned r = 777;
+    while (off < target) {
+        r = r * 1103515245 + 12345;
+        if ((r >> 8) % 3) {
+            off += sprintf(buf + off, "%s\n", s_note[(r >> 16) % 6]);
+        } else {
+            off += sprintf(buf + off, "- ");
+            off += gen_prose(buf + off, &r, 8 + (r >> 20) % 16);
+            off += sprintf(buf + off, "\n");
+        }
+    }
+    *len = off;
+    return buf;
+}
+
+static char *load_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(n > 0 ? n : 1);
+    *len = fread(buf, 1, n, f);
+    fclose(f);
+    return buf;
+}
+
+/* ── Benchmark ────────────────────────────────────────────────── */
+
+static int bench(const char *name, const char *data, size_t len)
+{
+    static uint8_t work[LZ_WORK_SIZE];
+    size_t nblocks = (len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint8_t *comp = malloc(nblocks * LZ_BOUND(BLOCK_SIZE));
+    size_t *clen = calloc(nblocks, sizeof(size_t));
+    uint8_t *out = malloc(BLOCK_SIZE);
+
+    size_t total = 0;
+    double t0 = now_s();
+    for (int r = 0; r < ROUNDS; r++) {
+        total = 0;
+        for (size_t b = 0; b < nblocks; b++) {
+            size_t n = len - b * BLOCK_SIZE < BLOCK_SIZE ? len - b * BLOCK_SIZE : BLOCK_SIZE;
+            clen[b] = lz_compress((const uint8_t *)data + b * BLOCK_SIZE, n,
+                                  comp + b * LZ_BOUND(BLOCK_SIZE), LZ_BOUND(BLOCK_SIZE), work);
+            total += clen[b];
+        }
+    }
+    double t_comp = (now_s() - t0) / ROUNDS;
+
+    t0 = now_s();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t b = 0; b < nblocks; b++) {
+            size_t n = len - b * BLOCK_SIZE < BLOCK_SIZE ? len - b * BLOCK_SIZE : BLOCK_SIZE;
+            int d = lz_decompress(comp + b * LZ_BOUND(BLOCK_SIZE), clen[b], out, BLOCK_SIZE);
+            if (d != (int)n || memcmp(out, data + b * BLOCK_SIZE, n) != 0) {
+                printf("%-24s ROUND-TRIP MISMATCH in block %zu\n", name, b);
+                return 1;
+            }
+        }
+    }
+    double t_dec = (now_s() - t0) / ROUNDS;
+
+    printf("%-24s %9zu %9zu %6.1f%% %8.1f %8.1f\n", name, len, total,
+           100.0 * total / (len ? len : 1), len / t_comp / 1e6, len / t_dec / 1e6);
+    free(comp);
+    free(clen);
+    free(out);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int rc = 0;
+    printf("%-24s %9s %9s %7s %8s %8s\n", "input", "bytes", "packed", "ratio", "comp MB/s", "dec MB/s");
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            size_t len;
+            char *data = load_file(argv[i], &len);
+            if (!data) {
+                fprintf(stderr, "cannot read %s\n", argv[i]);
+                return 1;
+            }
+            const char *base = strrchr(argv[i], '/');
+            rc |= bench(base ? base + 1 : argv[i], data, len);
+            free(data);
+        }
+        return rc;
+    }
+
+    static const size_t sizes[] = { 4 * 1024, 32 * 1024, 256 * 1024 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char name[32];
+        size_t len;
+        char *data = gen_session(sizes[i], &len);
+        snprintf(name, sizeof(name), "session %zuK", sizes[i] / 1024);
+        rc |= bench(name, data, len);
+        free(data);
+    }
+    size_t len;
+    char *note = gen_note(8 * 1024, &len);
+    rc |= bench("daily note 8K", note, len);
+    free(note);
+    return rc;
+}
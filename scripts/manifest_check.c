@@ -0,0 +1,250 @@
+/*
+ * Host check for manifest tools (main/tools/tool_manifest.c) with long names.
+ *
+ *   cc -g -D_GNU_SOURCE -Iscripts/host -Imain -I$IDF_PATH/components/json/cJSON \
+ *      -o /tmp/manifest_check scripts/manifest_check.c main/tools/tool_registry.c \
+ *      $IDF_PATH/components/json/cJSON/cJSON.c
+ *   /tmp/manifest_check      # exits non-zero if any check fails
+ *
+ * Writes endpoints.json and manifests with names of 10, 40 and
+ * MIMI_TOOL_NAME_MAX characters into a temporary directory standing in for
+ * /spiffs, loads them with tool_manifest_reload(), and calls each tool the way
+ * the agent does: by the name copied into llm_tool_call_t from the model's
+ * tool_use block. Every one must reach its endpoint (a fake HTTP client), and
+ * a name one character over the limit must be rejected at load time rather
+ * than registered and then reported as an unknown tool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "mimi_config.h"
+
+/* Manifests are read from a temporary directory instead of /spiffs */
+static char s_root[64];
+
+static FILE *sim_fopen(const char *path, const char *mode)
+{
+    char real[256];
+    if (strncmp(path, MIMI_SPIFFS_BASE, strlen(MIMI_SPIFFS_BASE)) == 0) {
+        snprintf(real, sizeof(real), "%s%s", s_root, path + strlen(MIMI_SPIFFS_BASE));
+        path = real;
+    }
+    return fopen(path, mode);
+}
+
+#define fopen sim_fopen
+#include "tools/tool_manifest.c"
+#undef fopen
+
+#include "llm/llm_proxy.h"
+
+/* ── Stubs for the rest of the firmware ───────────────────────── */
+
+#define STUB_TOOL(fn)                                                   \
+    esp_err_t fn(const char *input_json, char *output, size_t size)     \
+    {                                                                   \
+        snprintf(output, size, "ok");                                   \
+        return ESP_OK;                                                  \
+    }
+
+STUB_TOOL(tool_web_search_execute)
+STUB_TOOL(tool_web_fetch_execute)
+STUB_TOOL(tool_get_time_execute)
+STUB_TOOL(tool_read_file_execute)
+STUB_TOOL(tool_write_file_execute)
+STUB_TOOL(tool_edit_file_execute)
+STUB_TOOL(tool_list_dir_execute)
+STUB_TOOL(tool_cron_add_execute)
+STUB_TOOL(tool_cron_list_execute)
+STUB_TOOL(tool_cron_remove_execute)
+STUB_TOOL(tool_memory_get_execute)
+STUB_TOOL(tool_memory_upsert_execute)
+STUB_TOOL(tool_memory_delete_execute)
+STUB_TOOL(tool_memory_search_execute)
+
+esp_err_t tool_web_search_init(void) { return ESP_OK; }
+void tool_files_init(void) { }
+size_t skill_loader_read_matching(const char *text, char *buf, size_t size) { return 0; }
+
+/* The manifests written below, as the catalog would list them */
+#define SIM_FILES_MAX 8
+static char s_files[SIM_FILES_MAX][MIMI_CATALOG_PATH_LEN];
+static int s_file_count = 0;
+
+int fs_catalog_query(const char *prefix, int skip, fs_entry_t *out, int max)
+{
+    int n = 0;
+    for (int i = 0; i < s_file_count; i++) {
+        if (strncmp(s_files[i], prefix, strlen(prefix)) != 0) continue;
+        if (skip > 0) {
+            skip--;
+            continue;
+        }
+        if (n == max) break;
+        memset(&out[n], 0, sizeof(out[n]));
+        strcpy(out[n].path, s_files[i]);
+        n++;
+    }
+    return n;
+}
+
+/* ── Fake HTTP client: answers 200 with the URL it was asked for ─ */
+
+struct esp_http_client {
+    char body[MIMI_TOOL_HTTP_URL_MAX + 8];
+    size_t off;
+};
+
+static char s_last_url[MIMI_TOOL_HTTP_URL_MAX];
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    struct esp_http_client *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    snprintf(s_last_url, sizeof(s_last_url), "%s", config->url);
+    snprintf(c->body, sizeof(c->body), "got %s", config->url);
+    return c;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t c, const char *k, const char *v) { return ESP_OK; }
+esp_err_t esp_http_client_open(esp_http_client_handle_t c, int write_len) { return ESP_OK; }
+int esp_http_client_write(esp_http_client_handle_t c, const char *buf, int len) { return len; }
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t c) { return (int64_t)strlen(c->body); }
+int esp_http_client_get_status_code(esp_http_client_handle_t c) { return 200; }
+
+int esp_http_client_read(esp_http_client_handle_t c, char *buf, int len)
+{
+    size_t left = strlen(c->body) - c->off;
+    size_t n = left < (size_t)len ? left : (size_t)len;
+    memcpy(buf, c->body + c->off, n);
+    c->off += n;
+    return (int)n;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t c)
+{
+    free(c);
+    return ESP_OK;
+}
+
+/* ── Checks ───────────────────────────────────────────────────── */
+
+static int s_failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+    if (!(cond)) {                                              \
+        fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+        fprintf(stderr, __VA_ARGS__);                           \
+        fprintf(stderr, "\n");                                  \
+        s_failures++;                                           \
+    }                                                           \
+} while (0)
+
+static void write_file(const char *spiffs_path, const char *content)
+{
+    char real[256];
+    snprintf(real, sizeof(real), "%s%s", s_root, spiffs_path + strlen(MIMI_SPIFFS_BASE));
+    FILE *f = fopen(real, "w");
+    if (!f || fputs(content, f) < 0) {
+        fprintf(stderr, "cannot write %s\n", real);
+        exit(1);
+    }
+    fclose(f);
+    if (s_file_count < SIM_FILES_MAX) strcpy(s_files[s_file_count++], spiffs_path);
+}
+
+static void write_manifest(const char *name)
+{
+    char path[MIMI_CATALOG_PATH_LEN], json[512];
+    snprintf(path, sizeof(path), MIMI_TOOL_MANIFEST_PREFIX "t%d.json", s_file_count);
+    snprintf(json, sizeof(json),
+             "{\"name\": \"%s\", \"description\": \"Test tool %d.\", \"group\": \"core\","
+             " \"input_schema\": {\"type\": \"object\", \"properties\": {\"id\": {\"type\": \"string\"}}},"
+             " \"http\": {\"endpoint\": \"home\", \"path\": \"/t/{id}\"}}",
+             name, (int)strlen(name));
+    write_file(path, json);
+}
+
+/* Call a tool as the agent does: name as parsed into llm_tool_call_t */
+static void call_as_model(const char *name, const char *id)
+{
+    llm_tool_call_t call = {0};
+    strncpy(call.name, name, sizeof(call.name) - 1);   /* what llm_proxy.c does */
+
+    char input[64], output[512], want[128];
+    snprintf(input, sizeof(input), "{\"id\": \"%s\"}", id);
+    s_last_url[0] = '\0';
+    esp_err_t err = tool_registry_execute(call.name, input, output, sizeof(output));
+    snprintf(want, sizeof(want), "http://127.0.0.1:8080/t/%s", id);
+    CHECK(err == ESP_OK, "%zu-char tool: %s (%s)", strlen(name), esp_err_to_name(err), output);
+    CHECK(strcmp(s_last_url, want) == 0, "%zu-char tool called \"%s\"", strlen(name), s_last_url);
+}
+
+int main(void)
+{
+    strcpy(s_root, "/tmp/manifest_checkXXXXXX");
+    if (!mkdtemp(s_root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char dir[128];
+    snprintf(dir, sizeof(dir), "%s/tools", s_root);
+    mkdir(dir, 0700);
+
+    char longest[MIMI_TOOL_NAME_MAX + 2], too_long[MIMI_TOOL_NAME_MAX + 2];
+    memset(longest, 'x', MIMI_TOOL_NAME_MAX);
+    longest[MIMI_TOOL_NAME_MAX] = '\0';
+    memset(too_long, 'y', MIMI_TOOL_NAME_MAX + 1);
+    too_long[MIMI_TOOL_NAME_MAX + 1] = '\0';
+    const char *mid = "home_assistant_living_room_lights_set_v2";   /* 40 chars */
+
+    write_file(MIMI_TOOL_ENDPOINTS_FILE, "{\"home\": \"http://127.0.0.1:8080\"}");
+    write_manifest("lamp_on_10");
+    write_manifest(mid);
+    write_manifest(longest);
+    write_manifest(too_long);
+
+    if (tool_registry_init() != ESP_OK) {
+        fprintf(stderr, "tool_registry_init failed\n");
+        return 1;
+    }
+    int loaded = tool_manifest_reload();
+    CHECK(loaded == 3, "%d manifests loaded, expected 3 (the over-long name must be refused)", loaded);
+
+    const char *json = tool_registry_get_tools_json();
+    CHECK(json && strstr(json, longest), "%d-char tool missing from the tools JSON", MIMI_TOOL_NAME_MAX);
+    CHECK(json && !strstr(json, too_long), "over-long tool was advertised");
+
+    call_as_model("lamp_on_10", "a1");
+    call_as_model(mid, "b2");
+    call_as_model(longest, "c3");
+
+    /* Registering an over-long name directly fails instead of breaking later */
+    mimi_tool_t bad = {
+        .name = too_long,
+        .description = "Too long.",
+        .input_schema_json = "{\"type\":\"object\",\"properties\":{}}",
+        .execute = tool_get_time_execute,
+        .group = TOOL_GROUP_CORE,
+    };
+    CHECK(tool_registry_register(&bad) == ESP_ERR_INVALID_ARG, "over-long name registered");
+
+    for (int i = 0; i < s_file_count; i++) {
+        char real[256];
+        snprintf(real, sizeof(real), "%s%s", s_root, s_files[i] + strlen(MIMI_SPIFFS_BASE));
+        unlink(real);
+    }
+    rmdir(dir);
+    rmdir(s_root);
+
+    if (s_failures) {
+        fprintf(stderr, "%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("manifest names up to %d chars load and are callable\n", MIMI_TOOL_NAME_MAX);
+    return 0;
+}
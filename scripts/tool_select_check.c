@@ -0,0 +1,198 @@
+/*
+ * Host check for per-turn tool selection (main/tools/tool_registry.c).
+ *
+ *   cc -g -D_GNU_SOURCE -Iscripts/host -Imain -I$IDF_PATH/components/json/cJSON \
+ *      -o /tmp/tool_select_check scripts/tool_select_check.c \
+ *      $IDF_PATH/components/json/cJSON/cJSON.c
+ *   /tmp/tool_select_check   # exits non-zero if any check fails
+ *
+ * Registers the built-in tools (their handlers are stubs) and runs
+ * tool_registry_select() over messages that should and should not pull in
+ * the web and cron groups, and tool_registry_missing_groups() over replies
+ * that should and should not trigger the agent's one widened retry. The
+ * false-positive lists are ordinary chat; each of them would otherwise cost
+ * a second LLM call or extra schema bytes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tools/tool_registry.c"
+
+/* ── Stubs for the rest of the firmware ───────────────────────── */
+
+#define STUB_TOOL(fn)                                                   \
+    esp_err_t fn(const char *input_json, char *output, size_t size)     \
+    {                                                                   \
+        snprintf(output, size, "ok");                                   \
+        return ESP_OK;                                                  \
+    }
+
+STUB_TOOL(tool_web_search_execute)
+STUB_TOOL(tool_web_fetch_execute)
+STUB_TOOL(tool_get_time_execute)
+STUB_TOOL(tool_read_file_execute)
+STUB_TOOL(tool_write_file_execute)
+STUB_TOOL(tool_edit_file_execute)
+STUB_TOOL(tool_list_dir_execute)
+STUB_TOOL(tool_cron_add_execute)
+STUB_TOOL(tool_cron_list_execute)
+STUB_TOOL(tool_cron_remove_execute)
+STUB_TOOL(tool_memory_get_execute)
+STUB_TOOL(tool_memory_upsert_execute)
+STUB_TOOL(tool_memory_delete_execute)
+STUB_TOOL(tool_memory_search_execute)
+
+esp_err_t tool_web_search_init(void) { return ESP_OK; }
+void tool_files_init(void) { }
+size_t skill_loader_read_matching(const char *text, char *buf, size_t size) { return 0; }
+
+/* ── Checks ───────────────────────────────────────────────────── */
+
+static int s_failures = 0;
+static int s_checks = 0;
+
+static uint32_t select_for(const char *text)
+{
+    mimi_msg_t msg = {0};
+    strcpy(msg.channel, MIMI_CHAN_TELEGRAM);
+    strcpy(msg.chat_id, "1");
+    msg.content = (char *)text;
+    return tool_registry_select(&msg, NULL);
+}
+
+static void expect_select(const char *text, uint32_t group, bool want)
+{
+    bool got = (select_for(text) & group) != 0;
+    s_checks++;
+    if (got != want) {
+        fprintf(stderr, "FAIL select %s group 0x%02x for \"%s\"\n",
+                want ? "missed" : "added", (unsigned)group, text);
+        s_failures++;
+    }
+}
+
+static void expect_missing(const char *reply, uint32_t groups, uint32_t want)
+{
+    uint32_t got = tool_registry_missing_groups(reply, groups);
+    s_checks++;
+    if (got != want) {
+        fprintf(stderr, "FAIL missing 0x%02x (want 0x%02x) for \"%s\"\n",
+                (unsigned)got, (unsigned)want, reply);
+        s_failures++;
+    }
+}
+
+#define BASE  (TOOL_GROUP_CORE | TOOL_GROUP_FILES | TOOL_GROUP_MEMORY)
+
+int main(void)
+{
+    if (tool_registry_init() != ESP_OK) {
+        fprintf(stderr, "tool_registry_init failed\n");
+        return 1;
+    }
+
+    /* Messages that need the web group */
+    static const char *const web_yes[] = {
+        "What's the weather in Tokyo?",
+        "Search for ESP32-S3 benchmarks",
+        "any news about the election?",
+        "Bitcoin price please",
+        "summarize https://example.com/post",
+        "Stocks are down, why?",
+        "今天的天气怎么样",
+        NULL
+    };
+    /* Everyday words that used to contain a web keyword */
+    static const char *const web_no[] = {
+        "Thanks, that was a great answer",
+        "I'm currently at home, what should I cook?",
+        "I recently moved, help me write a note to my landlord",
+        "Today I feel tired",
+        "Our link between the two services is solid",
+        "There's a cobweb in the corner of my room",
+        "Sign me up for the newsletter idea we discussed",
+        "My score in the exam was 90",
+        "Who is your favourite poet among the ones you know?",
+        "I'm online now",
+        NULL
+    };
+    /* Messages that need the cron group */
+    static const char *const cron_yes[] = {
+        "Remind me to call mom at 6pm",
+        "Set up a reminder for the dentist",
+        "schedule a daily briefing at 8",
+        "every morning tell me a joke",
+        "每天提醒我喝水",
+        NULL
+    };
+    static const char *const cron_no[] = {
+        "Good morning!",
+        "Good job, thanks",
+        "Talk to you later",
+        "I'll see my friend tomorrow, any gift ideas?",
+        "Every one of my plants is dying",
+        "This evening was lovely",
+        NULL
+    };
+
+    for (int i = 0; web_yes[i]; i++) expect_select(web_yes[i], TOOL_GROUP_WEB, true);
+    for (int i = 0; web_no[i]; i++) expect_select(web_no[i], TOOL_GROUP_WEB, false);
+    for (int i = 0; cron_yes[i]; i++) expect_select(cron_yes[i], TOOL_GROUP_CRON, true);
+    for (int i = 0; cron_no[i]; i++) expect_select(cron_no[i], TOOL_GROUP_CRON, false);
+
+    /* A manifest tool's own hints are whole words too */
+    mimi_tool_t lamp = {
+        .name = "lamp_set",
+        .description = "Turn the desk lamp on or off.",
+        .input_schema_json = "{\"type\":\"object\",\"properties\":{}}",
+        .execute = tool_get_time_execute,
+        .group = TOOL_GROUP_WEB,
+        .hints = "lamp,light",
+    };
+    if (tool_registry_register(&lamp) != ESP_OK) {
+        fprintf(stderr, "FAIL register lamp_set\n");
+        s_failures++;
+    }
+    expect_select("turn on the light", TOOL_GROUP_WEB, true);
+    expect_select("lamps off please", TOOL_GROUP_WEB, true);
+    expect_select("that was a lightweight answer", TOOL_GROUP_WEB, false);
+    expect_select("I need a clamp for the shelf", TOOL_GROUP_WEB, false);
+
+    /* Replies that decline for want of a missing group: retry with it */
+    expect_missing("Sorry, I don't have access to real-time weather data.", BASE, TOOL_GROUP_WEB);
+    expect_missing("I can’t browse the internet, but Tokyo is usually mild in May.", BASE, TOOL_GROUP_WEB);
+    expect_missing("I'm unable to set reminders from here.", BASE, TOOL_GROUP_CRON);
+    expect_missing("I cannot look up live data or schedule alarms.", BASE,
+                   TOOL_GROUP_WEB | TOOL_GROUP_CRON);
+    expect_missing("抱歉，我无法获取实时信息。", BASE, TOOL_GROUP_WEB);
+
+    /* The group was offered: the model had the tool and chose not to use it */
+    expect_missing("Sorry, I don't have access to real-time weather data.",
+                   BASE | TOOL_GROUP_WEB, 0);
+    expect_missing("I'm unable to set reminders from here.", BASE | TOOL_GROUP_CRON, 0);
+
+    /* Ordinary replies: a refusal, or a tool word, but not both in one sentence */
+    static const char *const reply_no[] = {
+        "I can't tell you how happy that makes me!",
+        "I don't know the answer to that riddle, but here's a guess: a shadow.",
+        "Unable to decide? Pick the blue one.",
+        "The ESP32 has a real-time clock and Wi-Fi built in.",
+        "The internet was invented long before smartphones. I don't think you need one.",
+        "Your schedule looks busy. I cannot wait to hear how it goes.",
+        "I'm not able to feel emotions the way people do.",
+        "That's up to date as far as I know.",
+        "你没有说要去哪里。",
+        NULL
+    };
+    for (int i = 0; reply_no[i]; i++) expect_missing(reply_no[i], BASE, 0);
+    expect_missing("", BASE, 0);
+
+    if (s_failures) {
+        fprintf(stderr, "%d of %d checks failed\n", s_failures, s_checks);
+        return 1;
+    }
+    printf("%d checks passed\n", s_checks);
+    return 0;
+}